@@ -0,0 +1,365 @@
+#include <benchmark/benchmark.h>
+#include <cstdint>
+#include <vector>
+#include <zasm/testdata/x86/instructions.hpp>
+#include <zasm/zasm.hpp>
+
+namespace zasm::benchmarks
+{
+    static constexpr std::uint64_t kDecodeBaseAddress = 0x00400000;
+
+    // Repeats the encoded test instructions until the buffer has at least the requested size.
+    static std::vector<std::uint8_t> getDecodeInput(std::size_t size)
+    {
+        Program program(MachineMode::AMD64);
+        x86::Assembler assembler(program);
+        for (const auto& instrData : tests::data::Instructions)
+        {
+            instrData.emitter(assembler);
+        }
+
+        Serializer serializer;
+        serializer.serialize(program, kDecodeBaseAddress);
+
+        std::vector<std::uint8_t> code;
+        code.reserve(size + serializer.getCodeSize());
+        while (code.size() < size)
+        {
+            code.insert(code.end(), serializer.getCode(), serializer.getCode() + serializer.getCodeSize());
+        }
+
+        return code;
+    }
+
+    static void setDecodeCounters(benchmark::State& state, std::size_t bytes, std::size_t count)
+    {
+        state.counters["Bytes"] = benchmark::Counter(
+            static_cast<double>(bytes), benchmark::Counter::kIsIterationInvariantRate, benchmark::Counter::OneK::kIs1024);
+        state.counters["Instructions"] = benchmark::Counter(
+            static_cast<double>(count), benchmark::Counter::kIsIterationInvariantRate, benchmark::Counter::OneK::kIs1000);
+    }
+
+    static void BM_DecodeAssembler(benchmark::State& state)
+    {
+        const auto code = getDecodeInput(static_cast<std::size_t>(state.range(0)) * 1024 * 1024);
+
+        Program program(MachineMode::AMD64);
+
+        for (auto _ : state)
+        {
+            state.PauseTiming();
+            program.clear();
+            state.ResumeTiming();
+
+            Decoder decoder(program.getMode());
+            x86::Assembler assembler(program);
+
+            std::size_t offset = 0;
+            while (offset < code.size())
+            {
+                const auto decoderRes = decoder.decode(code.data() + offset, code.size() - offset, kDecodeBaseAddress + offset);
+                if (!decoderRes)
+                {
+                    state.SkipWithError("Failed to decode");
+                    return;
+                }
+
+                assembler.emit(decoderRes->getInstruction());
+                offset += decoderRes->getLength();
+            }
+        }
+
+        setDecodeCounters(state, code.size(), program.size());
+    }
+    BENCHMARK(BM_DecodeAssembler)->Arg(1)->Arg(4)->Arg(16)->Unit(benchmark::kMillisecond);
+
+    static void BM_DecodeProgram(benchmark::State& state)
+    {
+        const auto code = getDecodeInput(static_cast<std::size_t>(state.range(0)) * 1024 * 1024);
+
+        Program program(MachineMode::AMD64);
+
+        for (auto _ : state)
+        {
+            state.PauseTiming();
+            program.clear();
+            state.ResumeTiming();
+
+            if (decodeProgram(program, code.data(), code.size(), kDecodeBaseAddress) != ErrorCode::None)
+            {
+                state.SkipWithError("Failed to decode");
+                return;
+            }
+        }
+
+        setDecodeCounters(state, code.size(), program.size());
+    }
+    BENCHMARK(BM_DecodeProgram)->Arg(1)->Arg(4)->Arg(16)->Unit(benchmark::kMillisecond);
+
+    static void BM_DecodeProgramLabels(benchmark::State& state)
+    {
+        const auto code = getDecodeInput(static_cast<std::size_t>(state.range(0)) * 1024 * 1024);
+
+        Program program(MachineMode::AMD64);
+
+        for (auto _ : state)
+        {
+            state.PauseTiming();
+            program.clear();
+            state.ResumeTiming();
+
+            if (decodeProgram(program, code.data(), code.size(), kDecodeBaseAddress, DecodeProgramFlags::CreateLabels)
+                != ErrorCode::None)
+            {
+                state.SkipWithError("Failed to decode");
+                return;
+            }
+        }
+
+        setDecodeCounters(state, code.size(), program.size());
+    }
+    BENCHMARK(BM_DecodeProgramLabels)->Arg(1)->Arg(4)->Arg(16)->Unit(benchmark::kMillisecond);
+
+    static void BM_DecodeDecoder(benchmark::State& state)
+    {
+        const auto code = getDecodeInput(static_cast<std::size_t>(state.range(0)) * 1024 * 1024);
+
+        std::size_t count = 0;
+        for (auto _ : state)
+        {
+            Decoder decoder(MachineMode::AMD64);
+
+            count = 0;
+            std::size_t offset = 0;
+            while (offset < code.size())
+            {
+                const auto decoderRes = decoder.decode(code.data() + offset, code.size() - offset, kDecodeBaseAddress + offset);
+                if (!decoderRes)
+                {
+                    state.SkipWithError("Failed to decode");
+                    return;
+                }
+
+                offset += decoderRes->getLength();
+                count++;
+            }
+        }
+
+        setDecodeCounters(state, code.size(), count);
+    }
+    BENCHMARK(BM_DecodeDecoder)->Arg(16)->Unit(benchmark::kMillisecond);
+
+    // Decodes the input in batches of 64K entries, the benchmark argument selects the columns.
+    static void BM_DecodeColumns(benchmark::State& state)
+    {
+        const auto code = getDecodeInput(16 * 1024 * 1024);
+
+        constexpr std::size_t kCapacity = 64 * 1024;
+        std::vector<std::uint64_t> offsets(kCapacity);
+        std::vector<Instruction::Length> lengths(kCapacity);
+        std::vector<Instruction::Mnemonic> mnemonics(kCapacity);
+        std::vector<Instruction::Category> categories(kCapacity);
+        std::vector<Instruction::Attribs> attribs(kCapacity);
+        std::vector<std::uint16_t> operandKinds(kCapacity);
+
+        DecoderColumns columns;
+        columns.capacity = kCapacity;
+        columns.lengths = lengths.data();
+
+        auto flags = DecodeColumnsFlags::None;
+        switch (state.range(0))
+        {
+            case 0:
+                // Lengths only.
+                flags = DecodeColumnsFlags::Minimal;
+                break;
+            case 1:
+                flags = DecodeColumnsFlags::Minimal;
+                columns.offsets = offsets.data();
+                columns.mnemonics = mnemonics.data();
+                break;
+            case 2:
+                columns.offsets = offsets.data();
+                columns.mnemonics = mnemonics.data();
+                columns.categories = categories.data();
+                columns.attribs = attribs.data();
+                break;
+            default:
+                columns.offsets = offsets.data();
+                columns.mnemonics = mnemonics.data();
+                columns.categories = categories.data();
+                columns.attribs = attribs.data();
+                columns.operandKinds = operandKinds.data();
+                break;
+        }
+
+        std::size_t count = 0;
+        for (auto _ : state)
+        {
+            count = 0;
+            std::size_t offset = 0;
+            while (offset < code.size())
+            {
+                if (decodeColumns(columns, MachineMode::AMD64, code.data() + offset, code.size() - offset, flags)
+                    != ErrorCode::None)
+                {
+                    state.SkipWithError("Failed to decode");
+                    return;
+                }
+
+                offset += columns.bytesDecoded;
+                count += columns.count;
+            }
+            benchmark::DoNotOptimize(lengths.data());
+        }
+
+        setDecodeCounters(state, code.size(), count);
+    }
+    BENCHMARK(BM_DecodeColumns)
+        ->ArgName("Columns")
+        ->Arg(0)
+        ->Arg(1)
+        ->Arg(2)
+        ->Arg(3)
+        ->Unit(benchmark::kMillisecond);
+
+    // Fills all columns for the whole input at once, the benchmark argument is the thread count.
+    static void BM_DecodeColumnsParallel(benchmark::State& state)
+    {
+        const auto code = getDecodeInput(16 * 1024 * 1024);
+        const auto threadCount = static_cast<std::size_t>(state.range(0));
+
+        std::vector<std::uint64_t> offsets(code.size());
+        std::vector<Instruction::Length> lengths(code.size());
+        std::vector<Instruction::Mnemonic> mnemonics(code.size());
+        std::vector<Instruction::Category> categories(code.size());
+        std::vector<Instruction::Attribs> attribs(code.size());
+
+        DecoderColumns columns;
+        columns.capacity = code.size();
+        columns.offsets = offsets.data();
+        columns.lengths = lengths.data();
+        columns.mnemonics = mnemonics.data();
+        columns.categories = categories.data();
+        columns.attribs = attribs.data();
+
+        for (auto _ : state)
+        {
+            if (decodeColumnsParallel(columns, MachineMode::AMD64, code.data(), code.size(), threadCount)
+                != ErrorCode::None)
+            {
+                state.SkipWithError("Failed to decode");
+                return;
+            }
+            benchmark::DoNotOptimize(lengths.data());
+        }
+
+        setDecodeCounters(state, code.size(), columns.count);
+    }
+    BENCHMARK(BM_DecodeColumnsParallel)->RangeMultiplier(2)->Range(1, 8)->UseRealTime()->Unit(benchmark::kMillisecond);
+
+    static void BM_DecodeProgramParallel(benchmark::State& state)
+    {
+        const auto code = getDecodeInput(16 * 1024 * 1024);
+        const auto threadCount = static_cast<std::size_t>(state.range(0));
+
+        Program program(MachineMode::AMD64);
+
+        for (auto _ : state)
+        {
+            state.PauseTiming();
+            program.clear();
+            state.ResumeTiming();
+
+            if (decodeProgramParallel(
+                    program, code.data(), code.size(), kDecodeBaseAddress, threadCount, DecodeProgramFlags::CreateLabels)
+                != ErrorCode::None)
+            {
+                state.SkipWithError("Failed to decode");
+                return;
+            }
+        }
+
+        setDecodeCounters(state, code.size(), program.size());
+    }
+    BENCHMARK(BM_DecodeProgramParallel)->RangeMultiplier(2)->Range(1, 8)->UseRealTime()->Unit(benchmark::kMillisecond);
+
+    // Functions with a loop, a conditional call and data behind the ret, the entries receive the address of
+    // every function.
+    static std::vector<std::uint8_t> getCfgInput(std::size_t functionCount, std::vector<std::uint64_t>& entries)
+    {
+        Program program(MachineMode::AMD64);
+        x86::Assembler assembler(program);
+
+        std::vector<Label> functions;
+        functions.reserve(functionCount);
+        for (std::size_t i = 0; i < functionCount; ++i)
+        {
+            functions.push_back(assembler.createLabel());
+        }
+
+        for (std::size_t i = 0; i < functionCount; ++i)
+        {
+            auto loop = assembler.createLabel();
+            auto skip = assembler.createLabel();
+
+            assembler.bind(functions[i]);
+            assembler.push(x86::rbx);
+            assembler.mov(x86::ebx, x86::ecx);
+            assembler.xor_(x86::eax, x86::eax);
+            assembler.bind(loop);
+            assembler.add(x86::eax, x86::ebx);
+            assembler.and_(x86::eax, Imm(0x7FFF));
+            assembler.sub(x86::ebx, Imm(1));
+            assembler.jnz(loop);
+            assembler.test(x86::eax, x86::eax);
+            assembler.js(skip);
+            assembler.call(functions[(i * 7 + 1) % functionCount]);
+            assembler.bind(skip);
+            assembler.pop(x86::rbx);
+            assembler.ret();
+            assembler.dq(0xCCCCCCCCFFFFFFFF, 2);
+        }
+
+        Serializer serializer;
+        serializer.serialize(program, kDecodeBaseAddress);
+
+        entries.clear();
+        for (const auto& function : functions)
+        {
+            entries.push_back(static_cast<std::uint64_t>(serializer.getLabelAddress(function.getId())));
+        }
+
+        return std::vector<std::uint8_t>(serializer.getCode(), serializer.getCode() + serializer.getCodeSize());
+    }
+
+    // Decodes 256K functions from their entries, the benchmark argument is the thread count.
+    static void BM_DecodeCfg(benchmark::State& state)
+    {
+        std::vector<std::uint64_t> entries;
+        const auto code = getCfgInput(256 * 1024, entries);
+        const auto threadCount = static_cast<std::size_t>(state.range(0));
+
+        Program program(MachineMode::AMD64);
+        std::vector<DecodedBlock> blocks;
+
+        for (auto _ : state)
+        {
+            state.PauseTiming();
+            program.clear();
+            state.ResumeTiming();
+
+            if (decodeCfg(program, blocks, code.data(), code.size(), kDecodeBaseAddress, entries, threadCount)
+                != ErrorCode::None)
+            {
+                state.SkipWithError("Failed to decode");
+                return;
+            }
+        }
+
+        setDecodeCounters(state, code.size(), program.size() - blocks.size());
+        state.counters["Blocks"] = static_cast<double>(blocks.size());
+    }
+    BENCHMARK(BM_DecodeCfg)->RangeMultiplier(2)->Range(1, 8)->UseRealTime()->Unit(benchmark::kMillisecond);
+
+} // namespace zasm::benchmarks
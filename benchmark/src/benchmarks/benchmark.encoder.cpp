@@ -0,0 +1,128 @@
+#include <benchmark/benchmark.h>
+#include <vector>
+#include <zasm/testdata/x86/instructions.hpp>
+#include <zasm/zasm.hpp>
+
+namespace zasm::benchmarks
+{
+    static std::vector<Instruction> getTestInstructions(Program& program)
+    {
+        x86::Assembler assembler(program);
+        for (const auto& instrData : tests::data::Instructions)
+        {
+            instrData.emitter(assembler);
+        }
+
+        std::vector<Instruction> instrs;
+        for (const auto* node = program.getHead(); node != nullptr; node = node->getNext())
+        {
+            if (const auto* instr = node->getIf<Instruction>(); instr != nullptr)
+            {
+                instrs.push_back(*instr);
+            }
+        }
+
+        return instrs;
+    }
+
+    static void setInstructionCounter(benchmark::State& state, std::size_t count)
+    {
+        state.counters["Instructions"] = benchmark::Counter(
+            static_cast<double>(count), benchmark::Counter::kIsIterationInvariantRate, benchmark::Counter::OneK::kIs1000);
+    }
+
+    static void BM_EncodeSession(benchmark::State& state)
+    {
+        Program program(MachineMode::AMD64);
+        const auto instrs = getTestInstructions(program);
+
+        EncoderSession session(MachineMode::AMD64);
+
+        for (auto _ : state)
+        {
+            for (const auto& instr : instrs)
+            {
+                auto res = session.encode(instr, 0x00400000);
+                benchmark::DoNotOptimize(res);
+            }
+        }
+
+        setInstructionCounter(state, instrs.size());
+    }
+    BENCHMARK(BM_EncodeSession)->Unit(benchmark::kMillisecond);
+
+    static void BM_EncodeStateless(benchmark::State& state)
+    {
+        Program program(MachineMode::AMD64);
+        const auto instrs = getTestInstructions(program);
+
+        for (auto _ : state)
+        {
+            for (const auto& instr : instrs)
+            {
+                const auto& ops = instr.getOperands();
+                auto res = encode(
+                    MachineMode::AMD64, instr.getAttribs(), instr.getMnemonic(), instr.getOperandCount(), ops.data());
+                benchmark::DoNotOptimize(res);
+            }
+        }
+
+        setInstructionCounter(state, instrs.size());
+    }
+    BENCHMARK(BM_EncodeStateless)->Unit(benchmark::kMillisecond);
+
+    static void BM_EncodeGetDetail(benchmark::State& state)
+    {
+        Program program(MachineMode::AMD64);
+        const auto instrs = getTestInstructions(program);
+
+        for (auto _ : state)
+        {
+            for (const auto& instr : instrs)
+            {
+                auto res = instr.getDetail(MachineMode::AMD64);
+                benchmark::DoNotOptimize(res);
+            }
+        }
+
+        setInstructionCounter(state, instrs.size());
+    }
+    BENCHMARK(BM_EncodeGetDetail)->Unit(benchmark::kMillisecond);
+
+    static void BM_EncodeSerializer(benchmark::State& state)
+    {
+        Program program(MachineMode::AMD64);
+        const auto instrs = getTestInstructions(program);
+
+        Serializer serializer;
+
+        for (auto _ : state)
+        {
+            serializer.serialize(program, 0x00400000);
+            benchmark::DoNotOptimize(serializer.getCode());
+        }
+
+        setInstructionCounter(state, instrs.size());
+    }
+    BENCHMARK(BM_EncodeSerializer)->Unit(benchmark::kMillisecond);
+
+    static void BM_EncodeSerializerCached(benchmark::State& state)
+    {
+        Program program(MachineMode::AMD64);
+        const auto instrs = getTestInstructions(program);
+
+        Serializer serializer;
+        EncoderCache cache;
+        serializer.setEncoderCache(&cache);
+
+        for (auto _ : state)
+        {
+            serializer.serialize(program, 0x00400000);
+            benchmark::DoNotOptimize(serializer.getCode());
+        }
+
+        setInstructionCounter(state, instrs.size());
+    }
+    BENCHMARK(BM_EncodeSerializerCached)->Unit(benchmark::kMillisecond);
+
+} // namespace zasm::benchmarks
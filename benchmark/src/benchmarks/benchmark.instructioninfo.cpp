@@ -29,6 +29,9 @@ namespace zasm::benchmarks
                 instrData.emitter(assembler);
 
                 const auto& instr = assembler.getCursor()->get<Instruction>();
+
+                // Measure the encode and decode round trip.
+                Instruction::clearDetailCache();
                 state.ResumeTiming();
 
                 const auto instrInfo = instr.getDetail(program.getMode());
@@ -43,4 +46,70 @@ namespace zasm::benchmarks
     }
     BENCHMARK(BM_InstructionInfo)->Unit(benchmark::kMillisecond);
 
+    static void BM_InstructionInfoCached(benchmark::State& state)
+    {
+        using namespace zasm::x86;
+
+        Program program(MachineMode::AMD64);
+        Assembler assembler(program);
+
+        for (const auto& instrData : tests::data::Instructions)
+        {
+            instrData.emitter(assembler);
+        }
+
+        Instruction::clearDetailCache();
+
+        size_t numInstructions = 0;
+
+        for (auto s : state)
+        {
+            for (const auto* node = program.getHead(); node != nullptr; node = node->getNext())
+            {
+                const auto instrInfo = node->get<Instruction>().getDetail(program.getMode());
+                benchmark::DoNotOptimize(instrInfo);
+            }
+
+            numInstructions += program.size();
+        }
+
+        const auto stats = Instruction::getDetailCacheStats();
+
+        state.counters["InstructionInfos"] = benchmark::Counter(
+            static_cast<double>(numInstructions), benchmark::Counter::kIsRate, benchmark::Counter::OneK::kIs1000);
+        state.counters["Hits"] = static_cast<double>(stats.hits);
+        state.counters["Misses"] = static_cast<double>(stats.misses);
+    }
+    BENCHMARK(BM_InstructionInfoCached)->Unit(benchmark::kMillisecond);
+
+    // Computes the details of 100K instructions, the benchmark argument is the thread count.
+    static void BM_InstructionDetailTable(benchmark::State& state)
+    {
+        Program program(MachineMode::AMD64);
+        x86::Assembler assembler(program);
+
+        for (size_t i = 0; i < 100'000; i++)
+        {
+            tests::data::Instructions[i % std::size(tests::data::Instructions)].emitter(assembler);
+        }
+
+        const auto threadCount = static_cast<std::size_t>(state.range(0));
+
+        for (auto s : state)
+        {
+            InstructionDetailTable table(program);
+            if (table.compute(threadCount) != ErrorCode::None)
+            {
+                state.SkipWithError("Failed to compute details");
+                return;
+            }
+            benchmark::DoNotOptimize(table.size());
+        }
+
+        state.counters["InstructionInfos"] = benchmark::Counter(
+            static_cast<double>(program.size()), benchmark::Counter::kIsIterationInvariantRate,
+            benchmark::Counter::OneK::kIs1000);
+    }
+    BENCHMARK(BM_InstructionDetailTable)->RangeMultiplier(2)->Range(1, 8)->UseRealTime()->Unit(benchmark::kMillisecond);
+
 } // namespace zasm::benchmarks
@@ -0,0 +1,377 @@
+#include <algorithm>
+#include <benchmark/benchmark.h>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <random>
+#include <vector>
+#include <zasm/testdata/x86/instructions.hpp>
+#include <zasm/zasm.hpp>
+
+#ifdef __linux__
+#    include <unistd.h>
+#endif
+
+namespace zasm::benchmarks
+{
+    // Amount of nodes used for the traversal benchmarks.
+    static constexpr std::size_t kTraverseNodeCount = 1'000'000;
+
+    static void buildLargeProgram(Program& program)
+    {
+        using namespace zasm::x86;
+
+        Assembler assembler(program);
+
+        const auto count = std::size(tests::data::Instructions);
+        for (std::size_t i = 0; i < kTraverseNodeCount; ++i)
+        {
+            // Every 128 nodes a label.
+            if (i % 128 == 0)
+            {
+                assembler.bind(assembler.createLabel());
+                continue;
+            }
+
+            const auto& instr = tests::data::Instructions[i % count];
+            instr.emitter(assembler);
+        }
+    }
+
+    static void BM_ProgramVisit(benchmark::State& state)
+    {
+        Program program(MachineMode::AMD64);
+        buildLargeProgram(program);
+
+        for (auto _ : state)
+        {
+            std::size_t numOperands = 0;
+            for (const auto* node = program.getHead(); node != nullptr; node = node->getNext())
+            {
+                numOperands += node->visit([](auto&& data) -> std::size_t {
+                    using T = std::decay_t<decltype(data)>;
+                    if constexpr (std::is_same_v<T, Instruction>)
+                    {
+                        return data.getOperandCount();
+                    }
+                    return 0;
+                });
+            }
+            benchmark::DoNotOptimize(numOperands);
+        }
+
+        state.counters["Nodes"] = benchmark::Counter(
+            static_cast<double>(program.size()), benchmark::Counter::kIsIterationInvariantRate,
+            benchmark::Counter::OneK::kIs1000);
+    }
+    BENCHMARK(BM_ProgramVisit)->Unit(benchmark::kMillisecond);
+
+    // Relinks the nodes in a random order, the order of the list no longer follows the order in which the nodes
+    // were allocated. This is what a program looks like after many edits.
+    static void shuffleProgram(Program& program)
+    {
+        std::vector<Node*> nodes;
+        nodes.reserve(program.size());
+        for (auto* node = program.getHead(); node != nullptr; node = node->getNext())
+        {
+            nodes.push_back(node);
+        }
+
+        std::shuffle(nodes.begin(), nodes.end(), std::mt19937{ 0x5A5A5A5A });
+        for (auto* node : nodes)
+        {
+            program.moveAfter(program.getTail(), node);
+        }
+    }
+
+    // Traverses the nodes in allocation order and after the list was shuffled, the argument selects the order. The
+    // links are indices into the node arena of the program. Use --benchmark_perf_counters=CACHE-MISSES to count
+    // the cache misses when the benchmark library is built with libpfm.
+    static void BM_ProgramTraverse(benchmark::State& state)
+    {
+        Program program(MachineMode::AMD64);
+        buildLargeProgram(program);
+        if (state.range(0) != 0)
+        {
+            shuffleProgram(program);
+        }
+
+        for (auto _ : state)
+        {
+            std::size_t numInstructions = 0;
+            for (const auto* node = program.getHead(); node != nullptr; node = node->getNext())
+            {
+                if (node->holds<Instruction>())
+                {
+                    numInstructions++;
+                }
+            }
+            benchmark::DoNotOptimize(numInstructions);
+        }
+
+        state.SetLabel(state.range(0) != 0 ? "shuffled" : "sequential");
+        state.counters["Nodes"] = benchmark::Counter(
+            static_cast<double>(program.size()), benchmark::Counter::kIsIterationInvariantRate,
+            benchmark::Counter::OneK::kIs1000);
+    }
+    BENCHMARK(BM_ProgramTraverse)->Arg(0)->Arg(1)->Unit(benchmark::kMillisecond);
+
+    static void BM_ProgramSerializeLarge(benchmark::State& state)
+    {
+        Program program(MachineMode::AMD64);
+        buildLargeProgram(program);
+        if (state.range(0) != 0)
+        {
+            shuffleProgram(program);
+        }
+
+        Serializer serializer;
+
+        for (auto _ : state)
+        {
+            serializer.serialize(program, 0x00400000);
+        }
+
+        state.SetLabel(state.range(0) != 0 ? "shuffled" : "sequential");
+        state.counters["Nodes"] = benchmark::Counter(
+            static_cast<double>(program.size()), benchmark::Counter::kIsIterationInvariantRate,
+            benchmark::Counter::OneK::kIs1000);
+    }
+    BENCHMARK(BM_ProgramSerializeLarge)->Arg(0)->Arg(1)->Unit(benchmark::kMillisecond);
+
+    // Amount of instructions emitted into each of the short lived programs.
+    static constexpr std::size_t kSmallProgramSize = 32;
+
+    static void emitSmallProgram(Program& program)
+    {
+        x86::Assembler assembler(program);
+        for (std::size_t i = 0; i < kSmallProgramSize; ++i)
+        {
+            tests::data::Instructions[i].emitter(assembler);
+        }
+    }
+
+    // Returns the resident memory of the process in bytes or 0 if not supported.
+    static std::size_t getResidentMemory()
+    {
+#ifdef __linux__
+        std::ifstream statm("/proc/self/statm");
+
+        std::size_t totalPages{};
+        std::size_t residentPages{};
+        if (statm >> totalPages >> residentPages)
+        {
+            return residentPages * static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+        }
+#endif
+        return 0;
+    }
+
+    static void BM_ProgramConstruct(benchmark::State& state)
+    {
+        for (auto _ : state)
+        {
+            Program program(MachineMode::AMD64);
+            benchmark::DoNotOptimize(program);
+        }
+    }
+    BENCHMARK(BM_ProgramConstruct);
+
+    static void BM_ProgramConstructSmall(benchmark::State& state)
+    {
+        for (auto _ : state)
+        {
+            Program program(MachineMode::AMD64);
+            emitSmallProgram(program);
+            benchmark::DoNotOptimize(program);
+        }
+    }
+    BENCHMARK(BM_ProgramConstructSmall);
+
+    static void BM_ProgramConstructSmallReserved(benchmark::State& state)
+    {
+        for (auto _ : state)
+        {
+            Program program(MachineMode::AMD64);
+            program.reserve(kSmallProgramSize, kSmallProgramSize);
+            emitSmallProgram(program);
+            benchmark::DoNotOptimize(program);
+        }
+    }
+    BENCHMARK(BM_ProgramConstructSmallReserved);
+
+    static void BM_ProgramResidentMemory(benchmark::State& state)
+    {
+        const auto count = static_cast<std::size_t>(state.range(0));
+
+        std::size_t residentBytes = 0;
+        for (auto _ : state)
+        {
+            const auto residentBefore = getResidentMemory();
+
+            std::vector<std::unique_ptr<Program>> programs;
+            programs.reserve(count);
+            for (std::size_t i = 0; i < count; ++i)
+            {
+                auto& program = programs.emplace_back(std::make_unique<Program>(MachineMode::AMD64));
+                emitSmallProgram(*program);
+            }
+
+            const auto residentAfter = getResidentMemory();
+            residentBytes = residentAfter > residentBefore ? residentAfter - residentBefore : 0;
+        }
+
+        state.counters["ResidentBytesPerProgram"] = static_cast<double>(residentBytes) / static_cast<double>(count);
+    }
+    BENCHMARK(BM_ProgramResidentMemory)->Arg(1000)->Iterations(1)->Unit(benchmark::kMillisecond);
+
+    // Simulates a compile request, builds a small function and serializes it.
+    static bool handleRequest(Program& program, x86::Assembler& assembler, Serializer& serializer)
+    {
+        const auto label = assembler.createLabel();
+        assembler.bind(label);
+        for (std::size_t i = 0; i < kSmallProgramSize; ++i)
+        {
+            tests::data::Instructions[i].emitter(assembler);
+        }
+        assembler.jmp(label);
+
+        return serializer.serialize(program, 0x00400000) == ErrorCode::None;
+    }
+
+    static void BM_ProgramRequests(benchmark::State& state)
+    {
+        Serializer serializer;
+
+        for (auto _ : state)
+        {
+            Program program(MachineMode::AMD64);
+            x86::Assembler assembler(program);
+
+            if (!handleRequest(program, assembler, serializer))
+            {
+                state.SkipWithError("Serialization failed");
+                break;
+            }
+        }
+
+        state.SetItemsProcessed(state.iterations());
+    }
+    BENCHMARK(BM_ProgramRequests)->ThreadRange(1, 8)->UseRealTime();
+
+    static void BM_ProgramPoolRequests(benchmark::State& state)
+    {
+        // Shared by all benchmark threads.
+        static ProgramPool pool(MachineMode::AMD64);
+
+        Serializer serializer;
+
+        for (auto _ : state)
+        {
+            auto handle = pool.acquire();
+
+            if (!handleRequest(handle.getProgram(), handle.getAssembler(), serializer))
+            {
+                state.SkipWithError("Serialization failed");
+                break;
+            }
+        }
+
+        state.SetItemsProcessed(state.iterations());
+    }
+    BENCHMARK(BM_ProgramPoolRequests)->ThreadRange(1, 8)->UseRealTime();
+
+    // Moves the first half of the program behind the second half, one node at a time.
+    static void BM_ProgramMoveNodes(benchmark::State& state)
+    {
+        const auto count = static_cast<std::size_t>(state.range(0));
+
+        Program program(MachineMode::AMD64);
+        x86::Assembler assembler(program);
+        InstructionDetailTable table(program);
+
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            assembler.nop();
+        }
+
+        for (auto _ : state)
+        {
+            auto* pos = program.getTail();
+            for (std::size_t i = 0; i < count / 2; ++i)
+            {
+                auto* node = program.getHead();
+                program.detach(node);
+                pos = program.insertAfter(pos, node);
+            }
+        }
+
+        state.counters["Nodes"] = benchmark::Counter(
+            static_cast<double>(count / 2), benchmark::Counter::kIsIterationInvariantRate,
+            benchmark::Counter::OneK::kIs1000);
+    }
+    BENCHMARK(BM_ProgramMoveNodes)->RangeMultiplier(8)->Range(512, 1 << 18);
+
+    // Same as above using a single range operation.
+    static void BM_ProgramMoveRange(benchmark::State& state)
+    {
+        const auto count = static_cast<std::size_t>(state.range(0));
+
+        Program program(MachineMode::AMD64);
+        x86::Assembler assembler(program);
+        InstructionDetailTable table(program);
+
+        Node* middle = nullptr;
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            assembler.nop();
+            if (i == count / 2 - 1)
+            {
+                middle = assembler.getCursor();
+            }
+        }
+
+        for (auto _ : state)
+        {
+            auto* first = program.getHead();
+            auto* pos = program.getTail();
+            program.detachRange(first, middle);
+            program.insertRangeAfter(pos, first, middle);
+
+            // The next iteration moves the other half.
+            middle = pos;
+        }
+
+        state.counters["Nodes"] = benchmark::Counter(
+            static_cast<double>(count / 2), benchmark::Counter::kIsIterationInvariantRate,
+            benchmark::Counter::OneK::kIs1000);
+    }
+    BENCHMARK(BM_ProgramMoveRange)->RangeMultiplier(8)->Range(512, 1 << 18);
+
+    static void BM_ProgramSpliceRange(benchmark::State& state)
+    {
+        const auto count = static_cast<std::size_t>(state.range(0));
+
+        Program program(MachineMode::AMD64);
+        x86::Assembler assembler(program);
+
+        Node* middle = nullptr;
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            assembler.nop();
+            if (i == count / 2 - 1)
+            {
+                middle = assembler.getCursor();
+            }
+        }
+
+        for (auto _ : state)
+        {
+            auto* pos = program.getTail();
+            program.splice(pos, program.getHead(), middle);
+            middle = pos;
+        }
+    }
+    BENCHMARK(BM_ProgramSpliceRange)->RangeMultiplier(8)->Range(512, 1 << 18);
+
+} // namespace zasm::benchmarks
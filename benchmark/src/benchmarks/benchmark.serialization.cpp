@@ -1,5 +1,7 @@
 #include <benchmark/benchmark.h>
 #include <functional>
+#include <string>
+#include <vector>
 #include <zasm/testdata/x86/instructions.hpp>
 #include <zasm/zasm.hpp>
 
@@ -54,6 +56,60 @@ namespace zasm::benchmarks
     }
     BENCHMARK(BM_SerializationBasic)->Unit(benchmark::kMillisecond);
 
+    static void BM_SerializationBasicCached(benchmark::State& state)
+    {
+        using namespace zasm::x86;
+
+        Program program(MachineMode::AMD64);
+        Assembler assembler(program);
+        Serializer serializer;
+        EncoderCache cache;
+        serializer.setEncoderCache(&cache);
+
+        for (auto _ : state)
+        {
+            state.PauseTiming();
+            program.clear();
+            assembler.setCursor(nullptr);
+
+            // Fill in N instructions.
+            zasm::Label label;
+
+            const auto count = std::size(tests::data::Instructions);
+            for (std::size_t i = 0; i < count; ++i)
+            {
+                const auto& instr = tests::data::Instructions[i];
+                instr.emitter(assembler);
+
+                // Generate every 128 instructions a new instruction using a label.
+                if (i % 128 == 0)
+                {
+                    if (label.isValid())
+                    {
+                        assembler.lea(rax, qword_ptr(label));
+                    }
+                    label = assembler.createLabel();
+                    assembler.bind(label);
+                }
+            }
+
+            state.ResumeTiming();
+
+            serializer.serialize(program, 0x00400000);
+
+            state.counters["BytesEncoded"] = benchmark::Counter(
+                static_cast<double>(serializer.getCodeSize()), benchmark::Counter::kIsIterationInvariantRate,
+                benchmark::Counter::OneK::kIs1024);
+            state.counters["Instructions"] = benchmark::Counter(
+                static_cast<double>(count), benchmark::Counter::kIsIterationInvariantRate, benchmark::Counter::OneK::kIs1000);
+        }
+
+        state.counters["CacheHits"] = static_cast<double>(cache.getHitCount());
+        state.counters["CacheMisses"] = static_cast<double>(cache.getMissCount());
+        state.counters["CacheEvictions"] = static_cast<double>(cache.getEvictionCount());
+    }
+    BENCHMARK(BM_SerializationBasicCached)->Unit(benchmark::kMillisecond);
+
     template<int64_t TLabelStep> static void BM_SerializationWithLabels(benchmark::State& state)
     {
         using namespace zasm::x86;
@@ -106,6 +162,8 @@ namespace zasm::benchmarks
 
         state.counters["Instructions"] = benchmark::Counter(
             static_cast<double>(numInstructions), benchmark::Counter::kIsRate, benchmark::Counter::OneK::kIs1000);
+
+        state.counters["Passes"] = static_cast<double>(serializer.getPassCount());
     }
     BENCHMARK_TEMPLATE(BM_SerializationWithLabels, 128)->Unit(benchmark::kMillisecond);
 
@@ -113,4 +171,238 @@ namespace zasm::benchmarks
 
     BENCHMARK_TEMPLATE(BM_SerializationWithLabels, 32)->Unit(benchmark::kMillisecond);
 
+    // Same as above but with forward branches which have to be relaxed.
+    template<int64_t TLabelStep> static void BM_SerializationWithForwardBranches(benchmark::State& state)
+    {
+        using namespace zasm::x86;
+
+        Program program(MachineMode::AMD64);
+        Assembler assembler(program);
+        Serializer serializer;
+
+        size_t numBytesEncoded = 0;
+        size_t numInstructions = 0;
+
+        for (auto _ : state)
+        {
+            state.PauseTiming();
+            program.clear();
+            assembler.setCursor(nullptr);
+
+            zasm::Label label;
+            zasm::Label labelFar = assembler.createLabel();
+
+            const auto count = std::size(tests::data::Instructions);
+            for (std::size_t i = 0; i < count; ++i)
+            {
+                const auto& instr = tests::data::Instructions[i];
+                instr.emitter(assembler);
+
+                // Generate every N instructions a short and a far forward branch.
+                if (i % TLabelStep == 0)
+                {
+                    if (label.isValid())
+                    {
+                        assembler.bind(label);
+                    }
+                    label = assembler.createLabel();
+                    assembler.jz(label);
+                    assembler.jmp(labelFar);
+                }
+            }
+            assembler.bind(label);
+            assembler.bind(labelFar);
+
+            state.ResumeTiming();
+
+            serializer.serialize(program, 0x00400000);
+
+            numBytesEncoded += serializer.getCodeSize();
+            numInstructions += count;
+        }
+
+        state.counters["BytesEncoded"] = benchmark::Counter(
+            static_cast<double>(numBytesEncoded), benchmark::Counter::kIsRate, benchmark::Counter::OneK::kIs1024);
+
+        state.counters["Instructions"] = benchmark::Counter(
+            static_cast<double>(numInstructions), benchmark::Counter::kIsRate, benchmark::Counter::OneK::kIs1000);
+
+        state.counters["Passes"] = static_cast<double>(serializer.getPassCount());
+    }
+    BENCHMARK_TEMPLATE(BM_SerializationWithForwardBranches, 128)->Unit(benchmark::kMillisecond);
+
+    BENCHMARK_TEMPLATE(BM_SerializationWithForwardBranches, 32)->Unit(benchmark::kMillisecond);
+
+    BENCHMARK_TEMPLATE(BM_SerializationWithForwardBranches, 8)->Unit(benchmark::kMillisecond);
+
+    // Serializes a program with multiple sections, the argument is the amount of threads.
+    static void BM_SerializationParallel(benchmark::State& state)
+    {
+        using namespace zasm::x86;
+
+        constexpr std::size_t kSectionCount = 16;
+
+        Program program(MachineMode::AMD64);
+        Assembler assembler(program);
+        Serializer serializer;
+        serializer.setThreadCount(static_cast<std::size_t>(state.range(0)));
+
+        const auto count = std::size(tests::data::Instructions);
+        for (std::size_t sect = 0; sect < kSectionCount; ++sect)
+        {
+            const auto name = std::string(".text") + std::to_string(sect);
+            assembler.section(name.c_str());
+
+            zasm::Label label;
+            for (std::size_t i = 0; i < count; ++i)
+            {
+                const auto& instr = tests::data::Instructions[i];
+                instr.emitter(assembler);
+
+                // Generate every 128 instructions a new instruction using a label.
+                if (i % 128 == 0)
+                {
+                    if (label.isValid())
+                    {
+                        assembler.lea(rax, qword_ptr(label));
+                    }
+                    label = assembler.createLabel();
+                    assembler.bind(label);
+                }
+            }
+        }
+
+        size_t numBytesEncoded = 0;
+        size_t numInstructions = 0;
+
+        for (auto _ : state)
+        {
+            serializer.serialize(program, 0x00400000);
+
+            numBytesEncoded += serializer.getCodeSize();
+            numInstructions += count * kSectionCount;
+        }
+
+        state.counters["BytesEncoded"] = benchmark::Counter(
+            static_cast<double>(numBytesEncoded), benchmark::Counter::kIsRate, benchmark::Counter::OneK::kIs1024);
+
+        state.counters["Instructions"] = benchmark::Counter(
+            static_cast<double>(numInstructions), benchmark::Counter::kIsRate, benchmark::Counter::OneK::kIs1000);
+    }
+    BENCHMARK(BM_SerializationParallel)->RangeMultiplier(2)->Range(1, 16)->UseRealTime()->Unit(benchmark::kMillisecond);
+
+    static void serializeRelocatable(Program& program, Serializer& serializer)
+    {
+        using namespace zasm::x86;
+
+        Assembler assembler(program);
+
+        constexpr std::size_t kCount = 100'000;
+
+        auto label = assembler.createLabel();
+        assembler.bind(label);
+        for (std::size_t i = 0; i < kCount; ++i)
+        {
+            assembler.mov(rax, label);
+            assembler.mov(ecx, dword_ptr(rdx, 0x10));
+            assembler.embedLabel(label);
+        }
+
+        serializer.serialize(program, 0x0000000140001000);
+    }
+
+    static void BM_SerializationRelocate(benchmark::State& state)
+    {
+        Program program(MachineMode::AMD64);
+        Serializer serializer;
+        serializeRelocatable(program, serializer);
+
+        std::int64_t base = 0x0000000140001000;
+        for (auto _ : state)
+        {
+            base ^= 0x0000000010000000;
+            serializer.relocate(base);
+        }
+
+        state.counters["Relocations"] = benchmark::Counter(
+            static_cast<double>(serializer.getRelocationCount()), benchmark::Counter::kIsIterationInvariantRate,
+            benchmark::Counter::OneK::kIs1000);
+    }
+    BENCHMARK(BM_SerializationRelocate)->Unit(benchmark::kMicrosecond);
+
+    // Writes N relocated copies, the argument is the amount of copies.
+    static void BM_SerializationRelocateInto(benchmark::State& state)
+    {
+        Program program(MachineMode::AMD64);
+        Serializer serializer;
+        serializeRelocatable(program, serializer);
+
+        const auto count = static_cast<std::size_t>(state.range(0));
+
+        std::vector<std::int64_t> bases;
+        std::vector<std::vector<std::uint8_t>> outputs(count);
+        std::vector<std::uint8_t*> buffers;
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            bases.push_back(0x0000000140001000 + static_cast<std::int64_t>(i + 1) * 0x10000000);
+            outputs[i].resize(serializer.getCodeSize());
+            buffers.push_back(outputs[i].data());
+        }
+
+        for (auto _ : state)
+        {
+            serializer.relocateInto(bases.data(), buffers.data(), count);
+        }
+
+        state.counters["BytesWritten"] = benchmark::Counter(
+            static_cast<double>(serializer.getCodeSize() * count), benchmark::Counter::kIsIterationInvariantRate,
+            benchmark::Counter::OneK::kIs1024);
+    }
+    BENCHMARK(BM_SerializationRelocateInto)->RangeMultiplier(2)->Range(1, 8)->Unit(benchmark::kMicrosecond);
+
+    // Serializes the same small program repeatedly, the argument is the amount of instructions. The serializer
+    // is warmed up before measuring so this is the latency of serializing without allocating.
+    static void BM_SerializationSmall(benchmark::State& state)
+    {
+        using namespace zasm::x86;
+
+        Program program(MachineMode::AMD64);
+        Assembler assembler(program);
+        Serializer serializer;
+
+        const auto count = static_cast<std::size_t>(state.range(0));
+
+        auto label = assembler.createLabel();
+        assembler.bind(label);
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            switch (i % 4)
+            {
+                case 0:
+                    assembler.mov(rax, rcx);
+                    break;
+                case 1:
+                    assembler.add(edx, Imm(1));
+                    break;
+                case 2:
+                    assembler.lea(rax, qword_ptr(rcx, 0x10));
+                    break;
+                case 3:
+                    assembler.jnz(label);
+                    break;
+            }
+        }
+
+        serializer.serialize(program, 0x00400000);
+
+        for (auto _ : state)
+        {
+            serializer.serialize(program, 0x00400000);
+        }
+
+        state.counters["Instructions"] = benchmark::Counter(
+            static_cast<double>(count), benchmark::Counter::kIsIterationInvariantRate, benchmark::Counter::OneK::kIs1000);
+    }
+    BENCHMARK(BM_SerializationSmall)->RangeMultiplier(2)->Range(1, 64)->Unit(benchmark::kNanosecond);
+
 } // namespace zasm::benchmarks
@@ -1,6 +1,9 @@
 #include "../testutils.hpp"
 
+#include <algorithm>
 #include <gtest/gtest.h>
+#include <vector>
+#include <zasm/testdata/x86/instructions.hpp>
 #include <zasm/zasm.hpp>
 
 namespace zasm::tests
@@ -122,4 +125,612 @@ namespace zasm::tests
         ASSERT_EQ(decoded->isOperandCondWrite(3), false);
     }
 
+    static std::vector<uint8_t> getTestDataCode(std::uint64_t address)
+    {
+        Program program(MachineMode::AMD64);
+
+        x86::Assembler assembler(program);
+        for (const auto& instrEntry : data::Instructions)
+        {
+            instrEntry.emitter(assembler);
+        }
+
+        Serializer serializer;
+        if (serializer.serialize(program, address) != ErrorCode::None)
+        {
+            return {};
+        }
+
+        return std::vector<uint8_t>(serializer.getCode(), serializer.getCode() + serializer.getCodeSize());
+    }
+
+    TEST(DecoderTests, DecodeProgramMatchesDecoder)
+    {
+        constexpr std::uint64_t kBaseAddress = 0x00400000;
+
+        const auto code = getTestDataCode(kBaseAddress);
+        ASSERT_FALSE(code.empty());
+
+        // Decode the same way as the decode_to_assembler example.
+        Program expectedProgram(MachineMode::AMD64);
+        {
+            Decoder decoder(MachineMode::AMD64);
+            x86::Assembler assembler(expectedProgram);
+
+            std::size_t offset = 0;
+            while (offset < code.size())
+            {
+                const auto decoded = decoder.decode(code.data() + offset, code.size() - offset, kBaseAddress + offset);
+                ASSERT_TRUE(decoded);
+                ASSERT_EQ(assembler.emit(decoded->getInstruction()), ErrorCode::None);
+                offset += decoded->getLength();
+            }
+        }
+
+        Program program(MachineMode::AMD64);
+        ASSERT_EQ(decodeProgram(program, code.data(), code.size(), kBaseAddress), ErrorCode::None);
+        ASSERT_EQ(program.size(), expectedProgram.size());
+
+        const auto* expectedNode = expectedProgram.getHead();
+        for (const auto* node = program.getHead(); node != nullptr; node = node->getNext())
+        {
+            ASSERT_NE(expectedNode, nullptr);
+
+            // Only the visible operands are compared, the decoder leaves hidden operands behind the count.
+            const auto& instr = node->get<Instruction>();
+            const auto& expectedInstr = expectedNode->get<Instruction>();
+            ASSERT_EQ(instr.getAttribs(), expectedInstr.getAttribs());
+            ASSERT_EQ(instr.getMnemonic(), expectedInstr.getMnemonic());
+            ASSERT_EQ(instr.getOperandCount(), expectedInstr.getOperandCount());
+            for (std::size_t i = 0; i < instr.getOperandCount(); ++i)
+            {
+                ASSERT_EQ(instr.getOperand(i), expectedInstr.getOperand(i));
+            }
+
+            expectedNode = expectedNode->getNext();
+        }
+    }
+
+    TEST(DecoderTests, DecodeProgramLabels)
+    {
+        const std::array<uint8_t, 12> inputBytes = {
+            0x31, 0xC0,       // xor eax, eax
+            0xFF, 0xC0,       // inc eax
+            0x83, 0xF8, 0x0A, // cmp eax, 0xA
+            0x75, 0xF9,       // jnz 0x00400002
+            0xEB, 0x10,       // jmp 0x0040001B
+            0xC3,             // ret
+        };
+
+        Program program(MachineMode::AMD64);
+        ASSERT_EQ(
+            decodeProgram(program, inputBytes.data(), inputBytes.size(), 0x00400000, DecodeProgramFlags::CreateLabels),
+            ErrorCode::None);
+        ASSERT_EQ(program.size(), 7U);
+
+        const auto* node = program.getHead();
+        ASSERT_EQ(node->get<Instruction>().getMnemonic(), x86::Mnemonic::Xor);
+
+        node = node->getNext();
+        ASSERT_TRUE(node->holds<Label>());
+        const auto label = node->get<Label>();
+
+        node = node->getNext();
+        ASSERT_EQ(node->get<Instruction>().getMnemonic(), x86::Mnemonic::Inc);
+
+        node = node->getNext()->getNext();
+        ASSERT_EQ(node->get<Instruction>().getMnemonic(), x86::Mnemonic::Jnz);
+        ASSERT_EQ(node->get<Instruction>().getOperand<Label>(0), label);
+
+        // Outside of the buffer.
+        node = node->getNext();
+        ASSERT_EQ(node->get<Instruction>().getMnemonic(), x86::Mnemonic::Jmp);
+        ASSERT_EQ(node->get<Instruction>().getOperand<Imm>(0).value<std::uint64_t>(), 0x0040001BU);
+
+        Serializer serializer;
+        ASSERT_EQ(serializer.serialize(program, 0x00400000), ErrorCode::None);
+        ASSERT_EQ(
+            hexEncode(serializer.getCode(), serializer.getCodeSize()), hexEncode(inputBytes.data(), inputBytes.size()));
+
+        // Labels follow the code when it is moved.
+        ASSERT_EQ(serializer.serialize(program, 0x00500000), ErrorCode::None);
+        ASSERT_EQ(serializer.getCode()[8], 0xF9);
+    }
+
+    TEST(DecoderTests, DecodeProgramInvalidAsData)
+    {
+        const std::array<uint8_t, 3> inputBytes = {
+            0x90, // nop
+            0x06, // invalid in 64 bit mode
+            0xC3, // ret
+        };
+
+        Program program(MachineMode::AMD64);
+        ASSERT_EQ(
+            decodeProgram(program, inputBytes.data(), inputBytes.size(), 0x00400000), ErrorCode::InvalidInstruction);
+        ASSERT_EQ(program.size(), 1U);
+
+        program.clear();
+        ASSERT_EQ(
+            decodeProgram(program, inputBytes.data(), inputBytes.size(), 0x00400000, DecodeProgramFlags::InvalidAsData),
+            ErrorCode::None);
+        ASSERT_EQ(program.size(), 3U);
+        ASSERT_TRUE(program.getHead()->getNext()->holds<Data>());
+
+        Serializer serializer;
+        ASSERT_EQ(serializer.serialize(program, 0x00400000), ErrorCode::None);
+        ASSERT_EQ(
+            hexEncode(serializer.getCode(), serializer.getCodeSize()), hexEncode(inputBytes.data(), inputBytes.size()));
+    }
+
+    struct TestColumns
+    {
+        std::vector<std::uint64_t> offsets;
+        std::vector<Instruction::Length> lengths;
+        std::vector<Instruction::Mnemonic> mnemonics;
+        std::vector<Instruction::Category> categories;
+        std::vector<Instruction::Attribs> attribs;
+        std::vector<std::uint16_t> operandKinds;
+
+        DecoderColumns getColumns(std::size_t capacity)
+        {
+            offsets.resize(capacity);
+            lengths.resize(capacity);
+            mnemonics.resize(capacity);
+            categories.resize(capacity);
+            attribs.resize(capacity);
+            operandKinds.resize(capacity);
+
+            DecoderColumns columns;
+            columns.capacity = capacity;
+            columns.offsets = offsets.data();
+            columns.lengths = lengths.data();
+            columns.mnemonics = mnemonics.data();
+            columns.categories = categories.data();
+            columns.attribs = attribs.data();
+            columns.operandKinds = operandKinds.data();
+            return columns;
+        }
+    };
+
+    TEST(DecoderTests, DecodeColumnsMatchesDecoder)
+    {
+        constexpr std::uint64_t kBaseAddress = 0x00400000;
+
+        const auto code = getTestDataCode(kBaseAddress);
+        ASSERT_FALSE(code.empty());
+
+        TestColumns storage;
+        auto columns = storage.getColumns(code.size());
+        ASSERT_EQ(decodeColumns(columns, MachineMode::AMD64, code.data(), code.size()), ErrorCode::None);
+        ASSERT_EQ(columns.count, std::size(data::Instructions));
+        ASSERT_EQ(columns.bytesDecoded, code.size());
+
+        Decoder decoder(MachineMode::AMD64);
+        for (std::size_t i = 0; i < columns.count; ++i)
+        {
+            const auto offset = storage.offsets[i];
+            const auto decoded = decoder.decode(code.data() + offset, code.size() - offset, kBaseAddress + offset);
+            ASSERT_TRUE(decoded);
+
+            ASSERT_EQ(storage.lengths[i], decoded->getLength());
+            ASSERT_EQ(storage.mnemonics[i], decoded->getMnemonic());
+            ASSERT_EQ(storage.categories[i], decoded->getCategory());
+            ASSERT_EQ(storage.attribs[i], decoded->getAttribs());
+
+            for (std::size_t j = 0; j < decoded->getVisibleOperandCount(); ++j)
+            {
+                const auto kind = getDecodedOperandKind(storage.operandKinds[i], j);
+                if (decoded->isOperandType<Reg>(j))
+                {
+                    ASSERT_EQ(kind, DecodedOperandKind::Reg);
+                }
+                else if (decoded->isOperandType<Mem>(j))
+                {
+                    ASSERT_EQ(kind, DecodedOperandKind::Mem);
+                }
+                else if (decoded->isOperandType<Imm>(j))
+                {
+                    ASSERT_TRUE(kind == DecodedOperandKind::Imm || kind == DecodedOperandKind::Rel);
+                }
+            }
+            ASSERT_EQ(
+                getDecodedOperandKind(storage.operandKinds[i], decoded->getVisibleOperandCount()), DecodedOperandKind::None);
+
+            if (i + 1 < columns.count)
+            {
+                ASSERT_EQ(storage.offsets[i + 1], offset + storage.lengths[i]);
+            }
+        }
+    }
+
+    TEST(DecoderTests, DecodeColumnsMinimal)
+    {
+        const std::array<uint8_t, 11> inputBytes = {
+            0xB8, 0x01, 0x00, 0x00, 0x00, // mov eax, 0x1
+            0x75, 0xF9,                   // jnz -7
+            0x06,                         // invalid in 64 bit mode
+            0xF0, 0xFF, 0x00,             // lock inc dword ptr [rax]
+        };
+
+        std::vector<Instruction::Length> lengths(inputBytes.size());
+        std::vector<Instruction::Mnemonic> mnemonics(inputBytes.size());
+        std::vector<Instruction::Category> categories(inputBytes.size());
+
+        DecoderColumns columns;
+        columns.capacity = inputBytes.size();
+        columns.lengths = lengths.data();
+        columns.mnemonics = mnemonics.data();
+
+        ASSERT_EQ(
+            decodeColumns(columns, MachineMode::AMD64, inputBytes.data(), inputBytes.size(), DecodeColumnsFlags::Minimal),
+            ErrorCode::InvalidInstruction);
+        ASSERT_EQ(columns.count, 2U);
+        ASSERT_EQ(columns.bytesDecoded, 7U);
+
+        ASSERT_EQ(
+            decodeColumns(
+                columns, MachineMode::AMD64, inputBytes.data(), inputBytes.size(),
+                DecodeColumnsFlags::Minimal | DecodeColumnsFlags::InvalidAsEntry),
+            ErrorCode::None);
+        ASSERT_EQ(columns.count, 4U);
+        ASSERT_EQ(columns.bytesDecoded, inputBytes.size());
+
+        ASSERT_EQ(lengths[0], 5);
+        ASSERT_EQ(mnemonics[0], x86::Mnemonic::Mov);
+        ASSERT_EQ(lengths[1], 2);
+        ASSERT_EQ(mnemonics[1], x86::Mnemonic::Jnz);
+        ASSERT_EQ(lengths[2], 1);
+        ASSERT_EQ(mnemonics[2], x86::Mnemonic::Invalid);
+        ASSERT_EQ(lengths[3], 3);
+        ASSERT_EQ(mnemonics[3], x86::Mnemonic::Inc);
+
+        // Not available in the minimal mode.
+        columns.categories = categories.data();
+        ASSERT_EQ(
+            decodeColumns(columns, MachineMode::AMD64, inputBytes.data(), inputBytes.size(), DecodeColumnsFlags::Minimal),
+            ErrorCode::InvalidParameter);
+    }
+
+    TEST(DecoderTests, DecodeColumnsResume)
+    {
+        constexpr std::uint64_t kBaseAddress = 0x00400000;
+
+        const auto code = getTestDataCode(kBaseAddress);
+        ASSERT_FALSE(code.empty());
+
+        std::vector<Instruction::Length> lengths(16);
+
+        DecoderColumns columns;
+        columns.capacity = lengths.size();
+        columns.lengths = lengths.data();
+
+        std::size_t offset = 0;
+        std::size_t count = 0;
+        while (offset < code.size())
+        {
+            ASSERT_EQ(decodeColumns(columns, MachineMode::AMD64, code.data() + offset, code.size() - offset), ErrorCode::None);
+            ASSERT_GT(columns.count, 0U);
+
+            std::size_t bytes = 0;
+            for (std::size_t i = 0; i < columns.count; ++i)
+            {
+                bytes += lengths[i];
+            }
+            ASSERT_EQ(bytes, columns.bytesDecoded);
+
+            offset += columns.bytesDecoded;
+            count += columns.count;
+        }
+
+        ASSERT_EQ(count, std::size(data::Instructions));
+    }
+
+    // Repeats the test data until the buffer has at least the requested size and appends bytes that do not
+    // decode to valid instructions everywhere, the chunk boundaries land within instructions.
+    static std::vector<uint8_t> getParallelTestCode(std::uint64_t address, std::size_t size)
+    {
+        const auto code = getTestDataCode(address);
+        if (code.empty())
+        {
+            return {};
+        }
+
+        std::vector<uint8_t> res;
+        while (res.size() < size)
+        {
+            res.insert(res.end(), code.begin(), code.end());
+        }
+
+        std::uint32_t seed = 0x1337;
+        for (std::size_t i = 0; i < 64 * 1024; ++i)
+        {
+            seed = seed * 1103515245U + 12345U;
+            res.push_back(static_cast<uint8_t>(seed >> 16));
+        }
+
+        return res;
+    }
+
+    TEST(DecoderTests, DecodeColumnsParallelMatchesSequential)
+    {
+        const auto code = getParallelTestCode(0x00400000, 1024 * 1024);
+        ASSERT_FALSE(code.empty());
+
+        TestColumns expectedStorage;
+        auto expected = expectedStorage.getColumns(code.size());
+        ASSERT_EQ(
+            decodeColumns(expected, MachineMode::AMD64, code.data(), code.size(), DecodeColumnsFlags::InvalidAsEntry),
+            ErrorCode::None);
+        ASSERT_EQ(expected.bytesDecoded, code.size());
+
+        for (const std::size_t threadCount : { 1, 2, 4, 8 })
+        {
+            TestColumns storage;
+            auto columns = storage.getColumns(code.size());
+            ASSERT_EQ(
+                decodeColumnsParallel(
+                    columns, MachineMode::AMD64, code.data(), code.size(), threadCount, DecodeColumnsFlags::InvalidAsEntry),
+                ErrorCode::None);
+            ASSERT_EQ(columns.count, expected.count);
+            ASSERT_EQ(columns.bytesDecoded, expected.bytesDecoded);
+
+            storage.getColumns(columns.count);
+            expectedStorage.getColumns(expected.count);
+            ASSERT_EQ(storage.offsets, expectedStorage.offsets);
+            ASSERT_EQ(storage.lengths, expectedStorage.lengths);
+            ASSERT_EQ(storage.mnemonics, expectedStorage.mnemonics);
+            ASSERT_EQ(storage.categories, expectedStorage.categories);
+            ASSERT_EQ(storage.attribs, expectedStorage.attribs);
+            ASSERT_EQ(storage.operandKinds, expectedStorage.operandKinds);
+        }
+    }
+
+    TEST(DecoderTests, DecodeColumnsParallelPartial)
+    {
+        const auto code = getParallelTestCode(0x00400000, 1024 * 1024);
+        ASSERT_FALSE(code.empty());
+
+        std::vector<Instruction::Length> expectedLengths(code.size() / 3);
+        std::vector<Instruction::Length> lengths(expectedLengths.size());
+
+        DecoderColumns expected;
+        expected.capacity = expectedLengths.size();
+        expected.lengths = expectedLengths.data();
+
+        DecoderColumns columns;
+        columns.capacity = lengths.size();
+        columns.lengths = lengths.data();
+
+        // Stops at the capacity.
+        ASSERT_EQ(decodeColumns(expected, MachineMode::AMD64, code.data(), code.size()), ErrorCode::None);
+        ASSERT_EQ(decodeColumnsParallel(columns, MachineMode::AMD64, code.data(), code.size(), 4), ErrorCode::None);
+        ASSERT_EQ(columns.count, expected.capacity);
+        ASSERT_EQ(columns.count, expected.count);
+        ASSERT_EQ(columns.bytesDecoded, expected.bytesDecoded);
+        ASSERT_EQ(lengths, expectedLengths);
+
+        // Stops at the first invalid instruction.
+        expected.capacity = columns.capacity = code.size();
+        expectedLengths.resize(code.size());
+        lengths.resize(code.size());
+        expected.lengths = expectedLengths.data();
+        columns.lengths = lengths.data();
+
+        ASSERT_EQ(decodeColumns(expected, MachineMode::AMD64, code.data(), code.size()), ErrorCode::InvalidInstruction);
+        ASSERT_EQ(
+            decodeColumnsParallel(columns, MachineMode::AMD64, code.data(), code.size(), 4), ErrorCode::InvalidInstruction);
+        ASSERT_EQ(columns.count, expected.count);
+        ASSERT_EQ(columns.bytesDecoded, expected.bytesDecoded);
+        ASSERT_TRUE(std::equal(lengths.begin(), lengths.begin() + columns.count, expectedLengths.begin()));
+    }
+
+    TEST(DecoderTests, DecodeProgramParallelMatchesSequential)
+    {
+        constexpr std::uint64_t kBaseAddress = 0x00400000;
+        constexpr auto kFlags = DecodeProgramFlags::CreateLabels | DecodeProgramFlags::InvalidAsData;
+
+        const auto code = getParallelTestCode(kBaseAddress, 1024 * 1024);
+        ASSERT_FALSE(code.empty());
+
+        Program expectedProgram(MachineMode::AMD64);
+        ASSERT_EQ(decodeProgram(expectedProgram, code.data(), code.size(), kBaseAddress, kFlags), ErrorCode::None);
+
+        for (const std::size_t threadCount : { 1, 2, 4, 8 })
+        {
+            Program program(MachineMode::AMD64);
+            ASSERT_EQ(
+                decodeProgramParallel(program, code.data(), code.size(), kBaseAddress, threadCount, kFlags), ErrorCode::None);
+            ASSERT_EQ(program.size(), expectedProgram.size());
+
+            const auto* expectedNode = expectedProgram.getHead();
+            for (const auto* node = program.getHead(); node != nullptr; node = node->getNext())
+            {
+                ASSERT_NE(expectedNode, nullptr);
+
+                if (const auto* instr = node->getIf<Instruction>(); instr != nullptr)
+                {
+                    const auto* expectedInstr = expectedNode->getIf<Instruction>();
+                    ASSERT_NE(expectedInstr, nullptr);
+                    ASSERT_EQ(instr->getAttribs(), expectedInstr->getAttribs());
+                    ASSERT_EQ(instr->getMnemonic(), expectedInstr->getMnemonic());
+                    ASSERT_EQ(instr->getOperandCount(), expectedInstr->getOperandCount());
+                    for (std::size_t i = 0; i < instr->getOperandCount(); ++i)
+                    {
+                        ASSERT_EQ(instr->getOperand(i), expectedInstr->getOperand(i));
+                    }
+                }
+                else if (const auto* label = node->getIf<Label>(); label != nullptr)
+                {
+                    ASSERT_TRUE(expectedNode->holds<Label>());
+                    ASSERT_EQ(*label, expectedNode->get<Label>());
+                }
+                else
+                {
+                    ASSERT_TRUE(expectedNode->holds<Data>());
+                    ASSERT_EQ(node->get<Data>(), expectedNode->get<Data>());
+                }
+
+                expectedNode = expectedNode->getNext();
+            }
+        }
+    }
+
+    TEST(DecoderTests, DecodeCfgBlocks)
+    {
+        constexpr std::uint64_t kBaseAddress = 0x00400000;
+
+        const std::array<uint8_t, 20> inputBytes = {
+            0x31, 0xC0,                   // xor eax, eax
+            0xFF, 0xC0,                   // inc eax
+            0x83, 0xF8, 0x0A,             // cmp eax, 0xA
+            0x75, 0xF9,                   // jnz 0x00400002
+            0xE8, 0x04, 0x00, 0x00, 0x00, // call 0x00400012
+            0xC3,                         // ret
+            0x06, 0x06, 0x06,             // not reached, invalid in 64 bit mode
+            0x90,                         // nop
+            0xC3,                         // ret
+        };
+
+        for (const std::size_t threadCount : { 1, 4 })
+        {
+            Program program(MachineMode::AMD64);
+            std::vector<DecodedBlock> blocks;
+            ASSERT_EQ(
+                decodeCfg(program, blocks, inputBytes.data(), inputBytes.size(), kBaseAddress, { kBaseAddress }, threadCount),
+                ErrorCode::None);
+            ASSERT_EQ(program.size(), 12U);
+            ASSERT_EQ(blocks.size(), 4U);
+
+            ASSERT_EQ(blocks[0].address, kBaseAddress);
+            ASSERT_EQ(blocks[0].size, 2U);
+            ASSERT_EQ(blocks[0].instructionCount, 1U);
+            ASSERT_EQ(blocks[0].fallthrough, 1U);
+            ASSERT_EQ(blocks[0].branch, DecodedBlock::kNone);
+            ASSERT_TRUE(blocks[0].isFunction);
+
+            ASSERT_EQ(blocks[1].address, kBaseAddress + 0x02);
+            ASSERT_EQ(blocks[1].size, 7U);
+            ASSERT_EQ(blocks[1].instructionCount, 3U);
+            ASSERT_EQ(blocks[1].fallthrough, 2U);
+            ASSERT_EQ(blocks[1].branch, 1U);
+            ASSERT_FALSE(blocks[1].isFunction);
+
+            ASSERT_EQ(blocks[2].address, kBaseAddress + 0x09);
+            ASSERT_EQ(blocks[2].size, 6U);
+            ASSERT_EQ(blocks[2].instructionCount, 2U);
+            ASSERT_EQ(blocks[2].fallthrough, DecodedBlock::kNone);
+            ASSERT_EQ(blocks[2].branch, DecodedBlock::kNone);
+
+            ASSERT_EQ(blocks[3].address, kBaseAddress + 0x12);
+            ASSERT_EQ(blocks[3].size, 2U);
+            ASSERT_TRUE(blocks[3].isFunction);
+
+            for (const auto& block : blocks)
+            {
+                ASSERT_EQ(block.head->get<Label>(), block.label);
+            }
+
+            const auto& jnz = blocks[1].tail->get<Instruction>();
+            ASSERT_EQ(jnz.getMnemonic(), x86::Mnemonic::Jnz);
+            ASSERT_EQ(jnz.getOperand<Label>(0), blocks[1].label);
+
+            const auto& call = blocks[2].tail->getPrev()->get<Instruction>();
+            ASSERT_EQ(call.getMnemonic(), x86::Mnemonic::Call);
+            ASSERT_EQ(call.getOperand<Label>(0), blocks[3].label);
+        }
+
+        Program program(MachineMode::AMD64);
+        std::vector<DecodedBlock> blocks;
+        ASSERT_EQ(
+            decodeCfg(program, blocks, inputBytes.data(), inputBytes.size(), kBaseAddress, { kBaseAddress + 0x20 }),
+            ErrorCode::InvalidParameter);
+    }
+
+    // Functions with a loop and a conditional call to the next function.
+    static std::vector<uint8_t> getCfgTestCode(std::uint64_t address, std::size_t functionCount)
+    {
+        Program program(MachineMode::AMD64);
+        x86::Assembler assembler(program);
+
+        std::vector<Label> functions;
+        for (std::size_t i = 0; i < functionCount; ++i)
+        {
+            functions.push_back(assembler.createLabel());
+        }
+
+        for (std::size_t i = 0; i < functionCount; ++i)
+        {
+            auto loop = assembler.createLabel();
+            auto skip = assembler.createLabel();
+
+            assembler.bind(functions[i]);
+            assembler.xor_(x86::eax, x86::eax);
+            assembler.bind(loop);
+            assembler.inc(x86::eax);
+            assembler.cmp(x86::eax, Imm(10));
+            assembler.jnz(loop);
+            assembler.test(x86::ecx, x86::ecx);
+            assembler.jz(skip);
+            if (i + 1 < functionCount)
+            {
+                assembler.call(functions[i + 1]);
+            }
+            assembler.bind(skip);
+            assembler.mov(x86::rax, x86::qword_ptr(x86::rsp, 8));
+            assembler.ret();
+        }
+
+        Serializer serializer;
+        if (serializer.serialize(program, address) != ErrorCode::None)
+        {
+            return {};
+        }
+
+        return std::vector<uint8_t>(serializer.getCode(), serializer.getCode() + serializer.getCodeSize());
+    }
+
+    TEST(DecoderTests, DecodeCfgParallelRoundtrip)
+    {
+        constexpr std::uint64_t kBaseAddress = 0x00400000;
+        constexpr std::size_t kFunctionCount = 256;
+
+        const auto code = getCfgTestCode(kBaseAddress, kFunctionCount);
+        ASSERT_FALSE(code.empty());
+
+        std::vector<DecodedBlock> expectedBlocks;
+        for (const std::size_t threadCount : { 1, 2, 4, 8 })
+        {
+            Program program(MachineMode::AMD64);
+            std::vector<DecodedBlock> blocks;
+            ASSERT_EQ(
+                decodeCfg(program, blocks, code.data(), code.size(), kBaseAddress, { kBaseAddress }, threadCount),
+                ErrorCode::None);
+
+            // Each function has 5 blocks except the last one without the call.
+            ASSERT_EQ(blocks.size(), kFunctionCount * 5 - 1);
+
+            const auto functionCount = std::count_if(
+                blocks.begin(), blocks.end(), [](const auto& block) { return block.isFunction; });
+            ASSERT_EQ(static_cast<std::size_t>(functionCount), kFunctionCount);
+
+            if (expectedBlocks.empty())
+            {
+                expectedBlocks = blocks;
+            }
+            for (std::size_t i = 0; i < blocks.size(); ++i)
+            {
+                ASSERT_EQ(blocks[i].address, expectedBlocks[i].address);
+                ASSERT_EQ(blocks[i].size, expectedBlocks[i].size);
+                ASSERT_EQ(blocks[i].label, expectedBlocks[i].label);
+                ASSERT_EQ(blocks[i].fallthrough, expectedBlocks[i].fallthrough);
+                ASSERT_EQ(blocks[i].branch, expectedBlocks[i].branch);
+            }
+
+            Serializer serializer;
+            ASSERT_EQ(serializer.serialize(program, kBaseAddress), ErrorCode::None);
+            ASSERT_EQ(hexEncode(serializer.getCode(), serializer.getCodeSize()), hexEncode(code.data(), code.size()));
+        }
+    }
+
 } // namespace zasm::tests
@@ -0,0 +1,622 @@
+#include "../testutils.hpp"
+
+#include <gtest/gtest.h>
+#include <cstdint>
+#include <iterator>
+#include <optional>
+#include <vector>
+#include <zasm/testdata/x86/instructions.hpp>
+#include <zasm/zasm.hpp>
+
+namespace zasm::tests
+{
+    // Serializes the instruction, which uses the table driven encoder for the common forms, and compares the
+    // result against the temporary encoder that always uses Zydis.
+    static void expectSameAsZydis(MachineMode mode, const Instruction& instr)
+    {
+        Program program(mode);
+
+        x86::Assembler assembler(program);
+        ASSERT_EQ(assembler.emit(instr), ErrorCode::None);
+
+        Serializer serializer;
+        ASSERT_EQ(serializer.serialize(program, 0x0000000000401000), ErrorCode::None);
+
+        const auto& ops = instr.getOperands();
+        const auto res = encode(mode, instr.getAttribs(), instr.getMnemonic(), instr.getOperandCount(), ops.data());
+        ASSERT_TRUE(res);
+
+        ASSERT_EQ(
+            hexEncode(serializer.getCode(), serializer.getCodeSize()), hexEncode(res->buffer.data.data(), res->buffer.length));
+    }
+
+    static std::vector<Reg> getGpRegs(MachineMode mode, BitSize size)
+    {
+        const auto first = size == BitSize::_64 ? ZYDIS_REGISTER_RAX : ZYDIS_REGISTER_EAX;
+        const auto count = mode == MachineMode::AMD64 ? 16 : 8;
+
+        std::vector<Reg> regs;
+        for (int i = 0; i < count; ++i)
+        {
+            regs.emplace_back(static_cast<Reg::Id>(first + i));
+        }
+        return regs;
+    }
+
+    static std::vector<MachineMode> getModes()
+    {
+        return { MachineMode::I386, MachineMode::AMD64 };
+    }
+
+    static std::vector<BitSize> getGpSizes(MachineMode mode)
+    {
+        if (mode == MachineMode::AMD64)
+        {
+            return { BitSize::_32, BitSize::_64 };
+        }
+        return { BitSize::_32 };
+    }
+
+    TEST(EncoderTests, FastPathRegRegMatchesZydis)
+    {
+        const Instruction::Mnemonic mnemonics[] = {
+            x86::Mnemonic::Mov, x86::Mnemonic::Add, x86::Mnemonic::Or,  x86::Mnemonic::And,
+            x86::Mnemonic::Sub, x86::Mnemonic::Xor, x86::Mnemonic::Cmp, x86::Mnemonic::Test,
+        };
+
+        for (const auto mode : getModes())
+        {
+            for (const auto size : getGpSizes(mode))
+            {
+                const auto regs = getGpRegs(mode, size);
+                for (const auto mnemonic : mnemonics)
+                {
+                    for (const auto& dst : regs)
+                    {
+                        for (const auto& src : regs)
+                        {
+                            expectSameAsZydis(mode, Instruction().setMnemonic(mnemonic).addOperand(dst).addOperand(src));
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    TEST(EncoderTests, FastPathRegImmMatchesZydis)
+    {
+        const Instruction::Mnemonic mnemonics[] = {
+            x86::Mnemonic::Add, x86::Mnemonic::Or,  x86::Mnemonic::And,
+            x86::Mnemonic::Sub, x86::Mnemonic::Xor, x86::Mnemonic::Cmp,
+        };
+
+        // Includes values outside of the imm8 range which are encoded by Zydis.
+        const std::int64_t values[] = { -129, -128, -1, 0, 1, 127, 128, 0x12345678 };
+
+        for (const auto mode : getModes())
+        {
+            for (const auto size : getGpSizes(mode))
+            {
+                for (const auto mnemonic : mnemonics)
+                {
+                    for (const auto& dst : getGpRegs(mode, size))
+                    {
+                        for (const auto value : values)
+                        {
+                            expectSameAsZydis(mode, Instruction().setMnemonic(mnemonic).addOperand(dst).addOperand(Imm(value)));
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    TEST(EncoderTests, FastPathMovImmMatchesZydis)
+    {
+        const std::int64_t values[] = {
+            -1, 0, 1, 0x7FFFFFFF, -0x80000000LL, 0x80000000LL, 0xFFFFFFFFLL, 0x100000000LL, 0x0011223344556677LL,
+        };
+
+        for (const auto mode : getModes())
+        {
+            for (const auto size : getGpSizes(mode))
+            {
+                for (const auto& dst : getGpRegs(mode, size))
+                {
+                    for (const auto value : values)
+                    {
+                        if (size == BitSize::_32 && (value < INT32_MIN || value > UINT32_MAX))
+                        {
+                            continue;
+                        }
+                        expectSameAsZydis(
+                            mode, Instruction().setMnemonic(x86::Mnemonic::Mov).addOperand(dst).addOperand(Imm(value)));
+                    }
+                }
+            }
+        }
+    }
+
+    TEST(EncoderTests, FastPathPushPopMatchesZydis)
+    {
+        for (const auto mode : getModes())
+        {
+            const auto size = mode == MachineMode::AMD64 ? BitSize::_64 : BitSize::_32;
+            for (const auto& reg : getGpRegs(mode, size))
+            {
+                expectSameAsZydis(mode, Instruction().setMnemonic(x86::Mnemonic::Push).addOperand(reg));
+                expectSameAsZydis(mode, Instruction().setMnemonic(x86::Mnemonic::Pop).addOperand(reg));
+            }
+        }
+    }
+
+    TEST(EncoderTests, FastPathLeaMatchesZydis)
+    {
+        const std::int64_t displacements[] = { 0, 1, -128, 127, 128, -129, 0x12345678 };
+        const std::int32_t scales[] = { 1, 2, 4, 8 };
+
+        for (const auto mode : getModes())
+        {
+            const auto addrSize = mode == MachineMode::AMD64 ? BitSize::_64 : BitSize::_32;
+            const auto addrRegs = getGpRegs(mode, addrSize);
+
+            for (const auto size : getGpSizes(mode))
+            {
+                const auto dst = getGpRegs(mode, size).back();
+                for (const auto& base : addrRegs)
+                {
+                    for (const auto disp : displacements)
+                    {
+                        const auto mem = Mem(size, Reg{}, base, Reg{}, 0, disp);
+                        expectSameAsZydis(mode, Instruction().setMnemonic(x86::Mnemonic::Lea).addOperand(dst).addOperand(mem));
+                    }
+
+                    for (const auto& index : addrRegs)
+                    {
+                        // rsp can not be used as index.
+                        if (index == addrRegs[4])
+                        {
+                            continue;
+                        }
+                        for (const auto scale : scales)
+                        {
+                            const auto mem = Mem(size, Reg{}, base, index, scale, 0x10);
+                            expectSameAsZydis(
+                                mode, Instruction().setMnemonic(x86::Mnemonic::Lea).addOperand(dst).addOperand(mem));
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    TEST(EncoderTests, FastPathFixedMatchesZydis)
+    {
+        const Instruction::Mnemonic mnemonics[] = {
+            x86::Mnemonic::Nop,
+            x86::Mnemonic::Ret,
+            x86::Mnemonic::Leave,
+            x86::Mnemonic::Int3,
+        };
+
+        for (const auto mode : getModes())
+        {
+            for (const auto mnemonic : mnemonics)
+            {
+                expectSameAsZydis(mode, Instruction().setMnemonic(mnemonic));
+            }
+        }
+    }
+
+    TEST(EncoderTests, FastPathBranchesX64)
+    {
+        const Instruction::Mnemonic mnemonics[] = { x86::Mnemonic::Jmp, x86::Mnemonic::Jz, x86::Mnemonic::Jnle };
+
+        // Distances around the boundary of the short form in both directions.
+        for (const auto mnemonic : mnemonics)
+        {
+            for (std::size_t padding = 120; padding < 136; ++padding)
+            {
+                Program program(MachineMode::AMD64);
+
+                x86::Assembler assembler(program);
+
+                auto labelBack = assembler.createLabel();
+                auto labelForward = assembler.createLabel();
+
+                ASSERT_EQ(assembler.bind(labelBack), ErrorCode::None);
+                for (std::size_t i = 0; i < padding; ++i)
+                {
+                    ASSERT_EQ(assembler.nop(), ErrorCode::None);
+                }
+                ASSERT_EQ(assembler.emit(Instruction().setMnemonic(mnemonic).addOperand(labelBack)), ErrorCode::None);
+                ASSERT_EQ(assembler.emit(Instruction().setMnemonic(mnemonic).addOperand(labelForward)), ErrorCode::None);
+                for (std::size_t i = 0; i < padding; ++i)
+                {
+                    ASSERT_EQ(assembler.nop(), ErrorCode::None);
+                }
+                ASSERT_EQ(assembler.bind(labelForward), ErrorCode::None);
+
+                Serializer serializer;
+                ASSERT_EQ(serializer.serialize(program, 0x0000000000401000), ErrorCode::None);
+
+                Decoder decoder(MachineMode::AMD64);
+
+                const auto* code = serializer.getCode();
+                const auto codeSize = serializer.getCodeSize();
+                const auto branchVA = serializer.getLabelAddress(labelBack.getId()) + static_cast<std::int64_t>(padding);
+
+                auto backward = decoder.decode(code + padding, codeSize - padding, branchVA);
+                ASSERT_TRUE(backward);
+                ASSERT_EQ(backward->getMnemonic(), mnemonic);
+                ASSERT_EQ(backward->getOperand<Imm>(0).value<std::int64_t>(), serializer.getLabelAddress(labelBack.getId()));
+
+                const auto backwardLen = backward->getLength();
+                const auto forwardOffset = padding + backwardLen;
+                auto forward = decoder.decode(code + forwardOffset, codeSize - forwardOffset, branchVA + backwardLen);
+                ASSERT_TRUE(forward);
+                ASSERT_EQ(forward->getMnemonic(), mnemonic);
+                ASSERT_EQ(forward->getOperand<Imm>(0).value<std::int64_t>(), serializer.getLabelAddress(labelForward.getId()));
+
+                // The short form is used whenever the target is in range.
+                const auto isShortBackward = static_cast<std::int64_t>(padding) + 2 <= 128;
+                ASSERT_EQ(backwardLen, isShortBackward ? 2 : (mnemonic == x86::Mnemonic::Jmp ? 5 : 6));
+
+                const auto isShortForward = static_cast<std::int64_t>(padding) <= 127;
+                ASSERT_EQ(forward->getLength(), isShortForward ? 2 : (mnemonic == x86::Mnemonic::Jmp ? 5 : 6));
+            }
+        }
+    }
+
+    TEST(EncoderTests, BatchMatchesSerializerX64)
+    {
+        Program program(MachineMode::AMD64);
+
+        x86::Assembler assembler(program);
+        ASSERT_EQ(assembler.push(x86::rbp), ErrorCode::None);
+        ASSERT_EQ(assembler.mov(x86::rbp, x86::rsp), ErrorCode::None);
+        ASSERT_EQ(assembler.sub(x86::rsp, Imm(0x20)), ErrorCode::None);
+        ASSERT_EQ(assembler.mov(x86::rcx, x86::qword_ptr(x86::rdx, x86::rbx, 1, 128)), ErrorCode::None);
+        ASSERT_EQ(assembler.lea(x86::rax, x86::qword_ptr(x86::rcx, 0x10)), ErrorCode::None);
+        ASSERT_EQ(assembler.imul(x86::eax, x86::ecx, Imm(3)), ErrorCode::None);
+        ASSERT_EQ(assembler.movaps(x86::xmm0, x86::xmm1), ErrorCode::None);
+        ASSERT_EQ(assembler.mov(x86::rax, Imm64(0x0011223344556677)), ErrorCode::None);
+        ASSERT_EQ(assembler.pop(x86::rbp), ErrorCode::None);
+        ASSERT_EQ(assembler.ret(), ErrorCode::None);
+
+        Serializer serializer;
+        ASSERT_EQ(serializer.serialize(program, 0x0000000000401000), ErrorCode::None);
+
+        std::vector<Instruction> instrs;
+        for (const auto* node = program.getHead(); node != nullptr; node = node->getNext())
+        {
+            instrs.push_back(node->get<Instruction>());
+        }
+
+        EncoderBatch batch;
+        ASSERT_EQ(
+            encodeBatch(batch, MachineMode::AMD64, 0x0000000000401000, instrs.data(), instrs.size()), ErrorCode::None);
+        ASSERT_EQ(batch.size(), instrs.size());
+        ASSERT_EQ(hexEncode(batch.code.data(), batch.code.size()), hexEncode(serializer.getCode(), serializer.getCodeSize()));
+
+        std::int32_t offset = 0;
+        for (std::size_t i = 0; i < batch.size(); ++i)
+        {
+            ASSERT_EQ(batch.offsets[i], offset);
+            ASSERT_EQ(batch.relocKinds[i], RelocationType::None);
+            offset += batch.lengths[i];
+        }
+
+        // The node range produces the same result.
+        EncoderBatch batchNodes;
+        ASSERT_EQ(
+            encodeBatch(batchNodes, MachineMode::AMD64, 0x0000000000401000, program.getHead(), program.getTail()),
+            ErrorCode::None);
+        ASSERT_EQ(batchNodes.code, batch.code);
+        ASSERT_EQ(batchNodes.lengths, batch.lengths);
+
+        ASSERT_EQ(
+            encodeBatch(batch, MachineMode::Invalid, 0x0000000000401000, instrs.data(), instrs.size()),
+            ErrorCode::InvalidMode);
+        ASSERT_EQ(batch.size(), 0U);
+    }
+
+    class TestLabelFixup final : public IEncoderLabelFixup
+    {
+    public:
+        Label::Id known{ Label::Id::Invalid };
+        std::int64_t knownAddress{};
+        std::size_t calls{};
+
+        std::optional<std::int64_t> resolve(Label::Id label, std::size_t, std::int64_t) override
+        {
+            calls++;
+            if (label == known)
+            {
+                return knownAddress;
+            }
+            return std::nullopt;
+        }
+    };
+
+    TEST(EncoderTests, BatchLabelFixupX64)
+    {
+        Program program(MachineMode::AMD64);
+
+        x86::Assembler assembler(program);
+
+        auto labelKnown = assembler.createLabel();
+        auto labelUnknown = assembler.createLabel();
+
+        const Instruction instrs[] = {
+            Instruction().setMnemonic(x86::Mnemonic::Jmp).addOperand(labelKnown),
+            Instruction().setMnemonic(x86::Mnemonic::Jnz).addOperand(labelUnknown),
+            Instruction().setMnemonic(x86::Mnemonic::Ret),
+        };
+
+        TestLabelFixup fixup;
+        fixup.known = labelKnown.getId();
+        fixup.knownAddress = 0x0000000000401080;
+
+        EncoderBatch batch;
+        ASSERT_EQ(
+            encodeBatch(batch, MachineMode::AMD64, 0x0000000000401000, std::data(instrs), std::size(instrs), &fixup),
+            ErrorCode::None);
+        ASSERT_EQ(batch.size(), 3U);
+        ASSERT_EQ(fixup.calls, 2U);
+
+        Decoder decoder(MachineMode::AMD64);
+
+        // Resolved by the fixup.
+        auto decodedJmp = decoder.decode(batch.code.data(), batch.code.size(), 0x0000000000401000);
+        ASSERT_TRUE(decodedJmp);
+        ASSERT_EQ(decodedJmp->getOperand<Imm>(0).value<std::int64_t>(), 0x0000000000401080);
+        ASSERT_EQ(batch.relocKinds[0], RelocationType::None);
+
+        // Unknown label is reported with the location of the rel32 field.
+        ASSERT_EQ(batch.lengths[1], 6U);
+        ASSERT_EQ(batch.relocKinds[1], RelocationType::Rel32);
+        ASSERT_EQ(batch.relocData[1], RelocationData::Immediate);
+        ASSERT_EQ(batch.relocLabels[1], labelUnknown.getId());
+        ASSERT_EQ(batch.relocOffsets[1], 2U);
+        ASSERT_EQ(batch.relocSizes[1], 4U);
+
+        // Without a fixup every label is reported.
+        ASSERT_EQ(
+            encodeBatch(batch, MachineMode::AMD64, 0x0000000000401000, std::data(instrs), std::size(instrs)),
+            ErrorCode::None);
+        ASSERT_EQ(batch.relocKinds[0], RelocationType::Rel32);
+        ASSERT_EQ(batch.relocLabels[0], labelKnown.getId());
+    }
+
+    TEST(EncoderTests, BatchNodeLabelsX64)
+    {
+        Program program(MachineMode::AMD64);
+
+        x86::Assembler assembler(program);
+
+        auto labelBack = assembler.createLabel();
+        auto labelForward = assembler.createLabel();
+        ASSERT_EQ(assembler.bind(labelBack), ErrorCode::None);
+        ASSERT_EQ(assembler.jmp(labelForward), ErrorCode::None);
+        ASSERT_EQ(assembler.nop(), ErrorCode::None);
+        ASSERT_EQ(assembler.bind(labelForward), ErrorCode::None);
+        ASSERT_EQ(assembler.jnz(labelBack), ErrorCode::None);
+        ASSERT_EQ(assembler.ret(), ErrorCode::None);
+
+        TestLabelFixup fixup;
+
+        EncoderBatch batch;
+        ASSERT_EQ(
+            encodeBatch(batch, MachineMode::AMD64, 0x0000000000401000, program.getHead(), program.getTail(), &fixup),
+            ErrorCode::None);
+        ASSERT_EQ(batch.size(), 4U);
+
+        // Only the forward reference is passed to the fixup.
+        ASSERT_EQ(fixup.calls, 1U);
+
+        // The forward reference is patched and uses rel32, the backward reference knows the label.
+        Decoder decoder(MachineMode::AMD64);
+
+        auto decodedJmp = decoder.decode(batch.code.data(), batch.code.size(), 0x0000000000401000);
+        ASSERT_TRUE(decodedJmp);
+        ASSERT_EQ(batch.lengths[0], 5U);
+        ASSERT_EQ(decodedJmp->getOperand<Imm>(0).value<std::int64_t>(), 0x0000000000401006);
+        ASSERT_EQ(batch.relocKinds[0], RelocationType::None);
+
+        const auto offsetJnz = static_cast<std::size_t>(batch.offsets[2]);
+        auto decodedJnz = decoder.decode(batch.code.data() + offsetJnz, batch.code.size() - offsetJnz, 0x0000000000401006);
+        ASSERT_TRUE(decodedJnz);
+        ASSERT_EQ(batch.lengths[2], 2U);
+        ASSERT_EQ(decodedJnz->getOperand<Imm>(0).value<std::int64_t>(), 0x0000000000401000);
+
+        // Data is not supported.
+        ASSERT_EQ(assembler.db(0x90), ErrorCode::None);
+        ASSERT_EQ(
+            encodeBatch(batch, MachineMode::AMD64, 0x0000000000401000, program.getHead(), program.getTail()),
+            ErrorCode::InvalidOperation);
+    }
+
+    template<typename TBytes, std::size_t N>
+    static constexpr bool isSameBytes(const TBytes& bytes, const std::uint8_t (&expected)[N]) noexcept
+    {
+        if (bytes.size() != N)
+        {
+            return false;
+        }
+        for (std::size_t i = 0; i < N; ++i)
+        {
+            if (bytes[i] != expected[i])
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    static constexpr Instruction kConstPrologue[] = {
+        makeInstruction(x86::Mnemonic::Push, x86::rbp),
+        makeInstruction(x86::Mnemonic::Mov, x86::rbp, x86::rsp),
+        makeInstruction(x86::Mnemonic::Push, x86::r12),
+        makeInstruction(x86::Mnemonic::Sub, x86::rsp, Imm(0x20)),
+        makeInstruction(x86::Mnemonic::Lea, x86::rcx, x86::qword_ptr(x86::rbp, -8)),
+        makeInstruction(x86::Mnemonic::Lea, x86::rdx, x86::qword_ptr(x86::rsp, x86::r9, 8, 0x100)),
+        makeInstruction(x86::Mnemonic::Mov, x86::eax, Imm(1)),
+        makeInstruction(x86::Mnemonic::Mov, x86::r11, Imm64(0x0011223344556677)),
+        makeInstruction(x86::Mnemonic::Pop, x86::r12),
+        makeInstruction(x86::Mnemonic::Leave),
+        makeInstruction(x86::Mnemonic::Ret),
+    };
+
+    static constexpr auto kConstPrologueBytes = encodeConst<MachineMode::AMD64, kConstPrologue>();
+
+    static constexpr std::uint8_t kConstPrologueExpected[] = {
+        0x55,                                                       // push rbp
+        0x48, 0x89, 0xE5,                                           // mov rbp, rsp
+        0x41, 0x54,                                                 // push r12
+        0x48, 0x83, 0xEC, 0x20,                                     // sub rsp, 0x20
+        0x48, 0x8D, 0x4D, 0xF8,                                     // lea rcx, [rbp-8]
+        0x4A, 0x8D, 0x94, 0xCC, 0x00, 0x01, 0x00, 0x00,             // lea rdx, [rsp+r9*8+0x100]
+        0xB8, 0x01, 0x00, 0x00, 0x00,                               // mov eax, 1
+        0x49, 0xBB, 0x77, 0x66, 0x55, 0x44, 0x33, 0x22, 0x11, 0x00, // mov r11, 0x0011223344556677
+        0x41, 0x5C,                                                 // pop r12
+        0xC9,                                                       // leave
+        0xC3,                                                       // ret
+    };
+
+    static_assert(isSameBytes(kConstPrologueBytes, kConstPrologueExpected));
+
+    static constexpr Instruction kConstStub32[] = {
+        makeInstruction(x86::Mnemonic::Push, x86::ebp),
+        makeInstruction(x86::Mnemonic::Mov, x86::ebp, x86::esp),
+        makeInstruction(x86::Mnemonic::Xor, x86::eax, x86::eax),
+        makeInstruction(x86::Mnemonic::Pop, x86::ebp),
+        makeInstruction(x86::Mnemonic::Ret),
+    };
+
+    static constexpr auto kConstStub32Bytes = encodeConst<MachineMode::I386, kConstStub32>();
+
+    static constexpr std::uint8_t kConstStub32Expected[] = {
+        0x55, 0x89, 0xE5, 0x31, 0xC0, 0x5D, 0xC3,
+    };
+
+    static_assert(isSameBytes(kConstStub32Bytes, kConstStub32Expected));
+
+    template<std::size_t N, typename TBytes>
+    static void expectSameAsSerializer(MachineMode mode, const Instruction (&instrs)[N], const TBytes& bytes)
+    {
+        Program program(mode);
+
+        x86::Assembler assembler(program);
+        for (const auto& instr : instrs)
+        {
+            ASSERT_EQ(assembler.emit(instr), ErrorCode::None);
+        }
+
+        Serializer serializer;
+        ASSERT_EQ(serializer.serialize(program, 0x0000000000401000), ErrorCode::None);
+        ASSERT_EQ(hexEncode(bytes.data(), bytes.size()), hexEncode(serializer.getCode(), serializer.getCodeSize()));
+    }
+
+    TEST(EncoderTests, ConstEncodeMatchesSerializer)
+    {
+        expectSameAsSerializer(MachineMode::AMD64, kConstPrologue, kConstPrologueBytes);
+        expectSameAsSerializer(MachineMode::I386, kConstStub32, kConstStub32Bytes);
+    }
+
+    TEST(EncoderTests, SessionMatchesTestDataX64)
+    {
+        EncoderSession session(MachineMode::AMD64);
+        ASSERT_EQ(session.getMode(), MachineMode::AMD64);
+
+        // The second pass uses the prepared requests.
+        for (int pass = 0; pass < 2; ++pass)
+        {
+            for (const auto& instrEntry : data::Instructions)
+            {
+                Program program(MachineMode::AMD64);
+
+                x86::Assembler assembler(program);
+                ASSERT_EQ(instrEntry.emitter(assembler), ErrorCode::None) << instrEntry.operation;
+
+                const auto* instr = program.getHead()->getIf<Instruction>();
+                ASSERT_NE(instr, nullptr) << instrEntry.operation;
+
+                const auto res = session.encode(*instr, 0x0000000000401000);
+                ASSERT_TRUE(res) << instrEntry.operation;
+                ASSERT_EQ(std::string(instrEntry.instrBytes), hexEncode(res->buffer.data.data(), res->buffer.length))
+                    << instrEntry.operation;
+            }
+        }
+
+        ASSERT_GT(session.size(), 0U);
+        ASSERT_EQ(session.getMissCount(), session.size());
+        ASSERT_GE(session.getHitCount(), session.getMissCount());
+
+        session.clear();
+        ASSERT_EQ(session.size(), 0U);
+        ASSERT_EQ(session.getHitCount(), 0U);
+        ASSERT_EQ(session.getMissCount(), 0U);
+    }
+
+    TEST(EncoderTests, SessionPatchesOperandsX64)
+    {
+        EncoderSession session(MachineMode::AMD64);
+
+        const Instruction instrs[] = {
+            makeInstruction(x86::Mnemonic::Vaddps, x86::ymm0, x86::ymm1, x86::ymmword_ptr(x86::rax, x86::rcx, 4, 0x10)),
+            makeInstruction(x86::Mnemonic::Vaddps, x86::ymm9, x86::ymm15, x86::ymmword_ptr(x86::r13, x86::r12, 8, -0x200)),
+            makeInstruction(x86::Mnemonic::Vaddps, x86::ymm2, x86::ymm3, x86::ymmword_ptr(x86::rsp)),
+            makeInstruction(x86::Mnemonic::Imul, x86::eax, x86::ecx, Imm(3)),
+            makeInstruction(x86::Mnemonic::Imul, x86::r10d, x86::r11d, Imm(0x12345)),
+            makeInstruction(x86::Mnemonic::Movzx, x86::eax, x86::byte_ptr(x86::rdx)),
+            makeInstruction(x86::Mnemonic::Movzx, x86::r8d, x86::byte_ptr(x86::gs, x86::r9, 0x7F)),
+        };
+
+        for (const auto& instr : instrs)
+        {
+            const auto& ops = instr.getOperands();
+            const auto expected = encode(
+                MachineMode::AMD64, instr.getAttribs(), instr.getMnemonic(), instr.getOperandCount(), ops.data());
+            ASSERT_TRUE(expected);
+
+            const auto res = session.encode(instr);
+            ASSERT_TRUE(res);
+            ASSERT_EQ(
+                hexEncode(res->buffer.data.data(), res->buffer.length),
+                hexEncode(expected->buffer.data.data(), expected->buffer.length));
+            ASSERT_EQ(res->relocKind, RelocationType::None);
+        }
+
+        ASSERT_EQ(session.size(), 3U);
+        ASSERT_EQ(session.getMissCount(), 3U);
+        ASSERT_EQ(session.getHitCount(), 4U);
+    }
+
+    TEST(EncoderTests, SessionLabelsX64)
+    {
+        Program program(MachineMode::AMD64);
+
+        x86::Assembler assembler(program);
+        auto label = assembler.createLabel();
+
+        EncoderSession session(MachineMode::AMD64);
+
+        const auto res = session.encode(makeInstruction(x86::Mnemonic::Call, label), 0x0000000000401000);
+        ASSERT_TRUE(res);
+        ASSERT_EQ(res->buffer.length, 5U);
+        ASSERT_EQ(res->relocKind, RelocationType::Rel32);
+        ASSERT_EQ(res->relocLabel, label.getId());
+        ASSERT_EQ(res->relocOffset, 1U);
+        ASSERT_EQ(res->relocSize, 4U);
+
+        // Labels are not cached.
+        ASSERT_EQ(session.size(), 0U);
+
+        EncoderSession invalidSession(MachineMode::Invalid);
+        const auto invalidRes = invalidSession.encode(makeInstruction(x86::Mnemonic::Ret));
+        ASSERT_FALSE(invalidRes);
+        ASSERT_EQ(invalidRes.error(), ErrorCode::InvalidMode);
+    }
+
+} // namespace zasm::tests
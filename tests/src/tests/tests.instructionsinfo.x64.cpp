@@ -1,6 +1,7 @@
 #include "../testutils.hpp"
 
 #include <gtest/gtest.h>
+#include <vector>
 #include <zasm/testdata/x86/instructions.hpp>
 #include <zasm/zasm.hpp>
 
@@ -109,4 +110,82 @@ namespace zasm::tests
         ASSERT_EQ(opImm->value<int64_t>(), 0x18342F417);
     }
 
+    TEST(InstructionInfoTests, DetailCacheMatchesUncached)
+    {
+        Program program(MachineMode::AMD64);
+        x86::Assembler assembler(program);
+
+        for (const auto& instrTest : data::Instructions)
+        {
+            ASSERT_EQ(instrTest.emitter(assembler), ErrorCode::None) << instrTest.operation;
+        }
+
+        // Every detail computed with an empty cache.
+        std::vector<InstructionDetail> expected;
+        for (const auto* node = program.getHead(); node != nullptr; node = node->getNext())
+        {
+            Instruction::clearDetailCache();
+
+            const auto detail = node->get<Instruction>().getDetail(program.getMode());
+            ASSERT_TRUE(detail.hasValue());
+            expected.push_back(*detail);
+        }
+
+        // Twice with the cache shared between all instructions.
+        Instruction::clearDetailCache();
+        for (int pass = 0; pass < 2; ++pass)
+        {
+            std::size_t index = 0;
+            for (const auto* node = program.getHead(); node != nullptr; node = node->getNext(), ++index)
+            {
+                const auto detail = node->get<Instruction>().getDetail(program.getMode());
+                ASSERT_TRUE(detail.hasValue());
+                ASSERT_EQ(*detail, expected[index]) << data::Instructions[index].operation;
+            }
+        }
+
+        const auto stats = Instruction::getDetailCacheStats();
+        ASSERT_EQ(stats.hits + stats.misses, expected.size() * 2);
+        ASSERT_GE(stats.hits, expected.size() / 2);
+    }
+
+    TEST(InstructionInfoTests, DetailCacheStats)
+    {
+        Instruction::clearDetailCache();
+
+        const auto getDetail = [](const Instruction& instr) {
+            const auto detail = instr.getDetail(MachineMode::AMD64);
+            ASSERT_TRUE(detail.hasValue());
+        };
+
+        const auto movRegReg = Instruction().setMnemonic(x86::Mnemonic::Mov).addOperand(x86::rax).addOperand(x86::rbx);
+        const auto movRegImm = Instruction().setMnemonic(x86::Mnemonic::Mov).addOperand(x86::rax);
+
+        getDetail(movRegReg);
+        getDetail(movRegReg);
+        getDetail(Instruction(movRegImm).addOperand(Imm(1000)));
+        getDetail(Instruction(movRegImm).addOperand(Imm(2000)));
+        getDetail(Instruction(movRegImm).addOperand(Imm(0x123456789)));
+
+        auto stats = Instruction::getDetailCacheStats();
+        ASSERT_EQ(stats.hits, 2U);
+        ASSERT_EQ(stats.misses, 3U);
+        ASSERT_EQ(stats.size, 3U);
+
+        // Relative branches depend on the target.
+        const auto jmp = Instruction().setMnemonic(x86::Mnemonic::Jmp);
+        getDetail(Instruction(jmp).addOperand(Imm(0x10)));
+        getDetail(Instruction(jmp).addOperand(Imm(0x20)));
+
+        stats = Instruction::getDetailCacheStats();
+        ASSERT_EQ(stats.hits, 2U);
+        ASSERT_EQ(stats.misses, 5U);
+
+        Instruction::clearDetailCache();
+        stats = Instruction::getDetailCacheStats();
+        ASSERT_EQ(stats.hits, 0U);
+        ASSERT_EQ(stats.misses, 0U);
+        ASSERT_EQ(stats.size, 0U);
+    }
+
 } // namespace zasm::tests
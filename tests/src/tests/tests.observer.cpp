@@ -1,3 +1,4 @@
+#include <array>
 #include <gtest/gtest.h>
 #include <zasm/program/observer.hpp>
 #include <zasm/zasm.hpp>
@@ -130,4 +131,94 @@ namespace zasm::tests
         ASSERT_EQ(observer.nodesDetached, 1);
     }
 
+    TEST(ObserverTests, TestRangeDetachInsertDefault)
+    {
+        Program program(MachineMode::AMD64);
+
+        TestObserver observer;
+        program.addObserver(observer);
+
+        x86::Assembler assembler(program);
+        assembler.mov(x86::rax, x86::rbx);
+        auto* nodeA = assembler.getCursor();
+        assembler.mov(x86::rax, x86::rbx);
+        auto* nodeB = assembler.getCursor();
+        assembler.mov(x86::rax, x86::rbx);
+        auto* nodeC = assembler.getCursor();
+        assembler.mov(x86::rax, x86::rbx);
+        auto* nodeD = assembler.getCursor();
+
+        // Without overriding the range events each node is reported.
+        program.detachRange(nodeB, nodeC);
+        program.insertRangeAfter(nodeD, nodeB, nodeC);
+
+        ASSERT_EQ(observer.nodesCreated, 4);
+        ASSERT_EQ(observer.nodesInserted, 6);
+        ASSERT_EQ(observer.nodesDestroyed, 0);
+        ASSERT_EQ(observer.nodesDetached, 2);
+    }
+
+    struct TestRangeObserver final : zasm::Observer
+    {
+        size_t nodesInserted{};
+        size_t nodesDetached{};
+        size_t rangesInserted{};
+        size_t rangesDetached{};
+        size_t rangesMoved{};
+
+        void onNodeInserted(Node* node) override
+        {
+            nodesInserted++;
+        }
+        void onNodeDetach(Node* node) override
+        {
+            nodesDetached++;
+        }
+        void onRangeInserted(Node* first, Node* last) override
+        {
+            rangesInserted++;
+        }
+        void onRangeDetach(Node* first, Node* last) override
+        {
+            rangesDetached++;
+        }
+        void onRangeMoved(Node* first, Node* last) override
+        {
+            rangesMoved++;
+        }
+    };
+
+    TEST(ObserverTests, TestRangeDetachInsert)
+    {
+        Program program(MachineMode::AMD64);
+
+        x86::Assembler assembler(program);
+        for (int i = 0; i < 10; i++)
+        {
+            assembler.mov(x86::rax, x86::rbx);
+        }
+
+        TestRangeObserver observer;
+        program.addObserver(observer);
+
+        auto* first = program.getHead()->getNext();
+        auto* last = program.getTail()->getPrev();
+
+        program.detachRange(first, last);
+        program.insertRangeAfter(nullptr, first, last);
+
+        program.splice(program.getTail(), first, last);
+
+        // Inserting fresh nodes in bulk.
+        std::array<Node*, 2> nodes = { program.createNode(Instruction{}.setMnemonic(x86::Mnemonic::Nop)),
+                                       program.createNode(Instruction{}.setMnemonic(x86::Mnemonic::Nop)) };
+        program.insertRangeAfter(nullptr, nodes.data(), nodes.size());
+
+        ASSERT_EQ(observer.nodesInserted, 0);
+        ASSERT_EQ(observer.nodesDetached, 0);
+        ASSERT_EQ(observer.rangesInserted, 2);
+        ASSERT_EQ(observer.rangesDetached, 1);
+        ASSERT_EQ(observer.rangesMoved, 1);
+    }
+
 } // namespace zasm::tests
@@ -1,4 +1,9 @@
+#include <algorithm>
+#include <array>
+#include <cstring>
 #include <gtest/gtest.h>
+#include <thread>
+#include <vector>
 #include <zasm/testdata/x86/instructions.hpp>
 #include <zasm/zasm.hpp>
 
@@ -218,6 +223,155 @@ namespace zasm::tests
         ASSERT_EQ(lastNode, program.getTail());
     }
 
+    static std::vector<int> getImmOrder(const Program& program)
+    {
+        std::vector<int> res;
+        for (const auto* node = program.getHead(); node != nullptr; node = node->getNext())
+        {
+            res.push_back(node->get<Instruction>().getOperand<1, Imm>().value<int>());
+        }
+        return res;
+    }
+
+    static std::vector<Node*> emitMovSequence(x86::Assembler& assembler, int count)
+    {
+        std::vector<Node*> nodes;
+        for (int i = 0; i < count; i++)
+        {
+            assembler.mov(x86::eax, Imm(i));
+            nodes.push_back(assembler.getCursor());
+        }
+        return nodes;
+    }
+
+    TEST(ProgramTests, NodeRangeSplice)
+    {
+        Program program(MachineMode::AMD64);
+
+        x86::Assembler assembler(program);
+
+        const auto nodes = emitMovSequence(assembler, 10);
+        ASSERT_EQ(program.size(), 10);
+
+        ASSERT_EQ(program.splice(nodes[8], nodes[2], nodes[4]), nodes[4]);
+        ASSERT_EQ(getImmOrder(program), (std::vector<int>{ 0, 1, 5, 6, 7, 8, 2, 3, 4, 9 }));
+
+        // To the end.
+        program.splice(program.getTail(), nodes[0], nodes[1]);
+        ASSERT_EQ(getImmOrder(program), (std::vector<int>{ 5, 6, 7, 8, 2, 3, 4, 9, 0, 1 }));
+        ASSERT_EQ(program.getTail(), nodes[1]);
+
+        // To the start.
+        program.splice(nullptr, nodes[9], nodes[1]);
+        ASSERT_EQ(getImmOrder(program), (std::vector<int>{ 9, 0, 1, 5, 6, 7, 8, 2, 3, 4 }));
+        ASSERT_EQ(program.getHead(), nodes[9]);
+        ASSERT_EQ(program.getHead()->getPrev(), nullptr);
+        ASSERT_EQ(program.getTail(), nodes[4]);
+        ASSERT_EQ(program.getTail()->getNext(), nullptr);
+
+        // Already in place.
+        program.splice(nodes[1], nodes[5], nodes[8]);
+        ASSERT_EQ(getImmOrder(program), (std::vector<int>{ 9, 0, 1, 5, 6, 7, 8, 2, 3, 4 }));
+        ASSERT_EQ(program.size(), 10);
+    }
+
+    TEST(ProgramTests, NodeRangeDetachInsert)
+    {
+        Program program(MachineMode::AMD64);
+
+        x86::Assembler assembler(program);
+
+        const auto nodes = emitMovSequence(assembler, 10);
+
+        ASSERT_EQ(program.detachRange(nodes[3], nodes[6]), nodes[7]);
+        ASSERT_EQ(program.size(), 6);
+        ASSERT_EQ(getImmOrder(program), (std::vector<int>{ 0, 1, 2, 7, 8, 9 }));
+        ASSERT_FALSE(nodes[3]->isAttached());
+        ASSERT_FALSE(nodes[6]->isAttached());
+        ASSERT_EQ(nodes[3]->getPrev(), nullptr);
+        ASSERT_EQ(nodes[6]->getNext(), nullptr);
+
+        // Detaching again fails.
+        ASSERT_EQ(program.detachRange(nodes[3], nodes[6]), nullptr);
+
+        ASSERT_EQ(program.insertRangeAfter(program.getTail(), nodes[3], nodes[6]), nodes[6]);
+        ASSERT_EQ(program.size(), 10);
+        ASSERT_EQ(getImmOrder(program), (std::vector<int>{ 0, 1, 2, 7, 8, 9, 3, 4, 5, 6 }));
+        ASSERT_EQ(program.getTail(), nodes[6]);
+
+        // Detach everything and insert it into the empty program.
+        ASSERT_EQ(program.detachRange(program.getHead(), program.getTail()), nullptr);
+        ASSERT_EQ(program.size(), 0);
+        ASSERT_EQ(program.getHead(), nullptr);
+        ASSERT_EQ(program.getTail(), nullptr);
+
+        program.insertRangeAfter(nullptr, nodes[0], nodes[6]);
+        ASSERT_EQ(program.size(), 10);
+        ASSERT_EQ(program.getHead(), nodes[0]);
+        ASSERT_EQ(program.getTail(), nodes[6]);
+        ASSERT_TRUE(nodes[9]->isAttached());
+    }
+
+    TEST(ProgramTests, NodeRangeInsertArray)
+    {
+        Program program(MachineMode::AMD64);
+
+        x86::Assembler assembler(program);
+
+        const auto nodes = emitMovSequence(assembler, 4);
+
+        // Fresh nodes that were never linked.
+        std::vector<Node*> freshNodes;
+        for (int i = 10; i < 13; i++)
+        {
+            auto instr = Instruction{}.setMnemonic(x86::Mnemonic::Mov).addOperand(x86::eax).addOperand(Imm(i));
+            freshNodes.push_back(program.createNode(instr));
+        }
+        ASSERT_EQ(program.size(), 4);
+
+        ASSERT_EQ(program.insertRangeAfter(nodes[1], freshNodes.data(), freshNodes.size()), freshNodes[2]);
+        ASSERT_EQ(program.size(), 7);
+        ASSERT_EQ(getImmOrder(program), (std::vector<int>{ 0, 1, 10, 11, 12, 2, 3 }));
+        for (auto* node : freshNodes)
+        {
+            ASSERT_TRUE(node->isAttached());
+        }
+
+        // The inserted nodes form a regular range.
+        ASSERT_EQ(program.detachRange(freshNodes[0], freshNodes[2]), nodes[2]);
+        ASSERT_EQ(program.size(), 4);
+        ASSERT_EQ(program.insertRangeAfter(nullptr, freshNodes[0], freshNodes[2]), freshNodes[2]);
+        ASSERT_EQ(getImmOrder(program), (std::vector<int>{ 10, 11, 12, 0, 1, 2, 3 }));
+
+        // Inserting at the end and nothing at all.
+        program.detach(nodes[0]);
+        program.detach(nodes[3]);
+        const std::array<Node*, 2> tailNodes = { nodes[3], nodes[0] };
+        ASSERT_EQ(program.insertRangeAfter(program.getTail(), tailNodes.data(), tailNodes.size()), nodes[0]);
+        ASSERT_EQ(program.getTail(), nodes[0]);
+        ASSERT_EQ(program.insertRangeAfter(nodes[1], tailNodes.data(), 0), nodes[1]);
+        ASSERT_EQ(program.size(), 7);
+        ASSERT_EQ(getImmOrder(program), (std::vector<int>{ 10, 11, 12, 1, 2, 3, 0 }));
+    }
+
+    TEST(ProgramTests, NodeRangeDetachCursor)
+    {
+        Program program(MachineMode::AMD64);
+
+        x86::Assembler assembler(program);
+
+        const auto nodes = emitMovSequence(assembler, 10);
+
+        assembler.setCursor(nodes[5]);
+        program.detachRange(nodes[4], nodes[9]);
+        ASSERT_EQ(assembler.getCursor(), nodes[3]);
+
+        program.insertRangeAfter(nullptr, nodes[4], nodes[9]);
+        assembler.setCursor(nodes[4]);
+        program.detachRange(program.getHead(), nodes[5]);
+        ASSERT_EQ(assembler.getCursor(), nullptr);
+    }
+
     TEST(ProgramTests, TestClear)
     {
         Program program(MachineMode::AMD64);
@@ -370,6 +524,50 @@ namespace zasm::tests
         ASSERT_EQ(data, nullptr);
     }
 
+    TEST(ProgramTests, TestNodeInlineData)
+    {
+        Program program(MachineMode::AMD64);
+
+        auto* alignNode = program.createNode(Align(Align::Type::Code, 16));
+        ASSERT_NE(alignNode, nullptr);
+        ASSERT_TRUE(alignNode->holds<Align>());
+        ASSERT_EQ(alignNode->get<Align>().getAlign(), 16U);
+
+        alignNode->get<Align>().setAlign(32);
+        ASSERT_EQ(alignNode->get<Align>().getAlign(), 32U);
+
+        const auto label = program.createLabel();
+        auto labelNode = program.bindLabel(label);
+        ASSERT_EQ(labelNode.hasValue(), true);
+
+        auto* embedNode = program.createNode(EmbeddedLabel(label, BitSize::_32));
+        ASSERT_NE(embedNode, nullptr);
+
+        program.append(alignNode);
+        program.append(*labelNode);
+        program.append(embedNode);
+
+        const auto* labelData = (*labelNode)->getIf<Label>();
+        ASSERT_NE(labelData, nullptr);
+        ASSERT_EQ(labelData->getId(), label.getId());
+        ASSERT_EQ(embedNode->get<EmbeddedLabel>().getLabel(), label);
+
+        const auto visited = alignNode->visit([](auto&& val) -> std::uint32_t {
+            using T = std::decay_t<decltype(val)>;
+            if constexpr (std::is_same_v<T, Align>)
+            {
+                return val.getAlign();
+            }
+            return 0;
+        });
+        ASSERT_EQ(visited, 32U);
+
+        program.destroy(alignNode);
+        ASSERT_EQ(program.size(), 2);
+        ASSERT_EQ(program.getHead(), *labelNode);
+        ASSERT_EQ(program.getHead()->get<Label>(), label);
+    }
+
     // Test to ensure that we stay under 4 GiB of memory with a large number of instructions.
     TEST(ProgramTests, Test1MillionInstructions)
     {
@@ -389,4 +587,302 @@ namespace zasm::tests
         ASSERT_EQ(program.size(), kMaxInstructions);
     }
 
+    TEST(ProgramTests, TestReserve)
+    {
+        Program program(MachineMode::AMD64);
+
+        x86::Assembler assembler(program);
+
+        constexpr auto kInstructionCount = 10'000;
+
+        for (int pass = 0; pass < 2; pass++)
+        {
+            program.reserve(kInstructionCount + 1, kInstructionCount, 1);
+
+            auto label = assembler.createLabel();
+            ASSERT_EQ(assembler.bind(label), ErrorCode::None);
+
+            for (int i = 0; i < kInstructionCount; i++)
+            {
+                ASSERT_EQ(assembler.mov(x86::eax, Imm(i)), ErrorCode::None);
+            }
+            ASSERT_EQ(program.size(), kInstructionCount + 1);
+            ASSERT_EQ(program.getHead()->get<Label>(), label);
+
+            // Nodes from the reserved block and the blocks that follow it are all valid.
+            int value = 0;
+            for (const auto* node = program.getHead()->getNext(); node != nullptr; node = node->getNext())
+            {
+                const auto& instr = node->get<Instruction>();
+                ASSERT_EQ(instr.getOperand<Imm>(1).value<int>(), value);
+                value++;
+            }
+            ASSERT_EQ(value, kInstructionCount);
+
+            program.clear();
+            assembler.setCursor(nullptr);
+        }
+    }
+
+    TEST(ProgramTests, TestNodeLinksReuseSlots)
+    {
+        Program program(MachineMode::AMD64);
+
+        x86::Assembler assembler(program);
+
+        constexpr auto kInstructionCount = 5'000;
+
+        std::vector<Node*> nodes;
+        for (int i = 0; i < kInstructionCount; i++)
+        {
+            ASSERT_EQ(assembler.mov(x86::eax, Imm(i)), ErrorCode::None);
+            nodes.push_back(assembler.getCursor());
+        }
+
+        // Free slots all over the arena, the new nodes at the end are linked to nodes far away.
+        for (int i = 0; i < kInstructionCount; i += 3)
+        {
+            program.destroy(nodes[i]);
+            nodes[i] = nullptr;
+        }
+        assembler.setCursor(program.getTail());
+        for (int i = 0; i < kInstructionCount; i += 3)
+        {
+            ASSERT_EQ(assembler.mov(x86::eax, Imm(kInstructionCount + i)), ErrorCode::None);
+        }
+        nodes.erase(std::remove(nodes.begin(), nodes.end(), nullptr), nodes.end());
+        for (auto* node = nodes.back()->getNext(); node != nullptr; node = node->getNext())
+        {
+            nodes.push_back(node);
+        }
+        ASSERT_EQ(nodes.size(), program.size());
+
+        std::size_t index = 0;
+        for (const auto* node = program.getHead(); node != nullptr; node = node->getNext())
+        {
+            ASSERT_EQ(node, nodes[index]);
+            index++;
+        }
+        ASSERT_EQ(index, nodes.size());
+
+        for (const auto* node = program.getTail(); node != nullptr; node = node->getPrev())
+        {
+            index--;
+            ASSERT_EQ(node, nodes[index]);
+        }
+        ASSERT_EQ(index, 0U);
+    }
+
+    TEST(ProgramTests, InstructionDetailTable)
+    {
+        Program program(MachineMode::AMD64);
+
+        x86::Assembler assembler(program);
+        for (const auto& instrEntry : data::Instructions)
+        {
+            ASSERT_EQ(instrEntry.emitter(assembler), ErrorCode::None) << instrEntry.operation;
+        }
+
+        const auto label = assembler.createLabel();
+        ASSERT_EQ(assembler.bind(label), ErrorCode::None);
+
+        for (const std::size_t threadCount : { 1, 4 })
+        {
+            InstructionDetailTable table(program);
+            ASSERT_EQ(table.compute(threadCount), ErrorCode::None);
+            ASSERT_EQ(table.size(), std::size(data::Instructions));
+            ASSERT_EQ(table.get(program.getTail()), nullptr);
+
+            for (const auto* node = program.getHead(); node->holds<Instruction>(); node = node->getNext())
+            {
+                const auto* detail = table.get(node);
+                ASSERT_NE(detail, nullptr);
+
+                const auto expected = node->get<Instruction>().getDetail(program.getMode());
+                ASSERT_TRUE(expected.hasValue());
+                ASSERT_EQ(*detail, *expected);
+            }
+        }
+    }
+
+    TEST(ProgramTests, InstructionDetailTableInvalidation)
+    {
+        Program program(MachineMode::AMD64);
+
+        x86::Assembler assembler(program);
+        ASSERT_EQ(assembler.mov(x86::rax, x86::rbx), ErrorCode::None);
+        auto* first = assembler.getCursor();
+        ASSERT_EQ(assembler.add(x86::rax, Imm(1)), ErrorCode::None);
+        auto* second = assembler.getCursor();
+        ASSERT_EQ(assembler.ret(), ErrorCode::None);
+        auto* third = assembler.getCursor();
+
+        InstructionDetailTable table(program);
+
+        // Only the range.
+        ASSERT_EQ(table.compute(first, second), ErrorCode::None);
+        ASSERT_EQ(table.size(), 2U);
+        ASSERT_NE(table.get(first), nullptr);
+        ASSERT_NE(table.get(second), nullptr);
+        ASSERT_EQ(table.get(third), nullptr);
+
+        // Moving keeps the entry, the detail does not depend on the position.
+        program.moveAfter(third, first);
+        ASSERT_NE(table.get(first), nullptr);
+        ASSERT_EQ(table.size(), 2U);
+
+        // Re-inserting drops the entry.
+        program.detach(first);
+        program.insertAfter(third, first);
+        ASSERT_EQ(table.get(first), nullptr);
+        ASSERT_EQ(table.size(), 1U);
+
+        // Destroying drops the entry.
+        program.destroy(second);
+        ASSERT_EQ(table.size(), 0U);
+
+        ASSERT_EQ(table.compute(), ErrorCode::None);
+        ASSERT_EQ(table.size(), 2U);
+        ASSERT_EQ(table.get(first)->getMnemonic(), x86::Mnemonic::Mov);
+        ASSERT_EQ(table.get(third)->getMnemonic(), x86::Mnemonic::Ret);
+
+        // Modified in place.
+        first->get<Instruction>().setMnemonic(x86::Mnemonic::Xchg);
+        table.invalidate(first);
+        ASSERT_EQ(table.compute(), ErrorCode::None);
+        ASSERT_EQ(table.get(first)->getMnemonic(), x86::Mnemonic::Xchg);
+
+        program.clear();
+        ASSERT_EQ(table.size(), 0U);
+    }
+
+    TEST(ProgramTests, ProgramPool)
+    {
+        ProgramPool pool(MachineMode::AMD64, 1);
+        ASSERT_EQ(pool.size(), 1U);
+        ASSERT_EQ(pool.getAvailableCount(), 1U);
+
+        const Program* firstProgram = nullptr;
+        {
+            auto handle = pool.acquire();
+            ASSERT_TRUE(handle.isValid());
+            ASSERT_EQ(pool.getAvailableCount(), 0U);
+
+            auto& program = handle.getProgram();
+            auto& assembler = handle.getAssembler();
+            firstProgram = &program;
+
+            const auto label = assembler.createLabel("entry");
+            ASSERT_EQ(assembler.bind(label), ErrorCode::None);
+            ASSERT_EQ(assembler.mov(x86::eax, Imm(1)), ErrorCode::None);
+            ASSERT_EQ(assembler.ret(), ErrorCode::None);
+            program.setEntryPoint(label);
+
+            ASSERT_EQ(program.size(), 3U);
+        }
+        ASSERT_EQ(pool.getAvailableCount(), 1U);
+
+        auto handle = pool.acquire();
+        auto& program = handle.getProgram();
+        ASSERT_EQ(&program, firstProgram);
+        ASSERT_EQ(pool.size(), 1U);
+
+        // The previous state is gone.
+        ASSERT_EQ(program.size(), 0U);
+        ASSERT_EQ(program.getHead(), nullptr);
+        ASSERT_EQ(program.getEntryPoint().isValid(), false);
+        ASSERT_EQ(handle.getAssembler().getCursor(), nullptr);
+
+        const auto label = handle.getAssembler().createLabel("entry");
+        ASSERT_EQ(label.getId(), static_cast<Label::Id>(0));
+        ASSERT_STREQ(program.getLabelName(label), "entry");
+
+        // A second concurrent user gets a new pair.
+        auto handle2 = pool.acquire();
+        ASSERT_NE(&handle2.getProgram(), &program);
+        ASSERT_EQ(pool.size(), 2U);
+
+        handle2.release();
+        ASSERT_FALSE(handle2.isValid());
+        ASSERT_EQ(pool.getAvailableCount(), 1U);
+
+        // Counts the nodes created after it was registered.
+        struct CreateObserver final : Observer
+        {
+            std::size_t nodesCreated{};
+
+            void onNodeCreated(Node*) override
+            {
+                nodesCreated++;
+            }
+        };
+        CreateObserver observer;
+
+        // A prefix that was never consumed and a registered observer must not leak into the next user.
+        handle.getProgram().addObserver(observer);
+        handle.getAssembler().lock();
+        handle.release();
+
+        auto handle3 = pool.acquire();
+        ASSERT_EQ(&handle3.getProgram(), firstProgram);
+        ASSERT_EQ(handle3.getAssembler().add(x86::dword_ptr(x86::rax), x86::ecx), ErrorCode::None);
+        ASSERT_EQ(observer.nodesCreated, 0U);
+
+        const auto* node = handle3.getProgram().getHead();
+        ASSERT_NE(node, nullptr);
+        ASSERT_EQ(node->get<Instruction>().getAttribs(), x86::Attribs::None);
+
+        Serializer serializer;
+        ASSERT_EQ(serializer.serialize(handle3.getProgram(), 0x0000000000401000), ErrorCode::None);
+
+        const std::array<uint8_t, 2> expected = { 0x01, 0x08 };
+        ASSERT_EQ(serializer.getCodeSize(), expected.size());
+        ASSERT_EQ(std::memcmp(serializer.getCode(), expected.data(), expected.size()), 0);
+    }
+
+    TEST(ProgramTests, ProgramPoolMultiThreaded)
+    {
+        ProgramPool pool(MachineMode::AMD64);
+
+        constexpr std::size_t kThreadCount = 4;
+        constexpr std::size_t kRequestsPerThread = 200;
+
+        std::vector<std::size_t> codeSizes(kThreadCount);
+        std::vector<std::thread> threads;
+        for (std::size_t threadIdx = 0; threadIdx < kThreadCount; ++threadIdx)
+        {
+            threads.emplace_back([&pool, &codeSize = codeSizes[threadIdx]]() {
+                Serializer serializer;
+                for (std::size_t i = 0; i < kRequestsPerThread; ++i)
+                {
+                    auto handle = pool.acquire();
+                    auto& assembler = handle.getAssembler();
+
+                    const auto label = assembler.createLabel();
+                    assembler.bind(label);
+                    assembler.mov(x86::eax, Imm(i));
+                    assembler.jmp(label);
+
+                    if (serializer.serialize(handle.getProgram(), 0x1000) != ErrorCode::None)
+                    {
+                        return;
+                    }
+                    codeSize += serializer.getCodeSize();
+                }
+            });
+        }
+
+        for (auto& thread : threads)
+        {
+            thread.join();
+        }
+
+        for (const auto codeSize : codeSizes)
+        {
+            ASSERT_EQ(codeSize, kRequestsPerThread * 7);
+        }
+        ASSERT_LE(pool.size(), kThreadCount);
+        ASSERT_EQ(pool.getAvailableCount(), pool.size());
+    }
+
 } // namespace zasm::tests
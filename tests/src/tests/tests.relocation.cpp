@@ -1,6 +1,9 @@
 #include "../testutils.hpp"
 
+#include <array>
+#include <cstring>
 #include <gtest/gtest.h>
+#include <vector>
 #include <zasm/zasm.hpp>
 
 namespace zasm::tests
@@ -394,4 +397,171 @@ namespace zasm::tests
         }
     }
 
+    TEST(RelocationTests, MovRcxLabelImm32X64)
+    {
+        Program program(MachineMode::AMD64);
+
+        x86::Assembler assembler(program);
+
+        auto label = assembler.createLabel();
+        ASSERT_EQ(assembler.bind(label), ErrorCode::None);
+        ASSERT_EQ(assembler.mov(x86::rcx, label), ErrorCode::None);
+
+        Serializer serializer;
+        ASSERT_EQ(serializer.serialize(program, 0x0000000000401000), ErrorCode::None);
+
+        const std::array<uint8_t, 7> expected = {
+            0x48, 0xC7, 0xC1, 0x00, 0x10, 0x40, 0x00,
+        };
+        ASSERT_EQ(serializer.getCodeSize(), expected.size());
+
+        const auto* data = serializer.getCode();
+        ASSERT_NE(data, nullptr);
+        for (size_t i = 0; i < expected.size(); i++)
+        {
+            ASSERT_EQ(data[i], expected[i]);
+        }
+
+        ASSERT_EQ(serializer.getRelocationCount(), 1);
+        const auto* relocInfo = serializer.getRelocation(0);
+        ASSERT_EQ(relocInfo->kind, RelocationType::Abs);
+        ASSERT_EQ(relocInfo->address, 0x0000000000401003);
+        ASSERT_EQ(relocInfo->size, BitSize::_32);
+        ASSERT_EQ(relocInfo->offset, 3);
+    }
+
+    TEST(RelocationTests, MovMemImmX64)
+    {
+        Program program(MachineMode::AMD64);
+
+        x86::Assembler assembler(program);
+
+        ASSERT_EQ(assembler.mov(x86::dword_ptr(0x1000), Imm(0x55)), ErrorCode::None);
+
+        Serializer serializer;
+        ASSERT_EQ(serializer.serialize(program, 0x0000000000401000), ErrorCode::None);
+
+        const std::array<uint8_t, 11> expected = {
+            0xC7, 0x04, 0x25, 0x00, 0x10, 0x00, 0x00, 0x55, 0x00, 0x00, 0x00,
+        };
+        ASSERT_EQ(serializer.getCodeSize(), expected.size());
+
+        const auto* data = serializer.getCode();
+        ASSERT_NE(data, nullptr);
+        for (size_t i = 0; i < expected.size(); i++)
+        {
+            ASSERT_EQ(data[i], expected[i]);
+        }
+
+        // The displacement is followed by the immediate.
+        ASSERT_EQ(serializer.getRelocationCount(), 1);
+        const auto* relocInfo = serializer.getRelocation(0);
+        ASSERT_EQ(relocInfo->kind, RelocationType::Abs);
+        ASSERT_EQ(relocInfo->address, 0x0000000000401003);
+        ASSERT_EQ(relocInfo->size, BitSize::_32);
+        ASSERT_EQ(relocInfo->offset, 3);
+    }
+
+    TEST(RelocationTests, EncoderRelocFieldX64)
+    {
+        const auto res = encode(
+            MachineMode::AMD64, x86::Attribs::None, x86::Mnemonic::Mov, 2,
+            std::array<Operand, 2>{ x86::rdx, x86::qword_ptr(0x12345678) }.data());
+        ASSERT_TRUE(res);
+
+        ASSERT_EQ(res->relocKind, RelocationType::Abs);
+        ASSERT_EQ(res->relocData, RelocationData::Memory);
+        ASSERT_EQ(res->relocSize, 4);
+        ASSERT_EQ(res->relocOffset, res->buffer.length - 4);
+    }
+
+    TEST(RelocationTests, EncoderRelocFieldMoffsX64)
+    {
+        // The high half of the address is equal to the low half.
+        const auto res = encode(
+            MachineMode::AMD64, x86::Attribs::None, x86::Mnemonic::Mov, 2,
+            std::array<Operand, 2>{ x86::rax, x86::qword_ptr(0x1234567812345678) }.data());
+        ASSERT_TRUE(res);
+
+        // mov rax, moffs64
+        ASSERT_EQ(res->buffer.length, 10);
+        ASSERT_EQ(res->buffer.data[1], 0xA1);
+
+        ASSERT_EQ(res->relocKind, RelocationType::Abs);
+        ASSERT_EQ(res->relocData, RelocationData::Memory);
+        ASSERT_EQ(res->relocSize, 8);
+        ASSERT_EQ(res->relocOffset, 2);
+    }
+
+    TEST(RelocationTests, RelocateFailureKeepsStateX86)
+    {
+        Program program(MachineMode::I386);
+
+        x86::Assembler assembler(program);
+
+        auto label = assembler.createLabel();
+        ASSERT_EQ(assembler.bind(label), ErrorCode::None);
+        ASSERT_EQ(assembler.mov(x86::eax, x86::dword_ptr(label)), ErrorCode::None);
+        ASSERT_EQ(assembler.embedLabel(label), ErrorCode::None);
+
+        Serializer serializer;
+        ASSERT_EQ(serializer.serialize(program, 0x0000000000401000), ErrorCode::None);
+
+        const std::vector<uint8_t> code(serializer.getCode(), serializer.getCode() + serializer.getCodeSize());
+
+        // The 32 bit slots can not hold the new address.
+        ASSERT_EQ(serializer.relocate(0x0000000100401000), ErrorCode::ImpossibleRelocation);
+        ASSERT_EQ(serializer.getBase(), 0x0000000000401000);
+        ASSERT_EQ(serializer.getLabelAddress(label.getId()), 0x0000000000401000);
+        ASSERT_EQ(serializer.getRelocation(0)->address, 0x0000000000401001);
+        ASSERT_EQ(std::memcmp(serializer.getCode(), code.data(), code.size()), 0);
+
+        ASSERT_EQ(serializer.relocate(0x0000000000001000), ErrorCode::None);
+        ASSERT_EQ(serializer.getLabelAddress(label.getId()), 0x0000000000001000);
+        ASSERT_EQ(serializer.getCode()[3], 0x00);
+    }
+
+    TEST(RelocationTests, RelocateIntoX64)
+    {
+        Program program(MachineMode::AMD64);
+
+        x86::Assembler assembler(program);
+
+        auto label = assembler.createLabel();
+        ASSERT_EQ(assembler.bind(label), ErrorCode::None);
+        ASSERT_EQ(assembler.mov(x86::rax, label), ErrorCode::None);
+        ASSERT_EQ(assembler.mov(x86::ecx, x86::dword_ptr(label)), ErrorCode::None);
+        ASSERT_EQ(assembler.embedLabel(label), ErrorCode::None);
+
+        Serializer serializer;
+        ASSERT_EQ(serializer.serialize(program, 0x0000000000401000), ErrorCode::None);
+
+        const std::array<std::int64_t, 3> bases = { 0x0000000000501000, 0x0000000000001000, 0x0000000000401000 };
+
+        std::array<std::vector<std::uint8_t>, 3> outputs;
+        std::array<std::uint8_t*, 3> buffers{};
+        for (std::size_t i = 0; i < outputs.size(); i++)
+        {
+            outputs[i].resize(serializer.getCodeSize());
+            buffers[i] = outputs[i].data();
+        }
+
+        ASSERT_EQ(serializer.relocateInto(bases.data(), buffers.data(), bases.size()), ErrorCode::None);
+
+        // The serializer itself is not modified.
+        ASSERT_EQ(serializer.getBase(), 0x0000000000401000);
+
+        for (std::size_t i = 0; i < bases.size(); i++)
+        {
+            Serializer expected;
+            ASSERT_EQ(expected.serialize(program, bases[i]), ErrorCode::None);
+            ASSERT_EQ(expected.getCodeSize(), outputs[i].size());
+            ASSERT_EQ(std::memcmp(expected.getCode(), outputs[i].data(), outputs[i].size()), 0);
+        }
+
+        // Out of range for the 32 bit displacement.
+        const std::int64_t badBase = 0x0000000100000000;
+        ASSERT_EQ(serializer.relocateInto(&badBase, buffers.data(), 1), ErrorCode::ImpossibleRelocation);
+    }
+
 } // namespace zasm::tests
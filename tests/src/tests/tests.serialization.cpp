@@ -1,5 +1,11 @@
+#include "../testutils.hpp"
+
 #include <cstddef>
+#include <cstring>
 #include <gtest/gtest.h>
+#include <string>
+#include <vector>
+#include <zasm/core/memorystream.hpp>
 #include <zasm/zasm.hpp>
 
 namespace zasm::tests
@@ -1388,4 +1394,721 @@ namespace zasm::tests
         }
     }
 
+    TEST(SerializationTests, RelaxForwardBranchesX64)
+    {
+        Program program(MachineMode::AMD64);
+
+        x86::Assembler assembler(program);
+
+        constexpr int kNumBranches = 50;
+        constexpr int kNumNops = 10;
+
+        auto labelEnd = assembler.createLabel();
+        ASSERT_EQ(assembler.jmp(labelEnd), ErrorCode::None);
+        for (int i = 0; i < kNumBranches; i++)
+        {
+            auto label = assembler.createLabel();
+            ASSERT_EQ(assembler.jz(label), ErrorCode::None);
+            for (int n = 0; n < kNumNops; n++)
+            {
+                ASSERT_EQ(assembler.nop(), ErrorCode::None);
+            }
+            ASSERT_EQ(assembler.bind(label), ErrorCode::None);
+        }
+        ASSERT_EQ(assembler.bind(labelEnd), ErrorCode::None);
+        ASSERT_EQ(assembler.ret(), ErrorCode::None);
+
+        Serializer serializer;
+        ASSERT_EQ(serializer.serialize(program, 0x0000000000401000), ErrorCode::None);
+
+        // Initial pass with unknown labels and a single pass to emit the final code.
+        ASSERT_EQ(serializer.getPassCount(), 2);
+
+        constexpr auto kBlockSize = 2 + kNumNops;
+        ASSERT_EQ(serializer.getCodeSize(), 5 + kNumBranches * kBlockSize + 1);
+
+        const auto* data = serializer.getCode();
+        ASSERT_NE(data, nullptr);
+
+        // The jump to the end is out of rel8 range.
+        const std::array<std::uint8_t, 5> expectedJmp = { 0xE9, 0x58, 0x02, 0x00, 0x00 };
+        for (std::size_t i = 0; i < expectedJmp.size(); i++)
+        {
+            ASSERT_EQ(data[i], expectedJmp[i]);
+        }
+
+        // Every jz is short.
+        for (int i = 0; i < kNumBranches; i++)
+        {
+            ASSERT_EQ(data[5 + i * kBlockSize], 0x74);
+            ASSERT_EQ(data[5 + i * kBlockSize + 1], kNumNops);
+        }
+
+        ASSERT_EQ(serializer.getLabelAddress(labelEnd.getId()), 0x0000000000401000 + 5 + kNumBranches * kBlockSize);
+    }
+
+    static void expectSameSerialization(const Serializer& serializer, const Program& program, std::int64_t base)
+    {
+        Serializer reference;
+        ASSERT_EQ(reference.serialize(program, base), ErrorCode::None);
+
+        ASSERT_EQ(serializer.getCodeSize(), reference.getCodeSize());
+        for (std::size_t i = 0; i < reference.getCodeSize(); i++)
+        {
+            ASSERT_EQ(serializer.getCode()[i], reference.getCode()[i]);
+        }
+
+        ASSERT_EQ(serializer.getRelocationCount(), reference.getRelocationCount());
+        for (std::size_t i = 0; i < reference.getRelocationCount(); i++)
+        {
+            ASSERT_EQ(serializer.getRelocation(i)->offset, reference.getRelocation(i)->offset);
+            ASSERT_EQ(serializer.getRelocation(i)->size, reference.getRelocation(i)->size);
+        }
+    }
+
+    TEST(SerializationTests, IncrementalInsertX64)
+    {
+        Program program(MachineMode::AMD64);
+
+        x86::Assembler assembler(program);
+
+        auto labelLoop = assembler.createLabel();
+        auto labelExit = assembler.createLabel();
+
+        ASSERT_EQ(assembler.bind(labelLoop), ErrorCode::None);
+        ASSERT_EQ(assembler.mov(x86::rax, x86::rbx), ErrorCode::None);
+        ASSERT_EQ(assembler.test(x86::rax, x86::rax), ErrorCode::None);
+        ASSERT_EQ(assembler.jz(labelExit), ErrorCode::None);
+        auto* patchPos = assembler.getCursor();
+        ASSERT_EQ(assembler.lea(x86::rcx, x86::qword_ptr(x86::rip, labelExit)), ErrorCode::None);
+        ASSERT_EQ(assembler.mov(x86::rdx, x86::qword_ptr(0x1000)), ErrorCode::None);
+        ASSERT_EQ(assembler.jmp(labelLoop), ErrorCode::None);
+        ASSERT_EQ(assembler.bind(labelExit), ErrorCode::None);
+        ASSERT_EQ(assembler.ret(), ErrorCode::None);
+
+        Serializer serializer;
+        serializer.enableIncremental(program);
+        ASSERT_TRUE(serializer.isIncremental());
+
+        ASSERT_EQ(serializer.serialize(program, 0x0000000000401000), ErrorCode::None);
+        expectSameSerialization(serializer, program, 0x0000000000401000);
+
+        // Grow the code between the branch and its target.
+        assembler.setCursor(patchPos);
+        for (int i = 0; i < 200; i++)
+        {
+            ASSERT_EQ(assembler.nop(), ErrorCode::None);
+        }
+
+        ASSERT_EQ(serializer.serialize(program, 0x0000000000401000), ErrorCode::None);
+        expectSameSerialization(serializer, program, 0x0000000000401000);
+        ASSERT_EQ(serializer.getLabelAddress(labelLoop.getId()), 0x0000000000401000);
+
+        // Remove it again.
+        for (int i = 0; i < 200; i++)
+        {
+            program.destroy(patchPos->getNext());
+        }
+
+        ASSERT_EQ(serializer.serialize(program, 0x0000000000401000), ErrorCode::None);
+        expectSameSerialization(serializer, program, 0x0000000000401000);
+
+        // Different base.
+        ASSERT_EQ(serializer.serialize(program, 0x0000000140001000), ErrorCode::None);
+        expectSameSerialization(serializer, program, 0x0000000140001000);
+    }
+
+    TEST(SerializationTests, IncrementalModifyInPlaceX64)
+    {
+        Program program(MachineMode::AMD64);
+
+        x86::Assembler assembler(program);
+
+        ASSERT_EQ(assembler.mov(x86::rax, Imm(1)), ErrorCode::None);
+        auto* node = assembler.getCursor();
+        ASSERT_EQ(assembler.ret(), ErrorCode::None);
+
+        Serializer serializer;
+        serializer.enableIncremental(program);
+        ASSERT_EQ(serializer.serialize(program, 0x0000000000401000), ErrorCode::None);
+
+        node->get<Instruction>().setOperand(1, Imm(std::int64_t{ 0x7FFFFFFFFF }));
+        serializer.invalidate(node);
+
+        ASSERT_EQ(serializer.serialize(program, 0x0000000000401000), ErrorCode::None);
+        expectSameSerialization(serializer, program, 0x0000000000401000);
+
+        serializer.disableIncremental();
+        ASSERT_FALSE(serializer.isIncremental());
+    }
+
+    TEST(SerializationTests, IncrementalCopyRangesX64)
+    {
+        Program program(MachineMode::AMD64);
+
+        x86::Assembler assembler(program);
+
+        auto labelLoop = assembler.createLabel();
+        ASSERT_EQ(assembler.bind(labelLoop), ErrorCode::None);
+
+        Node* patchNode = nullptr;
+        for (int i = 0; i < 1000; i++)
+        {
+            ASSERT_EQ(assembler.add(x86::rcx, Imm(i)), ErrorCode::None);
+            if (i == 500)
+            {
+                ASSERT_EQ(assembler.mov(x86::rax, Imm(1)), ErrorCode::None);
+                patchNode = assembler.getCursor();
+            }
+        }
+        ASSERT_EQ(assembler.lea(x86::rdx, x86::qword_ptr(x86::rip, labelLoop)), ErrorCode::None);
+        ASSERT_EQ(assembler.jmp(labelLoop), ErrorCode::None);
+
+        Serializer serializer;
+        serializer.enableIncremental(program);
+        serializer.setStatsEnabled(true);
+        ASSERT_EQ(serializer.serialize(program, 0x0000000000401000), ErrorCode::None);
+
+        // Only the patched node and the two nodes that depend on their address are encoded again.
+        constexpr std::size_t kMaxEncoded = 3;
+
+        // Same size.
+        patchNode->get<Instruction>().setOperand(1, Imm(2));
+        serializer.invalidate(patchNode);
+
+        ASSERT_EQ(serializer.serialize(program, 0x0000000000401000), ErrorCode::None);
+        expectSameSerialization(serializer, program, 0x0000000000401000);
+        ASSERT_EQ(serializer.getStats().passCount, 1);
+        ASSERT_LE(serializer.getStats().encodedInstructions, kMaxEncoded);
+
+        // Different size, the nodes after it are moved.
+        patchNode->get<Instruction>().setOperand(1, Imm(std::int64_t{ 0x7FFFFFFFFF }));
+        serializer.invalidate(patchNode);
+
+        ASSERT_EQ(serializer.serialize(program, 0x0000000000401000), ErrorCode::None);
+        expectSameSerialization(serializer, program, 0x0000000000401000);
+        ASSERT_EQ(serializer.getStats().passCount, 1);
+        ASSERT_LE(serializer.getStats().encodedInstructions, kMaxEncoded);
+
+        // Insert and remove nodes.
+        assembler.setCursor(patchNode);
+        ASSERT_EQ(assembler.nop(), ErrorCode::None);
+        auto* insertedNode = assembler.getCursor();
+
+        ASSERT_EQ(serializer.serialize(program, 0x0000000000401000), ErrorCode::None);
+        expectSameSerialization(serializer, program, 0x0000000000401000);
+        ASSERT_LE(serializer.getStats().encodedInstructions, kMaxEncoded);
+
+        program.destroy(insertedNode);
+        program.moveAfter(program.getHead(), patchNode);
+
+        ASSERT_EQ(serializer.serialize(program, 0x0000000000401000), ErrorCode::None);
+        expectSameSerialization(serializer, program, 0x0000000000401000);
+        ASSERT_LE(serializer.getStats().encodedInstructions, kMaxEncoded);
+
+        // Different base.
+        ASSERT_EQ(serializer.serialize(program, 0x0000000140001000), ErrorCode::None);
+        expectSameSerialization(serializer, program, 0x0000000140001000);
+    }
+
+    TEST(SerializationTests, IncrementalUnboundLabel)
+    {
+        Program program(MachineMode::AMD64);
+
+        x86::Assembler assembler(program);
+
+        auto label = assembler.createLabel();
+        ASSERT_EQ(assembler.jmp(label), ErrorCode::None);
+        ASSERT_EQ(assembler.bind(label), ErrorCode::None);
+        auto* labelNode = assembler.getCursor();
+        ASSERT_EQ(assembler.ret(), ErrorCode::None);
+
+        Serializer serializer;
+        serializer.enableIncremental(program);
+        ASSERT_EQ(serializer.serialize(program, 0x0000000000401000), ErrorCode::None);
+
+        program.destroy(labelNode);
+
+        ASSERT_EQ(serializer.serialize(program, 0x0000000000401000), ErrorCode::UnresolvedLabel);
+    }
+
+    TEST(SerializationTests, EncoderCacheX64)
+    {
+        Program program(MachineMode::AMD64);
+
+        x86::Assembler assembler(program);
+
+        auto label = assembler.createLabel();
+        ASSERT_EQ(assembler.bind(label), ErrorCode::None);
+        ASSERT_EQ(assembler.mov(x86::rax, x86::rbx), ErrorCode::None);
+        ASSERT_EQ(assembler.add(x86::eax, Imm(1)), ErrorCode::None);
+        ASSERT_EQ(assembler.mov(x86::rax, x86::rbx), ErrorCode::None);
+        ASSERT_EQ(assembler.lea(x86::rcx, x86::qword_ptr(label)), ErrorCode::None);
+        ASSERT_EQ(assembler.jnz(label), ErrorCode::None);
+        ASSERT_EQ(assembler.ret(), ErrorCode::None);
+
+        Serializer reference;
+        ASSERT_EQ(reference.serialize(program, 0x0000000000401000), ErrorCode::None);
+
+        EncoderCache cache;
+        Serializer serializer;
+        serializer.setEncoderCache(&cache);
+        ASSERT_EQ(serializer.getEncoderCache(), &cache);
+
+        ASSERT_EQ(serializer.serialize(program, 0x0000000000401000), ErrorCode::None);
+        ASSERT_EQ(serializer.getCodeSize(), reference.getCodeSize());
+        ASSERT_EQ(std::memcmp(serializer.getCode(), reference.getCode(), reference.getCodeSize()), 0);
+
+        // mov, add and ret are cached, the second mov is a hit, lea and jnz depend on the label.
+        ASSERT_EQ(cache.size(), 3U);
+        ASSERT_EQ(cache.getMissCount(), 3U);
+        ASSERT_EQ(cache.getHitCount(), 1U);
+
+        ASSERT_EQ(serializer.serialize(program, 0x0000000140001000), ErrorCode::None);
+        ASSERT_EQ(reference.serialize(program, 0x0000000140001000), ErrorCode::None);
+        ASSERT_EQ(serializer.getCodeSize(), reference.getCodeSize());
+        ASSERT_EQ(std::memcmp(serializer.getCode(), reference.getCode(), reference.getCodeSize()), 0);
+
+        ASSERT_EQ(cache.getMissCount(), 3U);
+        ASSERT_EQ(cache.getHitCount(), 5U);
+
+        cache.clear();
+        ASSERT_EQ(cache.size(), 0U);
+        ASSERT_EQ(cache.getHitCount(), 0U);
+        ASSERT_EQ(cache.getMissCount(), 0U);
+    }
+
+    TEST(SerializationTests, EncoderCacheCapacityX64)
+    {
+        Program program(MachineMode::AMD64);
+
+        x86::Assembler assembler(program);
+        ASSERT_EQ(assembler.mov(x86::rax, x86::rbx), ErrorCode::None);
+        ASSERT_EQ(assembler.add(x86::eax, Imm(1)), ErrorCode::None);
+        ASSERT_EQ(assembler.mov(x86::rax, x86::rbx), ErrorCode::None);
+        ASSERT_EQ(assembler.ret(), ErrorCode::None);
+
+        Serializer reference;
+        ASSERT_EQ(reference.serialize(program, 0x0000000000401000), ErrorCode::None);
+
+        EncoderCache cache(2);
+        ASSERT_EQ(cache.getCapacity(), 2U);
+
+        Serializer serializer;
+        serializer.setEncoderCache(&cache);
+        ASSERT_EQ(serializer.serialize(program, 0x0000000000401000), ErrorCode::None);
+        ASSERT_EQ(serializer.getCodeSize(), reference.getCodeSize());
+        ASSERT_EQ(std::memcmp(serializer.getCode(), reference.getCode(), reference.getCodeSize()), 0);
+
+        // mov and add fill the cache, ret evicts both.
+        ASSERT_EQ(cache.size(), 1U);
+        ASSERT_EQ(cache.getEvictionCount(), 2U);
+        ASSERT_EQ(cache.getHitCount(), 1U);
+
+        cache.clear();
+        ASSERT_EQ(cache.getEvictionCount(), 0U);
+
+        // Caching is disabled without capacity.
+        EncoderCache disabledCache(0);
+        serializer.setEncoderCache(&disabledCache);
+        ASSERT_EQ(serializer.serialize(program, 0x0000000000401000), ErrorCode::None);
+        ASSERT_EQ(std::memcmp(serializer.getCode(), reference.getCode(), reference.getCodeSize()), 0);
+        ASSERT_EQ(disabledCache.size(), 0U);
+    }
+
+    static void buildSectionedProgram(x86::Assembler& a, std::size_t sectionCount, std::size_t blockCount)
+    {
+        auto labelData = a.createLabel();
+        auto labelEntry = a.createLabel();
+
+        for (std::size_t sect = 0; sect < sectionCount; ++sect)
+        {
+            const auto name = std::string(".text") + std::to_string(sect);
+            ASSERT_EQ(a.section(name.c_str()), ErrorCode::None);
+
+            if (sect == 0)
+            {
+                ASSERT_EQ(a.bind(labelEntry), ErrorCode::None);
+            }
+
+            auto labelLoop = a.createLabel();
+            ASSERT_EQ(a.bind(labelLoop), ErrorCode::None);
+            for (std::size_t i = 0; i < blockCount; ++i)
+            {
+                ASSERT_EQ(a.mov(x86::rax, x86::rbx), ErrorCode::None);
+                ASSERT_EQ(a.add(x86::ecx, Imm(i)), ErrorCode::None);
+                ASSERT_EQ(a.mov(x86::rdx, x86::qword_ptr(x86::rsp, static_cast<std::int32_t>(i * 8))), ErrorCode::None);
+                ASSERT_EQ(a.push(x86::rbx), ErrorCode::None);
+                ASSERT_EQ(a.pop(x86::rbx), ErrorCode::None);
+                if (i % 16 == 0)
+                {
+                    ASSERT_EQ(a.jnz(labelLoop), ErrorCode::None);
+                    ASSERT_EQ(a.lea(x86::rcx, x86::qword_ptr(x86::rip, labelData)), ErrorCode::None);
+                    ASSERT_EQ(a.call(labelEntry), ErrorCode::None);
+                    ASSERT_EQ(a.mov(x86::rax, labelData), ErrorCode::None);
+                }
+            }
+            ASSERT_EQ(a.align(Align::Type::Code, 16), ErrorCode::None);
+            ASSERT_EQ(a.ret(), ErrorCode::None);
+        }
+
+        ASSERT_EQ(a.section(".data", Section::Attribs::Data | Section::Attribs::Read), ErrorCode::None);
+        ASSERT_EQ(a.bind(labelData), ErrorCode::None);
+        ASSERT_EQ(a.dq(0x1122334455667788), ErrorCode::None);
+        ASSERT_EQ(a.embedLabel(labelEntry), ErrorCode::None);
+    }
+
+    static void expectSameSections(const Serializer& serializer, const Serializer& reference)
+    {
+        ASSERT_EQ(serializer.getSectionCount(), reference.getSectionCount());
+        for (std::size_t i = 0; i < reference.getSectionCount(); i++)
+        {
+            ASSERT_EQ(serializer.getSectionInfo(i)->address, reference.getSectionInfo(i)->address);
+            ASSERT_EQ(serializer.getSectionInfo(i)->physicalSize, reference.getSectionInfo(i)->physicalSize);
+        }
+    }
+
+    TEST(SerializationTests, ParallelSectionsX64)
+    {
+        Program program(MachineMode::AMD64);
+
+        x86::Assembler assembler(program);
+        buildSectionedProgram(assembler, 8, 64);
+
+        Serializer reference;
+        ASSERT_EQ(reference.serialize(program, 0x0000000140001000), ErrorCode::None);
+
+        for (std::size_t threadCount : { 2U, 3U, 8U })
+        {
+            Serializer serializer;
+            serializer.setThreadCount(threadCount);
+            ASSERT_EQ(serializer.getThreadCount(), threadCount);
+
+            ASSERT_EQ(serializer.serialize(program, 0x0000000140001000), ErrorCode::None);
+            expectSameSerialization(serializer, program, 0x0000000140001000);
+            expectSameSections(serializer, reference);
+            ASSERT_EQ(serializer.getPassCount(), reference.getPassCount());
+        }
+    }
+
+    TEST(SerializationTests, ParallelRangesX64)
+    {
+        Program program(MachineMode::AMD64);
+
+        x86::Assembler assembler(program);
+        buildSectionedProgram(assembler, 1, 256);
+
+        Serializer reference;
+        ASSERT_EQ(reference.serialize(program, 0x0000000000401000), ErrorCode::None);
+
+        // Split the program into ranges of equal size.
+        std::vector<SerializerRange> ranges;
+        std::size_t nodeIndex = 0;
+        for (const auto* node = program.getHead(); node != nullptr; node = node->getNext(), ++nodeIndex)
+        {
+            if (nodeIndex % 100 == 0)
+            {
+                ranges.push_back({ node, node });
+            }
+            ranges.back().last = node;
+        }
+        ASSERT_GT(ranges.size(), 1U);
+
+        Serializer serializer;
+        serializer.setThreadCount(4);
+        ASSERT_EQ(serializer.serializeRanges(program, 0x0000000000401000, ranges.data(), ranges.size()), ErrorCode::None);
+        expectSameSerialization(serializer, program, 0x0000000000401000);
+        expectSameSections(serializer, reference);
+
+        // Ranges with a gap are rejected.
+        std::swap(ranges[0], ranges[1]);
+        ASSERT_EQ(
+            serializer.serializeRanges(program, 0x0000000000401000, ranges.data(), ranges.size()), ErrorCode::InvalidParameter);
+        ASSERT_EQ(serializer.serializeRanges(program, 0x0000000000401000, nullptr, 0), ErrorCode::InvalidParameter);
+    }
+
+    TEST(SerializationTests, ParallelEncodeErrorX64)
+    {
+        Program program(MachineMode::AMD64);
+
+        x86::Assembler assembler(program);
+        buildSectionedProgram(assembler, 4, 64);
+
+        // Invalid instruction in the middle of the program.
+        auto* node = program.getHead();
+        for (std::size_t i = 0; i < program.size() / 2; ++i)
+        {
+            node = node->getNext();
+        }
+        assembler.setCursor(node);
+        ASSERT_EQ(assembler.and_(x86::rbp, Imm64(0x123456789ABCDF)), ErrorCode::None);
+
+        Serializer serializer;
+        serializer.setThreadCount(4);
+        ASSERT_EQ(serializer.serialize(program, 0x0000000000401000), ErrorCode::ImpossibleInstruction);
+    }
+
+    // Grows to exactly the requested size and records the requests.
+    class VectorCodeSink final : public ICodeSink
+    {
+    public:
+        std::vector<std::uint8_t> data;
+        std::size_t growCount{};
+        std::size_t lastRequiredSize{};
+
+        CodeSpan grow(std::size_t usedSize, std::size_t requiredSize) override
+        {
+            EXPECT_LE(usedSize, data.size());
+            data.resize(requiredSize);
+            growCount++;
+            lastRequiredSize = requiredSize;
+            return { data.data(), data.size() };
+        }
+    };
+
+    TEST(SerializationTests, SerializeToFixedSinkX64)
+    {
+        Program program(MachineMode::AMD64);
+
+        x86::Assembler assembler(program);
+        buildSectionedProgram(assembler, 2, 64);
+
+        Serializer reference;
+        ASSERT_EQ(reference.serialize(program, 0x0000000140001000), ErrorCode::None);
+
+        std::vector<std::uint8_t> memory(reference.getCodeSize() + 16, 0xFF);
+        FixedCodeSink sink(memory.data(), memory.size());
+
+        Serializer serializer;
+        ASSERT_EQ(serializer.serialize(program, 0x0000000140001000, sink), ErrorCode::None);
+        ASSERT_EQ(serializer.getCodeSize(), reference.getCodeSize());
+        ASSERT_EQ(serializer.getCode(), nullptr);
+        ASSERT_EQ(std::memcmp(memory.data(), reference.getCode(), reference.getCodeSize()), 0);
+        ASSERT_EQ(memory[reference.getCodeSize()], 0xFF);
+        expectSameSections(serializer, reference);
+
+        ASSERT_EQ(serializer.getRelocationCount(), reference.getRelocationCount());
+        ASSERT_EQ(serializer.relocate(0x0000000140002000), ErrorCode::EmptyState);
+
+        // Too small.
+        FixedCodeSink smallSink(memory.data(), reference.getCodeSize() - 1);
+        ASSERT_EQ(serializer.serialize(program, 0x0000000140001000, smallSink), ErrorCode::OutOfMemory);
+    }
+
+    TEST(SerializationTests, SerializeToGrowingSinkX64)
+    {
+        Program program(MachineMode::AMD64);
+
+        x86::Assembler assembler(program);
+        buildSectionedProgram(assembler, 2, 64);
+
+        Serializer reference;
+        ASSERT_EQ(reference.serialize(program, 0x0000000140001000), ErrorCode::None);
+
+        VectorCodeSink sink;
+
+        Serializer serializer;
+        ASSERT_EQ(serializer.serialize(program, 0x0000000140001000, sink), ErrorCode::None);
+        ASSERT_GT(serializer.getPassCount(), 1);
+
+        // The passes before the layout is final do not touch the sink.
+        ASSERT_EQ(sink.growCount, 1U);
+        ASSERT_EQ(sink.lastRequiredSize, reference.getCodeSize());
+        ASSERT_EQ(serializer.getCodeSize(), reference.getCodeSize());
+        ASSERT_EQ(std::memcmp(sink.data.data(), reference.getCode(), reference.getCodeSize()), 0);
+    }
+
+    TEST(SerializationTests, SerializeToSinkKeepsNoCopyX64)
+    {
+        Program program(MachineMode::AMD64);
+
+        // Mostly data so the code is much larger than the serializer state per node.
+        const std::vector<std::uint8_t> data(0x100000, 0xCC);
+
+        x86::Assembler assembler(program);
+        auto label = assembler.createLabel();
+        ASSERT_EQ(assembler.jmp(label), ErrorCode::None);
+        ASSERT_EQ(assembler.embed(data.data(), data.size()), ErrorCode::None);
+        ASSERT_EQ(assembler.bind(label), ErrorCode::None);
+        ASSERT_EQ(assembler.ret(), ErrorCode::None);
+
+        Serializer reference;
+        ASSERT_EQ(reference.serialize(program, 0x0000000140001000), ErrorCode::None);
+
+        const auto codeSize = static_cast<std::int64_t>(reference.getCodeSize());
+        std::vector<std::uint8_t> memory(reference.getCodeSize());
+        FixedCodeSink sink(memory.data(), memory.size());
+
+        const auto allocatedBefore = getAllocatedSize();
+
+        // The code of a regular serialization is kept by the serializer.
+        Serializer serializer;
+        ASSERT_EQ(serializer.serialize(program, 0x0000000140001000), ErrorCode::None);
+        ASSERT_GE(getAllocatedSize() - allocatedBefore, codeSize);
+
+        // Serializing to the sink releases it and does not keep a copy either.
+        ASSERT_EQ(serializer.serialize(program, 0x0000000140001000, sink), ErrorCode::None);
+        ASSERT_LT(getAllocatedSize() - allocatedBefore, codeSize / 16);
+
+        ASSERT_EQ(serializer.getCode(), nullptr);
+        ASSERT_EQ(serializer.getCodeSize(), reference.getCodeSize());
+        ASSERT_EQ(std::memcmp(memory.data(), reference.getCode(), reference.getCodeSize()), 0);
+    }
+
+    TEST(SerializationTests, SerializeToStreamX64)
+    {
+        Program program(MachineMode::AMD64);
+
+        x86::Assembler assembler(program);
+        buildSectionedProgram(assembler, 4, 2048);
+
+        Serializer reference;
+        ASSERT_EQ(reference.serialize(program, 0x0000000140001000), ErrorCode::None);
+
+        // Large enough to be written in multiple chunks.
+        ASSERT_GT(reference.getCodeSize(), 0x20000U);
+
+        MemoryStream codeStream;
+        MemoryStream relocStream;
+
+        Serializer serializer;
+        ASSERT_EQ(serializer.serialize(program, 0x0000000140001000, codeStream, &relocStream), ErrorCode::None);
+        ASSERT_EQ(serializer.getCode(), nullptr);
+        ASSERT_EQ(serializer.getCodeSize(), reference.getCodeSize());
+        ASSERT_EQ(codeStream.size(), reference.getCodeSize());
+        ASSERT_EQ(std::memcmp(codeStream.data(), reference.getCode(), reference.getCodeSize()), 0);
+        expectSameSections(serializer, reference);
+
+        // Relocations are only in the stream.
+        ASSERT_EQ(serializer.getRelocationCount(), 0U);
+        ASSERT_EQ(relocStream.size(), reference.getRelocationCount() * sizeof(RelocationInfo));
+
+        relocStream.seek(0, SeekType::Begin);
+        for (std::size_t i = 0; i < reference.getRelocationCount(); i++)
+        {
+            RelocationInfo reloc{};
+            ASSERT_EQ(relocStream.read(&reloc, sizeof(reloc)), sizeof(reloc));
+            ASSERT_EQ(reloc.offset, reference.getRelocation(i)->offset);
+            ASSERT_EQ(reloc.address, reference.getRelocation(i)->address);
+            ASSERT_EQ(reloc.size, reference.getRelocation(i)->size);
+        }
+
+        // Without relocation stream they are kept.
+        MemoryStream codeStream2;
+        ASSERT_EQ(serializer.serialize(program, 0x0000000140001000, codeStream2), ErrorCode::None);
+        ASSERT_EQ(std::memcmp(codeStream2.data(), reference.getCode(), reference.getCodeSize()), 0);
+        ASSERT_EQ(serializer.getRelocationCount(), reference.getRelocationCount());
+    }
+
+    TEST(SerializationTests, StatsX64)
+    {
+        Program program(MachineMode::AMD64);
+
+        x86::Assembler assembler(program);
+
+        auto labelData = assembler.createLabel();
+        auto labelExit = assembler.createLabel();
+        ASSERT_EQ(assembler.jmp(labelExit), ErrorCode::None);
+        ASSERT_EQ(assembler.mov(x86::rax, labelData), ErrorCode::None);
+        ASSERT_EQ(assembler.mov(x86::rcx, x86::qword_ptr(0x1000)), ErrorCode::None);
+        ASSERT_EQ(assembler.bind(labelExit), ErrorCode::None);
+        ASSERT_EQ(assembler.ret(), ErrorCode::None);
+        ASSERT_EQ(assembler.section(".data", Section::Attribs::Data | Section::Attribs::Read), ErrorCode::None);
+        ASSERT_EQ(assembler.bind(labelData), ErrorCode::None);
+        ASSERT_EQ(assembler.embedLabel(labelData), ErrorCode::None);
+
+        Serializer serializer;
+        ASSERT_FALSE(serializer.isStatsEnabled());
+        ASSERT_EQ(serializer.serialize(program, 0x0000000000401000), ErrorCode::None);
+        ASSERT_EQ(serializer.getStats().passCount, 0);
+        ASSERT_TRUE(serializer.getStats().resizedNodesPerPass.empty());
+
+        serializer.setStatsEnabled(true);
+        ASSERT_TRUE(serializer.isStatsEnabled());
+        ASSERT_EQ(serializer.serialize(program, 0x0000000000401000), ErrorCode::None);
+
+        const auto& stats = serializer.getStats();
+        ASSERT_EQ(stats.passCount, serializer.getPassCount());
+        ASSERT_EQ(stats.resizedNodesPerPass.size(), static_cast<std::size_t>(stats.passCount));
+        ASSERT_EQ(stats.resizedNodesPerPass[0], 0U);
+        ASSERT_GT(stats.encodedInstructions, 0U);
+        ASSERT_EQ(stats.codeSize, serializer.getCodeSize());
+
+        ASSERT_EQ(stats.sectionSizes.size(), serializer.getSectionCount());
+        for (std::size_t i = 0; i < serializer.getSectionCount(); i++)
+        {
+            ASSERT_EQ(stats.sectionSizes[i], serializer.getSectionInfo(i)->physicalSize);
+        }
+
+        // mov rax, label, mov rcx, [abs] and the embedded label.
+        ASSERT_EQ(stats.relocationsByType[static_cast<std::size_t>(RelocationType::Abs)], 3U);
+        ASSERT_EQ(stats.relocationsByData[static_cast<std::size_t>(RelocationData::Immediate)], 1U);
+        ASSERT_EQ(stats.relocationsByData[static_cast<std::size_t>(RelocationData::Memory)], 1U);
+        ASSERT_EQ(stats.relocationsByData[static_cast<std::size_t>(RelocationData::Data)], 1U);
+        ASSERT_EQ(serializer.getRelocationCount(), 3U);
+
+        serializer.setStatsEnabled(false);
+        ASSERT_EQ(serializer.getStats().passCount, 0);
+    }
+
+    TEST(SerializationTests, ReuseSerializerX64)
+    {
+        Program large(MachineMode::AMD64);
+        x86::Assembler assemblerLarge(large);
+        buildSectionedProgram(assemblerLarge, 4, 64);
+
+        Program small(MachineMode::AMD64);
+        x86::Assembler assemblerSmall(small);
+        auto label = assemblerSmall.createLabel();
+        ASSERT_EQ(assemblerSmall.bind(label), ErrorCode::None);
+        ASSERT_EQ(assemblerSmall.mov(x86::rax, label), ErrorCode::None);
+        ASSERT_EQ(assemblerSmall.jmp(label), ErrorCode::None);
+
+        Program small32(MachineMode::I386);
+        x86::Assembler assemblerSmall32(small32);
+        ASSERT_EQ(assemblerSmall32.mov(x86::eax, x86::dword_ptr(0x1000)), ErrorCode::None);
+        ASSERT_EQ(assemblerSmall32.ret(), ErrorCode::None);
+
+        // The scratch memory of a previous call must not leak into the result of the next one.
+        Serializer serializer;
+        for (const auto* program : { &large, &small, &small32, &small, &large })
+        {
+            ASSERT_EQ(serializer.serialize(*program, 0x0000000000401000), ErrorCode::None);
+
+            Serializer reference;
+            ASSERT_EQ(reference.serialize(*program, 0x0000000000401000), ErrorCode::None);
+            ASSERT_EQ(serializer.getCodeSize(), reference.getCodeSize());
+            ASSERT_EQ(std::memcmp(serializer.getCode(), reference.getCode(), reference.getCodeSize()), 0);
+            ASSERT_EQ(serializer.getRelocationCount(), reference.getRelocationCount());
+            expectSameSections(serializer, reference);
+        }
+    }
+
+    TEST(SerializationTests, ReuseSerializerNoAllocationX64)
+    {
+        Program program(MachineMode::AMD64);
+        x86::Assembler assembler(program);
+
+        auto label = assembler.createLabel();
+        ASSERT_EQ(assembler.bind(label), ErrorCode::None);
+        ASSERT_EQ(assembler.mov(x86::rax, label), ErrorCode::None);
+        ASSERT_EQ(assembler.lea(x86::rcx, x86::qword_ptr(x86::rip, label)), ErrorCode::None);
+        ASSERT_EQ(assembler.add(x86::rcx, Imm(4)), ErrorCode::None);
+        ASSERT_EQ(assembler.jmp(label), ErrorCode::None);
+
+        // The code buffer is swapped with the scratch buffer on every call, both have their capacity after two
+        // calls.
+        Serializer serializer;
+        ASSERT_EQ(serializer.serialize(program, 0x0000000000401000), ErrorCode::None);
+        ASSERT_EQ(serializer.serialize(program, 0x0000000000401000), ErrorCode::None);
+
+        const auto allocationsBefore = getAllocationCount();
+        const auto status = serializer.serialize(program, 0x0000000000401000);
+        const auto allocations = getAllocationCount() - allocationsBefore;
+
+        ASSERT_EQ(status, ErrorCode::None);
+        ASSERT_EQ(allocations, 0U);
+        ASSERT_GT(serializer.getRelocationCount(), 0U);
+    }
+
 } // namespace zasm::tests
@@ -0,0 +1,59 @@
+#include "../../../zasm/src/zasm/src/core/threadpool.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <gtest/gtest.h>
+#include <stdexcept>
+#include <thread>
+
+namespace zasm::tests
+{
+    TEST(ThreadPoolTests, RunAllTasks)
+    {
+        detail::ThreadPool pool;
+        pool.resize(4);
+
+        std::atomic<std::size_t> sum{};
+        pool.run(4, 100, [&](std::size_t idx) { sum += idx; });
+        ASSERT_EQ(sum, 4950U);
+    }
+
+    TEST(ThreadPoolTests, WorkerException)
+    {
+        constexpr std::size_t kTaskCount = 1000;
+
+        detail::ThreadPool pool;
+        pool.resize(4);
+
+        const auto callerId = std::this_thread::get_id();
+        std::atomic<bool> hasWorkerThrown{};
+        std::atomic<std::size_t> tasksRun{};
+
+        const auto task = [&](std::size_t) {
+            tasksRun++;
+            if (std::this_thread::get_id() != callerId)
+            {
+                hasWorkerThrown = true;
+                throw std::runtime_error("worker");
+            }
+
+            // Keep the calling thread busy until a worker has thrown.
+            const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+            while (!hasWorkerThrown && std::chrono::steady_clock::now() < deadline)
+            {
+                std::this_thread::yield();
+            }
+        };
+        ASSERT_THROW(pool.run(4, kTaskCount, task), std::runtime_error);
+
+        // The remaining tasks were not handed out.
+        ASSERT_TRUE(hasWorkerThrown);
+        ASSERT_LT(tasksRun, kTaskCount);
+
+        // The pool is still usable.
+        std::atomic<std::size_t> count{};
+        pool.run(4, 100, [&](std::size_t) { count++; });
+        ASSERT_EQ(count, 100U);
+    }
+
+} // namespace zasm::tests
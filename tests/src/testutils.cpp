@@ -1,5 +1,75 @@
 #include "testutils.hpp"
 
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+
+// Per thread so that allocations of other threads such as the ones of gtest or thread pools are not counted.
+static thread_local std::size_t allocationCount{};
+static thread_local std::int64_t allocatedSize{};
+
+// Each allocation is prefixed with its size so the amount of live memory can be tracked.
+static constexpr std::size_t kAllocationHeaderSize = alignof(std::max_align_t);
+
+static void* allocate(std::size_t size) noexcept
+{
+    auto* ptr = static_cast<std::uint8_t*>(std::malloc(kAllocationHeaderSize + size));
+    if (ptr == nullptr)
+    {
+        return nullptr;
+    }
+
+    *reinterpret_cast<std::size_t*>(ptr) = size;
+    allocationCount++;
+    allocatedSize += static_cast<std::int64_t>(size);
+
+    return ptr + kAllocationHeaderSize;
+}
+
+static void deallocate(void* ptr) noexcept
+{
+    if (ptr == nullptr)
+    {
+        return;
+    }
+
+    auto* base = static_cast<std::uint8_t*>(ptr) - kAllocationHeaderSize;
+    allocatedSize -= static_cast<std::int64_t>(*reinterpret_cast<std::size_t*>(base));
+
+    std::free(base);
+}
+
+// Counts the allocations so tests can verify that a code path does not allocate.
+void* operator new(std::size_t size)
+{
+    if (void* ptr = allocate(size); ptr != nullptr)
+    {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept
+{
+    return allocate(size);
+}
+
+void operator delete(void* ptr) noexcept
+{
+    deallocate(ptr);
+}
+
+void operator delete(void* ptr, std::size_t) noexcept
+{
+    deallocate(ptr);
+}
+
+void operator delete(void* ptr, const std::nothrow_t&) noexcept
+{
+    deallocate(ptr);
+}
+
 namespace zasm::tests
 {
 
@@ -46,4 +116,14 @@ namespace zasm::tests
     {
         return os << err.getErrorName();
     }
+
+    std::size_t getAllocationCount() noexcept
+    {
+        return allocationCount;
+    }
+
+    std::int64_t getAllocatedSize() noexcept
+    {
+        return allocatedSize;
+    }
 }
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <cstddef>
+#include <cstdint>
 #include <gtest/gtest.h>
 #include <ostream>
 #include <string>
@@ -16,4 +18,10 @@ namespace zasm::tests
     std::ostream& operator<<(std::ostream& os, const BitSize& s);
     std::ostream& operator<<(std::ostream& os, const Error& err);
 
+    // Returns the amount of allocations made with the global operator new by the calling thread so far.
+    std::size_t getAllocationCount() noexcept;
+
+    // Returns the amount of bytes allocated minus the amount freed with the global operators by the calling thread.
+    std::int64_t getAllocatedSize() noexcept;
+
 } // namespace zasm::tests
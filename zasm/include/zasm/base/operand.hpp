@@ -254,7 +254,7 @@ namespace zasm
         /// </summary>
         /// <typeparam name="T">Operand Type</typeparam>
         /// <returns>Reference to operand or throws std::bad_variant_access if type mismatches</returns>
-        template<typename T> const T& get() const
+        template<typename T> constexpr const T& get() const
         {
             if constexpr (std::is_same_v<T, Operand>)
             {
@@ -1,5 +1,6 @@
 ﻿#pragma once
 
+#include <algorithm>
 #include <array>
 #include <cassert>
 #include <cstddef>
@@ -11,7 +12,10 @@ namespace zasm
     namespace detail
     {
         constexpr std::size_t kDefaultBlockCount = 0xFFFF;
-    }
+
+        // Entries of the first block, each following block doubles in size up to the maximum block size.
+        constexpr std::size_t kMinBlockCount = 64;
+    } // namespace detail
 
     template<typename T, std::size_t TEntriesInBlock = detail::kDefaultBlockCount> class ObjectPool
     {
@@ -32,13 +36,30 @@ namespace zasm
 
         struct Block
         {
-            std::array<Entry, TEntriesInBlock> storage;
-            std::size_t slot;
+            // Not value initialized, the memory is only touched once an entry is handed out.
+            std::unique_ptr<Entry[]> storage;
+            std::size_t capacity{};
+            std::size_t slot{};
         };
 
-        std::vector<std::unique_ptr<Block>> _blocks;
+        std::vector<Block> _blocks;
         Entry* _freeItem = nullptr;
 
+        Block& addBlock(std::size_t capacity)
+        {
+            // NOLINTNEXTLINE
+            return _blocks.emplace_back(Block{ std::unique_ptr<Entry[]>(new Entry[capacity]), capacity, 0 });
+        }
+
+        std::size_t getNextBlockCapacity() const noexcept
+        {
+            if (_blocks.empty())
+            {
+                return std::min(detail::kMinBlockCount, TEntriesInBlock);
+            }
+            return std::min(_blocks.back().capacity * 2, TEntriesInBlock);
+        }
+
     public:
         using other = ObjectPool<T>;
 
@@ -64,22 +85,40 @@ namespace zasm
             using other = ObjectPool<TOther>;
         };
 
-        ObjectPool()
-        {
-            _blocks.push_back(std::make_unique<Block>());
-        }
+        ObjectPool() = default;
 
         void reset()
         {
-            // Shrink to single block.
-            _blocks.resize(1);
-
-            // Reset slot to zero.
-            _blocks[0]->slot = 0;
+            if (!_blocks.empty())
+            {
+                // Shrink to the largest block.
+                const auto it = std::max_element(_blocks.begin(), _blocks.end(), [](const Block& lhs, const Block& rhs) {
+                    return lhs.capacity < rhs.capacity;
+                });
+                std::swap(_blocks.front(), *it);
+                _blocks.resize(1);
+
+                // Reset slot to zero.
+                _blocks[0].slot = 0;
+            }
 
             _freeItem = nullptr;
         }
 
+        /// <summary>
+        /// Ensures that the next count allocations do not have to allocate another block.
+        /// </summary>
+        void reserve(size_type count)
+        {
+            const auto available = _blocks.empty() ? 0 : _blocks.back().capacity - _blocks.back().slot;
+            if (available >= count)
+            {
+                return;
+            }
+
+            addBlock(std::max(count, getNextBlockCapacity()));
+        }
+
         pointer address(reference val) const noexcept
         {
             return std::addressof(val);
@@ -120,14 +159,15 @@ namespace zasm
                 return static_cast<pointer>(entry->data());
             }
 
-            auto* block = _blocks.back().get();
-            if (block->slot >= TEntriesInBlock)
+            if (_blocks.empty() || _blocks.back().slot >= _blocks.back().capacity)
             {
-                block = _blocks.emplace_back(std::make_unique<Block>()).get();
+                addBlock(getNextBlockCapacity());
             }
 
-            auto& entry = block->storage[block->slot];
-            block->slot++;
+            auto& block = _blocks.back();
+
+            auto& entry = block.storage[block.slot];
+            block.slot++;
 
             return static_cast<pointer>(entry.data());
         }
@@ -4,6 +4,7 @@
 #include <array>
 #include <cstddef>
 #include <cstring>
+#include <limits>
 #include <memory>
 #include <string.h>
 #include <string>
@@ -172,18 +173,19 @@ namespace zasm
                 // Because clearing the buckets is expensive do nothing if already empty.
                 return;
             }
+            // Only the buckets of the entries can hold ids, released entries are already removed.
+            for (const auto& entry : _entries)
+            {
+                _hashBuckets[entry.hash % kMaxHashBuckets].clear();
+            }
             _entries.clear();
-            if (_blocks.size() > 1)
+            if (!_blocks.empty())
             {
                 _blocks.resize(1);
                 _blocks[0]->used = 0;
             }
             _nextFreeId = Id::Invalid;
             _numFree = 0;
-            for (auto& bucket : _hashBuckets)
-            {
-                bucket.clear();
-            }
         }
 
         std::size_t size() const noexcept
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <zasm/base/label.hpp>
+#include <zasm/core/errors.hpp>
+
+namespace zasm
+{
+    class Node;
+    class Program;
+
+    struct DecodedBlock
+    {
+        static constexpr std::size_t kNone = ~std::size_t{ 0 };
+
+        // Address of the first instruction.
+        std::uint64_t address{};
+        // Size of the instructions in bytes.
+        std::size_t size{};
+        std::size_t instructionCount{};
+        // The label bound at the start of the block.
+        Label label{};
+        // The node of the label and the node of the last instruction.
+        Node* head{};
+        Node* tail{};
+        // Index of the block that is reached when the last instruction does not transfer control.
+        std::size_t fallthrough{ kNone };
+        // Index of the block targeted by a relative jump or conditional branch at the end of the block.
+        std::size_t branch{ kNone };
+        // Set for blocks at an entry address or the target of a relative call.
+        bool isFunction{};
+    };
+
+    /// <summary>
+    /// Decodes the code reachable from the entry addresses by recursive descent and appends it to the program,
+    /// the program mode determines the machine mode. Relative jumps, conditional branches and calls to
+    /// addresses within the buffer are followed, a path ends at an unconditional jump, ret, hlt, ud2, int3 or
+    /// at bytes that can not be decoded. Targets of relative calls are decoded as additional functions.
+    ///
+    /// Every basic block starts with a bound label and relative branches to a block reference its label.
+    /// The blocks are appended in the order of their address, bytes that are not reached are not added.
+    /// Functions are decoded independently, with a threadCount other than 1 they are decoded on worker
+    /// threads. The nodes are always created on the calling thread so the result does not depend on it.
+    /// </summary>
+    /// <param name="program">The program to append the nodes to</param>
+    /// <param name="blocks">Receives the basic blocks ordered by address</param>
+    /// <param name="data">The code to decode</param>
+    /// <param name="len">Size of the code in bytes</param>
+    /// <param name="address">Address of the first byte</param>
+    /// <param name="entries">Addresses to start decoding from, each must be within the buffer</param>
+    /// <param name="threadCount">Amount of threads including the calling thread, 0 uses all hardware threads</param>
+    /// <returns>If successful returns Error::None otherwise check Error value.</returns>
+    Error decodeCfg(
+        Program& program, std::vector<DecodedBlock>& blocks, const void* data, std::size_t len, std::uint64_t address,
+        const std::vector<std::uint64_t>& entries, std::size_t threadCount = 1);
+
+} // namespace zasm
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <zasm/base/mode.hpp>
+#include <zasm/core/enumflags.hpp>
+#include <zasm/core/errors.hpp>
+#include <zasm/program/instruction.hpp>
+
+namespace zasm
+{
+    enum class DecodeColumnsFlags : std::uint32_t
+    {
+        None = 0,
+        // Skips the semantic analysis, only offsets, lengths and mnemonics are available.
+        Minimal = 1U << 0,
+        // Bytes that can not be decoded are stored as entries of length one with the invalid mnemonic.
+        InvalidAsEntry = 1U << 1,
+    };
+    ZASM_ENABLE_ENUM_OPERATORS(DecodeColumnsFlags);
+
+    enum class DecodedOperandKind : std::uint8_t
+    {
+        None = 0,
+        Reg,
+        Mem,
+        Imm,
+        // Relative immediate of branches.
+        Rel,
+    };
+
+    /// <summary>
+    /// Caller provided columns for decodeColumns, every column that is not null must be able to hold capacity
+    /// entries. Columns that are null are not computed, operands are only decoded if operandKinds is provided.
+    /// </summary>
+    struct DecoderColumns
+    {
+        std::size_t capacity{};
+
+        // Offset of the instruction relative to the start of the buffer.
+        std::uint64_t* offsets{};
+        Instruction::Length* lengths{};
+        Instruction::Mnemonic* mnemonics{};
+        Instruction::Category* categories{};
+        // Prefix attributes like lock and rep, same values as Instruction::getAttribs.
+        Instruction::Attribs* attribs{};
+        // Kinds of the visible operands, 3 bits per operand, see getDecodedOperandKind.
+        std::uint16_t* operandKinds{};
+
+        // Amount of entries written by the last call.
+        std::size_t count{};
+        // Amount of bytes consumed by the last call, decoding can be resumed from here.
+        std::size_t bytesDecoded{};
+    };
+
+    /// <summary>
+    /// Returns the kind of the operand at the index from an entry of the operandKinds column.
+    /// </summary>
+    constexpr DecodedOperandKind getDecodedOperandKind(std::uint16_t kinds, std::size_t index) noexcept
+    {
+        return static_cast<DecodedOperandKind>((kinds >> (index * 3U)) & 0b111U);
+    }
+
+    /// <summary>
+    /// Decodes the buffer as straight-line code into the columns without creating instruction objects, decoding
+    /// stops at the end of the buffer or once the capacity is reached. The minimal mode can not fill the category,
+    /// attribs and operandKinds columns and fails with ErrorCode::InvalidParameter if any of them is provided.
+    /// On failure count and bytesDecoded describe the instructions before the failing one.
+    /// </summary>
+    /// <param name="columns">The columns to fill, count and bytesDecoded are updated</param>
+    /// <param name="mode">Machine mode of the code</param>
+    /// <param name="data">The code to decode</param>
+    /// <param name="len">Size of the code in bytes</param>
+    /// <param name="flags">Options, see DecodeColumnsFlags</param>
+    /// <returns>If successful returns Error::None otherwise check Error value.</returns>
+    Error decodeColumns(
+        DecoderColumns& columns, MachineMode mode, const void* data, std::size_t len,
+        DecodeColumnsFlags flags = DecodeColumnsFlags::None);
+
+} // namespace zasm
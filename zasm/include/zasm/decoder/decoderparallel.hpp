@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <zasm/base/mode.hpp>
+#include <zasm/core/errors.hpp>
+#include <zasm/decoder/decodercolumns.hpp>
+#include <zasm/decoder/decoderprogram.hpp>
+
+namespace zasm
+{
+    class Program;
+
+    /// <summary>
+    /// Same as decodeColumns but splits the buffer into chunks that are decoded on worker threads. Every chunk
+    /// is first scanned speculatively from its start, the scans are then resynchronized at the chunk boundaries
+    /// by decoding from the end of the previous instruction until an instruction start of the scan is reached.
+    /// The columns are filled in parallel afterwards, the result is identical to decodeColumns.
+    /// </summary>
+    /// <param name="columns">The columns to fill, count and bytesDecoded are updated</param>
+    /// <param name="mode">Machine mode of the code</param>
+    /// <param name="data">The code to decode</param>
+    /// <param name="len">Size of the code in bytes</param>
+    /// <param name="threadCount">Amount of threads including the calling thread, 0 uses all hardware threads</param>
+    /// <param name="flags">Options, see DecodeColumnsFlags</param>
+    /// <returns>If successful returns Error::None otherwise check Error value.</returns>
+    Error decodeColumnsParallel(
+        DecoderColumns& columns, MachineMode mode, const void* data, std::size_t len, std::size_t threadCount,
+        DecodeColumnsFlags flags = DecodeColumnsFlags::None);
+
+    /// <summary>
+    /// Same as decodeProgram but decodes the instructions on worker threads, see decodeColumnsParallel for how
+    /// the chunks are synchronized. The nodes are created on the calling thread in the order of the buffer, the
+    /// resulting program is identical to decodeProgram.
+    /// </summary>
+    /// <param name="program">The program to append the nodes to</param>
+    /// <param name="data">The code to decode</param>
+    /// <param name="len">Size of the code in bytes</param>
+    /// <param name="address">Address of the first byte</param>
+    /// <param name="threadCount">Amount of threads including the calling thread, 0 uses all hardware threads</param>
+    /// <param name="flags">Options, see DecodeProgramFlags</param>
+    /// <returns>If successful returns Error::None otherwise check Error value.</returns>
+    Error decodeProgramParallel(
+        Program& program, const void* data, std::size_t len, std::uint64_t address, std::size_t threadCount,
+        DecodeProgramFlags flags = DecodeProgramFlags::None);
+
+} // namespace zasm
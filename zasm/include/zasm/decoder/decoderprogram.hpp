@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <zasm/core/enumflags.hpp>
+#include <zasm/core/errors.hpp>
+
+namespace zasm
+{
+    class Program;
+
+    enum class DecodeProgramFlags : std::uint32_t
+    {
+        None = 0,
+        // Relative branches to an instruction within the buffer reference a label bound before the target.
+        CreateLabels = 1U << 0,
+        // Bytes that can not be decoded are added as single byte data nodes instead of failing.
+        InvalidAsData = 1U << 1,
+    };
+    ZASM_ENABLE_ENUM_OPERATORS(DecodeProgramFlags);
+
+    /// <summary>
+    /// Decodes the entire buffer as straight-line code and appends the instructions to the program, the program mode
+    /// determines the machine mode. This is equivalent to calling Decoder::decode and Assembler::emit for each
+    /// instruction but only decodes the visible operands and creates the nodes directly. On failure the nodes
+    /// decoded before the failing instruction remain in the program.
+    /// </summary>
+    /// <param name="program">The program to append the nodes to</param>
+    /// <param name="data">The code to decode</param>
+    /// <param name="len">Size of the code in bytes</param>
+    /// <param name="address">Address of the first byte</param>
+    /// <param name="flags">Options, see DecodeProgramFlags</param>
+    /// <returns>If successful returns Error::None otherwise check Error value.</returns>
+    Error decodeProgram(
+        Program& program, const void* data, std::size_t len, std::uint64_t address,
+        DecodeProgramFlags flags = DecodeProgramFlags::None);
+
+} // namespace zasm
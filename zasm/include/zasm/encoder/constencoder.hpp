@@ -0,0 +1,82 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <zasm/base/mode.hpp>
+#include <zasm/encoder/fastencoder.hpp>
+#include <zasm/program/instruction.hpp>
+
+namespace zasm
+{
+    /// <summary>
+    /// Creates an instruction from the mnemonic and operands, this can be used in constant expressions
+    /// ex.: makeInstruction(x86::Mnemonic::Mov, x86::rbp, x86::rsp)
+    /// </summary>
+    template<typename... TOps>
+    constexpr Instruction makeInstruction(Instruction::Mnemonic mnemonic, const TOps&... ops) noexcept
+    {
+        static_assert(sizeof...(TOps) <= std::tuple_size_v<Instruction::Operands>, "Too many operands");
+
+        return Instruction(
+            mnemonic, static_cast<Instruction::OperandCount>(sizeof...(TOps)), Instruction::Operands{ Operand(ops)... });
+    }
+
+    namespace detail
+    {
+        static constexpr std::size_t kConstEncodeFailed = ~std::size_t{};
+
+        constexpr bool encodeConstInstr(EncoderBuffer& buf, MachineMode mode, const Instruction& instr) noexcept
+        {
+            return encodeFast(
+                buf, mode, instr.getAttribs(), instr.getMnemonic(), instr.getOperandCount(), instr.getOperands().data());
+        }
+
+        template<typename TInstrs> constexpr std::size_t getConstEncodedSize(MachineMode mode, const TInstrs& instrs) noexcept
+        {
+            std::size_t size = 0;
+            for (const auto& instr : instrs)
+            {
+                EncoderBuffer buf{};
+                if (!encodeConstInstr(buf, mode, instr))
+                {
+                    return kConstEncodeFailed;
+                }
+                size += buf.length;
+            }
+            return size;
+        }
+    } // namespace detail
+
+    /// <summary>
+    /// Encodes a fixed sequence of instructions at compile time, the result has exactly the size of the encoded
+    /// instructions and is identical to the output of the Serializer. Only label free forms covered by the table
+    /// driven encoder are supported which includes mov, the common arithmetic instructions, push, pop, lea, nop,
+    /// int3, leave and ret with general purpose registers, using anything else fails to compile.
+    /// The instructions must be an array with static storage duration:
+    ///   static constexpr Instruction kStub[] = { makeInstruction(x86::Mnemonic::Push, x86::rbp), ... };
+    ///   static constexpr auto kStubBytes = encodeConst&lt;MachineMode::AMD64, kStub&gt;();
+    /// </summary>
+    /// <returns>Array with the encoded bytes</returns>
+    template<MachineMode TMode, const auto& TInstrs> constexpr auto encodeConst() noexcept
+    {
+        constexpr auto size = detail::getConstEncodedSize(TMode, TInstrs);
+        static_assert(size != detail::kConstEncodeFailed, "The sequence contains an instruction that can not be encoded");
+
+        std::array<std::uint8_t, size> res{};
+
+        std::size_t offset = 0;
+        for (const auto& instr : TInstrs)
+        {
+            EncoderBuffer buf{};
+            detail::encodeConstInstr(buf, TMode, instr);
+            for (std::size_t i = 0; i < buf.length; ++i)
+            {
+                res[offset++] = buf.data[i];
+            }
+        }
+
+        return res;
+    }
+
+} // namespace zasm
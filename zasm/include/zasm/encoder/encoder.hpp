@@ -43,6 +43,10 @@ namespace zasm
         RelocationType relocKind{};
         RelocationData relocData{};
         Label::Id relocLabel{ Label::Id::Invalid };
+        // Offset and size in bytes of the field that requires relocation within the buffer, the size is
+        // zero if the location could not be determined.
+        std::uint8_t relocOffset{};
+        std::uint8_t relocSize{};
     };
 
     using EncoderOperands = std::array<Operand, 5 /* ZYDIS_ENCODER_MAX_OPERANDS */>;
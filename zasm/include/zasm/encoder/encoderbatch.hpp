@@ -0,0 +1,111 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <vector>
+#include <zasm/base/label.hpp>
+#include <zasm/base/mode.hpp>
+#include <zasm/core/errors.hpp>
+#include <zasm/encoder/encoder.hpp>
+#include <zasm/program/instruction.hpp>
+
+namespace zasm
+{
+    class Node;
+
+    /// <summary>
+    /// Resolves the labels referenced by the instructions of a batch.
+    /// </summary>
+    class IEncoderLabelFixup
+    {
+    public:
+        virtual ~IEncoderLabelFixup() = default;
+
+        /// <summary>
+        /// Called for each label operand before the instruction is encoded, labels already bound within a node
+        /// range are not passed to the fixup. If the address is returned the instruction is encoded against it,
+        /// otherwise a placeholder is encoded and the field is reported in the relocation arrays of the batch
+        /// so it can be patched once the address is known.
+        /// </summary>
+        /// <param name="label">The referenced label</param>
+        /// <param name="index">Index of the instruction in the batch</param>
+        /// <param name="address">Address of the instruction</param>
+        /// <returns>Address of the label if known</returns>
+        virtual std::optional<std::int64_t> resolve(Label::Id label, std::size_t index, std::int64_t address) = 0;
+    };
+
+    /// <summary>
+    /// Result of encodeBatch, the code of all instructions is stored contiguous and every other array has one
+    /// entry per encoded instruction. The object can be reused for multiple batches to keep the memory.
+    /// </summary>
+    struct EncoderBatch
+    {
+        std::vector<std::uint8_t> code;
+        std::vector<std::int32_t> offsets;
+        std::vector<std::uint8_t> lengths;
+        // Same meaning as the fields of EncoderResult, the offset is relative to the instruction.
+        std::vector<RelocationType> relocKinds;
+        std::vector<RelocationData> relocData;
+        std::vector<Label::Id> relocLabels;
+        std::vector<std::uint8_t> relocOffsets;
+        std::vector<std::uint8_t> relocSizes;
+
+        /// <summary>
+        /// Returns the amount of encoded instructions.
+        /// </summary>
+        std::size_t size() const noexcept
+        {
+            return lengths.size();
+        }
+
+        /// <summary>
+        /// Removes all entries but keeps the memory.
+        /// </summary>
+        void clear() noexcept
+        {
+            code.clear();
+            offsets.clear();
+            lengths.clear();
+            relocKinds.clear();
+            relocData.clear();
+            relocLabels.clear();
+            relocOffsets.clear();
+            relocSizes.clear();
+        }
+    };
+
+    /// <summary>
+    /// Encodes the instructions as straight-line code starting at the base address without requiring a Program.
+    /// The mode is validated and the encoder is set up once for the entire batch, each instruction is encoded
+    /// exactly once so branches to labels that are not known yet use the rel32 form. On failure the batch holds
+    /// the instructions before the failing one.
+    /// </summary>
+    /// <param name="batch">Receives the result, previous content is removed</param>
+    /// <param name="mode">Machine mode of the instructions</param>
+    /// <param name="base">Address of the first instruction</param>
+    /// <param name="instrs">Array of instructions</param>
+    /// <param name="count">Amount of instructions</param>
+    /// <param name="fixup">Optional resolver for label operands, without one every label is reported as relocation</param>
+    /// <returns>If successful returns Error::None otherwise check Error value.</returns>
+    Error encodeBatch(
+        EncoderBatch& batch, MachineMode mode, std::int64_t base, const Instruction* instrs, std::size_t count,
+        IEncoderLabelFixup* fixup = nullptr);
+
+    /// <summary>
+    /// Encodes the nodes from first to last, see the overload above. Label nodes are bound to the address they
+    /// appear at, references to them that were encoded before are patched at the end. Other nodes than
+    /// instructions and labels are not supported and fail with ErrorCode::InvalidOperation.
+    /// </summary>
+    /// <param name="batch">Receives the result, previous content is removed</param>
+    /// <param name="mode">Machine mode of the instructions</param>
+    /// <param name="base">Address of the first instruction</param>
+    /// <param name="first">First node to encode</param>
+    /// <param name="last">Last node to encode, inclusive</param>
+    /// <param name="fixup">Optional resolver for label operands, without one every label is reported as relocation</param>
+    /// <returns>If successful returns Error::None otherwise check Error value.</returns>
+    Error encodeBatch(
+        EncoderBatch& batch, MachineMode mode, std::int64_t base, const Node* first, const Node* last,
+        IEncoderLabelFixup* fixup = nullptr);
+
+} // namespace zasm
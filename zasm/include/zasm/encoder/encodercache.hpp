@@ -0,0 +1,90 @@
+#pragma once
+
+#include <cstddef>
+#include <zasm/base/mode.hpp>
+#include <zasm/encoder/encoder.hpp>
+#include <zasm/program/instruction.hpp>
+
+namespace zasm
+{
+    namespace detail
+    {
+        struct EncoderCacheState;
+    }
+
+    /// <summary>
+    /// Cache for the encoding of instructions that do not depend on the address they are encoded at, this excludes
+    /// instructions with label operands, relative branches and rip relative memory operands. The cache can be
+    /// attached to multiple Serializer objects at the same time, all functions are thread-safe. The amount of
+    /// entries is limited by the capacity, once it is reached all entries are evicted before the next insert.
+    /// </summary>
+    class EncoderCache
+    {
+        detail::EncoderCacheState* _state{};
+
+    public:
+        static constexpr std::size_t kDefaultCapacity = 1U << 16;
+
+    public:
+        /// <summary>
+        /// Creates the cache with the maximum amount of entries, a capacity of 0 disables caching.
+        /// </summary>
+        /// <param name="capacity">Maximum amount of cached instructions</param>
+        explicit EncoderCache(std::size_t capacity = kDefaultCapacity);
+        EncoderCache(const EncoderCache&) = delete;
+        EncoderCache(EncoderCache&& other) noexcept;
+        ~EncoderCache();
+
+        EncoderCache& operator=(const EncoderCache&) = delete;
+        EncoderCache& operator=(EncoderCache&& other) noexcept;
+
+        /// <summary>
+        /// Looks up the encoding of the instruction.
+        /// </summary>
+        /// <param name="mode">Machine mode of the instruction</param>
+        /// <param name="instr">The instruction</param>
+        /// <param name="res">Receives the cached result</param>
+        /// <returns>True if the instruction was found</returns>
+        bool lookup(MachineMode mode, const Instruction& instr, EncoderResult& res) const;
+
+        /// <summary>
+        /// Stores the encoding of the instruction, the caller is responsible to only store instructions
+        /// which encoding does not depend on the address.
+        /// </summary>
+        /// <param name="mode">Machine mode of the instruction</param>
+        /// <param name="instr">The instruction</param>
+        /// <param name="res">The encoded result</param>
+        void insert(MachineMode mode, const Instruction& instr, const EncoderResult& res);
+
+        /// <summary>
+        /// Returns the amount of lookups that found an entry.
+        /// </summary>
+        std::size_t getHitCount() const noexcept;
+
+        /// <summary>
+        /// Returns the amount of lookups that did not find an entry.
+        /// </summary>
+        std::size_t getMissCount() const noexcept;
+
+        /// <summary>
+        /// Returns the amount of entries that were evicted because the capacity was reached.
+        /// </summary>
+        std::size_t getEvictionCount() const noexcept;
+
+        /// <summary>
+        /// Returns the amount of cached instructions.
+        /// </summary>
+        std::size_t size() const noexcept;
+
+        /// <summary>
+        /// Returns the maximum amount of cached instructions.
+        /// </summary>
+        std::size_t getCapacity() const noexcept;
+
+        /// <summary>
+        /// Removes all entries and resets the counters.
+        /// </summary>
+        void clear() noexcept;
+    };
+
+} // namespace zasm
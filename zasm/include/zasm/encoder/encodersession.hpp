@@ -0,0 +1,79 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <zasm/base/mode.hpp>
+#include <zasm/core/errors.hpp>
+#include <zasm/core/expected.hpp>
+#include <zasm/encoder/encoder.hpp>
+#include <zasm/program/instruction.hpp>
+
+namespace zasm
+{
+    namespace detail
+    {
+        struct EncoderSessionState;
+    }
+
+    /// <summary>
+    /// Encoder bound to a single machine mode that prepares the encoder request once per instruction shape,
+    /// the shape is the mnemonic, the attributes and the kind of each operand. Encoding another instruction
+    /// of the same shape only fills in the registers, immediates and memory fields. Instructions with labels
+    /// or rip relative memory are encoded by the regular path and report relocations like encodeBatch without
+    /// a fixup. The output is identical to the Serializer. The object is not thread-safe, use one per thread.
+    /// </summary>
+    class EncoderSession
+    {
+        detail::EncoderSessionState* _state{};
+
+    public:
+        explicit EncoderSession(MachineMode mode);
+        EncoderSession(const EncoderSession&) = delete;
+        EncoderSession(EncoderSession&& other) noexcept;
+        ~EncoderSession();
+
+        EncoderSession& operator=(const EncoderSession&) = delete;
+        EncoderSession& operator=(EncoderSession&& other) noexcept;
+
+        /// <summary>
+        /// Returns the machine mode the session encodes for.
+        /// </summary>
+        MachineMode getMode() const noexcept;
+
+        /// <summary>
+        /// Encodes the instruction at the given address.
+        /// </summary>
+        /// <param name="instr">The instruction</param>
+        /// <param name="address">Address of the instruction, only relevant for relative operands</param>
+        /// <returns>The encoded instruction or the error</returns>
+        Expected<EncoderResult, Error> encode(const Instruction& instr, std::int64_t address = 0);
+
+        /// <summary>
+        /// Encodes the instruction at the given address, see the overload above.
+        /// </summary>
+        Expected<EncoderResult, Error> encode(
+            std::int64_t address, Instruction::Attribs attribs, Instruction::Mnemonic mnemonic, std::size_t numOps,
+            const Operand* operands);
+
+        /// <summary>
+        /// Returns the amount of encodes that used a prepared request.
+        /// </summary>
+        std::size_t getHitCount() const noexcept;
+
+        /// <summary>
+        /// Returns the amount of encodes that had to prepare a new request.
+        /// </summary>
+        std::size_t getMissCount() const noexcept;
+
+        /// <summary>
+        /// Returns the amount of prepared requests.
+        /// </summary>
+        std::size_t size() const noexcept;
+
+        /// <summary>
+        /// Removes all prepared requests and resets the counters.
+        /// </summary>
+        void clear() noexcept;
+    };
+
+} // namespace zasm
@@ -0,0 +1,469 @@
+#pragma once
+
+#include <Zydis/Mnemonic.h>
+#include <Zydis/Register.h>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <zasm/base/mode.hpp>
+#include <zasm/encoder/encoder.hpp>
+#include <zasm/program/instruction.hpp>
+
+// Table driven encoder for the most frequent general purpose forms, everything that is not covered here is
+// encoded by Zydis. The output must be identical to the output of Zydis for the same request. All functions
+// are constexpr so the same tables are used to encode at compile time, see constencoder.hpp.
+namespace zasm::detail
+{
+    enum class FastForm : std::uint8_t
+    {
+        None = 0,
+        // op r/m, r and op r/m, imm8 via 0x83 /ext.
+        Alu,
+        // mov r/m, r and mov r, imm
+        Mov,
+        // test r/m, r
+        Test,
+        // opcode + register
+        PushPop,
+        // Single opcode without operands.
+        Fixed,
+        Lea,
+        // Short opcode, the near form is 0F 80+cc.
+        Jcc,
+        // Short opcode, the near form is E9.
+        Jmp,
+    };
+
+    struct FastEncodeInfo
+    {
+        FastForm form{};
+        // Opcode of the register form, the base opcode for push/pop or the short opcode for branches.
+        std::uint8_t opcode{};
+        // ModRM.reg extension used by the imm8 form of Alu.
+        std::uint8_t ext{};
+    };
+
+    static constexpr auto buildFastEncodeTable() noexcept
+    {
+        std::array<FastEncodeInfo, ZydisMnemonic::ZYDIS_MNEMONIC_MAX_VALUE> data{};
+
+        // NOLINTBEGIN(cppcoreguidelines-avoid-magic-numbers, readability-magic-numbers)
+        data[ZYDIS_MNEMONIC_ADD] = FastEncodeInfo{ FastForm::Alu, 0x01, 0 };
+        data[ZYDIS_MNEMONIC_OR] = FastEncodeInfo{ FastForm::Alu, 0x09, 1 };
+        data[ZYDIS_MNEMONIC_AND] = FastEncodeInfo{ FastForm::Alu, 0x21, 4 };
+        data[ZYDIS_MNEMONIC_SUB] = FastEncodeInfo{ FastForm::Alu, 0x29, 5 };
+        data[ZYDIS_MNEMONIC_XOR] = FastEncodeInfo{ FastForm::Alu, 0x31, 6 };
+        data[ZYDIS_MNEMONIC_CMP] = FastEncodeInfo{ FastForm::Alu, 0x39, 7 };
+        data[ZYDIS_MNEMONIC_MOV] = FastEncodeInfo{ FastForm::Mov, 0x89, 0 };
+        data[ZYDIS_MNEMONIC_TEST] = FastEncodeInfo{ FastForm::Test, 0x85, 0 };
+        data[ZYDIS_MNEMONIC_PUSH] = FastEncodeInfo{ FastForm::PushPop, 0x50, 0 };
+        data[ZYDIS_MNEMONIC_POP] = FastEncodeInfo{ FastForm::PushPop, 0x58, 0 };
+        data[ZYDIS_MNEMONIC_LEA] = FastEncodeInfo{ FastForm::Lea, 0x8D, 0 };
+        data[ZYDIS_MNEMONIC_NOP] = FastEncodeInfo{ FastForm::Fixed, 0x90, 0 };
+        data[ZYDIS_MNEMONIC_RET] = FastEncodeInfo{ FastForm::Fixed, 0xC3, 0 };
+        data[ZYDIS_MNEMONIC_LEAVE] = FastEncodeInfo{ FastForm::Fixed, 0xC9, 0 };
+        data[ZYDIS_MNEMONIC_INT3] = FastEncodeInfo{ FastForm::Fixed, 0xCC, 0 };
+        data[ZYDIS_MNEMONIC_JO] = FastEncodeInfo{ FastForm::Jcc, 0x70, 0 };
+        data[ZYDIS_MNEMONIC_JNO] = FastEncodeInfo{ FastForm::Jcc, 0x71, 0 };
+        data[ZYDIS_MNEMONIC_JB] = FastEncodeInfo{ FastForm::Jcc, 0x72, 0 };
+        data[ZYDIS_MNEMONIC_JNB] = FastEncodeInfo{ FastForm::Jcc, 0x73, 0 };
+        data[ZYDIS_MNEMONIC_JZ] = FastEncodeInfo{ FastForm::Jcc, 0x74, 0 };
+        data[ZYDIS_MNEMONIC_JNZ] = FastEncodeInfo{ FastForm::Jcc, 0x75, 0 };
+        data[ZYDIS_MNEMONIC_JBE] = FastEncodeInfo{ FastForm::Jcc, 0x76, 0 };
+        data[ZYDIS_MNEMONIC_JNBE] = FastEncodeInfo{ FastForm::Jcc, 0x77, 0 };
+        data[ZYDIS_MNEMONIC_JS] = FastEncodeInfo{ FastForm::Jcc, 0x78, 0 };
+        data[ZYDIS_MNEMONIC_JNS] = FastEncodeInfo{ FastForm::Jcc, 0x79, 0 };
+        data[ZYDIS_MNEMONIC_JP] = FastEncodeInfo{ FastForm::Jcc, 0x7A, 0 };
+        data[ZYDIS_MNEMONIC_JNP] = FastEncodeInfo{ FastForm::Jcc, 0x7B, 0 };
+        data[ZYDIS_MNEMONIC_JL] = FastEncodeInfo{ FastForm::Jcc, 0x7C, 0 };
+        data[ZYDIS_MNEMONIC_JNL] = FastEncodeInfo{ FastForm::Jcc, 0x7D, 0 };
+        data[ZYDIS_MNEMONIC_JLE] = FastEncodeInfo{ FastForm::Jcc, 0x7E, 0 };
+        data[ZYDIS_MNEMONIC_JNLE] = FastEncodeInfo{ FastForm::Jcc, 0x7F, 0 };
+        data[ZYDIS_MNEMONIC_JMP] = FastEncodeInfo{ FastForm::Jmp, 0xEB, 0 };
+        // NOLINTEND(cppcoreguidelines-avoid-magic-numbers, readability-magic-numbers)
+
+        return data;
+    }
+
+    static constexpr auto kFastEncodeTable = buildFastEncodeTable();
+
+    constexpr FastEncodeInfo getFastEncodeInfo(Instruction::Mnemonic mnemonic) noexcept
+    {
+        if (mnemonic.value() >= kFastEncodeTable.size())
+        {
+            return {};
+        }
+        return kFastEncodeTable[mnemonic.value()]; // NOLINT
+    }
+
+    constexpr bool isFastBranch(const FastEncodeInfo& info) noexcept
+    {
+        return info.form == FastForm::Jcc || info.form == FastForm::Jmp;
+    }
+
+    struct FastReg
+    {
+        // Encoding index 0 to 15, -1 if the register is not a supported general purpose register.
+        std::int8_t index{ -1 };
+        std::uint8_t width{};
+    };
+
+    constexpr FastReg getFastReg(MachineMode mode, const Reg& reg) noexcept
+    {
+        const auto id = static_cast<std::int32_t>(reg.getId());
+
+        FastReg res{};
+        if (id >= ZYDIS_REGISTER_RAX && id <= ZYDIS_REGISTER_R15 && mode == MachineMode::AMD64)
+        {
+            res = FastReg{ static_cast<std::int8_t>(id - ZYDIS_REGISTER_RAX), 64 };
+        }
+        else if (id >= ZYDIS_REGISTER_EAX && id <= ZYDIS_REGISTER_R15D)
+        {
+            res = FastReg{ static_cast<std::int8_t>(id - ZYDIS_REGISTER_EAX), 32 };
+        }
+
+        // The extended registers are not available in 32 bit mode.
+        if (mode != MachineMode::AMD64 && res.index >= 8)
+        {
+            return {};
+        }
+
+        return res;
+    }
+
+    constexpr bool isInt8(std::int64_t value) noexcept
+    {
+        return value >= std::numeric_limits<std::int8_t>::min() && value <= std::numeric_limits<std::int8_t>::max();
+    }
+
+    constexpr bool isInt32(std::int64_t value) noexcept
+    {
+        return value >= std::numeric_limits<std::int32_t>::min() && value <= std::numeric_limits<std::int32_t>::max();
+    }
+
+    constexpr void emitByte(EncoderBuffer& buf, std::uint32_t value) noexcept
+    {
+        buf.data[buf.length++] = static_cast<std::uint8_t>(value); // NOLINT
+    }
+
+    constexpr void emitImm32(EncoderBuffer& buf, std::int64_t value) noexcept
+    {
+        const auto raw = static_cast<std::uint32_t>(value);
+        for (std::uint32_t i = 0; i < 4; ++i)
+        {
+            emitByte(buf, (raw >> (i * 8U)) & 0xFFU);
+        }
+    }
+
+    constexpr void emitRex(EncoderBuffer& buf, bool w, std::int32_t reg, std::int32_t index, std::int32_t base) noexcept
+    {
+        std::uint32_t rex = 0x40U;
+        rex |= w ? 0x08U : 0U;
+        rex |= reg >= 8 ? 0x04U : 0U;
+        rex |= index >= 8 ? 0x02U : 0U;
+        rex |= base >= 8 ? 0x01U : 0U;
+        if (rex != 0x40U)
+        {
+            emitByte(buf, rex);
+        }
+    }
+
+    constexpr void emitModRM(EncoderBuffer& buf, std::uint32_t mod, std::int32_t reg, std::int32_t rm) noexcept
+    {
+        emitByte(buf, (mod << 6U) | ((static_cast<std::uint32_t>(reg) & 7U) << 3U) | (static_cast<std::uint32_t>(rm) & 7U));
+    }
+
+    // op r/m, r
+    constexpr bool encodeFastRegReg(EncoderBuffer& buf, MachineMode mode, std::uint8_t opcode, const Reg& dst, const Reg& src)
+    {
+        const auto dstReg = getFastReg(mode, dst);
+        const auto srcReg = getFastReg(mode, src);
+        if (dstReg.index < 0 || srcReg.index < 0 || dstReg.width != srcReg.width)
+        {
+            return false;
+        }
+
+        emitRex(buf, dstReg.width == 64, srcReg.index, 0, dstReg.index);
+        emitByte(buf, opcode);
+        emitModRM(buf, 3, srcReg.index, dstReg.index);
+
+        return true;
+    }
+
+    // op r/m, imm8
+    constexpr bool encodeFastRegImm8(EncoderBuffer& buf, MachineMode mode, std::uint8_t ext, const Reg& dst, const Imm& imm)
+    {
+        const auto dstReg = getFastReg(mode, dst);
+        const auto value = imm.value<std::int64_t>();
+        if (dstReg.index < 0 || !isInt8(value))
+        {
+            return false;
+        }
+
+        emitRex(buf, dstReg.width == 64, 0, 0, dstReg.index);
+        emitByte(buf, 0x83);
+        emitModRM(buf, 3, ext, dstReg.index);
+        emitByte(buf, static_cast<std::uint32_t>(value) & 0xFFU);
+
+        return true;
+    }
+
+    // mov r32, imm32 uses B8+r, mov r64 uses the sign extended C7 /0 form if the value fits otherwise B8+r imm64.
+    constexpr bool encodeFastMovImm(EncoderBuffer& buf, MachineMode mode, const Reg& dst, const Imm& imm)
+    {
+        const auto dstReg = getFastReg(mode, dst);
+        const auto value = imm.value<std::int64_t>();
+        if (dstReg.index < 0)
+        {
+            return false;
+        }
+
+        if (dstReg.width == 32)
+        {
+            if (value < std::numeric_limits<std::int32_t>::min() || value > std::numeric_limits<std::uint32_t>::max())
+            {
+                return false;
+            }
+            emitRex(buf, false, 0, 0, dstReg.index);
+            emitByte(buf, 0xB8U + (static_cast<std::uint32_t>(dstReg.index) & 7U));
+            emitImm32(buf, value);
+            return true;
+        }
+
+        emitRex(buf, true, 0, 0, dstReg.index);
+        if (isInt32(value))
+        {
+            emitByte(buf, 0xC7);
+            emitModRM(buf, 3, 0, dstReg.index);
+            emitImm32(buf, value);
+            return true;
+        }
+
+        emitByte(buf, 0xB8U + (static_cast<std::uint32_t>(dstReg.index) & 7U));
+        emitImm32(buf, value);
+        emitImm32(buf, value >> 32);
+        return true;
+    }
+
+    constexpr bool encodeFastPushPop(EncoderBuffer& buf, MachineMode mode, std::uint8_t opcode, const Reg& reg)
+    {
+        // Only the native stack width is covered, 16 bit forms require a prefix.
+        const auto fastReg = getFastReg(mode, reg);
+        if (fastReg.index < 0 || fastReg.width != (mode == MachineMode::AMD64 ? 64 : 32))
+        {
+            return false;
+        }
+
+        emitRex(buf, false, 0, 0, fastReg.index);
+        emitByte(buf, opcode + (static_cast<std::uint32_t>(fastReg.index) & 7U));
+
+        return true;
+    }
+
+    // lea r, [base + index * scale + disp] with registers of the native address size.
+    constexpr bool encodeFastLea(EncoderBuffer& buf, MachineMode mode, std::uint8_t opcode, const Reg& dst, const Mem& mem)
+    {
+        const auto dstReg = getFastReg(mode, dst);
+        if (dstReg.index < 0 || mem.getLabelId() != Label::Id::Invalid || mem.getSegment().isValid())
+        {
+            return false;
+        }
+
+        const auto memSize = getBitSize(mem.getBitSize());
+        if (memSize != 0 && memSize != static_cast<unsigned>(dstReg.width))
+        {
+            return false;
+        }
+
+        const auto addrWidth = mode == MachineMode::AMD64 ? 64 : 32;
+
+        const auto baseReg = getFastReg(mode, mem.getBase());
+        if (baseReg.index < 0 || baseReg.width != addrWidth)
+        {
+            return false;
+        }
+
+        FastReg indexReg{};
+        std::uint32_t scaleBits = 0;
+        if (mem.getIndex().isValid())
+        {
+            indexReg = getFastReg(mode, mem.getIndex());
+            // Index 4 without REX.X means no index.
+            if (indexReg.index < 0 || indexReg.index == 4 || indexReg.width != addrWidth)
+            {
+                return false;
+            }
+            switch (mem.getScale())
+            {
+                case 1:
+                    scaleBits = 0;
+                    break;
+                case 2:
+                    scaleBits = 1;
+                    break;
+                case 4:
+                    scaleBits = 2;
+                    break;
+                case 8:
+                    scaleBits = 3;
+                    break;
+                default:
+                    return false;
+            }
+        }
+
+        const auto disp = mem.getDisplacement();
+        if (!isInt32(disp))
+        {
+            return false;
+        }
+
+        // rbp and r13 can not be encoded without a displacement.
+        std::uint32_t mod = 2;
+        if (disp == 0 && (baseReg.index & 7) != 5)
+        {
+            mod = 0;
+        }
+        else if (isInt8(disp))
+        {
+            mod = 1;
+        }
+
+        // rsp and r12 as base always require the SIB byte.
+        const bool needsSib = indexReg.index >= 0 || (baseReg.index & 7) == 4;
+
+        emitRex(buf, dstReg.width == 64, dstReg.index, indexReg.index, baseReg.index);
+        emitByte(buf, opcode);
+        if (needsSib)
+        {
+            emitModRM(buf, mod, dstReg.index, 4);
+            const auto sibIndex = indexReg.index >= 0 ? static_cast<std::uint32_t>(indexReg.index) & 7U : 4U;
+            emitByte(buf, (scaleBits << 6U) | (sibIndex << 3U) | (static_cast<std::uint32_t>(baseReg.index) & 7U));
+        }
+        else
+        {
+            emitModRM(buf, mod, dstReg.index, baseReg.index);
+        }
+
+        if (mod == 1)
+        {
+            emitByte(buf, static_cast<std::uint32_t>(disp) & 0xFFU);
+        }
+        else if (mod == 2)
+        {
+            emitImm32(buf, disp);
+        }
+
+        return true;
+    }
+
+    // Encodes a direct branch at va to the absolute target, the short form is used whenever the target is in
+    // range which is also what Zydis selects.
+    constexpr bool encodeFastBranch(
+        EncoderBuffer& buf, MachineMode mode, const FastEncodeInfo& info, std::int64_t va, std::int64_t target)
+    {
+        // 32 bit mode has additional 16 bit branch forms, leave those to Zydis.
+        if (mode != MachineMode::AMD64 || !isFastBranch(info))
+        {
+            return false;
+        }
+
+        constexpr std::int64_t kShortSize = 2;
+        if (const auto rel8 = target - (va + kShortSize); isInt8(rel8))
+        {
+            emitByte(buf, info.opcode);
+            emitByte(buf, static_cast<std::uint32_t>(rel8) & 0xFFU);
+            return true;
+        }
+
+        const std::int64_t nearSize = info.form == FastForm::Jcc ? 6 : 5;
+        const auto rel32 = target - (va + nearSize);
+        if (!isInt32(rel32))
+        {
+            return false;
+        }
+
+        if (info.form == FastForm::Jcc)
+        {
+            emitByte(buf, 0x0F);
+            emitByte(buf, info.opcode + 0x10U);
+        }
+        else
+        {
+            emitByte(buf, 0xE9);
+        }
+        emitImm32(buf, rel32);
+
+        return true;
+    }
+
+    // Encodes the instruction if the form is covered by the tables, branches are not handled here as their
+    // target has to be resolved first, see encodeFastBranch. On failure the buffer content is unspecified.
+    constexpr bool encodeFast(
+        EncoderBuffer& buf, MachineMode mode, Instruction::Attribs attribs, Instruction::Mnemonic mnemonic, std::size_t numOps,
+        const Operand* operands)
+    {
+        buf.length = 0;
+
+        if (mode != MachineMode::AMD64 && mode != MachineMode::I386)
+        {
+            return false;
+        }
+
+        // Prefixes and operand size hints are left to Zydis.
+        if (attribs != Instruction::Attribs{})
+        {
+            return false;
+        }
+
+        const auto info = getFastEncodeInfo(mnemonic);
+        switch (info.form)
+        {
+            case FastForm::Alu:
+            case FastForm::Mov:
+            case FastForm::Test:
+                if (numOps != 2 || !operands[0].holds<Reg>())
+                {
+                    return false;
+                }
+                if (operands[1].holds<Reg>())
+                {
+                    return encodeFastRegReg(buf, mode, info.opcode, operands[0].get<Reg>(), operands[1].get<Reg>());
+                }
+                if (info.form == FastForm::Alu && operands[1].holds<Imm>())
+                {
+                    return encodeFastRegImm8(buf, mode, info.ext, operands[0].get<Reg>(), operands[1].get<Imm>());
+                }
+                if (info.form == FastForm::Mov && operands[1].holds<Imm>())
+                {
+                    return encodeFastMovImm(buf, mode, operands[0].get<Reg>(), operands[1].get<Imm>());
+                }
+                return false;
+            case FastForm::PushPop:
+                if (numOps != 1 || !operands[0].holds<Reg>())
+                {
+                    return false;
+                }
+                return encodeFastPushPop(buf, mode, info.opcode, operands[0].get<Reg>());
+            case FastForm::Fixed:
+                if (numOps != 0)
+                {
+                    return false;
+                }
+                emitByte(buf, info.opcode);
+                return true;
+            case FastForm::Lea:
+                if (numOps != 2 || !operands[0].holds<Reg>() || !operands[1].holds<Mem>())
+                {
+                    return false;
+                }
+                return encodeFastLea(buf, mode, info.opcode, operands[0].get<Reg>(), operands[1].get<Mem>());
+            default:
+                break;
+        }
+
+        return false;
+    }
+
+} // namespace zasm::detail
@@ -60,6 +60,25 @@ namespace zasm
         Expected<InstructionDetail, Error> getDetail(MachineMode mode) const;
 
         static Expected<InstructionDetail, Error> getDetail(MachineMode mode, const Instruction& instr);
+
+        struct DetailCacheStats
+        {
+            std::size_t hits{};
+            std::size_t misses{};
+            std::size_t size{};
+        };
+
+        /// <summary>
+        /// getDetail caches the details per thread by mode, mnemonic, attributes and operand signature, only the
+        /// first instruction of each signature is encoded and decoded. Returns the statistics of the cache of
+        /// the calling thread.
+        /// </summary>
+        static DetailCacheStats getDetailCacheStats() noexcept;
+
+        /// <summary>
+        /// Clears the detail cache of the calling thread and resets its statistics.
+        /// </summary>
+        static void clearDetailCache() noexcept;
     };
 
     class InstructionDetail final : public TInstructionBase<InstructionDetail, 10>
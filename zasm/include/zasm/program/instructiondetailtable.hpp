@@ -0,0 +1,70 @@
+#pragma once
+
+#include <cstddef>
+#include <zasm/core/errors.hpp>
+#include <zasm/program/instruction.hpp>
+#include <zasm/program/node.hpp>
+
+namespace zasm
+{
+    class Program;
+
+    namespace detail
+    {
+        struct InstructionDetailTableState;
+    }
+
+    /// <summary>
+    /// Holds the InstructionDetail of the instruction nodes of a Program indexed by Node::Id, the details are
+    /// computed in batches and afterwards available in constant time. The table observes the program and drops
+    /// the entry of a node once the node is destroyed or inserted again. Instructions that are modified in place
+    /// must be invalidated explicitly. The program must outlive the table.
+    /// </summary>
+    class InstructionDetailTable
+    {
+        detail::InstructionDetailTableState* _state{};
+
+    public:
+        explicit InstructionDetailTable(Program& program);
+        InstructionDetailTable(const InstructionDetailTable&) = delete;
+        InstructionDetailTable(InstructionDetailTable&& other) noexcept;
+        ~InstructionDetailTable();
+
+        InstructionDetailTable& operator=(const InstructionDetailTable&) = delete;
+        InstructionDetailTable& operator=(InstructionDetailTable&& other) noexcept;
+
+        /// <summary>
+        /// Computes the details of all instruction nodes in the program that have no entry yet.
+        /// </summary>
+        /// <param name="threadCount">Amount of threads including the calling thread, 0 uses all hardware threads</param>
+        /// <returns>The error of the first instruction that failed, the other instructions are still computed</returns>
+        Error compute(std::size_t threadCount = 1);
+
+        /// <summary>
+        /// Computes the details of the instruction nodes from first to last, including both, that have no
+        /// entry yet. See the overload above.
+        /// </summary>
+        Error compute(const Node* first, const Node* last, std::size_t threadCount = 1);
+
+        /// <summary>
+        /// Returns the details of the node or null if the node has no entry.
+        /// </summary>
+        const InstructionDetail* get(const Node* node) const noexcept;
+
+        /// <summary>
+        /// Removes the entry of the node.
+        /// </summary>
+        void invalidate(const Node* node) noexcept;
+
+        /// <summary>
+        /// Removes all entries.
+        /// </summary>
+        void clear() noexcept;
+
+        /// <summary>
+        /// Returns the amount of entries.
+        /// </summary>
+        std::size_t size() const noexcept;
+    };
+
+} // namespace zasm
@@ -9,23 +9,187 @@
 
 #include <climits>
 #include <cstddef>
+#include <cstdint>
+#include <tuple>
+#include <type_traits>
+#include <utility>
 #include <variant>
 #include <zasm/base/label.hpp>
 #include <zasm/core/enumflags.hpp>
 
 namespace zasm
 {
-    enum class NodeFlags : std::uint32_t
+    enum class NodeFlags : std::uint8_t
     {
         None = 0,
         Attached = 1U << 0,
     };
     ZASM_ENABLE_ENUM_OPERATORS(NodeFlags);
 
+    namespace detail
+    {
+        // The types a node can hold, the index in this list is the type tag stored in the node.
+        using NodeTypes = std::tuple<Sentinel, Instruction, Label, EmbeddedLabel, Data, Section, Align>;
+
+        template<typename T, typename TTypes> struct NodeTypeIndex;
+
+        template<typename T, typename... TTypes> struct NodeTypeIndex<T, std::tuple<T, TTypes...>>
+        {
+            static constexpr std::uint8_t kValue = 0;
+        };
+
+        template<typename T, typename TOther, typename... TTypes>
+        struct NodeTypeIndex<T, std::tuple<TOther, TTypes...>>
+        {
+            static constexpr std::uint8_t kValue = 1 + NodeTypeIndex<T, std::tuple<TTypes...>>::kValue;
+        };
+
+        template<typename T> static constexpr std::uint8_t kNodeTypeIndex = NodeTypeIndex<T, NodeTypes>::kValue;
+
+        // Types that fit into the space of the pointer are stored inline in the node.
+        template<typename T>
+        static constexpr bool kNodeInline = sizeof(T) <= sizeof(void*) && alignof(T) <= alignof(void*)
+            && std::is_trivially_copyable_v<T>;
+
+        template<typename T> using NodeStorage = std::conditional_t<kNodeInline<T>, T, T*>;
+
+        // The data of a node, either the value itself or a pointer to it, see kNodeInline.
+        union NodePayload
+        {
+            NodeStorage<Sentinel> sentinel;
+            NodeStorage<Instruction> instruction;
+            NodeStorage<Label> label;
+            NodeStorage<EmbeddedLabel> embeddedLabel;
+            NodeStorage<Data> data;
+            NodeStorage<Section> section;
+            NodeStorage<Align> align;
+
+            constexpr NodePayload() noexcept
+                : sentinel{}
+            {
+            }
+            constexpr NodePayload(NodeStorage<Sentinel> val) noexcept
+                : sentinel{ val }
+            {
+            }
+            constexpr NodePayload(NodeStorage<Instruction> val) noexcept
+                : instruction{ val }
+            {
+            }
+            constexpr NodePayload(NodeStorage<Label> val) noexcept
+                : label{ val }
+            {
+            }
+            constexpr NodePayload(NodeStorage<EmbeddedLabel> val) noexcept
+                : embeddedLabel{ val }
+            {
+            }
+            constexpr NodePayload(NodeStorage<Data> val) noexcept
+                : data{ val }
+            {
+            }
+            constexpr NodePayload(NodeStorage<Section> val) noexcept
+                : section{ val }
+            {
+            }
+            constexpr NodePayload(NodeStorage<Align> val) noexcept
+                : align{ val }
+            {
+            }
+
+            template<typename T> constexpr NodeStorage<T>& get() noexcept
+            {
+                if constexpr (std::is_same_v<T, Sentinel>)
+                    return sentinel;
+                else if constexpr (std::is_same_v<T, Instruction>)
+                    return instruction;
+                else if constexpr (std::is_same_v<T, Label>)
+                    return label;
+                else if constexpr (std::is_same_v<T, EmbeddedLabel>)
+                    return embeddedLabel;
+                else if constexpr (std::is_same_v<T, Data>)
+                    return data;
+                else if constexpr (std::is_same_v<T, Section>)
+                    return section;
+                else
+                    return align;
+            }
+
+            template<typename T> constexpr const NodeStorage<T>& get() const noexcept
+            {
+                return const_cast<NodePayload*>(this)->get<T>();
+            }
+        };
+
+        // Nodes live in chunks of kNodeChunkSize bytes that are aligned to their size, a node finds the header of
+        // its chunk by masking its own address. The header occupies the first slot of a chunk so the index 0
+        // never refers to a node.
+        static constexpr std::size_t kNodeChunkSize = 0x4000;
+        static constexpr std::size_t kNodeSlotSize = 32;
+        static constexpr std::uint32_t kNodeChunkSlots = static_cast<std::uint32_t>(kNodeChunkSize / kNodeSlotSize);
+
+        struct NodeChunk;
+
+        // All chunks of an arena, the index of a chunk is the upper part of the node index.
+        struct NodeChunkTable
+        {
+            NodeChunk* const* chunks{};
+        };
+
+        struct NodeChunk
+        {
+            const NodeChunkTable* table{};
+            std::uint32_t index{};
+
+            static NodeChunk* of(const void* node) noexcept
+            {
+                // NOLINTNEXTLINE
+                return reinterpret_cast<NodeChunk*>(reinterpret_cast<std::uintptr_t>(node) & ~(kNodeChunkSize - 1));
+            }
+
+            // Returns the index of the node within the arena, 0 for null.
+            static std::uint32_t indexOf(const void* node) noexcept
+            {
+                if (node == nullptr)
+                {
+                    return 0;
+                }
+
+                const auto* chunk = of(node);
+                const auto offset = reinterpret_cast<std::uintptr_t>(node) - reinterpret_cast<std::uintptr_t>(chunk);
+
+                return chunk->index * kNodeChunkSlots + static_cast<std::uint32_t>(offset / kNodeSlotSize);
+            }
+
+            // Returns the node at the index within the arena of the given node, null for the index 0.
+            static void* resolve(const void* node, std::uint32_t index) noexcept
+            {
+                if (index == 0)
+                {
+                    return nullptr;
+                }
+
+                auto* chunk = of(node);
+
+                // Neighbours are usually in the same chunk which avoids the lookup in the table.
+                const auto chunkIndex = index / kNodeChunkSlots;
+                if (chunkIndex != chunk->index)
+                {
+                    chunk = chunk->table->chunks[chunkIndex];
+                }
+
+                // NOLINTNEXTLINE
+                return reinterpret_cast<std::byte*>(chunk) + (index % kNodeChunkSlots) * kNodeSlotSize;
+            }
+        };
+
+    } // namespace detail
+
     /// <summary>
     /// A type to hold data such as Instruction, Label, Data etc. within a doubly
-    /// linked list managed by the Program. The data is internally stored as a variant
-    /// of the possible types a node can hold.
+    /// linked list managed by the Program. The data is internally stored as a pointer
+    /// with a compact tag of the type it holds, small types are stored inline. Nodes
+    /// are stored in an arena of the Program and linked by their 32 bit index in it.
     /// </summary>
     class Node
     {
@@ -38,9 +202,13 @@ namespace zasm
     protected:
         Id _id{ Id::Invalid };
         NodeFlags _flags{};
-        Node* _prev{};
-        Node* _next{};
-        std::variant<Sentinel*, Instruction*, Label*, EmbeddedLabel*, Data*, Section*, Align*> _data{};
+        // Index of the held type in detail::NodeTypes.
+        std::uint8_t _type{};
+        // Index of the previous and next node in the arena, 0 if there is none.
+        std::uint32_t _prev{};
+        std::uint32_t _next{};
+
+        detail::NodePayload _data{};
 
         union
         {
@@ -53,8 +221,42 @@ namespace zasm
         template<typename T>
         constexpr Node(Id nodeId, T* val) noexcept
             : _id{ nodeId }
+            , _type{ detail::kNodeTypeIndex<T> }
+            , _data{ val }
+        {
+            static_assert(!detail::kNodeInline<T>);
+        }
+
+        template<typename T>
+        constexpr Node(Id nodeId, std::in_place_t, const T& val) noexcept
+            : _id{ nodeId }
+            , _type{ detail::kNodeTypeIndex<T> }
             , _data{ val }
         {
+            static_assert(detail::kNodeInline<T>);
+        }
+
+        template<typename T> constexpr const T* data_() const noexcept
+        {
+            if constexpr (detail::kNodeInline<T>)
+            {
+                return &_data.get<T>();
+            }
+            else
+            {
+                return _data.get<T>();
+            }
+        }
+
+        template<typename T> constexpr T* data_() noexcept
+        {
+            return const_cast<T*>(static_cast<const Node*>(this)->data_<T>());
+        }
+
+        template<std::size_t TIndex, typename TPred> constexpr auto visit_(TPred&& func)
+        {
+            using T = std::tuple_element_t<TIndex, detail::NodeTypes>;
+            return func(*data_<T>());
         }
 
     public:
@@ -66,13 +268,13 @@ namespace zasm
         /// <returns>Previous node or null</returns>
         Node* getPrev() const noexcept
         {
-            return _prev;
+            return static_cast<Node*>(detail::NodeChunk::resolve(this, _prev));
         }
 
         /// <see cref="getPrev"/>
         Node* getPrev() noexcept
         {
-            return _prev;
+            return static_cast<Node*>(detail::NodeChunk::resolve(this, _prev));
         }
 
         /// <summary>
@@ -81,13 +283,13 @@ namespace zasm
         /// <returns>Next node or null</returns>
         Node* getNext() const noexcept
         {
-            return _next;
+            return static_cast<Node*>(detail::NodeChunk::resolve(this, _next));
         }
 
         /// <see cref="getNext"/>
         Node* getNext() noexcept
         {
-            return _next;
+            return static_cast<Node*>(detail::NodeChunk::resolve(this, _next));
         }
 
         /// <summary>
@@ -97,7 +299,7 @@ namespace zasm
         /// <returns>True if the T is the current type</returns>
         template<typename T> constexpr bool holds() const noexcept
         {
-            return std::holds_alternative<T*>(_data);
+            return _type == detail::kNodeTypeIndex<T>;
         }
 
         /// <summary>
@@ -108,13 +310,21 @@ namespace zasm
         /// <returns>Returns a reference to the data with the type of T</returns>
         template<typename T> constexpr const T& get() const
         {
-            return *std::get<T*>(_data);
+            if (!holds<T>())
+            {
+                throw std::bad_variant_access{};
+            }
+            return *data_<T>();
         }
 
         /// <see cref="get"/>
         template<typename T> constexpr T& get()
         {
-            return *std::get<T*>(_data);
+            if (!holds<T>())
+            {
+                throw std::bad_variant_access{};
+            }
+            return *data_<T>();
         }
 
         /// <summary>
@@ -125,19 +335,17 @@ namespace zasm
         /// <returns>Pointer of type T</returns>
         template<typename T> constexpr const T* getIf() const noexcept
         {
-            auto r = std::get_if<T*>(&_data);
-            if (r == nullptr)
+            if (!holds<T>())
                 return nullptr;
-            return *r;
+            return data_<T>();
         }
 
         /// <see cref="getIf"/>
         template<typename T> constexpr T* getIf() noexcept
         {
-            auto r = std::get_if<T*>(&_data);
-            if (r == nullptr)
+            if (!holds<T>())
                 return nullptr;
-            return *r;
+            return data_<T>();
         }
 
         /// <summary>
@@ -149,13 +357,32 @@ namespace zasm
         /// <returns>The result of the visitor function</returns>
         template<typename TPred> constexpr auto visit(TPred&& func) const
         {
-            return std::visit([&](auto&& obj) { return func(*obj); }, _data);
+            return const_cast<Node*>(this)->visit([&](const auto& obj) { return func(obj); });
         }
 
         /// <see cref="visit"/>
         template<typename TPred> constexpr auto visit(TPred&& func)
         {
-            return std::visit([&](auto&& obj) { return func(*obj); }, _data);
+            static_assert(std::tuple_size_v<detail::NodeTypes> == 7, "Every type requires a case");
+
+            switch (_type)
+            {
+                case 1:
+                    return visit_<1>(func);
+                case 2:
+                    return visit_<2>(func);
+                case 3:
+                    return visit_<3>(func);
+                case 4:
+                    return visit_<4>(func);
+                case 5:
+                    return visit_<5>(func);
+                case 6:
+                    return visit_<6>(func);
+                default:
+                    break;
+            }
+            return visit_<0>(func);
         }
 
         /// <summary>
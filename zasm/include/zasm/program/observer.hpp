@@ -1,8 +1,9 @@
 #pragma once
 
+#include "node.hpp"
+
 namespace zasm
 {
-    class Node;
 
     /// <summary>
     /// Observer interface to be implemented by classes that want to be notified of changes in the Program.
@@ -43,6 +44,50 @@ namespace zasm
         virtual void onNodeInserted(Node* node)
         {
         }
+
+        /// <summary>
+        /// This is called before a range of nodes is detached, the default calls onNodeDetach for each node.
+        /// </summary>
+        /// <param name="first">The first node of the range</param>
+        /// <param name="last">The last node of the range</param>
+        virtual void onRangeDetach(Node* first, Node* last)
+        {
+            for (auto* node = first; node != nullptr; node = node->getNext())
+            {
+                onNodeDetach(node);
+                if (node == last)
+                {
+                    break;
+                }
+            }
+        }
+
+        /// <summary>
+        /// This is called after a range of nodes has been inserted, the default calls onNodeInserted for each node.
+        /// </summary>
+        /// <param name="first">The first node of the range</param>
+        /// <param name="last">The last node of the range</param>
+        virtual void onRangeInserted(Node* first, Node* last)
+        {
+            for (auto* node = first; node != nullptr; node = node->getNext())
+            {
+                onNodeInserted(node);
+                if (node == last)
+                {
+                    break;
+                }
+            }
+        }
+
+        /// <summary>
+        /// This is called after a range of nodes has been moved to a different position with Program::splice,
+        /// the nodes remain attached. Program::moveAfter and Program::moveBefore call this with the single node.
+        /// </summary>
+        /// <param name="first">The first node of the range</param>
+        /// <param name="last">The last node of the range</param>
+        virtual void onRangeMoved(Node* first, Node* last)
+        {
+        }
     };
 
 } // namespace zasm
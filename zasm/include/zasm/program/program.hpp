@@ -146,6 +146,50 @@ namespace zasm
         /// <returns>The moved node</returns>
         Node* moveBefore(Node* pos, Node* node) noexcept;
 
+        /// <summary>
+        /// Inserts a detached range of nodes after the specified position, the range must be linked as returned
+        /// by detachRange. The range is linked in constant time and observers are notified once with
+        /// onRangeInserted.
+        /// </summary>
+        /// <param name="pos">Position of insertion, null inserts at the start</param>
+        /// <param name="first">The first node of the range</param>
+        /// <param name="last">The last node of the range</param>
+        /// <returns>The last inserted node</returns>
+        Node* insertRangeAfter(Node* pos, Node* first, Node* last) noexcept;
+
+        /// <summary>
+        /// Links the detached nodes in the order of the array and inserts them after the specified position,
+        /// this is the bulk version of insertAfter for nodes obtained from the create functions. Observers are
+        /// notified once with onRangeInserted.
+        /// </summary>
+        /// <param name="pos">Position of insertion, null inserts at the start</param>
+        /// <param name="nodes">Array of detached nodes</param>
+        /// <param name="count">Amount of nodes</param>
+        /// <returns>The last inserted node or pos if count is zero</returns>
+        Node* insertRangeAfter(Node* pos, Node* const* nodes, std::size_t count) noexcept;
+
+        /// <summary>
+        /// Detaches the nodes from first to last, including both, from the program. The nodes stay linked to each
+        /// other so the range can be inserted again with insertRangeAfter. Observers are notified once with
+        /// onRangeDetach.
+        /// </summary>
+        /// <param name="first">The first node of the range</param>
+        /// <param name="last">The last node of the range</param>
+        /// <returns>The node that followed the range</returns>
+        /// <note>Nodes that are detached are not tracked, make sure they don't get lost to avoid memory leaks</note>
+        Node* detachRange(Node* first, Node* last) noexcept;
+
+        /// <summary>
+        /// Moves the nodes from first to last, including both, after the specified position in constant time.
+        /// The nodes stay attached, observers are notified once with onRangeMoved. The position must not be
+        /// within the range.
+        /// </summary>
+        /// <param name="pos">Position of node to move after, null moves the range to the start</param>
+        /// <param name="first">The first node of the range</param>
+        /// <param name="last">The last node of the range</param>
+        /// <returns>The last moved node</returns>
+        Node* splice(Node* pos, Node* first, Node* last) noexcept;
+
         /// <summary>
         /// Releases the memory of node back into the pool, the memory is considered invalid after the
         /// call.
@@ -159,6 +203,16 @@ namespace zasm
         /// <returns>Node count</returns>
         std::size_t size() const noexcept;
 
+        /// <summary>
+        /// Reserves memory for the specified amount of additional nodes, instructions and labels. The
+        /// pools otherwise start small and grow on demand, this avoids the intermediate growth steps
+        /// when the size of the program is known upfront.
+        /// </summary>
+        /// <param name="nodeCount">Amount of nodes of any type</param>
+        /// <param name="instructionCount">Amount of instruction nodes</param>
+        /// <param name="labelCount">Amount of labels</param>
+        void reserve(std::size_t nodeCount, std::size_t instructionCount = 0, std::size_t labelCount = 0);
+
         /// <summary>
         /// Clears the entire program state, pools will keep their
         /// capacity.
@@ -0,0 +1,100 @@
+#pragma once
+
+#include <cstddef>
+#include <zasm/base/mode.hpp>
+
+namespace zasm
+{
+    class Program;
+
+    namespace x86
+    {
+        class Assembler;
+    }
+
+    namespace detail
+    {
+        struct ProgramPoolState;
+        struct ProgramPoolEntry;
+    } // namespace detail
+
+    /// <summary>
+    /// Keeps Program and Assembler pairs for reuse so that short lived programs do not pay for their
+    /// construction and the growth of their internal storage on every use. Acquiring and releasing is
+    /// thread safe, a released program is cleared by the releasing thread in time proportional to what
+    /// was used while keeping the capacity of its pools, tables and string storage.
+    /// </summary>
+    class ProgramPool
+    {
+        detail::ProgramPoolState* _state{};
+
+    public:
+        /// <summary>
+        /// Exclusive access to a pooled Program and its Assembler, the pair is returned to the pool once the
+        /// handle is destroyed. Observers that are still registered at that point receive the notifications
+        /// of clearing the program and are removed afterwards, they must therefore outlive the handle.
+        /// </summary>
+        class Handle
+        {
+            detail::ProgramPoolState* _state{};
+            detail::ProgramPoolEntry* _entry{};
+
+            friend class ProgramPool;
+
+            Handle(detail::ProgramPoolState* state, detail::ProgramPoolEntry* entry) noexcept;
+
+        public:
+            Handle() = default;
+            Handle(const Handle&) = delete;
+            Handle(Handle&& other) noexcept;
+            ~Handle();
+
+            Handle& operator=(const Handle&) = delete;
+            Handle& operator=(Handle&& other) noexcept;
+
+            /// <summary>
+            /// Returns the program and the assembler to the pool, the handle is empty afterwards.
+            /// </summary>
+            void release();
+
+            bool isValid() const noexcept
+            {
+                return _entry != nullptr;
+            }
+
+            Program& getProgram() const noexcept;
+            x86::Assembler& getAssembler() const noexcept;
+        };
+
+    public:
+        /// <summary>
+        /// Constructs the pool, all programs are created with the specified mode.
+        /// </summary>
+        /// <param name="mode">Machine mode of the programs</param>
+        /// <param name="initialCount">Amount of programs that are created upfront</param>
+        explicit ProgramPool(MachineMode mode, std::size_t initialCount = 0);
+        ProgramPool(const ProgramPool&) = delete;
+        ProgramPool(ProgramPool&& other) noexcept;
+        ~ProgramPool();
+
+        ProgramPool& operator=(const ProgramPool&) = delete;
+        ProgramPool& operator=(ProgramPool&& other) noexcept;
+
+        /// <summary>
+        /// Hands out an empty program with the assembler cursor at the start, a new pair is created if none is
+        /// available. The pool must outlive the handle.
+        /// </summary>
+        Handle acquire();
+
+        /// <summary>
+        /// Returns the amount of programs that are currently not handed out.
+        /// </summary>
+        std::size_t getAvailableCount() const;
+
+        /// <summary>
+        /// Returns the amount of programs owned by the pool including the ones that are handed out.
+        /// </summary>
+        std::size_t size() const;
+    };
+
+} // namespace zasm
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace zasm
+{
+    /// <summary>
+    /// Writable memory handed out by a code sink.
+    /// </summary>
+    struct CodeSpan
+    {
+        std::uint8_t* data{};
+        std::size_t capacity{};
+    };
+
+    /// <summary>
+    /// Caller provided memory that receives the serialized code, the serializer writes the encoded bytes
+    /// into it once the layout is final which avoids copying the code out of the serializer afterwards. The
+    /// sink is written once per serialization and grow is only called with the final size of the code.
+    /// </summary>
+    class ICodeSink
+    {
+    public:
+        virtual ~ICodeSink() = default;
+
+        /// <summary>
+        /// Called when the serializer requires more memory than the current span can hold. The returned span
+        /// must have a capacity of at least requiredSize bytes and if the memory is moved the first usedSize
+        /// bytes have to be preserved. Returning a span without data fails the serialization with
+        /// ErrorCode::OutOfMemory.
+        /// </summary>
+        /// <param name="usedSize">Amount of bytes written so far</param>
+        /// <param name="requiredSize">Minimum capacity required</param>
+        /// <returns>The span to continue writing to</returns>
+        virtual CodeSpan grow(std::size_t usedSize, std::size_t requiredSize) = 0;
+    };
+
+    /// <summary>
+    /// Code sink for memory with a fixed size such as a mapped region.
+    /// </summary>
+    class FixedCodeSink final : public ICodeSink
+    {
+        CodeSpan _span{};
+
+    public:
+        FixedCodeSink(void* data, std::size_t capacity) noexcept
+            : _span{ static_cast<std::uint8_t*>(data), capacity }
+        {
+        }
+
+        CodeSpan grow([[maybe_unused]] std::size_t usedSize, std::size_t requiredSize) override
+        {
+            if (requiredSize > _span.capacity)
+            {
+                return {};
+            }
+            return _span;
+        }
+    };
+
+} // namespace zasm
@@ -1,10 +1,16 @@
 #pragma once
 
+#include <array>
+#include <chrono>
 #include <cstdint>
+#include <vector>
 #include <zasm/core/errors.hpp>
 #include <zasm/core/expected.hpp>
+#include <zasm/core/stream.hpp>
 #include <zasm/encoder/encoder.hpp>
+#include <zasm/encoder/encodercache.hpp>
 #include <zasm/program/program.hpp>
+#include <zasm/serialization/codesink.hpp>
 
 namespace zasm
 {
@@ -35,6 +41,34 @@ namespace zasm
         Label::Id label{ Label::Id::Invalid };
     };
 
+    struct SerializerStats
+    {
+        // Amount of encoding passes.
+        std::int32_t passCount{};
+        // Amount of nodes that changed their size compared to the previous pass, one entry per pass.
+        std::vector<std::size_t> resizedNodesPerPass;
+        // Amount of instructions encoded by the passes, copied and pre-encoded instructions are not included.
+        std::size_t encodedInstructions{};
+        // Time spent encoding and resolving the layout, includes the relocations when streaming.
+        std::chrono::nanoseconds encodeTime{};
+        // Time spent building the relocations.
+        std::chrono::nanoseconds relocationTime{};
+        // Total size of the code and the size of each section.
+        std::size_t codeSize{};
+        std::vector<std::int64_t> sectionSizes;
+        // Relocations including external ones indexed by RelocationType and RelocationData.
+        std::array<std::size_t, 3> relocationsByType{};
+        std::array<std::size_t, 4> relocationsByData{};
+        // Relocations that required decoding the instruction to locate the field.
+        std::size_t decodedRelocations{};
+    };
+
+    struct SerializerRange
+    {
+        const Node* first{};
+        const Node* last{};
+    };
+
     class Serializer
     {
         detail::SerializerState* _state{};
@@ -56,6 +90,29 @@ namespace zasm
         /// <returns>If successful returns Error::None otherwise check Error value.</returns>
         Error serialize(const Program& program, std::int64_t newBase);
 
+        /// <summary>
+        /// Serializes the all the nodes in the Program and writes the code directly into the memory provided
+        /// by the sink. The serializer does not keep a copy of the code, getCode returns nullptr and relocate
+        /// is not available, everything else can be queried as usual.
+        /// </summary>
+        /// <param name="newBase">Virtual base address at where the code starts</param>
+        /// <param name="sink">Receives the code, getCodeSize returns the amount of bytes written</param>
+        /// <returns>If successful returns Error::None otherwise check Error value.</returns>
+        Error serialize(const Program& program, std::int64_t newBase, ICodeSink& sink);
+
+        /// <summary>
+        /// Serializes the all the nodes in the Program and writes the code in chunks to the stream once the layout
+        /// is resolved, memory usage is bounded by the amount of nodes rather than the size of the code. If a
+        /// relocation stream is specified the RelocationInfo entries are written to it as they are created instead
+        /// of being kept by the serializer, external relocations are always kept. As with sinks getCode returns
+        /// nullptr and relocate is not available.
+        /// </summary>
+        /// <param name="newBase">Virtual base address at where the code starts</param>
+        /// <param name="code">Receives the code, getCodeSize returns the amount of bytes written</param>
+        /// <param name="relocations">Optional stream that receives the relocations</param>
+        /// <returns>If successful returns Error::None otherwise check Error value.</returns>
+        Error serialize(const Program& program, std::int64_t newBase, IStream& code, IStream* relocations = nullptr);
+
         /// <summary>
         /// Serializes the specified range in the Program to the encoder and
         /// resolves the address of each label.
@@ -68,18 +125,120 @@ namespace zasm
         Error serialize(const Program& program, std::int64_t newBase, const Node* first, const Node* last);
 
         /// <summary>
-        /// Attempts to relocate the current serialized code to the new specified base address.
+        /// Serializes the nodes from the first to the last range, each range is encoded by a single worker
+        /// if multiple threads are configured, see setThreadCount. The ranges must be in program order and
+        /// each range has to be followed directly by the next one.
+        /// </summary>
+        /// <param name="program"></param>
+        /// <param name="newBase">Virtual base address at where the code starts</param>
+        /// <param name="ranges">Array of ranges, first and last node are inclusive</param>
+        /// <param name="rangeCount">Amount of ranges</param>
+        /// <returns>If successful returns Error::None otherwise check Error value.</returns>
+        Error serializeRanges(
+            const Program& program, std::int64_t newBase, const SerializerRange* ranges, std::size_t rangeCount);
+
+        /// <summary>
+        /// Enables incremental serialization for the specified Program. The serializer registers itself as an
+        /// observer of the program and keeps the encoded nodes of the last successful serialization, subsequent
+        /// calls to serialize will only encode instructions that were inserted since or whose encoding depends on
+        /// an address that has moved, everything else is copied from the previous result. Unmodified ranges of
+        /// nodes are copied as a whole if no label moved, otherwise the remaining passes visit every node.
+        /// The program must outlive the serializer or incremental serialization has to be disabled before.
+        /// </summary>
+        /// <param name="program">The program to observe</param>
+        void enableIncremental(Program& program);
+
+        /// <summary>
+        /// Disables incremental serialization and removes the observer from the program.
+        /// </summary>
+        void disableIncremental() noexcept;
+
+        /// <summary>
+        /// Returns true if incremental serialization is enabled.
+        /// </summary>
+        bool isIncremental() const noexcept;
+
+        /// <summary>
+        /// Marks the node as modified for incremental serialization. This is only required when the
+        /// instruction of a node is modified in place, inserting, detaching and destroying nodes is tracked.
+        /// </summary>
+        /// <param name="node">The modified node</param>
+        void invalidate(const Node* node) noexcept;
+
+        /// <summary>
+        /// Attempts to relocate the current serialized code to the new specified base address. The code is
+        /// patched in place, all relocations are validated first so the state is unchanged on failure.
         /// </summary>
         /// <param name="newBase">Virtual base address at where the code starts</param>
         /// <returns>If successful returns Error::None otherwise check Error value.</returns>
         Error relocate(std::int64_t newBase);
 
+        /// <summary>
+        /// Writes a copy of the current serialized code relocated to each of the specified base addresses into
+        /// the buffers, the serializer state is not modified. Each buffer must be able to hold getCodeSize bytes.
+        /// </summary>
+        /// <param name="newBases">Array of base addresses</param>
+        /// <param name="buffers">Array of output buffers, one per base address</param>
+        /// <param name="count">Amount of base addresses and buffers</param>
+        /// <returns>If successful returns Error::None otherwise check Error value.</returns>
+        Error relocateInto(const std::int64_t* newBases, std::uint8_t* const* buffers, std::size_t count) const;
+
         /// <summary>
         /// Returns the last base address used in a successful serialize call.
         /// </summary>
         /// <returns>Current base address</returns>
         std::int64_t getBase() const noexcept;
 
+        /// <summary>
+        /// Attaches an encoder cache, instructions that do not depend on the address are looked up in the
+        /// cache before encoding them. The cache may be shared with other serializers and must outlive the
+        /// serializer, passing nullptr detaches the cache.
+        /// </summary>
+        /// <param name="cache">The cache to use or nullptr</param>
+        void setEncoderCache(EncoderCache* cache) noexcept;
+
+        /// <summary>
+        /// Returns the attached encoder cache or nullptr if none is attached.
+        /// </summary>
+        EncoderCache* getEncoderCache() const noexcept;
+
+        /// <summary>
+        /// Enables collecting statistics for each serialize call, this is disabled by default. When disabled
+        /// no time is measured and nothing is allocated.
+        /// </summary>
+        /// <param name="enabled">True to collect statistics</param>
+        void setStatsEnabled(bool enabled) noexcept;
+
+        /// <summary>
+        /// Returns true if statistics are collected.
+        /// </summary>
+        bool isStatsEnabled() const noexcept;
+
+        /// <summary>
+        /// Returns the statistics of the last serialize call, all values are zero if statistics are disabled.
+        /// </summary>
+        const SerializerStats& getStats() const noexcept;
+
+        /// <summary>
+        /// Sets the amount of threads used to serialize, 0 and 1 serialize on the calling thread only.
+        /// Instructions that do not depend on an address are encoded in parallel, by default the program is
+        /// split at sections and large sections are split further. Labels, branches and relocations are
+        /// resolved afterwards on the calling thread, the result is identical to the serial result. The worker
+        /// threads are started here and kept by the serializer for all following calls.
+        /// </summary>
+        /// <param name="count">Amount of threads including the calling thread</param>
+        void setThreadCount(std::size_t count) noexcept;
+
+        /// <summary>
+        /// Returns the amount of threads used to serialize.
+        /// </summary>
+        std::size_t getThreadCount() const noexcept;
+
+        /// <summary>
+        /// Returns the amount of encoding passes the last successful serialize call required.
+        /// </summary>
+        std::int32_t getPassCount() const noexcept;
+
         /// <summary>
         /// After a successful serialization this will return the total size of all encoded nodes not
         /// including section alignment. This is the size of the flat buffer used to encode every node,
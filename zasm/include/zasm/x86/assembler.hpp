@@ -40,6 +40,12 @@ namespace zasm::x86
         /// <returns>Position in Program</returns>
         Node* getCursor() const noexcept;
 
+        /// <summary>
+        /// Resets the cursor and discards pending attributes such as prefixes that were not consumed by
+        /// an instruction yet.
+        /// </summary>
+        void reset() noexcept;
+
     public:
         /// <summary>
         /// See Program::createLabel
@@ -194,6 +200,7 @@ namespace zasm::x86
         /// <param name="node"></param>
         void onNodeDetach(Node* node) noexcept override;
         void onNodeDestroy(Node* node) noexcept override;
+        void onRangeDetach(Node* first, Node* last) noexcept override;
     };
 
 } // namespace zasm::x86
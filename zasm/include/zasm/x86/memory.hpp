@@ -151,47 +151,47 @@ namespace zasm::x86
 
     // Generic helper functions that specify size
     // See the ptr overloads for all valid forms.
-    template<typename... TArgs> static Mem byte_ptr(TArgs&&... args) noexcept
+    template<typename... TArgs> static constexpr Mem byte_ptr(TArgs&&... args) noexcept
     {
         return ptr(BitSize::_8, std::forward<TArgs>(args)...);
     };
-    template<typename... TArgs> static Mem word_ptr(TArgs&&... args) noexcept
+    template<typename... TArgs> static constexpr Mem word_ptr(TArgs&&... args) noexcept
     {
         return ptr(BitSize::_16, std::forward<TArgs>(args)...);
     };
-    template<typename... TArgs> static Mem dword_ptr(TArgs&&... args) noexcept
+    template<typename... TArgs> static constexpr Mem dword_ptr(TArgs&&... args) noexcept
     {
         return ptr(BitSize::_32, std::forward<TArgs>(args)...);
     };
-    template<typename... TArgs> static Mem fword_ptr(TArgs&&... args) noexcept
+    template<typename... TArgs> static constexpr Mem fword_ptr(TArgs&&... args) noexcept
     {
         return ptr(BitSize::_48, std::forward<TArgs>(args)...);
     };
-    template<typename... TArgs> static Mem qword_ptr(TArgs&&... args) noexcept
+    template<typename... TArgs> static constexpr Mem qword_ptr(TArgs&&... args) noexcept
     {
         return ptr(BitSize::_64, std::forward<TArgs>(args)...);
     };
-    template<typename... TArgs> static Mem tbyte_ptr(TArgs&&... args) noexcept
+    template<typename... TArgs> static constexpr Mem tbyte_ptr(TArgs&&... args) noexcept
     {
         return ptr(BitSize::_80, std::forward<TArgs>(args)...);
     };
-    template<typename... TArgs> static Mem tword_ptr(TArgs&&... args) noexcept
+    template<typename... TArgs> static constexpr Mem tword_ptr(TArgs&&... args) noexcept
     {
         return ptr(BitSize::_80, std::forward<TArgs>(args)...);
     };
-    template<typename... TArgs> static Mem oword_ptr(TArgs&&... args) noexcept
+    template<typename... TArgs> static constexpr Mem oword_ptr(TArgs&&... args) noexcept
     {
         return ptr(BitSize::_128, std::forward<TArgs>(args)...);
     };
-    template<typename... TArgs> static Mem xmmword_ptr(TArgs&&... args) noexcept
+    template<typename... TArgs> static constexpr Mem xmmword_ptr(TArgs&&... args) noexcept
     {
         return ptr(BitSize::_128, std::forward<TArgs>(args)...);
     };
-    template<typename... TArgs> static Mem ymmword_ptr(TArgs&&... args) noexcept
+    template<typename... TArgs> static constexpr Mem ymmword_ptr(TArgs&&... args) noexcept
     {
         return ptr(BitSize::_256, std::forward<TArgs>(args)...);
     };
-    template<typename... TArgs> static Mem zmmword_ptr(TArgs&&... args) noexcept
+    template<typename... TArgs> static constexpr Mem zmmword_ptr(TArgs&&... args) noexcept
     {
         return ptr(BitSize::_512, std::forward<TArgs>(args)...);
     };
@@ -2,7 +2,17 @@
 
 #include <zasm/core/errors.hpp>
 #include <zasm/decoder/decoder.hpp>
+#include <zasm/decoder/decodercfg.hpp>
+#include <zasm/decoder/decodercolumns.hpp>
+#include <zasm/decoder/decoderparallel.hpp>
+#include <zasm/decoder/decoderprogram.hpp>
+#include <zasm/encoder/constencoder.hpp>
 #include <zasm/encoder/encoder.hpp>
+#include <zasm/encoder/encoderbatch.hpp>
+#include <zasm/encoder/encodercache.hpp>
+#include <zasm/encoder/encodersession.hpp>
+#include <zasm/program/instructiondetailtable.hpp>
 #include <zasm/program/program.hpp>
+#include <zasm/program/programpool.hpp>
 #include <zasm/serialization/serializer.hpp>
 #include <zasm/x86/x86.hpp>
@@ -0,0 +1,166 @@
+#include "threadpool.hpp"
+
+#include <algorithm>
+#include <exception>
+#include <utility>
+
+namespace zasm::detail
+{
+    ThreadPool::~ThreadPool()
+    {
+        stopThreads();
+    }
+
+    void ThreadPool::resize(std::size_t threadCount) noexcept
+    {
+        const auto workerCount = threadCount > 1 ? threadCount - 1 : 0;
+
+        std::lock_guard runLock(_runMutex);
+        if (workerCount < _threads.size())
+        {
+            stopThreads();
+        }
+        startThreads(workerCount);
+    }
+
+    void ThreadPool::startThreads(std::size_t count) noexcept
+    {
+        try
+        {
+            _threads.reserve(count);
+            while (_threads.size() < count)
+            {
+                _threads.emplace_back(&ThreadPool::workerMain, this, _threads.size(), _generation);
+            }
+        }
+        catch (const std::exception&)
+        {
+            // Continue with the threads that were started.
+        }
+    }
+
+    void ThreadPool::stopThreads() noexcept
+    {
+        {
+            std::lock_guard lock(_mutex);
+            _stop = true;
+        }
+        _wakeCv.notify_all();
+
+        for (auto& thread : _threads)
+        {
+            thread.join();
+        }
+        _threads.clear();
+
+        _stop = false;
+    }
+
+    void ThreadPool::workerMain(std::size_t workerIdx, std::uint64_t generation)
+    {
+        std::unique_lock lock(_mutex);
+        while (true)
+        {
+            _wakeCv.wait(lock, [&]() { return _stop || _generation != generation; });
+            if (_stop)
+            {
+                break;
+            }
+
+            generation = _generation;
+            if (workerIdx >= _participants)
+            {
+                continue;
+            }
+
+            lock.unlock();
+            runTasks();
+            lock.lock();
+
+            if (--_activeWorkers == 0)
+            {
+                _doneCv.notify_one();
+            }
+        }
+    }
+
+    void ThreadPool::runTasks() noexcept
+    {
+        try
+        {
+            for (auto idx = _nextTask++; idx < _taskCount; idx = _nextTask++)
+            {
+                _fn(_ctx, idx);
+            }
+        }
+        catch (...)
+        {
+            std::lock_guard lock(_mutex);
+            if (!_error)
+            {
+                _error = std::current_exception();
+            }
+
+            // Stop handing out the remaining tasks.
+            _nextTask = _taskCount;
+        }
+    }
+
+    void ThreadPool::dispatch(std::size_t threadCount, std::size_t taskCount, TaskFn fn, void* ctx)
+    {
+        std::unique_lock runLock(_runMutex, std::try_to_lock);
+
+        std::size_t workerCount = 0;
+        if (runLock.owns_lock() && threadCount > 1 && taskCount > 1)
+        {
+            if (threadCount - 1 > _threads.size())
+            {
+                startThreads(threadCount - 1);
+            }
+            workerCount = std::min({ threadCount - 1, taskCount - 1, _threads.size() });
+        }
+
+        if (workerCount == 0)
+        {
+            for (std::size_t idx = 0; idx < taskCount; ++idx)
+            {
+                fn(ctx, idx);
+            }
+            return;
+        }
+
+        {
+            std::lock_guard lock(_mutex);
+            _fn = fn;
+            _ctx = ctx;
+            _taskCount = taskCount;
+            _nextTask = 0;
+            _participants = workerCount;
+            _activeWorkers = workerCount;
+            _generation++;
+        }
+        _wakeCv.notify_all();
+
+        runTasks();
+
+        // The workers may still access the function, wait for them before passing on an exception.
+        std::exception_ptr error;
+        {
+            std::unique_lock lock(_mutex);
+            _doneCv.wait(lock, [&]() { return _activeWorkers == 0; });
+            error = std::exchange(_error, nullptr);
+        }
+
+        if (error)
+        {
+            std::rethrow_exception(error);
+        }
+    }
+
+    ThreadPool& getSharedThreadPool()
+    {
+        static ThreadPool pool;
+        return pool;
+    }
+
+} // namespace zasm::detail
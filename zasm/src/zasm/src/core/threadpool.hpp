@@ -0,0 +1,86 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace zasm::detail
+{
+    // Worker threads that are kept alive between calls, starting threads on every call costs more than the
+    // work of small inputs. The calling thread always participates in the work.
+    class ThreadPool
+    {
+        using TaskFn = void (*)(void* ctx, std::size_t taskIdx);
+
+        // Held for the duration of a run and while the threads are started or stopped.
+        std::mutex _runMutex;
+        std::vector<std::thread> _threads;
+
+        std::mutex _mutex;
+        std::condition_variable _wakeCv;
+        std::condition_variable _doneCv;
+        bool _stop{};
+        std::uint64_t _generation{};
+        std::size_t _participants{};
+        std::size_t _activeWorkers{};
+
+        // First exception thrown by a task of the current run.
+        std::exception_ptr _error;
+
+        // The current run.
+        TaskFn _fn{};
+        void* _ctx{};
+        std::size_t _taskCount{};
+        std::atomic<std::size_t> _nextTask{};
+
+        void startThreads(std::size_t count) noexcept;
+        void stopThreads() noexcept;
+        void workerMain(std::size_t workerIdx, std::uint64_t generation);
+        void runTasks() noexcept;
+        void dispatch(std::size_t threadCount, std::size_t taskCount, TaskFn fn, void* ctx);
+
+    public:
+        ThreadPool() = default;
+        ThreadPool(const ThreadPool&) = delete;
+        ~ThreadPool();
+
+        ThreadPool& operator=(const ThreadPool&) = delete;
+
+        // Sets the amount of threads including the calling thread, threads that can not be started are left out.
+        void resize(std::size_t threadCount) noexcept;
+
+        // Calls the function for every task index on up to threadCount threads including the calling thread and
+        // returns once all tasks are done. The pool grows if it has less threads, if the pool is used by another
+        // thread at the same time all tasks are run on the calling thread. If a task throws the remaining tasks
+        // are skipped and the first exception is rethrown on the calling thread.
+        template<typename TFn> void run(std::size_t threadCount, std::size_t taskCount, TFn&& fn)
+        {
+            using TFunc = std::remove_reference_t<TFn>;
+
+            const TaskFn invoke = [](void* ctx, std::size_t taskIdx) { (*static_cast<TFunc*>(ctx))(taskIdx); };
+            dispatch(threadCount, taskCount, invoke, const_cast<void*>(static_cast<const void*>(std::addressof(fn))));
+        }
+    };
+
+    // Pool shared by the functions that do not have a state of their own to keep one.
+    ThreadPool& getSharedThreadPool();
+
+    // Resolves a thread count of 0 to the amount of hardware threads.
+    inline std::size_t getThreadCount(std::size_t threadCount) noexcept
+    {
+        if (threadCount == 0)
+        {
+            threadCount = std::max(1U, std::thread::hardware_concurrency());
+        }
+        return threadCount;
+    }
+
+} // namespace zasm::detail
@@ -0,0 +1,379 @@
+#include "zasm/decoder/decodercfg.hpp"
+
+#include "../core/threadpool.hpp"
+#include "decoder.program.hpp"
+#include "zasm/program/program.hpp"
+#include "zasm/x86/mnemonic.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <bitset>
+#include <condition_variable>
+#include <mutex>
+#include <vector>
+
+namespace zasm
+{
+    namespace detail
+    {
+        // Bit per byte of the buffer, shared between the threads.
+        using CfgBitmap = std::vector<std::atomic<std::uint64_t>>;
+
+        struct CfgInstr
+        {
+            std::size_t offset{};
+            DecodedInstr decoded;
+        };
+
+        struct CfgState
+        {
+            const ZydisDecoder* decoder{};
+            const std::uint8_t* bytes{};
+            std::size_t len{};
+            std::uint64_t address{};
+
+            // Offsets of the decoded instructions, also serves as the visited set.
+            CfgBitmap instrStarts;
+            // Targets of relative jumps and branches.
+            CfgBitmap blockStarts;
+            CfgBitmap functionStarts;
+
+            // Functions waiting to be decoded and the amount of functions currently being decoded.
+            std::mutex mutex;
+            std::condition_variable cv;
+            std::vector<std::size_t> functions;
+            std::size_t active{};
+        };
+
+    } // namespace detail
+
+    static bool testBit(const detail::CfgBitmap& bitmap, std::size_t offset) noexcept
+    {
+        const auto mask = std::uint64_t{ 1 } << (offset % 64);
+        return (bitmap[offset / 64].load(std::memory_order_relaxed) & mask) != 0;
+    }
+
+    // Returns true if the bit was already set.
+    static bool testAndSetBit(detail::CfgBitmap& bitmap, std::size_t offset) noexcept
+    {
+        const auto mask = std::uint64_t{ 1 } << (offset % 64);
+        auto& word = bitmap[offset / 64];
+        if ((word.load(std::memory_order_relaxed) & mask) != 0)
+        {
+            return true;
+        }
+        return (word.fetch_or(mask, std::memory_order_relaxed) & mask) != 0;
+    }
+
+    static void clearBit(detail::CfgBitmap& bitmap, std::size_t offset) noexcept
+    {
+        const auto mask = std::uint64_t{ 1 } << (offset % 64);
+        bitmap[offset / 64].fetch_and(~mask, std::memory_order_relaxed);
+    }
+
+    // Instructions after which the execution does not continue with the next instruction.
+    static constexpr bool isFlowEnd(InstrMnemonic mnemonic) noexcept
+    {
+        if (x86::isJmp(mnemonic) || x86::isRet(mnemonic))
+        {
+            return true;
+        }
+
+        switch (mnemonic)
+        {
+            case x86::Mnemonic::Hlt:
+            case x86::Mnemonic::Int3:
+            case x86::Mnemonic::Iret:
+            case x86::Mnemonic::Iretd:
+            case x86::Mnemonic::Iretq:
+            case x86::Mnemonic::Ud2:
+                return true;
+        }
+
+        return false;
+    }
+
+    static constexpr bool isConditionalBranch(InstrMnemonic mnemonic) noexcept
+    {
+        switch (mnemonic)
+        {
+            case x86::Mnemonic::Loop:
+            case x86::Mnemonic::Loope:
+            case x86::Mnemonic::Loopne:
+                return true;
+        }
+
+        return x86::isCondBranching(mnemonic);
+    }
+
+    static constexpr bool isBlockEnd(InstrMnemonic mnemonic) noexcept
+    {
+        return isFlowEnd(mnemonic) || isConditionalBranch(mnemonic);
+    }
+
+    // Decodes a single function, relative jumps and branches are queued to the pending offsets and relative
+    // calls to functions that were not seen before are added to calls.
+    static void decodeFunction(
+        detail::CfgState& state, std::size_t entryOffset, std::vector<std::size_t>& pending,
+        std::vector<detail::CfgInstr>& instrs, std::vector<std::size_t>& calls)
+    {
+        pending.clear();
+        pending.push_back(entryOffset);
+
+        while (!pending.empty())
+        {
+            auto offset = pending.back();
+            pending.pop_back();
+
+            // Stops at instructions that were already decoded by this or another function.
+            while (offset < state.len && !testAndSetBit(state.instrStarts, offset))
+            {
+                auto& entry = instrs.emplace_back();
+                entry.offset = offset;
+
+                const auto status = decodeInstruction(
+                    *state.decoder, state.bytes, state.len, offset, state.address, entry.decoded);
+                if (ZYAN_FAILED(status))
+                {
+                    clearBit(state.instrStarts, offset);
+                    instrs.pop_back();
+                    break;
+                }
+
+                const auto mnemonic = entry.decoded.instr.getMnemonic();
+                const bool isCall = x86::isCall(mnemonic);
+
+                forEachBranchTarget(entry.decoded, state.address, state.len, [&](std::size_t, std::size_t targetOffset) {
+                    if (isCall)
+                    {
+                        if (!testAndSetBit(state.functionStarts, targetOffset))
+                        {
+                            calls.push_back(targetOffset);
+                        }
+                        return;
+                    }
+
+                    testAndSetBit(state.blockStarts, targetOffset);
+                    pending.push_back(targetOffset);
+                });
+
+                if (isFlowEnd(mnemonic))
+                {
+                    break;
+                }
+
+                offset += entry.decoded.length;
+            }
+        }
+    }
+
+    // Takes functions from the queue until it is empty and no other worker can add more.
+    static void runWorker(detail::CfgState& state, std::vector<detail::CfgInstr>& instrs)
+    {
+        std::vector<std::size_t> pending;
+        std::vector<std::size_t> calls;
+
+        std::unique_lock lock(state.mutex);
+        while (true)
+        {
+            if (state.functions.empty())
+            {
+                if (state.active == 0)
+                {
+                    break;
+                }
+
+                state.cv.wait(lock);
+                continue;
+            }
+
+            const auto entryOffset = state.functions.back();
+            state.functions.pop_back();
+            state.active++;
+
+            lock.unlock();
+
+            calls.clear();
+            decodeFunction(state, entryOffset, pending, instrs, calls);
+
+            lock.lock();
+
+            state.active--;
+            state.functions.insert(state.functions.end(), calls.begin(), calls.end());
+
+            if (!calls.empty() || (state.active == 0 && state.functions.empty()))
+            {
+                state.cv.notify_all();
+            }
+        }
+    }
+
+    // Orders the instructions of all workers by offset, the position of each instruction is the amount of
+    // instruction starts before it.
+    static std::vector<const detail::CfgInstr*> getOrderedInstrs(
+        const detail::CfgState& state, const std::vector<std::vector<detail::CfgInstr>>& results)
+    {
+        const auto& starts = state.instrStarts;
+
+        std::vector<std::size_t> wordRanks(starts.size());
+
+        std::size_t count = 0;
+        for (std::size_t i = 0; i < starts.size(); ++i)
+        {
+            wordRanks[i] = count;
+            count += std::bitset<64>(starts[i].load(std::memory_order_relaxed)).count();
+        }
+
+        std::vector<const detail::CfgInstr*> ordered(count);
+        for (const auto& instrs : results)
+        {
+            for (const auto& entry : instrs)
+            {
+                const auto word = starts[entry.offset / 64].load(std::memory_order_relaxed);
+                const auto below = word & ((std::uint64_t{ 1 } << (entry.offset % 64)) - 1);
+                ordered[wordRanks[entry.offset / 64] + std::bitset<64>(below).count()] = &entry;
+            }
+        }
+
+        return ordered;
+    }
+
+    Error decodeCfg(
+        Program& program, std::vector<DecodedBlock>& blocks, const void* data, std::size_t len, std::uint64_t address,
+        const std::vector<std::uint64_t>& entries, std::size_t threadCount)
+    {
+        blocks.clear();
+
+        if (data == nullptr && len != 0)
+        {
+            return ErrorCode::InvalidParameter;
+        }
+        for (const auto entry : entries)
+        {
+            if (entry < address || entry - address >= len)
+            {
+                return ErrorCode::InvalidParameter;
+            }
+        }
+
+        ZydisDecoder decoder{};
+        if (auto status = initDecoder(decoder, program.getMode()); status != ErrorCode::None)
+        {
+            return status;
+        }
+
+        detail::CfgState state;
+        state.decoder = &decoder;
+        state.bytes = static_cast<const std::uint8_t*>(data);
+        state.len = len;
+        state.address = address;
+        state.instrStarts = detail::CfgBitmap((len + 63) / 64);
+        state.blockStarts = detail::CfgBitmap((len + 63) / 64);
+        state.functionStarts = detail::CfgBitmap((len + 63) / 64);
+
+        for (const auto entry : entries)
+        {
+            const auto offset = static_cast<std::size_t>(entry - address);
+            if (!testAndSetBit(state.functionStarts, offset))
+            {
+                state.functions.push_back(offset);
+            }
+        }
+
+        const auto numThreads = std::min(
+            detail::getThreadCount(threadCount), std::max<std::size_t>(state.functions.size(), 1));
+
+        // One task per thread, a worker only returns once all functions are decoded so tasks that run late
+        // return immediately.
+        std::vector<std::vector<detail::CfgInstr>> results(numThreads);
+        detail::getSharedThreadPool().run(
+            numThreads, numThreads, [&](std::size_t idx) { runWorker(state, results[idx]); });
+
+        const auto ordered = getOrderedInstrs(state, results);
+
+        // Create the nodes in the order of the buffer.
+        std::vector<const detail::CfgInstr*> blockTails;
+        std::vector<detail::BranchRef> branches;
+
+        const detail::CfgInstr* prev = nullptr;
+        for (const auto* entry : ordered)
+        {
+            const auto offset = entry->offset;
+
+            const bool isFunction = testBit(state.functionStarts, offset);
+            if (prev == nullptr || isFunction || testBit(state.blockStarts, offset)
+                || isBlockEnd(prev->decoded.instr.getMnemonic()) || prev->offset + prev->decoded.length != offset)
+            {
+                const auto label = program.createLabel();
+
+                auto labelNode = program.bindLabel(label);
+                if (!labelNode)
+                {
+                    return labelNode.error();
+                }
+                program.append(*labelNode);
+
+                auto& block = blocks.emplace_back();
+                block.address = address + offset;
+                block.label = label;
+                block.head = *labelNode;
+                block.isFunction = isFunction;
+
+                blockTails.push_back(nullptr);
+            }
+
+            auto* node = program.append(program.createNode(entry->decoded.instr));
+            addBranchRefs(branches, node, entry->decoded, address, len);
+
+            auto& block = blocks.back();
+            block.size += entry->decoded.length;
+            block.instructionCount++;
+            block.tail = node;
+
+            blockTails.back() = entry;
+            prev = entry;
+        }
+
+        const auto findBlock = [&](std::size_t offset) -> std::size_t {
+            const auto blockAddress = address + offset;
+            const auto it = std::lower_bound(
+                blocks.begin(), blocks.end(), blockAddress,
+                [](const DecodedBlock& block, std::uint64_t val) { return block.address < val; });
+            if (it == blocks.end() || it->address != blockAddress)
+            {
+                return DecodedBlock::kNone;
+            }
+            return static_cast<std::size_t>(std::distance(blocks.begin(), it));
+        };
+
+        for (const auto& branch : branches)
+        {
+            const auto blockIndex = findBlock(branch.targetOffset);
+            if (blockIndex != DecodedBlock::kNone)
+            {
+                branch.node->get<Instruction>().setOperand(branch.operandIndex, blocks[blockIndex].label);
+            }
+        }
+
+        for (std::size_t i = 0; i < blocks.size(); ++i)
+        {
+            auto& block = blocks[i];
+            const auto* tail = blockTails[i];
+
+            const auto mnemonic = tail->decoded.instr.getMnemonic();
+            if (!isFlowEnd(mnemonic))
+            {
+                block.fallthrough = findBlock(tail->offset + tail->decoded.length);
+            }
+            if (x86::isJmp(mnemonic) || isConditionalBranch(mnemonic))
+            {
+                forEachBranchTarget(tail->decoded, address, len, [&](std::size_t, std::size_t targetOffset) {
+                    block.branch = findBlock(targetOffset);
+                });
+            }
+        }
+
+        return ErrorCode::None;
+    }
+
+} // namespace zasm
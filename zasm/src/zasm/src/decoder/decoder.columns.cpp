@@ -0,0 +1,154 @@
+#include "zasm/decoder/decodercolumns.hpp"
+
+#include "decoder.common.hpp"
+
+#include <array>
+
+namespace zasm
+{
+    static constexpr DecodedOperandKind getOperandKind(const ZydisDecodedOperand& op) noexcept
+    {
+        switch (op.type)
+        {
+            case ZYDIS_OPERAND_TYPE_REGISTER:
+                return DecodedOperandKind::Reg;
+            case ZYDIS_OPERAND_TYPE_MEMORY:
+                return DecodedOperandKind::Mem;
+            case ZYDIS_OPERAND_TYPE_IMMEDIATE:
+                return op.imm.is_relative != 0 ? DecodedOperandKind::Rel : DecodedOperandKind::Imm;
+            default:
+                break;
+        }
+        return DecodedOperandKind::None;
+    }
+
+    static void storeInvalidEntry(DecoderColumns& columns, std::size_t index, std::size_t offset) noexcept
+    {
+        if (columns.offsets != nullptr)
+        {
+            columns.offsets[index] = offset;
+        }
+        if (columns.lengths != nullptr)
+        {
+            columns.lengths[index] = 1;
+        }
+        if (columns.mnemonics != nullptr)
+        {
+            columns.mnemonics[index] = Instruction::Mnemonic{ ZYDIS_MNEMONIC_INVALID };
+        }
+        if (columns.categories != nullptr)
+        {
+            columns.categories[index] = Instruction::Category{};
+        }
+        if (columns.attribs != nullptr)
+        {
+            columns.attribs[index] = Instruction::Attribs{};
+        }
+        if (columns.operandKinds != nullptr)
+        {
+            columns.operandKinds[index] = 0;
+        }
+    }
+
+    Error decodeColumns(
+        DecoderColumns& columns, MachineMode mode, const void* data, std::size_t len, DecodeColumnsFlags flags)
+    {
+        columns.count = 0;
+        columns.bytesDecoded = 0;
+
+        if (data == nullptr && len != 0)
+        {
+            return ErrorCode::InvalidParameter;
+        }
+
+        const bool minimal = (flags & DecodeColumnsFlags::Minimal) != DecodeColumnsFlags::None;
+        const bool invalidAsEntry = (flags & DecodeColumnsFlags::InvalidAsEntry) != DecodeColumnsFlags::None;
+        const bool decodeOperands = columns.operandKinds != nullptr;
+
+        if (minimal && (columns.categories != nullptr || columns.attribs != nullptr || decodeOperands))
+        {
+            return ErrorCode::InvalidParameter;
+        }
+
+        ZydisDecoder decoder{};
+        if (auto status = initDecoder(decoder, mode); status != ErrorCode::None)
+        {
+            return status;
+        }
+        if (minimal && ZYAN_FAILED(ZydisDecoderEnableMode(&decoder, ZYDIS_DECODER_MODE_MINIMAL, ZYAN_TRUE)))
+        {
+            return ErrorCode::InvalidOperation;
+        }
+
+        const auto* bytes = static_cast<const std::uint8_t*>(data);
+
+        ZydisDecoderContext ctx{};
+        ZydisDecodedInstruction instr{};
+        std::array<ZydisDecodedOperand, ZYDIS_MAX_OPERAND_COUNT_VISIBLE> instrOps{};
+
+        std::size_t offset = 0;
+        std::size_t index = 0;
+        while (offset < len && index < columns.capacity)
+        {
+            auto status = ZydisDecoderDecodeInstruction(&decoder, &ctx, bytes + offset, len - offset, &instr);
+            if (ZYAN_SUCCESS(status) && decodeOperands)
+            {
+                status = ZydisDecoderDecodeOperands(&decoder, &ctx, &instr, instrOps.data(), instr.operand_count_visible);
+            }
+
+            if (ZYAN_FAILED(status))
+            {
+                if (!invalidAsEntry)
+                {
+                    columns.count = index;
+                    columns.bytesDecoded = offset;
+                    return getDecodeError(status);
+                }
+
+                storeInvalidEntry(columns, index, offset);
+                index++;
+                offset++;
+                continue;
+            }
+
+            if (columns.offsets != nullptr)
+            {
+                columns.offsets[index] = offset;
+            }
+            if (columns.lengths != nullptr)
+            {
+                columns.lengths[index] = instr.length;
+            }
+            if (columns.mnemonics != nullptr)
+            {
+                columns.mnemonics[index] = Instruction::Mnemonic{ static_cast<std::uint16_t>(instr.mnemonic) };
+            }
+            if (columns.categories != nullptr)
+            {
+                columns.categories[index] = getCategory(instr.meta.category);
+            }
+            if (columns.attribs != nullptr)
+            {
+                columns.attribs[index] = getAttribs(instr.attributes);
+            }
+            if (decodeOperands)
+            {
+                std::uint16_t kinds{};
+                for (std::size_t i = 0; i < instr.operand_count_visible; ++i)
+                {
+                    kinds |= static_cast<std::uint16_t>(static_cast<std::uint16_t>(getOperandKind(instrOps[i])) << (i * 3U));
+                }
+                columns.operandKinds[index] = kinds;
+            }
+
+            index++;
+            offset += instr.length;
+        }
+
+        columns.count = index;
+        columns.bytesDecoded = offset;
+
+        return ErrorCode::None;
+    }
+
+} // namespace zasm
@@ -0,0 +1,181 @@
+#pragma once
+
+#include <Zydis/Zydis.h>
+#include <zasm/base/mode.hpp>
+#include <zasm/base/operand.hpp>
+#include <zasm/core/errors.hpp>
+#include <zasm/program/instruction.hpp>
+#include <zasm/x86/meta.hpp>
+
+// Translation of the Zydis decoder types shared by the decoders.
+namespace zasm
+{
+    constexpr Reg getReg(ZydisRegister reg)
+    {
+        return Reg{ static_cast<Reg::Id>(reg) };
+    }
+
+    constexpr bool isRipRelative(const ZydisDecodedOperandMem& mem)
+    {
+        return mem.base == ZYDIS_REGISTER_RIP || mem.base == ZYDIS_REGISTER_EIP || mem.base == ZYDIS_REGISTER_IP;
+    }
+
+    inline Operand getOperand(
+        const ZydisDecodedInstruction& instr, const ZydisDecodedOperand& srcOp, std::uint64_t address) noexcept
+    {
+        if (srcOp.type == ZydisOperandType::ZYDIS_OPERAND_TYPE_UNUSED)
+        {
+            return Operand::None{};
+        }
+        if (srcOp.type == ZydisOperandType::ZYDIS_OPERAND_TYPE_REGISTER)
+        {
+            return Reg{ static_cast<Reg::Id>(srcOp.reg.value) };
+        }
+        if (srcOp.type == ZydisOperandType::ZYDIS_OPERAND_TYPE_MEMORY)
+        {
+            auto baseReg = getReg(srcOp.mem.base);
+            auto disp = srcOp.mem.disp.value;
+            if (isRipRelative(srcOp.mem))
+            {
+                // Keep RIP as a hint to make this relative.
+                disp += static_cast<std::int64_t>(address + instr.length);
+            }
+            return Mem{ toBitSize(srcOp.size),   getReg(srcOp.mem.segment), baseReg,
+                        getReg(srcOp.mem.index), srcOp.mem.scale,           disp };
+        }
+        if (srcOp.type == ZydisOperandType::ZYDIS_OPERAND_TYPE_IMMEDIATE)
+        {
+            const auto& imm = srcOp.imm;
+            if (imm.is_relative != 0)
+            {
+                std::uint64_t val{};
+                ZydisCalcAbsoluteAddress(&instr, &srcOp, address, &val);
+                return Imm{ val };
+            }
+            if (imm.is_signed != 0)
+            {
+                return Imm{ imm.value.s };
+            }
+
+            return Imm{ imm.value.u };
+        }
+        return Operand::None{};
+    }
+
+    constexpr bool hasAttrib(ZydisInstructionAttributes attribs, ZydisInstructionAttributes test) noexcept
+    {
+        return (attribs & test) != 0;
+    }
+
+    constexpr Instruction::Attribs getAttribs(ZydisInstructionAttributes attribs) noexcept
+    {
+        Instruction::Attribs res{};
+        const auto translateAttrib = [&](ZydisInstructionAttributes test, Instruction::Attribs newAttrib) {
+            if (!hasAttrib(attribs, test))
+            {
+                return;
+            }
+            res = static_cast<Instruction::Attribs>(static_cast<std::uint32_t>(res) | static_cast<std::uint32_t>(newAttrib));
+        };
+        translateAttrib(ZYDIS_ATTRIB_HAS_LOCK, x86::Attribs::Lock);
+        translateAttrib(ZYDIS_ATTRIB_HAS_REP, x86::Attribs::Rep);
+        translateAttrib(ZYDIS_ATTRIB_HAS_REPE, x86::Attribs::Repe);
+        translateAttrib(ZYDIS_ATTRIB_HAS_REPNE, x86::Attribs::Repne);
+        translateAttrib(ZYDIS_ATTRIB_HAS_BND, x86::Attribs::Bnd);
+        translateAttrib(ZYDIS_ATTRIB_HAS_XACQUIRE, x86::Attribs::Xacquire);
+        translateAttrib(ZYDIS_ATTRIB_HAS_XRELEASE, x86::Attribs::Xrelease);
+        translateAttrib(ZYDIS_ATTRIB_HAS_OPERANDSIZE, x86::Attribs::OperandSize16);
+        return res;
+    }
+
+    constexpr InstructionDetail::Category getCategory(ZydisInstructionCategory category) noexcept
+    {
+        return static_cast<InstructionDetail::Category>(category);
+    }
+
+    constexpr Operand::Visibility translateOperandVisibility(ZydisOperandVisibility vis)
+    {
+        switch (vis)
+        {
+            case ZYDIS_OPERAND_VISIBILITY_INVALID:
+                return Operand::Visibility::Invalid;
+            case ZYDIS_OPERAND_VISIBILITY_EXPLICIT:
+                return Operand::Visibility::Explicit;
+            case ZYDIS_OPERAND_VISIBILITY_IMPLICIT:
+                return Operand::Visibility::Implicit;
+            case ZYDIS_OPERAND_VISIBILITY_HIDDEN:
+                return Operand::Visibility::Hidden;
+            default:
+                break;
+        }
+        return Operand::Visibility::Invalid;
+    }
+
+    constexpr Operand::Access translateOperandAccess(ZydisOperandActions action)
+    {
+        Operand::Access res{};
+        if ((action & ZYDIS_OPERAND_ACTION_READ) != 0)
+        {
+            res = res | Operand::Access::Read;
+        }
+        if ((action & ZYDIS_OPERAND_ACTION_WRITE) != 0)
+        {
+            res = res | Operand::Access::Write;
+        }
+        if ((action & ZYDIS_OPERAND_ACTION_CONDREAD) != 0)
+        {
+            res = res | Operand::Access::CondRead;
+        }
+        if ((action & ZYDIS_OPERAND_ACTION_CONDWRITE) != 0)
+        {
+            res = res | Operand::Access::CondWrite;
+        }
+        return res;
+    }
+
+    inline Error initDecoder(ZydisDecoder& decoder, MachineMode mode) noexcept
+    {
+        ZyanStatus status = ZYAN_STATUS_INVALID_OPERATION;
+        switch (mode)
+        {
+            case MachineMode::AMD64:
+                status = ZydisDecoderInit(&decoder, ZYDIS_MACHINE_MODE_LONG_64, ZydisStackWidth::ZYDIS_STACK_WIDTH_64);
+                break;
+            case MachineMode::I386:
+                status = ZydisDecoderInit(&decoder, ZYDIS_MACHINE_MODE_LONG_COMPAT_32, ZydisStackWidth::ZYDIS_STACK_WIDTH_32);
+                break;
+            default:
+                break;
+        }
+
+        switch (status)
+        {
+            case ZYAN_STATUS_SUCCESS:
+                return ErrorCode::None;
+            case ZYAN_STATUS_INVALID_ARGUMENT:
+                return ErrorCode::InvalidParameter;
+            case ZYAN_STATUS_INVALID_OPERATION:
+                return ErrorCode::InvalidOperation;
+            default:
+                break;
+        }
+        return ErrorCode::NotInitialized;
+    }
+
+    constexpr ErrorCode getDecodeError(ZyanStatus status) noexcept
+    {
+        switch (status)
+        {
+            case ZYAN_STATUS_SUCCESS:
+                return ErrorCode::None;
+            case ZYDIS_STATUS_NO_MORE_DATA:
+                return ErrorCode::OutOfBounds;
+            case ZYDIS_STATUS_INSTRUCTION_TOO_LONG:
+                return ErrorCode::InstructionTooLong;
+            default:
+                break;
+        }
+        return ErrorCode::InvalidInstruction;
+    }
+
+} // namespace zasm
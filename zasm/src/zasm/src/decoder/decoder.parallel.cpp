@@ -0,0 +1,371 @@
+#include "zasm/decoder/decoderparallel.hpp"
+
+#include "../core/threadpool.hpp"
+#include "decoder.program.hpp"
+#include "zasm/program/program.hpp"
+
+#include <algorithm>
+#include <vector>
+
+namespace zasm
+{
+    // Smaller buffers are decoded on the calling thread.
+    static constexpr std::size_t kMinChunkSize = 64 * 1024;
+
+    // Use more chunks than threads so threads that finish early can pick up more work.
+    static constexpr std::size_t kChunksPerThread = 4;
+
+    namespace detail
+    {
+        struct DecodeChunk
+        {
+            // The chunk owns the instructions that start within [begin, end).
+            std::size_t begin{};
+            std::size_t end{};
+            // One bit per byte of the range, set for every instruction start.
+            std::vector<std::uint64_t> starts;
+            // Amount of bits set.
+            std::size_t count{};
+            // Offset of the first instruction starting at or after end.
+            std::size_t next{};
+            // Offset of the first instruction of the sequential sweep within the chunk.
+            std::size_t first{};
+            // Index of the first instruction in the output.
+            std::size_t index{};
+        };
+
+        struct DecodeChunkResult
+        {
+            Error status{};
+            std::size_t count{};
+            std::size_t bytesDecoded{};
+        };
+
+        struct DecodeChunkInstrs
+        {
+            // Entries with a length of zero are bytes that could not be decoded.
+            std::vector<DecodedInstr> instrs;
+            ErrorCode status{};
+        };
+
+    } // namespace detail
+
+    static bool hasStart(const detail::DecodeChunk& chunk, std::size_t offset) noexcept
+    {
+        const auto bit = offset - chunk.begin;
+        return ((chunk.starts[bit / 64] >> (bit % 64)) & 1U) != 0;
+    }
+
+    static void setStart(detail::DecodeChunk& chunk, std::size_t offset) noexcept
+    {
+        const auto bit = offset - chunk.begin;
+        chunk.starts[bit / 64] |= std::uint64_t{ 1 } << (bit % 64);
+    }
+
+    static void clearStart(detail::DecodeChunk& chunk, std::size_t offset) noexcept
+    {
+        const auto bit = offset - chunk.begin;
+        chunk.starts[bit / 64] &= ~(std::uint64_t{ 1 } << (bit % 64));
+    }
+
+    // Returns the length of the instruction at the offset, bytes that can not be decoded count as one byte
+    // which is the same as DecodeColumnsFlags::InvalidAsEntry and DecodeProgramFlags::InvalidAsData.
+    static std::size_t getInstrLength(
+        const ZydisDecoder& decoder, const std::uint8_t* bytes, std::size_t len, std::size_t offset) noexcept
+    {
+        ZydisDecoderContext ctx{};
+        ZydisDecodedInstruction instr{};
+        if (ZYAN_FAILED(ZydisDecoderDecodeInstruction(&decoder, &ctx, bytes + offset, len - offset, &instr)))
+        {
+            return 1;
+        }
+        return instr.length;
+    }
+
+    // Decodes the chunk from its start without knowing if that is an instruction boundary.
+    static void scanChunk(const ZydisDecoder& decoder, const std::uint8_t* bytes, std::size_t len, detail::DecodeChunk& chunk)
+    {
+        chunk.starts.assign((chunk.end - chunk.begin + 63) / 64, 0);
+        chunk.count = 0;
+
+        auto offset = chunk.begin;
+        while (offset < chunk.end)
+        {
+            setStart(chunk, offset);
+            chunk.count++;
+            offset += getInstrLength(decoder, bytes, len, offset);
+        }
+
+        chunk.next = offset;
+    }
+
+    // Decodes from the first instruction of the sequential sweep until it reaches an instruction start of the
+    // scan, from there on both agree. The starts before that point are replaced by the ones of the sweep.
+    static void syncChunk(
+        const ZydisDecoder& decoder, const std::uint8_t* bytes, std::size_t len, detail::DecodeChunk& chunk,
+        std::size_t first, std::vector<std::size_t>& sweepStarts)
+    {
+        chunk.first = first;
+
+        sweepStarts.clear();
+
+        auto offset = first;
+        while (offset < chunk.end && !hasStart(chunk, offset))
+        {
+            sweepStarts.push_back(offset);
+            offset += getInstrLength(decoder, bytes, len, offset);
+        }
+
+        const auto syncOffset = std::min(offset, chunk.end);
+        for (auto pos = chunk.begin; pos < syncOffset; ++pos)
+        {
+            if (hasStart(chunk, pos))
+            {
+                clearStart(chunk, pos);
+                chunk.count--;
+            }
+        }
+        for (const auto pos : sweepStarts)
+        {
+            setStart(chunk, pos);
+            chunk.count++;
+        }
+
+        // Never synchronized, the sweep determines the next chunk.
+        if (offset >= chunk.end)
+        {
+            chunk.next = offset;
+        }
+    }
+
+    // Splits the buffer into chunks and determines the instructions of the sequential sweep in each of them.
+    static Error computeChunks(
+        MachineMode mode, const std::uint8_t* bytes, std::size_t len, std::size_t threadCount,
+        std::vector<detail::DecodeChunk>& chunks)
+    {
+        ZydisDecoder decoder{};
+        if (auto status = initDecoder(decoder, mode); status != ErrorCode::None)
+        {
+            return status;
+        }
+        if (ZYAN_FAILED(ZydisDecoderEnableMode(&decoder, ZYDIS_DECODER_MODE_MINIMAL, ZYAN_TRUE)))
+        {
+            return ErrorCode::InvalidOperation;
+        }
+
+        const auto chunkCount = std::clamp<std::size_t>(len / kMinChunkSize, 1, threadCount * kChunksPerThread);
+        const auto chunkSize = (len + chunkCount - 1) / chunkCount;
+
+        chunks.clear();
+        for (std::size_t begin = 0; begin < len; begin += chunkSize)
+        {
+            auto& chunk = chunks.emplace_back();
+            chunk.begin = begin;
+            chunk.end = std::min(len, begin + chunkSize);
+        }
+
+        detail::getSharedThreadPool().run(
+            threadCount, chunks.size(), [&](std::size_t idx) { scanChunk(decoder, bytes, len, chunks[idx]); });
+
+        std::vector<std::size_t> sweepStarts;
+
+        std::size_t first = 0;
+        std::size_t index = 0;
+        for (auto& chunk : chunks)
+        {
+            syncChunk(decoder, bytes, len, chunk, first, sweepStarts);
+            chunk.index = index;
+
+            index += chunk.count;
+            first = chunk.next;
+        }
+
+        return ErrorCode::None;
+    }
+
+    static constexpr bool isParallelWorthwhile(std::size_t len, std::size_t threadCount) noexcept
+    {
+        return threadCount > 1 && len >= kMinChunkSize * 2;
+    }
+
+    Error decodeColumnsParallel(
+        DecoderColumns& columns, MachineMode mode, const void* data, std::size_t len, std::size_t threadCount,
+        DecodeColumnsFlags flags)
+    {
+        threadCount = detail::getThreadCount(threadCount);
+
+        const bool minimal = (flags & DecodeColumnsFlags::Minimal) != DecodeColumnsFlags::None;
+        if (!isParallelWorthwhile(len, threadCount) || data == nullptr
+            || (minimal && (columns.categories != nullptr || columns.attribs != nullptr || columns.operandKinds != nullptr)))
+        {
+            // Also reports invalid parameters.
+            return decodeColumns(columns, mode, data, len, flags);
+        }
+
+        columns.count = 0;
+        columns.bytesDecoded = 0;
+
+        const auto* bytes = static_cast<const std::uint8_t*>(data);
+
+        std::vector<detail::DecodeChunk> chunks;
+        if (auto status = computeChunks(mode, bytes, len, threadCount, chunks); status != ErrorCode::None)
+        {
+            return status;
+        }
+
+        std::vector<detail::DecodeChunkResult> results(chunks.size());
+
+        detail::getSharedThreadPool().run(threadCount, chunks.size(), [&](std::size_t idx) {
+            const auto& chunk = chunks[idx];
+            if (chunk.index >= columns.capacity)
+            {
+                return;
+            }
+
+            const auto index = chunk.index;
+            const auto offsetPtr = [index](auto* column) { return column != nullptr ? column + index : nullptr; };
+
+            DecoderColumns view;
+            view.capacity = std::min(chunk.count, columns.capacity - index);
+            view.offsets = offsetPtr(columns.offsets);
+            view.lengths = offsetPtr(columns.lengths);
+            view.mnemonics = offsetPtr(columns.mnemonics);
+            view.categories = offsetPtr(columns.categories);
+            view.attribs = offsetPtr(columns.attribs);
+            view.operandKinds = offsetPtr(columns.operandKinds);
+
+            auto& res = results[idx];
+            res.status = decodeColumns(view, mode, bytes + chunk.first, len - chunk.first, flags);
+            res.count = view.count;
+            res.bytesDecoded = view.bytesDecoded;
+
+            if (view.offsets != nullptr)
+            {
+                for (std::size_t i = 0; i < view.count; ++i)
+                {
+                    view.offsets[i] += chunk.first;
+                }
+            }
+        });
+
+        for (std::size_t i = 0; i < chunks.size(); ++i)
+        {
+            const auto& chunk = chunks[i];
+            const auto& res = results[i];
+
+            columns.count = chunk.index + res.count;
+            columns.bytesDecoded = chunk.first + res.bytesDecoded;
+
+            // Stop at the first failure or once the capacity is reached.
+            if (res.status != ErrorCode::None)
+            {
+                return res.status;
+            }
+            if (res.count < chunk.count)
+            {
+                break;
+            }
+        }
+
+        return ErrorCode::None;
+    }
+
+    Error decodeProgramParallel(
+        Program& program, const void* data, std::size_t len, std::uint64_t address, std::size_t threadCount,
+        DecodeProgramFlags flags)
+    {
+        threadCount = detail::getThreadCount(threadCount);
+        if (!isParallelWorthwhile(len, threadCount) || data == nullptr)
+        {
+            return decodeProgram(program, data, len, address, flags);
+        }
+
+        const bool createLabels = (flags & DecodeProgramFlags::CreateLabels) != DecodeProgramFlags::None;
+        const bool invalidAsData = (flags & DecodeProgramFlags::InvalidAsData) != DecodeProgramFlags::None;
+
+        const auto* bytes = static_cast<const std::uint8_t*>(data);
+
+        std::vector<detail::DecodeChunk> chunks;
+        if (auto status = computeChunks(program.getMode(), bytes, len, threadCount, chunks); status != ErrorCode::None)
+        {
+            return status;
+        }
+
+        ZydisDecoder decoder{};
+        if (auto status = initDecoder(decoder, program.getMode()); status != ErrorCode::None)
+        {
+            return status;
+        }
+
+        std::vector<detail::DecodeChunkInstrs> results(chunks.size());
+
+        detail::getSharedThreadPool().run(threadCount, chunks.size(), [&](std::size_t idx) {
+            const auto& chunk = chunks[idx];
+            auto& res = results[idx];
+            res.instrs.resize(chunk.count);
+
+            auto offset = chunk.first;
+            for (std::size_t i = 0; i < chunk.count; ++i)
+            {
+                auto& decoded = res.instrs[i];
+                if (const auto status = decodeInstruction(decoder, bytes, len, offset, address, decoded); ZYAN_FAILED(status))
+                {
+                    if (!invalidAsData)
+                    {
+                        res.instrs.resize(i);
+                        res.status = getDecodeError(status);
+                        return;
+                    }
+
+                    decoded.length = 0;
+                    offset++;
+                    continue;
+                }
+
+                offset += decoded.length;
+            }
+        });
+
+        // Nodes are created in the order of the buffer on the calling thread.
+        std::vector<detail::DecodedNode> nodes;
+        std::vector<detail::BranchRef> branches;
+
+        for (std::size_t i = 0; i < chunks.size(); ++i)
+        {
+            const auto& res = results[i];
+
+            auto offset = chunks[i].first;
+            for (const auto& decoded : res.instrs)
+            {
+                if (decoded.length == 0)
+                {
+                    program.append(program.createNode(Data(bytes[offset])));
+                    offset++;
+                    continue;
+                }
+
+                auto* node = program.append(program.createNode(decoded.instr));
+                if (createLabels)
+                {
+                    nodes.push_back({ offset, node });
+                    addBranchRefs(branches, node, decoded, address, len);
+                }
+
+                offset += decoded.length;
+            }
+
+            if (res.status != ErrorCode::None)
+            {
+                return res.status;
+            }
+        }
+
+        if (createLabels)
+        {
+            return createBranchLabels(program, nodes, branches);
+        }
+
+        return ErrorCode::None;
+    }
+
+} // namespace zasm
@@ -0,0 +1,116 @@
+#include "zasm/decoder/decoderprogram.hpp"
+
+#include "decoder.program.hpp"
+#include "zasm/program/program.hpp"
+
+#include <algorithm>
+#include <unordered_map>
+#include <vector>
+
+namespace zasm
+{
+    static Node* findNodeAt(const std::vector<detail::DecodedNode>& nodes, std::size_t offset) noexcept
+    {
+        const auto it = std::lower_bound(nodes.begin(), nodes.end(), offset, [](const auto& entry, std::size_t val) {
+            return entry.offset < val;
+        });
+        if (it == nodes.end() || it->offset != offset)
+        {
+            return nullptr;
+        }
+        return it->node;
+    }
+
+    Error createBranchLabels(
+        Program& program, const std::vector<detail::DecodedNode>& nodes, const std::vector<detail::BranchRef>& branches)
+    {
+        std::unordered_map<std::size_t, Label> labels;
+
+        for (const auto& branch : branches)
+        {
+            auto* targetNode = findNodeAt(nodes, branch.targetOffset);
+            if (targetNode == nullptr)
+            {
+                continue;
+            }
+
+            auto it = labels.find(branch.targetOffset);
+            if (it == labels.end())
+            {
+                const auto label = program.createLabel();
+
+                auto labelNode = program.bindLabel(label);
+                if (!labelNode)
+                {
+                    return labelNode.error();
+                }
+                program.insertBefore(targetNode, *labelNode);
+
+                it = labels.emplace(branch.targetOffset, label).first;
+            }
+
+            branch.node->get<Instruction>().setOperand(branch.operandIndex, it->second);
+        }
+
+        return ErrorCode::None;
+    }
+
+    Error decodeProgram(
+        Program& program, const void* data, std::size_t len, std::uint64_t address, DecodeProgramFlags flags)
+    {
+        if (data == nullptr && len != 0)
+        {
+            return ErrorCode::InvalidParameter;
+        }
+
+        ZydisDecoder decoder{};
+        if (auto status = initDecoder(decoder, program.getMode()); status != ErrorCode::None)
+        {
+            return status;
+        }
+
+        const bool createLabels = (flags & DecodeProgramFlags::CreateLabels) != DecodeProgramFlags::None;
+        const bool invalidAsData = (flags & DecodeProgramFlags::InvalidAsData) != DecodeProgramFlags::None;
+
+        std::vector<detail::DecodedNode> nodes;
+        std::vector<detail::BranchRef> branches;
+
+        const auto* bytes = static_cast<const std::uint8_t*>(data);
+
+        detail::DecodedInstr decoded;
+
+        std::size_t offset = 0;
+        while (offset < len)
+        {
+            if (const auto status = decodeInstruction(decoder, bytes, len, offset, address, decoded); ZYAN_FAILED(status))
+            {
+                if (!invalidAsData)
+                {
+                    return getDecodeError(status);
+                }
+
+                program.append(program.createNode(Data(bytes[offset])));
+                offset++;
+                continue;
+            }
+
+            auto* node = program.append(program.createNode(decoded.instr));
+
+            if (createLabels)
+            {
+                nodes.push_back({ offset, node });
+                addBranchRefs(branches, node, decoded, address, len);
+            }
+
+            offset += decoded.length;
+        }
+
+        if (createLabels)
+        {
+            return createBranchLabels(program, nodes, branches);
+        }
+
+        return ErrorCode::None;
+    }
+
+} // namespace zasm
@@ -0,0 +1,118 @@
+#pragma once
+
+#include "decoder.common.hpp"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <tuple>
+#include <vector>
+#include <zasm/program/node.hpp>
+
+namespace zasm
+{
+    class Program;
+
+    namespace detail
+    {
+        struct DecodedNode
+        {
+            std::size_t offset{};
+            Node* node{};
+        };
+
+        struct BranchRef
+        {
+            Node* node{};
+            std::size_t operandIndex{};
+            std::size_t targetOffset{};
+        };
+
+        struct DecodedInstr
+        {
+            Instruction instr{};
+            std::uint8_t length{};
+            // Bit per operand that holds a relative branch target.
+            std::uint8_t relativeOps{};
+        };
+
+    } // namespace detail
+
+    // Decodes the instruction at the offset of the buffer with only the visible operands.
+    inline ZyanStatus decodeInstruction(
+        const ZydisDecoder& decoder, const std::uint8_t* bytes, std::size_t len, std::size_t offset, std::uint64_t address,
+        detail::DecodedInstr& res) noexcept
+    {
+        ZydisDecoderContext ctx{};
+        ZydisDecodedInstruction instr{};
+        std::array<ZydisDecodedOperand, ZYDIS_MAX_OPERAND_COUNT_VISIBLE> instrOps{};
+
+        auto status = ZydisDecoderDecodeInstruction(&decoder, &ctx, bytes + offset, len - offset, &instr);
+        if (ZYAN_SUCCESS(status))
+        {
+            status = ZydisDecoderDecodeOperands(&decoder, &ctx, &instr, instrOps.data(), instr.operand_count_visible);
+        }
+        if (ZYAN_FAILED(status))
+        {
+            return status;
+        }
+
+        const auto va = address + offset;
+        const auto opCount = std::min<std::size_t>(instr.operand_count_visible, std::tuple_size_v<Instruction::Operands>);
+
+        Instruction::Operands ops{};
+        res.relativeOps = 0;
+        for (std::size_t i = 0; i < opCount; ++i)
+        {
+            const auto& op = instrOps[i];
+            ops[i] = getOperand(instr, op, va);
+
+            if (op.type == ZYDIS_OPERAND_TYPE_IMMEDIATE && op.imm.is_relative != 0)
+            {
+                res.relativeOps |= static_cast<std::uint8_t>(1U << i);
+            }
+        }
+
+        res.instr = Instruction(
+            getAttribs(instr.attributes), instr.mnemonic, static_cast<Instruction::OperandCount>(opCount), ops);
+        res.length = instr.length;
+
+        return ZYAN_STATUS_SUCCESS;
+    }
+
+    // Calls the function with the operand index and the target offset of each relative operand that targets
+    // an offset within the buffer.
+    template<typename TFn>
+    inline void forEachBranchTarget(const detail::DecodedInstr& decoded, std::uint64_t address, std::size_t len, TFn&& fn)
+    {
+        for (std::size_t i = 0; i < decoded.instr.getOperandCount(); ++i)
+        {
+            if ((decoded.relativeOps & (1U << i)) == 0)
+            {
+                continue;
+            }
+
+            const auto target = decoded.instr.getOperand<Imm>(i).value<std::uint64_t>();
+            if (target >= address && target - address < len)
+            {
+                fn(i, static_cast<std::size_t>(target - address));
+            }
+        }
+    }
+
+    // Records the relative operands of the node that target an offset within the buffer.
+    inline void addBranchRefs(
+        std::vector<detail::BranchRef>& branches, Node* node, const detail::DecodedInstr& decoded, std::uint64_t address,
+        std::size_t len)
+    {
+        forEachBranchTarget(decoded, address, len, [&](std::size_t operandIndex, std::size_t targetOffset) {
+            branches.push_back({ node, operandIndex, targetOffset });
+        });
+    }
+
+    // Binds a label before each branch target and replaces the immediate of the branch with it, targets
+    // that are not at the start of an instruction keep the immediate. The nodes must be ordered by offset.
+    Error createBranchLabels(
+        Program& program, const std::vector<detail::DecodedNode>& nodes, const std::vector<detail::BranchRef>& branches);
+
+} // namespace zasm
@@ -0,0 +1,202 @@
+#include "zasm/encoder/encodercache.hpp"
+
+#include <atomic>
+#include <mutex>
+#include <shared_mutex>
+#include <unordered_map>
+#include <utility>
+
+namespace zasm
+{
+    namespace detail
+    {
+        struct EncoderCacheKey
+        {
+            MachineMode mode{};
+            Instruction instr{};
+
+            bool operator==(const EncoderCacheKey& other) const noexcept
+            {
+                return mode == other.mode && instr == other.instr;
+            }
+        };
+
+        class EncoderCacheHash
+        {
+            static constexpr std::uint64_t kOffset = 0xcbf29ce484222325ULL;
+            static constexpr std::uint64_t kPrime = 0x00000100000001B3ULL;
+
+            template<typename T> static constexpr void combine(std::uint64_t& hash, T value) noexcept
+            {
+                hash ^= static_cast<std::uint64_t>(value);
+                hash *= kPrime;
+            }
+
+        public:
+            std::size_t operator()(const EncoderCacheKey& key) const noexcept
+            {
+                std::uint64_t hash = kOffset;
+
+                const auto& instr = key.instr;
+                combine(hash, key.mode);
+                combine(hash, instr.getMnemonic().value());
+                combine(hash, instr.getAttribs().value());
+                combine(hash, instr.getOperandCount());
+
+                const auto& ops = instr.getOperands();
+                for (std::size_t i = 0; i < instr.getOperandCount(); ++i)
+                {
+                    const auto& op = ops[i]; // NOLINT
+                    combine(hash, op.getTypeIndex());
+
+                    if (const auto* reg = op.getIf<Reg>(); reg != nullptr)
+                    {
+                        combine(hash, reg->getId());
+                    }
+                    else if (const auto* imm = op.getIf<Imm>(); imm != nullptr)
+                    {
+                        combine(hash, imm->value<std::int64_t>());
+                    }
+                    else if (const auto* mem = op.getIf<Mem>(); mem != nullptr)
+                    {
+                        combine(hash, mem->getBase().getId());
+                        combine(hash, mem->getIndex().getId());
+                        combine(hash, mem->getSegment().getId());
+                        combine(hash, mem->getScale());
+                        combine(hash, mem->getDisplacement());
+                        combine(hash, mem->getBitSize());
+                    }
+                }
+
+                return static_cast<std::size_t>(hash);
+            }
+        };
+
+        struct EncoderCacheState
+        {
+            mutable std::shared_mutex mutex;
+            std::unordered_map<EncoderCacheKey, EncoderResult, EncoderCacheHash> entries;
+            std::size_t capacity{};
+            std::size_t evictions{};
+            mutable std::atomic<std::size_t> hits{};
+            mutable std::atomic<std::size_t> misses{};
+        };
+
+    } // namespace detail
+
+    EncoderCache::EncoderCache(std::size_t capacity)
+        : _state(new detail::EncoderCacheState())
+    {
+        _state->capacity = capacity;
+    }
+
+    EncoderCache::EncoderCache(EncoderCache&& other) noexcept
+    {
+        *this = std::move(other);
+    }
+
+    EncoderCache::~EncoderCache()
+    {
+        delete _state;
+        _state = nullptr;
+    }
+
+    EncoderCache& EncoderCache::operator=(EncoderCache&& other) noexcept
+    {
+        if (this != &other)
+        {
+            delete _state;
+            _state = other._state;
+            other._state = nullptr;
+        }
+
+        return *this;
+    }
+
+    bool EncoderCache::lookup(MachineMode mode, const Instruction& instr, EncoderResult& res) const
+    {
+        const detail::EncoderCacheKey key{ mode, instr };
+
+        std::shared_lock lock(_state->mutex);
+
+        const auto it = _state->entries.find(key);
+        if (it == _state->entries.end())
+        {
+            _state->misses.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+
+        res = it->second;
+        _state->hits.fetch_add(1, std::memory_order_relaxed);
+
+        return true;
+    }
+
+    void EncoderCache::insert(MachineMode mode, const Instruction& instr, const EncoderResult& res)
+    {
+        if (_state->capacity == 0)
+        {
+            return;
+        }
+
+        detail::EncoderCacheKey key{ mode, instr };
+
+        std::unique_lock lock(_state->mutex);
+
+        auto& entries = _state->entries;
+        if (entries.size() >= _state->capacity)
+        {
+            if (entries.find(key) != entries.end())
+            {
+                return;
+            }
+
+            // Same as the detail cache, clearing is cheaper than tracking the age of the entries and the
+            // instructions still in use are inserted again.
+            _state->evictions += entries.size();
+            entries.clear();
+        }
+
+        entries.emplace(std::move(key), res);
+    }
+
+    std::size_t EncoderCache::getHitCount() const noexcept
+    {
+        return _state->hits.load(std::memory_order_relaxed);
+    }
+
+    std::size_t EncoderCache::getMissCount() const noexcept
+    {
+        return _state->misses.load(std::memory_order_relaxed);
+    }
+
+    std::size_t EncoderCache::getEvictionCount() const noexcept
+    {
+        std::shared_lock lock(_state->mutex);
+
+        return _state->evictions;
+    }
+
+    std::size_t EncoderCache::size() const noexcept
+    {
+        std::shared_lock lock(_state->mutex);
+
+        return _state->entries.size();
+    }
+
+    std::size_t EncoderCache::getCapacity() const noexcept
+    {
+        return _state->capacity;
+    }
+
+    void EncoderCache::clear() noexcept
+    {
+        std::unique_lock lock(_state->mutex);
+
+        _state->entries.clear();
+        _state->evictions = 0;
+        _state->hits = 0;
+        _state->misses = 0;
+    }
+
+} // namespace zasm
@@ -7,6 +7,7 @@
 #include <vector>
 #include <zasm/base/label.hpp>
 #include <zasm/core/stringpool.hpp>
+#include <zasm/program/instruction.hpp>
 #include <zasm/program/section.hpp>
 
 namespace zasm
@@ -14,6 +15,8 @@ namespace zasm
     enum class RelocationType : std::uint8_t;
     enum class RelocationData : std::uint8_t;
 
+    class EncoderCache;
+
     namespace detail
     {
         struct ProgramState;
@@ -45,6 +48,7 @@ namespace zasm
     public:
         EncoderFlags flags{};
         detail::ProgramState* program{};
+        EncoderCache* cache{};
         bool needsExtraPass{};
         std::size_t nodeIndex{};
         std::size_t sectionIndex{};
@@ -79,12 +83,38 @@ namespace zasm
             RelocationType relocKind{};
             RelocationData relocData{};
             Label::Id relocLabel{ Label::Id::Invalid };
+            std::uint8_t relocOffset{};
+            std::uint8_t relocSize{};
         };
 
         std::vector<EncoderSection> sections;
         std::vector<LabelLink> labelLinks;
         std::vector<Node> nodes;
 
+        // Addresses of labels from a previous serialization indexed by the label id, used as a guess
+        // for labels that are not yet bound.
+        std::vector<std::int64_t> labelHints;
+
+        // Resets the context but keeps the memory of the containers.
+        void reset() noexcept
+        {
+            flags = EncoderFlags::none;
+            program = nullptr;
+            cache = nullptr;
+            needsExtraPass = false;
+            nodeIndex = 0;
+            sectionIndex = 0;
+            pass = 0;
+            baseVA = 0;
+            va = 0;
+            offset = 0;
+            instrSize = 0;
+            sections.clear();
+            labelLinks.clear();
+            nodes.clear();
+            labelHints.clear();
+        }
+
         LabelLink& getOrCreateLabelLink(Label::Id id)
         {
             assert(id != Label::Id::Invalid);
@@ -120,6 +150,11 @@ namespace zasm
             const auto& entry = getOrCreateLabelLink(id);
             if (entry.boundVA == -1)
             {
+                const auto labelIdx = static_cast<std::size_t>(id);
+                if (labelIdx < labelHints.size() && labelHints[labelIdx] != LabelLink::kUnboundVA)
+                {
+                    return labelHints[labelIdx];
+                }
                 return std::nullopt;
             }
 
@@ -137,4 +172,30 @@ namespace zasm
             return nodes[nodeIndex].length;
         }
     };
+
+    struct EncodeVariantsInfo
+    {
+        bool isControlFlow{};
+        std::int8_t encodeSizeRel8{ -1 };
+        std::int8_t encodeSizeRel32{ -1 };
+        std::int8_t cfOperandIndex{ -1 };
+
+        constexpr bool canEncodeRel8() const noexcept
+        {
+            return encodeSizeRel8 != -1;
+        }
+
+        constexpr bool canEncodeRel32() const noexcept
+        {
+            return encodeSizeRel32 != -1;
+        }
+    };
+
+    // Returns the sizes of the relative branch forms the instruction can be encoded with.
+    const EncodeVariantsInfo& getEncodeVariantInfo(const Instruction& instr) noexcept;
+
+    // Returns true if the encoding of the instruction depends on the address it is encoded at or on the
+    // address of a label, the encoded bytes of such instructions can not be reused once the layout changes.
+    bool isAddressDependent(const Instruction& instr) noexcept;
+
 } // namespace zasm
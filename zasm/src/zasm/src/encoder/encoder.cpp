@@ -2,14 +2,21 @@
 
 #include "../program/program.state.hpp"
 #include "encoder.context.hpp"
+#include "zasm/encoder/encoderbatch.hpp"
+#include "zasm/encoder/encodercache.hpp"
+#include "zasm/encoder/encodersession.hpp"
+#include "zasm/encoder/fastencoder.hpp"
+#include "zasm/program/node.hpp"
 #include "zasm/x86/meta.hpp"
 #include "zasm/x86/mnemonic.hpp"
 
 #include <Zydis/Decoder.h>
 #include <Zydis/Encoder.h>
 #include <cstddef>
+#include <cstring>
 #include <limits>
 #include <optional>
+#include <unordered_map>
 
 namespace zasm
 {
@@ -23,6 +30,7 @@ namespace zasm
         RelocationType relocKind{};
         RelocationData relocData{};
         Label::Id relocLabel{ Label::Id::Invalid };
+        std::size_t relocOperand{};
     };
 
     // NOTE: This value has to be at least larger than 0xFFFF to be used with imm32/rel32 displacement.
@@ -37,24 +45,6 @@ namespace zasm
         ZYDIS_ENCODABLE_ENCODING_LEGACY | ZYDIS_ENCODABLE_ENCODING_3DNOW | ZYDIS_ENCODABLE_ENCODING_XOP
         | ZYDIS_ENCODABLE_ENCODING_VEX | ZYDIS_ENCODABLE_ENCODING_EVEX);
 
-    struct EncodeVariantsInfo
-    {
-        bool isControlFlow{};
-        std::int8_t encodeSizeRel8{ -1 };
-        std::int8_t encodeSizeRel32{ -1 };
-        std::int8_t cfOperandIndex{ -1 };
-
-        constexpr bool canEncodeRel8() const noexcept
-        {
-            return encodeSizeRel8 != -1;
-        }
-
-        constexpr bool canEncodeRel32() const noexcept
-        {
-            return encodeSizeRel32 != -1;
-        }
-    };
-
     static constexpr auto buildEncodeVariantTable() noexcept
     {
         std::array<EncodeVariantsInfo, ZydisMnemonic::ZYDIS_MNEMONIC_MAX_VALUE> data{};
@@ -96,6 +86,11 @@ namespace zasm
         return encoderVariantData[mnemonic]; // NOLINT
     }
 
+    const EncodeVariantsInfo& getEncodeVariantInfo(const Instruction& instr) noexcept
+    {
+        return getEncodeVariantInfo(static_cast<ZydisMnemonic>(instr.getMnemonic().value()));
+    }
+
     static bool isLabelExternal(EncoderContext& ctx, Label::Id labelId)
     {
         if ((ctx.flags & EncoderFlags::temporary) != EncoderFlags::none)
@@ -104,6 +99,12 @@ namespace zasm
         }
 
         const auto state = ctx.program;
+        if (state == nullptr)
+        {
+            // Encoding a batch, labels are external unless bound or resolved by the fixup.
+            return !ctx.getLabelAddress(labelId).has_value();
+        }
+
         const auto idx = static_cast<std::size_t>(labelId);
         if (idx >= state->labels.size())
         {
@@ -191,6 +192,7 @@ namespace zasm
             state.relocKind = RelocationType::Rel32;
             state.relocData = RelocationData::Immediate;
             state.relocLabel = src.getId();
+            state.relocOperand = state.operandIndex;
         }
 
         if (encodeInfo.isControlFlow)
@@ -225,6 +227,7 @@ namespace zasm
                 state.relocKind = RelocationType::Abs;
                 state.relocData = RelocationData::Immediate;
                 state.relocLabel = src.getId();
+                state.relocOperand = state.operandIndex;
             }
         }
 
@@ -317,6 +320,7 @@ namespace zasm
             // Memory ABS, mark relocatable.
             state.relocKind = RelocationType::Abs;
             state.relocData = RelocationData::Memory;
+            state.relocOperand = state.operandIndex;
             if (usingLabel)
             {
                 state.relocLabel = src.getLabelId();
@@ -351,6 +355,7 @@ namespace zasm
                 state.relocKind = RelocationType::Rel32;
                 state.relocData = RelocationData::Memory;
                 state.relocLabel = src.getLabelId();
+                state.relocOperand = state.operandIndex;
             }
         }
 
@@ -460,20 +465,190 @@ namespace zasm
         return false;
     }
 
-    static Error encode_(
+    static bool isFieldValue(const EncoderBuffer& buf, std::size_t offset, std::size_t size, std::int64_t value) noexcept
+    {
+        if (offset + size > buf.length)
+        {
+            return false;
+        }
+
+        std::uint64_t raw{};
+        std::memcpy(&raw, buf.data.data() + offset, size);
+
+        const auto mask = size == sizeof(std::uint64_t) ? ~std::uint64_t{} : (std::uint64_t{ 1 } << (size * 8U)) - 1U;
+        return raw == (static_cast<std::uint64_t>(value) & mask);
+    }
+
+    static bool setRelocField(EncoderResult& res, std::size_t size, std::int64_t value) noexcept
+    {
+        // The relocated field is always the last field of the instruction.
+        const auto length = res.buffer.length;
+        if (size >= length || !isFieldValue(res.buffer, length - size, size, value))
+        {
+            return false;
+        }
+
+        res.relocOffset = static_cast<std::uint8_t>(length - size);
+        res.relocSize = static_cast<std::uint8_t>(size);
+        return true;
+    }
+
+    // Determines the location of the relocated field without decoding the instruction, the size
+    // is left at zero for forms where the location is ambiguous.
+    static void findRelocField(EncoderResult& res, const EncoderState& state, std::int64_t va) noexcept
+    {
+        const auto& req = state.req;
+        const auto& op = req.operands[state.relocOperand]; // NOLINT
+        const auto length = static_cast<std::int64_t>(res.buffer.length);
+
+        if (state.relocData == RelocationData::Immediate)
+        {
+            if (op.type != ZYDIS_OPERAND_TYPE_IMMEDIATE)
+            {
+                return;
+            }
+
+            const auto& encodeInfo = getEncodeVariantInfo(req.mnemonic);
+            if (state.relocKind == RelocationType::Rel32 && encodeInfo.isControlFlow)
+            {
+                setRelocField(res, sizeof(std::int32_t), op.imm.s - (va + length));
+            }
+            else if (state.relocKind == RelocationType::Abs && req.operands[0].type == ZYDIS_OPERAND_TYPE_REGISTER)
+            {
+                const auto regWidth = ZydisRegisterGetWidth(req.machine_mode, req.operands[0].reg.value);
+                const auto immSize = static_cast<std::size_t>(regWidth / 8U);
+
+                // 64 bit registers may use the sign extended imm32 form.
+                if (!setRelocField(res, immSize, op.imm.s) && immSize == sizeof(std::int64_t))
+                {
+                    setRelocField(res, sizeof(std::int32_t), op.imm.s);
+                }
+            }
+        }
+        else if (state.relocData == RelocationData::Memory)
+        {
+            if (op.type != ZYDIS_OPERAND_TYPE_MEMORY)
+            {
+                return;
+            }
+
+            // Any immediate would follow the displacement.
+            for (std::size_t i = 0; i < req.operand_count; ++i)
+            {
+                if (req.operands[i].type == ZYDIS_OPERAND_TYPE_IMMEDIATE) // NOLINT
+                {
+                    return;
+                }
+            }
+
+            if (state.relocKind == RelocationType::Rel32)
+            {
+                setRelocField(res, sizeof(std::int32_t), op.mem.displacement - (va + length));
+            }
+            else
+            {
+                // A displacement that does not fit into 32 bits in long mode is the 64 bit moffs field, its high
+                // half may be equal to the low half so the wide field is checked first.
+                const auto disp = op.mem.displacement;
+                const bool isWide = req.machine_mode == ZYDIS_MACHINE_MODE_LONG_64
+                    && (disp < std::numeric_limits<std::int32_t>::min() || disp > std::numeric_limits<std::int32_t>::max());
+                if (isWide && setRelocField(res, sizeof(std::int64_t), disp))
+                {
+                    return;
+                }
+                if (!setRelocField(res, sizeof(std::int32_t), disp))
+                {
+                    // moffs form.
+                    setRelocField(res, sizeof(std::int64_t), disp);
+                }
+            }
+        }
+    }
+
+    // Encodes the instruction with the table driven encoder if the form is covered, returns false if the
+    // instruction has to be encoded by Zydis. Temporary encodings are always done by Zydis.
+    static bool encodeFastPath(
         EncoderResult& res, EncoderContext& ctx, MachineMode mode, Instruction::Attribs attribs, Instruction::Mnemonic mnemonic,
         size_t numOps, const Operand* operands)
     {
-        if (!validateMachineMode(mode))
+        if ((ctx.flags & EncoderFlags::temporary) != EncoderFlags::none)
         {
-            return ErrorCode::InvalidMode;
+            return false;
         }
 
-        res.buffer.length = 0;
+        const auto info = detail::getFastEncodeInfo(mnemonic);
+        if (info.form == detail::FastForm::None)
+        {
+            return false;
+        }
 
-        EncoderState state{};
+        if (detail::isFastBranch(info))
+        {
+            if (attribs != Instruction::Attribs{} || numOps != 1)
+            {
+                return false;
+            }
 
-        ZydisEncoderRequest& req = state.req;
+            // Resolve the target the same way as buildOperand_ does.
+            std::int64_t target{};
+            if (const auto* label = operands[0].getIf<Label>(); label != nullptr)
+            {
+                // External labels require a relocation.
+                if (isLabelExternal(ctx, label->getId()))
+                {
+                    return false;
+                }
+
+                target = ctx.va + kTemporaryRel32Value;
+                if (const auto labelVA = ctx.getLabelAddress(label->getId()); labelVA.has_value())
+                {
+                    target = *labelVA;
+                }
+                else
+                {
+                    ctx.needsExtraPass = true;
+                }
+            }
+            else if (const auto* imm = operands[0].getIf<Imm>(); imm != nullptr)
+            {
+                target = imm->value<std::int64_t>();
+            }
+            else
+            {
+                return false;
+            }
+
+            // Let the regular path report the error.
+            const auto rel = target - (ctx.va + ctx.instrSize);
+            if (std::abs(rel) > std::numeric_limits<std::int32_t>::max())
+            {
+                return false;
+            }
+
+            res.buffer.length = 0;
+            if (!detail::encodeFastBranch(res.buffer, mode, info, ctx.va, target))
+            {
+                return false;
+            }
+        }
+        else if (!detail::encodeFast(res.buffer, mode, attribs, mnemonic, numOps, operands))
+        {
+            return false;
+        }
+
+        res.relocKind = RelocationType::None;
+        res.relocData = RelocationData::None;
+        res.relocLabel = Label::Id::Invalid;
+        res.relocOffset = 0;
+        res.relocSize = 0;
+
+        return true;
+    }
+
+    // Sets up the fields of the request that do not depend on the operands.
+    static void initRequest(
+        ZydisEncoderRequest& req, MachineMode mode, Instruction::Attribs attribs, Instruction::Mnemonic mnemonic) noexcept
+    {
         if (mode == MachineMode::AMD64)
         {
             req.machine_mode = ZYDIS_MACHINE_MODE_LONG_64;
@@ -503,6 +678,28 @@ namespace zasm
         {
             req.operand_size_hint = ZydisOperandSizeHint::ZYDIS_OPERAND_SIZE_HINT_64;
         }
+    }
+
+    static Error encode_(
+        EncoderResult& res, EncoderContext& ctx, MachineMode mode, Instruction::Attribs attribs, Instruction::Mnemonic mnemonic,
+        size_t numOps, const Operand* operands)
+    {
+        if (!validateMachineMode(mode))
+        {
+            return ErrorCode::InvalidMode;
+        }
+
+        if (encodeFastPath(res, ctx, mode, attribs, mnemonic, numOps, operands))
+        {
+            return ErrorCode::None;
+        }
+
+        res.buffer.length = 0;
+
+        EncoderState state{};
+
+        ZydisEncoderRequest& req = state.req;
+        initRequest(req, mode, attribs, mnemonic);
 
         const auto numOperands = std::min<std::size_t>(ZYDIS_ENCODER_MAX_OPERANDS, numOps);
         for (state.operandIndex = 0; state.operandIndex < numOperands; ++state.operandIndex)
@@ -532,6 +729,13 @@ namespace zasm
         res.relocKind = state.relocKind;
         res.relocData = state.relocData;
         res.relocLabel = state.relocLabel;
+        res.relocOffset = 0;
+        res.relocSize = 0;
+
+        if (state.relocKind != RelocationType::None)
+        {
+            findRelocField(res, state, ctx.va);
+        }
 
         return ErrorCode::None;
     }
@@ -552,6 +756,40 @@ namespace zasm
         return res;
     }
 
+    bool isAddressDependent(const Instruction& instr) noexcept
+    {
+        const auto& encodeInfo = getEncodeVariantInfo(instr);
+
+        const auto& ops = instr.getOperands();
+        for (std::size_t i = 0; i < instr.getOperandCount(); ++i)
+        {
+            const auto& op = ops[i]; // NOLINT
+            if (op.holds<Label>())
+            {
+                return true;
+            }
+            if (op.holds<Imm>() && encodeInfo.isControlFlow)
+            {
+                // Relative branch to an absolute address.
+                return true;
+            }
+            if (const auto* mem = op.getIf<Mem>(); mem != nullptr)
+            {
+                if (mem->getLabelId() != Label::Id::Invalid)
+                {
+                    return true;
+                }
+                const auto baseReg = static_cast<ZydisRegister>(mem->getBase().getId());
+                if (baseReg == ZYDIS_REGISTER_RIP || baseReg == ZYDIS_REGISTER_EIP)
+                {
+                    return true;
+                }
+            }
+        }
+
+        return false;
+    }
+
     Expected<EncoderResult, Error> encode(
         MachineMode mode, Instruction::Attribs attribs, Instruction::Mnemonic mnemonic, std::size_t numOps,
         const Operand* operands)
@@ -565,7 +803,509 @@ namespace zasm
     Expected<EncoderResult, Error> encode(EncoderContext& ctx, MachineMode mode, const Instruction& instr)
     {
         const auto& ops = instr.getOperands();
-        return encodeWithContext(ctx, mode, instr.getAttribs(), instr.getMnemonic(), instr.getOperandCount(), ops.data());
+
+        if (ctx.cache == nullptr || isAddressDependent(instr))
+        {
+            return encodeWithContext(
+                ctx, mode, instr.getAttribs(), instr.getMnemonic(), instr.getOperandCount(), ops.data());
+        }
+
+        EncoderResult cached;
+        if (ctx.cache->lookup(mode, instr, cached))
+        {
+            return cached;
+        }
+
+        auto res = encodeWithContext(ctx, mode, instr.getAttribs(), instr.getMnemonic(), instr.getOperandCount(), ops.data());
+        if (res)
+        {
+            ctx.cache->insert(mode, instr, *res);
+        }
+
+        return res;
+    }
+
+    // Looks up the labels referenced by the instruction before encoding it, labels that were bound within the
+    // batch are already known.
+    static void resolveBatchLabels(
+        EncoderContext& ctx, IEncoderLabelFixup* fixup, const Instruction& instr, std::size_t index)
+    {
+        const auto& ops = instr.getOperands();
+        for (std::size_t i = 0; i < instr.getOperandCount(); ++i)
+        {
+            const auto& op = ops[i]; // NOLINT
+
+            auto labelId = Label::Id::Invalid;
+            if (const auto* label = op.getIf<Label>(); label != nullptr)
+            {
+                labelId = label->getId();
+            }
+            else if (const auto* mem = op.getIf<Mem>(); mem != nullptr)
+            {
+                labelId = mem->getLabelId();
+            }
+
+            if (labelId == Label::Id::Invalid)
+            {
+                continue;
+            }
+
+            auto& link = ctx.getOrCreateLabelLink(labelId);
+            if (link.isBound())
+            {
+                continue;
+            }
+
+            link.boundVA = EncoderContext::LabelLink::kUnboundVA;
+            if (fixup != nullptr)
+            {
+                if (const auto address = fixup->resolve(labelId, index, ctx.va); address.has_value())
+                {
+                    link.boundVA = *address;
+                }
+            }
+        }
+    }
+
+    static Error encodeBatchInstr(
+        EncoderBatch& batch, EncoderContext& ctx, MachineMode mode, const Instruction& instr, IEncoderLabelFixup* fixup)
+    {
+        resolveBatchLabels(ctx, fixup, instr, batch.size());
+
+        EncoderResult res;
+        const auto& ops = instr.getOperands();
+        if (const auto status = encode_(
+                res, ctx, mode, instr.getAttribs(), instr.getMnemonic(), instr.getOperandCount(), ops.data());
+            status != ErrorCode::None)
+        {
+            return status;
+        }
+
+        const auto length = res.buffer.length;
+        batch.code.insert(batch.code.end(), res.buffer.data.begin(), res.buffer.data.begin() + length);
+        batch.offsets.push_back(ctx.offset);
+        batch.lengths.push_back(length);
+        batch.relocKinds.push_back(res.relocKind);
+        batch.relocData.push_back(res.relocData);
+        batch.relocLabels.push_back(res.relocLabel);
+        batch.relocOffsets.push_back(res.relocOffset);
+        batch.relocSizes.push_back(res.relocSize);
+
+        ctx.offset += length;
+        ctx.va += length;
+
+        return ErrorCode::None;
+    }
+
+    // Patches the references to labels that were bound after the instruction referencing them.
+    static Error patchBatchLabels(EncoderBatch& batch, EncoderContext& ctx)
+    {
+        for (std::size_t i = 0; i < batch.size(); ++i)
+        {
+            const auto labelId = batch.relocLabels[i];
+            if (labelId == Label::Id::Invalid || static_cast<std::size_t>(labelId) >= ctx.labelLinks.size())
+            {
+                continue;
+            }
+
+            const auto& link = ctx.labelLinks[static_cast<std::size_t>(labelId)];
+            if (!link.isBound())
+            {
+                continue;
+            }
+
+            const auto size = batch.relocSizes[i];
+            if (size == 0)
+            {
+                return ErrorCode::ImpossibleRelocation;
+            }
+
+            auto value = link.boundVA;
+            if (batch.relocKinds[i] == RelocationType::Rel32)
+            {
+                value -= ctx.baseVA + batch.offsets[i] + batch.lengths[i];
+                if (std::abs(value) > std::numeric_limits<std::int32_t>::max())
+                {
+                    return ErrorCode::AddressOutOfRange;
+                }
+            }
+
+            auto* field = batch.code.data() + batch.offsets[i] + batch.relocOffsets[i];
+            std::memcpy(field, &value, size);
+
+            // Relative references within the batch no longer require a relocation.
+            if (batch.relocKinds[i] == RelocationType::Rel32)
+            {
+                batch.relocKinds[i] = RelocationType::None;
+                batch.relocData[i] = RelocationData::None;
+                batch.relocLabels[i] = Label::Id::Invalid;
+                batch.relocOffsets[i] = 0;
+                batch.relocSizes[i] = 0;
+            }
+        }
+
+        return ErrorCode::None;
+    }
+
+    Error encodeBatch(
+        EncoderBatch& batch, MachineMode mode, std::int64_t base, const Instruction* instrs, std::size_t count,
+        IEncoderLabelFixup* fixup)
+    {
+        batch.clear();
+
+        if (!validateMachineMode(mode))
+        {
+            return ErrorCode::InvalidMode;
+        }
+        if (instrs == nullptr && count != 0)
+        {
+            return ErrorCode::InvalidParameter;
+        }
+
+        EncoderContext ctx{};
+        ctx.baseVA = base;
+        ctx.va = base;
+
+        batch.offsets.reserve(count);
+        batch.lengths.reserve(count);
+        batch.relocKinds.reserve(count);
+        batch.relocData.reserve(count);
+        batch.relocLabels.reserve(count);
+        batch.relocOffsets.reserve(count);
+        batch.relocSizes.reserve(count);
+
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            if (const auto status = encodeBatchInstr(batch, ctx, mode, instrs[i], fixup); status != ErrorCode::None)
+            {
+                return status;
+            }
+        }
+
+        return ErrorCode::None;
+    }
+
+    Error encodeBatch(
+        EncoderBatch& batch, MachineMode mode, std::int64_t base, const Node* first, const Node* last,
+        IEncoderLabelFixup* fixup)
+    {
+        batch.clear();
+
+        if (!validateMachineMode(mode))
+        {
+            return ErrorCode::InvalidMode;
+        }
+        if (first == nullptr)
+        {
+            return ErrorCode::InvalidParameter;
+        }
+
+        EncoderContext ctx{};
+        ctx.baseVA = base;
+        ctx.va = base;
+
+        const auto* lastNode = last != nullptr ? last->getNext() : nullptr;
+        for (const auto* node = first; node != lastNode; node = node->getNext())
+        {
+            if (const auto* instr = node->getIf<Instruction>(); instr != nullptr)
+            {
+                if (const auto status = encodeBatchInstr(batch, ctx, mode, *instr, fixup); status != ErrorCode::None)
+                {
+                    return status;
+                }
+            }
+            else if (const auto* label = node->getIf<Label>(); label != nullptr)
+            {
+                auto& link = ctx.getOrCreateLabelLink(label->getId());
+                link.boundOffset = ctx.offset;
+                link.boundVA = ctx.va;
+            }
+            else if (!node->holds<Sentinel>())
+            {
+                return ErrorCode::InvalidOperation;
+            }
+        }
+
+        return patchBatchLabels(batch, ctx);
+    }
+
+    namespace detail
+    {
+        struct EncoderSessionRequest
+        {
+            ZydisEncoderRequest req{};
+            // Prefixes without the segment overrides of memory operands.
+            ZydisInstructionAttributes prefixes{};
+        };
+
+        struct EncoderSessionState
+        {
+            MachineMode mode{};
+            EncoderContext ctx{};
+            std::unordered_map<std::uint64_t, EncoderSessionRequest> requests;
+            // Consecutive instructions often have the same shape.
+            std::uint64_t lastKey{};
+            EncoderSessionRequest* lastRequest{};
+            std::size_t hits{};
+            std::size_t misses{};
+        };
+
+    } // namespace detail
+
+    // Builds the key of the instruction shape, returns nullopt if the instruction requires the regular path
+    // because the encoding depends on labels or produces a relocation.
+    static std::optional<std::uint64_t> getSessionShapeKey(
+        Instruction::Attribs attribs, Instruction::Mnemonic mnemonic, std::size_t numOps, const Operand* operands) noexcept
+    {
+        if (numOps > ZYDIS_ENCODER_MAX_OPERANDS)
+        {
+            return std::nullopt;
+        }
+
+        // 16 bits mnemonic, 32 bits attributes, 3 bits operand count and 2 bits per operand kind.
+        std::uint64_t key = static_cast<std::uint64_t>(mnemonic.value()) & 0xFFFFU;
+        key |= static_cast<std::uint64_t>(attribs.value()) << 16U;
+        key |= static_cast<std::uint64_t>(numOps) << 48U;
+
+        for (std::size_t i = 0; i < numOps; ++i)
+        {
+            const auto& op = operands[i]; // NOLINT
+
+            std::uint64_t kind{};
+            if (op.holds<Reg>())
+            {
+                kind = 1;
+            }
+            else if (op.holds<Imm>())
+            {
+                kind = 2;
+            }
+            else if (const auto* mem = op.getIf<Mem>(); mem != nullptr)
+            {
+                const auto baseReg = static_cast<ZydisRegister>(mem->getBase().getId());
+                const auto indexReg = static_cast<ZydisRegister>(mem->getIndex().getId());
+                if (mem->getLabelId() != Label::Id::Invalid || baseReg == ZYDIS_REGISTER_RIP || baseReg == ZYDIS_REGISTER_EIP
+                    || (baseReg == ZYDIS_REGISTER_NONE && indexReg == ZYDIS_REGISTER_NONE))
+                {
+                    return std::nullopt;
+                }
+                kind = 3;
+            }
+            else if (!op.holds<Operand::None>())
+            {
+                return std::nullopt;
+            }
+
+            key |= kind << (51U + i * 2U);
+        }
+
+        return key;
+    }
+
+    static void prepareSessionRequest(
+        detail::EncoderSessionRequest& entry, MachineMode mode, Instruction::Attribs attribs, Instruction::Mnemonic mnemonic,
+        std::size_t numOps, const Operand* operands) noexcept
+    {
+        auto& req = entry.req;
+        initRequest(req, mode, attribs, mnemonic);
+
+        req.operand_count = static_cast<ZyanU8>(numOps);
+        for (std::size_t i = 0; i < numOps; ++i)
+        {
+            const auto& op = operands[i]; // NOLINT
+            auto& dst = req.operands[i];  // NOLINT
+            if (op.holds<Reg>())
+            {
+                dst.type = ZYDIS_OPERAND_TYPE_REGISTER;
+            }
+            else if (op.holds<Imm>())
+            {
+                dst.type = ZYDIS_OPERAND_TYPE_IMMEDIATE;
+            }
+            else if (op.holds<Mem>())
+            {
+                dst.type = ZYDIS_OPERAND_TYPE_MEMORY;
+            }
+            else
+            {
+                dst.type = ZYDIS_OPERAND_TYPE_UNUSED;
+            }
+        }
+
+        // Only depends on the operand types.
+        fixupIs4Operands(req);
+
+        entry.prefixes = req.prefixes;
+    }
+
+    // Fills in the operand values, the types are already set by prepareSessionRequest.
+    static void patchSessionRequest(detail::EncoderSessionRequest& entry, std::size_t numOps, const Operand* operands) noexcept
+    {
+        auto& req = entry.req;
+        req.prefixes = entry.prefixes;
+
+        for (std::size_t i = 0; i < numOps; ++i)
+        {
+            const auto& op = operands[i]; // NOLINT
+            auto& dst = req.operands[i];  // NOLINT
+            if (const auto* reg = op.getIf<Reg>(); reg != nullptr)
+            {
+                dst.reg.value = static_cast<ZydisRegister>(reg->getId());
+            }
+            else if (const auto* imm = op.getIf<Imm>(); imm != nullptr)
+            {
+                dst.imm.s = imm->value<std::int64_t>();
+            }
+            else if (const auto* mem = op.getIf<Mem>(); mem != nullptr)
+            {
+                dst.mem.base = static_cast<ZydisRegister>(mem->getBase().getId());
+                dst.mem.index = static_cast<ZydisRegister>(mem->getIndex().getId());
+                dst.mem.scale = dst.mem.index == ZYDIS_REGISTER_NONE ? 0 : mem->getScale();
+                dst.mem.size = static_cast<uint16_t>(mem->getByteSize());
+                dst.mem.displacement = mem->getDisplacement();
+
+                const auto segmentId = static_cast<ZydisRegister>(mem->getSegment().getId());
+                if (segmentId == ZYDIS_REGISTER_GS)
+                {
+                    req.prefixes |= ZYDIS_ATTRIB_HAS_SEGMENT_GS;
+                }
+                else if (segmentId == ZYDIS_REGISTER_FS)
+                {
+                    req.prefixes |= ZYDIS_ATTRIB_HAS_SEGMENT_FS;
+                }
+            }
+        }
+    }
+
+    EncoderSession::EncoderSession(MachineMode mode)
+        : _state(new detail::EncoderSessionState())
+    {
+        _state->mode = mode;
+    }
+
+    EncoderSession::EncoderSession(EncoderSession&& other) noexcept
+    {
+        *this = std::move(other);
+    }
+
+    EncoderSession::~EncoderSession()
+    {
+        delete _state;
+        _state = nullptr;
+    }
+
+    EncoderSession& EncoderSession::operator=(EncoderSession&& other) noexcept
+    {
+        if (this != &other)
+        {
+            delete _state;
+            _state = other._state;
+            other._state = nullptr;
+        }
+
+        return *this;
+    }
+
+    MachineMode EncoderSession::getMode() const noexcept
+    {
+        return _state->mode;
+    }
+
+    Expected<EncoderResult, Error> EncoderSession::encode(const Instruction& instr, std::int64_t address)
+    {
+        const auto& ops = instr.getOperands();
+        return encode(address, instr.getAttribs(), instr.getMnemonic(), instr.getOperandCount(), ops.data());
+    }
+
+    Expected<EncoderResult, Error> EncoderSession::encode(
+        std::int64_t address, Instruction::Attribs attribs, Instruction::Mnemonic mnemonic, std::size_t numOps,
+        const Operand* operands)
+    {
+        auto& state = *_state;
+        if (!validateMachineMode(state.mode))
+        {
+            return makeUnexpected(Error(ErrorCode::InvalidMode));
+        }
+
+        auto& ctx = state.ctx;
+        ctx.va = address;
+        ctx.instrSize = 0;
+
+        EncoderResult res;
+
+        const auto key = getSessionShapeKey(attribs, mnemonic, numOps, operands);
+        if (!key.has_value())
+        {
+            if (const auto status = encode_(res, ctx, state.mode, attribs, mnemonic, numOps, operands);
+                status != ErrorCode::None)
+            {
+                return makeUnexpected(status);
+            }
+            return res;
+        }
+
+        if (encodeFastPath(res, ctx, state.mode, attribs, mnemonic, numOps, operands))
+        {
+            return res;
+        }
+
+        auto* entry = state.lastRequest;
+        if (entry == nullptr || state.lastKey != *key)
+        {
+            auto [it, inserted] = state.requests.try_emplace(*key);
+            entry = &it->second;
+            if (inserted)
+            {
+                prepareSessionRequest(*entry, state.mode, attribs, mnemonic, numOps, operands);
+                state.misses++;
+            }
+            else
+            {
+                state.hits++;
+            }
+            state.lastKey = *key;
+            state.lastRequest = entry;
+        }
+        else
+        {
+            state.hits++;
+        }
+
+        patchSessionRequest(*entry, numOps, operands);
+
+        std::size_t bufLen = res.buffer.data.size();
+        if (ZYAN_FAILED(ZydisEncoderEncodeInstructionAbsolute(&entry->req, res.buffer.data.data(), &bufLen, address)))
+        {
+            return makeUnexpected(Error(ErrorCode::ImpossibleInstruction));
+        }
+        res.buffer.length = static_cast<std::uint8_t>(bufLen);
+
+        return res;
+    }
+
+    std::size_t EncoderSession::getHitCount() const noexcept
+    {
+        return _state->hits;
+    }
+
+    std::size_t EncoderSession::getMissCount() const noexcept
+    {
+        return _state->misses;
+    }
+
+    std::size_t EncoderSession::size() const noexcept
+    {
+        return _state->requests.size();
+    }
+
+    void EncoderSession::clear() noexcept
+    {
+        _state->requests.clear();
+        _state->lastKey = 0;
+        _state->lastRequest = nullptr;
+        _state->hits = 0;
+        _state->misses = 0;
+        _state->ctx.reset();
     }
 
 } // namespace zasm
@@ -1,15 +1,62 @@
 #include "zasm/program/instruction.hpp"
 
+#include <Zydis/Zydis.h>
 #include <cassert>
+#include <limits>
+#include <optional>
+#include <unordered_map>
 #include <zasm/base/mode.hpp>
 #include <zasm/base/operand.hpp>
 #include <zasm/decoder/decoder.hpp>
 #include <zasm/encoder/encoder.hpp>
+#include <zasm/x86/meta.hpp>
+#include <zasm/x86/mnemonic.hpp>
 
 namespace zasm
 {
+    // The cache is cleared once it reaches this amount of entries.
+    static constexpr std::size_t kMaxDetailCacheSize = 1U << 16;
+
+    // Register ids are stored with 10 bits in the cache key.
+    static_assert(ZYDIS_REGISTER_MAX_VALUE < (1U << 10));
+
+    namespace detail
+    {
+        // Mode, mnemonic, attributes and operand count followed by the signature of each operand.
+        using DetailCacheKey = std::array<std::uint64_t, 1 + std::tuple_size_v<Instruction::Operands>>;
+
+        struct DetailCacheKeyHash
+        {
+            std::size_t operator()(const DetailCacheKey& key) const noexcept
+            {
+                std::uint64_t res = 0xcbf29ce484222325ULL;
+                for (const auto word : key)
+                {
+                    res = (res ^ word) * 0x00000100000001B3ULL;
+                }
+                return static_cast<std::size_t>(res);
+            }
+        };
+
+        struct DetailCacheEntry
+        {
+            InstructionDetail detail;
+            // Relative branches encode differently depending on the target, those are never reused.
+            bool reusable{};
+        };
+
+        struct DetailCache
+        {
+            std::unordered_map<DetailCacheKey, DetailCacheEntry, DetailCacheKeyHash> entries;
+            std::size_t hits{};
+            std::size_t misses{};
+        };
+
+    } // namespace detail
+
     static thread_local Decoder _decoderI386(MachineMode::I386);
     static thread_local Decoder _decoderAMD64(MachineMode::AMD64);
+    static thread_local detail::DetailCache _detailCache;
 
     static Decoder* getDecoder(MachineMode mode) noexcept
     {
@@ -25,7 +72,102 @@ namespace zasm
         return nullptr;
     }
 
-    Expected<InstructionDetail, Error> Instruction::getDetail(MachineMode mode, const Instruction& instr)
+    template<typename T> static constexpr bool fitsInto(std::int64_t val) noexcept
+    {
+        return val >= static_cast<std::int64_t>(std::numeric_limits<T>::min())
+            && val <= static_cast<std::int64_t>(std::numeric_limits<T>::max());
+    }
+
+    // The encoder picks the encoding based on the sizes a value fits into, values of 0 and 1 can also select
+    // dedicated encodings.
+    static constexpr std::uint64_t getValueSizeMask(std::int64_t val) noexcept
+    {
+        std::uint64_t mask{};
+        mask |= val == 0 ? (1U << 0) : 0U;
+        mask |= val == 1 ? (1U << 1) : 0U;
+        mask |= fitsInto<std::int8_t>(val) ? (1U << 2) : 0U;
+        mask |= fitsInto<std::uint8_t>(val) ? (1U << 3) : 0U;
+        mask |= fitsInto<std::int16_t>(val) ? (1U << 4) : 0U;
+        mask |= fitsInto<std::uint16_t>(val) ? (1U << 5) : 0U;
+        mask |= fitsInto<std::int32_t>(val) ? (1U << 6) : 0U;
+        mask |= fitsInto<std::uint32_t>(val) ? (1U << 7) : 0U;
+        return mask;
+    }
+
+    // Builds the key from everything that influences the encoding, returns nothing for operands that
+    // depend on the address of the instruction.
+    static std::optional<detail::DetailCacheKey> getDetailCacheKey(MachineMode mode, const Instruction& instr) noexcept
+    {
+        const auto opCount = instr.getOperandCount();
+        const auto& operands = instr.getOperands();
+
+        detail::DetailCacheKey key{};
+        key[0] = static_cast<std::uint64_t>(mode);
+        key[0] |= static_cast<std::uint64_t>(instr.getMnemonic().value() & 0xFFFFU) << 8U;
+        key[0] |= static_cast<std::uint64_t>(instr.getAttribs().value()) << 24U;
+        key[0] |= static_cast<std::uint64_t>(opCount) << 56U;
+
+        for (std::size_t i = 0; i < opCount; ++i)
+        {
+            const auto& op = operands[i];
+            auto& word = key[i + 1];
+
+            if (const auto* reg = op.getIf<Reg>(); reg != nullptr)
+            {
+                word = 1U | (static_cast<std::uint64_t>(reg->getId()) << 3U);
+            }
+            else if (const auto* imm = op.getIf<Imm>(); imm != nullptr)
+            {
+                word = 2U | (getValueSizeMask(imm->value<std::int64_t>()) << 3U);
+            }
+            else if (const auto* mem = op.getIf<Mem>(); mem != nullptr)
+            {
+                const auto baseReg = static_cast<ZydisRegister>(mem->getBase().getId());
+                if (mem->getLabelId() != Label::Id::Invalid || baseReg == ZYDIS_REGISTER_RIP
+                    || baseReg == ZYDIS_REGISTER_EIP)
+                {
+                    return std::nullopt;
+                }
+
+                word = 3U;
+                word |= static_cast<std::uint64_t>(mem->getSegment().getId()) << 3U;
+                word |= static_cast<std::uint64_t>(baseReg) << 13U;
+                word |= static_cast<std::uint64_t>(mem->getIndex().getId()) << 23U;
+                word |= static_cast<std::uint64_t>(mem->getScale() & 0xFU) << 33U;
+                word |= static_cast<std::uint64_t>(mem->getBitSize()) << 37U;
+                word |= getValueSizeMask(mem->getDisplacement()) << 45U;
+            }
+            else if (!op.holds<Operand::None>())
+            {
+                return std::nullopt;
+            }
+        }
+
+        return key;
+    }
+
+    static bool isReusableDetail(const InstructionDetail& detail) noexcept
+    {
+        const auto category = detail.getCategory();
+        if (category != x86::Category::CondBr && category != x86::Category::UncondBR && category != x86::Category::Call
+            && detail.getMnemonic() != x86::Mnemonic::Xbegin)
+        {
+            return true;
+        }
+
+        for (std::size_t i = 0; i < detail.getVisibleOperandCount(); ++i)
+        {
+            if (detail.isOperandType<Imm>(i))
+            {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    // Encodes the instruction and decodes the bytes again.
+    static Expected<InstructionDetail, Error> decodeDetail(MachineMode mode, const Instruction& instr)
     {
         const auto& operands = instr.getOperands();
         const auto opCount = instr.getOperandCount();
@@ -45,14 +187,20 @@ namespace zasm
             return zasm::makeUnexpected(decodeResult.error());
         }
 
-        zasm::InstructionDetail& decoded = *decodeResult;
-
-        if (decoded.getVisibleOperandCount() != opCount)
+        if (decodeResult->getVisibleOperandCount() != opCount)
         {
             return zasm::makeUnexpected(Error{ ErrorCode::InvalidOperation });
         }
 
-        // Replace the decoded operands with user specified operands.
+        return decodeResult;
+    }
+
+    // Replace the decoded operands with user specified operands.
+    static void applyOperands(InstructionDetail& decoded, const Instruction& instr) noexcept
+    {
+        const auto& operands = instr.getOperands();
+        const auto opCount = instr.getOperandCount();
+
         auto& dstOps = decoded.getOperands();
         for (std::size_t i = 0; i < opCount; i++)
         {
@@ -68,6 +216,45 @@ namespace zasm
                 dstOps[i] = operands[i];
             }
         }
+    }
+
+    Expected<InstructionDetail, Error> Instruction::getDetail(MachineMode mode, const Instruction& instr)
+    {
+        auto& cache = _detailCache;
+
+        const auto key = getDetailCacheKey(mode, instr);
+        if (key.has_value())
+        {
+            if (const auto it = cache.entries.find(*key); it != cache.entries.end() && it->second.reusable)
+            {
+                cache.hits++;
+
+                auto res = it->second.detail;
+                applyOperands(res, instr);
+                return res;
+            }
+        }
+
+        cache.misses++;
+
+        auto decodeResult = decodeDetail(mode, instr);
+        if (!decodeResult)
+        {
+            return decodeResult;
+        }
+
+        zasm::InstructionDetail& decoded = *decodeResult;
+
+        if (key.has_value())
+        {
+            if (cache.entries.size() >= kMaxDetailCacheSize)
+            {
+                cache.entries.clear();
+            }
+            cache.entries.emplace(*key, detail::DetailCacheEntry{ decoded, isReusableDetail(decoded) });
+        }
+
+        applyOperands(decoded, instr);
 
         return decoded;
     }
@@ -77,4 +264,18 @@ namespace zasm
         return getDetail(mode, *this);
     }
 
+    Instruction::DetailCacheStats Instruction::getDetailCacheStats() noexcept
+    {
+        const auto& cache = _detailCache;
+        return DetailCacheStats{ cache.hits, cache.misses, cache.entries.size() };
+    }
+
+    void Instruction::clearDetailCache() noexcept
+    {
+        auto& cache = _detailCache;
+        cache.entries.clear();
+        cache.hits = 0;
+        cache.misses = 0;
+    }
+
 } // namespace zasm
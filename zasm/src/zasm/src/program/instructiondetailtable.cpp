@@ -0,0 +1,268 @@
+#include "zasm/program/instructiondetailtable.hpp"
+
+#include "../core/threadpool.hpp"
+#include "program.state.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+#include <zasm/program/observer.hpp>
+#include <zasm/program/program.hpp>
+
+namespace zasm
+{
+    // Amount of instructions a thread takes at once.
+    static constexpr std::size_t kDetailChunkSize = 256;
+
+    namespace detail
+    {
+        struct InstructionDetailTableState;
+
+        class DetailTableObserver final : public Observer
+        {
+            InstructionDetailTableState& _state;
+
+        public:
+            explicit DetailTableObserver(InstructionDetailTableState& state) noexcept
+                : _state{ state }
+            {
+            }
+
+            void onNodeDestroy(Node* node) override;
+            void onNodeInserted(Node* node) override;
+            void onRangeInserted(Node* first, Node* last) override;
+        };
+
+        struct InstructionDetailTableState
+        {
+            static constexpr std::int32_t kInvalidIndex = -1;
+
+            Program* program{};
+            DetailTableObserver observer{ *this };
+
+            // Index into details per Node::Id.
+            std::vector<std::int32_t> index;
+            std::vector<InstructionDetail> details;
+            std::vector<std::int32_t> freeSlots;
+
+            std::int32_t allocateSlot()
+            {
+                if (!freeSlots.empty())
+                {
+                    const auto slot = freeSlots.back();
+                    freeSlots.pop_back();
+                    return slot;
+                }
+
+                details.emplace_back();
+                return static_cast<std::int32_t>(details.size() - 1);
+            }
+
+            void invalidate(const Node* node) noexcept
+            {
+                const auto nodeIdx = static_cast<std::size_t>(node->getId());
+                if (nodeIdx >= index.size() || index[nodeIdx] == kInvalidIndex)
+                {
+                    return;
+                }
+
+                freeSlots.push_back(index[nodeIdx]);
+                index[nodeIdx] = kInvalidIndex;
+            }
+
+            void clear() noexcept
+            {
+                index.clear();
+                details.clear();
+                freeSlots.clear();
+            }
+        };
+
+        void DetailTableObserver::onNodeDestroy(Node* node)
+        {
+            _state.invalidate(node);
+        }
+
+        void DetailTableObserver::onNodeInserted(Node* node)
+        {
+            _state.invalidate(node);
+        }
+
+        void DetailTableObserver::onRangeInserted(Node* first, Node* last)
+        {
+            for (const auto* node = first; node != nullptr; node = node->getNext())
+            {
+                _state.invalidate(node);
+                if (node == last)
+                {
+                    break;
+                }
+            }
+        }
+
+    } // namespace detail
+
+    InstructionDetailTable::InstructionDetailTable(Program& program)
+        : _state(new detail::InstructionDetailTableState())
+    {
+        _state->program = &program;
+        program.addObserver(_state->observer);
+    }
+
+    InstructionDetailTable::InstructionDetailTable(InstructionDetailTable&& other) noexcept
+    {
+        *this = std::move(other);
+    }
+
+    InstructionDetailTable::~InstructionDetailTable()
+    {
+        if (_state != nullptr)
+        {
+            _state->program->removeObserver(_state->observer);
+        }
+        delete _state;
+        _state = nullptr;
+    }
+
+    InstructionDetailTable& InstructionDetailTable::operator=(InstructionDetailTable&& other) noexcept
+    {
+        if (this != &other)
+        {
+            if (_state != nullptr)
+            {
+                _state->program->removeObserver(_state->observer);
+            }
+            delete _state;
+            _state = other._state;
+            other._state = nullptr;
+        }
+
+        return *this;
+    }
+
+    Error InstructionDetailTable::compute(std::size_t threadCount)
+    {
+        auto* program = _state->program;
+        return compute(program->getHead(), program->getTail(), threadCount);
+    }
+
+    Error InstructionDetailTable::compute(const Node* first, const Node* last, std::size_t threadCount)
+    {
+        auto& state = *_state;
+
+        // Assign the slots on the calling thread, the workers only fill them.
+        std::vector<const Node*> nodes;
+        std::vector<std::int32_t> slots;
+
+        for (const auto* node = first; node != nullptr; node = node->getNext())
+        {
+            if (node->holds<Instruction>())
+            {
+                const auto nodeIdx = static_cast<std::size_t>(node->getId());
+                if (nodeIdx >= state.index.size())
+                {
+                    state.index.resize(nodeIdx + 1, detail::InstructionDetailTableState::kInvalidIndex);
+                }
+
+                if (state.index[nodeIdx] == detail::InstructionDetailTableState::kInvalidIndex)
+                {
+                    const auto slot = state.allocateSlot();
+                    state.index[nodeIdx] = slot;
+
+                    nodes.push_back(node);
+                    slots.push_back(slot);
+                }
+            }
+
+            if (node == last)
+            {
+                break;
+            }
+        }
+
+        if (nodes.empty())
+        {
+            return ErrorCode::None;
+        }
+
+        const auto mode = state.program->getMode();
+        const auto chunkCount = (nodes.size() + kDetailChunkSize - 1) / kDetailChunkSize;
+
+        std::vector<std::uint8_t> computed(nodes.size());
+        std::vector<Error> chunkErrors(chunkCount);
+
+        detail::getSharedThreadPool().run(detail::getThreadCount(threadCount), chunkCount, [&](std::size_t chunkIdx) {
+            const auto begin = chunkIdx * kDetailChunkSize;
+            const auto end = std::min(begin + kDetailChunkSize, nodes.size());
+            for (auto i = begin; i < end; ++i)
+            {
+                auto res = Instruction::getDetail(mode, nodes[i]->get<Instruction>());
+                if (!res)
+                {
+                    if (chunkErrors[chunkIdx] == ErrorCode::None)
+                    {
+                        chunkErrors[chunkIdx] = res.error();
+                    }
+                    continue;
+                }
+
+                state.details[static_cast<std::size_t>(slots[i])] = *res;
+                computed[i] = 1;
+            }
+        });
+
+        // Release the slots of the instructions that failed.
+        for (std::size_t i = 0; i < nodes.size(); ++i)
+        {
+            if (computed[i] == 0)
+            {
+                state.invalidate(nodes[i]);
+            }
+        }
+
+        for (const auto& err : chunkErrors)
+        {
+            if (err != ErrorCode::None)
+            {
+                return err;
+            }
+        }
+
+        return ErrorCode::None;
+    }
+
+    const InstructionDetail* InstructionDetailTable::get(const Node* node) const noexcept
+    {
+        const auto& state = *_state;
+
+        const auto nodeIdx = static_cast<std::size_t>(node->getId());
+        if (nodeIdx >= state.index.size())
+        {
+            return nullptr;
+        }
+
+        const auto slot = state.index[nodeIdx];
+        if (slot == detail::InstructionDetailTableState::kInvalidIndex)
+        {
+            return nullptr;
+        }
+
+        return &state.details[static_cast<std::size_t>(slot)];
+    }
+
+    void InstructionDetailTable::invalidate(const Node* node) noexcept
+    {
+        _state->invalidate(node);
+    }
+
+    void InstructionDetailTable::clear() noexcept
+    {
+        _state->clear();
+    }
+
+    std::size_t InstructionDetailTable::size() const noexcept
+    {
+        return _state->details.size() - _state->freeSlots.size();
+    }
+
+} // namespace zasm
@@ -397,13 +397,221 @@ namespace zasm
     Node* Program::moveAfter(Node* pos, Node* node) noexcept
     {
         detach_<false>(node, *_state);
-        return insertAfter_<false>(pos, node, *_state);
+        insertAfter_<false>(pos, node, *_state);
+
+        notifyObservers<true>(&Observer::onRangeMoved, _state->observer, node, node);
+        return node;
     }
 
     Node* Program::moveBefore(Node* pos, Node* node) noexcept
     {
         detach_<false>(node, *_state);
-        return insertBefore_<false>(pos, node, *_state);
+        insertBefore_<false>(pos, node, *_state);
+
+        notifyObservers<true>(&Observer::onRangeMoved, _state->observer, node, node);
+        return node;
+    }
+
+    // Unlinks the range from the list, the links within the range are kept.
+    static void unlinkRange_(detail::Node* first, detail::Node* last, detail::ProgramState& state) noexcept
+    {
+        auto* pre = detail::toInternal(first->getPrev());
+        auto* post = detail::toInternal(last->getNext());
+
+        if (pre != nullptr)
+        {
+            pre->setNext(post);
+        }
+        else
+        {
+            state.head = post;
+        }
+
+        if (post != nullptr)
+        {
+            post->setPrev(pre);
+        }
+        else
+        {
+            state.tail = pre;
+        }
+
+        first->setPrev(nullptr);
+        last->setNext(nullptr);
+    }
+
+    // Debug checks for the range operations, last must be reachable from first.
+    [[maybe_unused]] static bool isRangeLinked_(const Node* first, const Node* last) noexcept
+    {
+        for (const auto* node = first; node != nullptr; node = node->getNext())
+        {
+            if (node == last)
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    [[maybe_unused]] static bool isInRange_(const Node* pos, const Node* first, const Node* last) noexcept
+    {
+        for (const auto* node = first; node != nullptr; node = node->getNext())
+        {
+            if (node == pos)
+            {
+                return true;
+            }
+            if (node == last)
+            {
+                break;
+            }
+        }
+        return false;
+    }
+
+    // Links the range after pos, a null pos links it at the start.
+    static void linkRangeAfter_(
+        detail::Node* pos, detail::Node* first, detail::Node* last, detail::ProgramState& state) noexcept
+    {
+        auto* next = detail::toInternal(pos != nullptr ? pos->getNext() : state.head);
+
+        first->setPrev(pos);
+        last->setNext(next);
+
+        if (pos != nullptr)
+        {
+            pos->setNext(first);
+        }
+        else
+        {
+            state.head = first;
+        }
+
+        if (next != nullptr)
+        {
+            next->setPrev(last);
+        }
+        else
+        {
+            state.tail = last;
+        }
+    }
+
+    Node* Program::insertRangeAfter(Node* pos, Node* first, Node* last) noexcept
+    {
+        auto& state = *_state;
+
+        assert(pos == nullptr || pos->isAttached());
+        assert(isRangeLinked_(first, last));
+
+        // Update the state of the nodes without notifying for each.
+        for (auto* node = detail::toInternal(first); node != nullptr; node = detail::toInternal(node->getNext()))
+        {
+            attachNode(node);
+            state.nodeCount++;
+
+            if (node == last)
+            {
+                break;
+            }
+        }
+
+        linkRangeAfter_(detail::toInternal(pos), detail::toInternal(first), detail::toInternal(last), state);
+
+        notifyObservers<true>(&Observer::onRangeInserted, state.observer, first, last);
+
+        return last;
+    }
+
+    Node* Program::insertRangeAfter(Node* pos, Node* const* nodes, std::size_t count) noexcept
+    {
+        auto& state = *_state;
+
+        assert(pos == nullptr || pos->isAttached());
+
+        if (count == 0)
+        {
+            return pos;
+        }
+
+        // Link the nodes to each other in one walk, the range is then inserted as a whole.
+        detail::Node* prev = nullptr;
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            auto* node = detail::toInternal(nodes[i]);
+            assert(node->getPrev() == nullptr && node->getNext() == nullptr);
+
+            attachNode(node);
+            node->setPrev(prev);
+            if (prev != nullptr)
+            {
+                prev->setNext(node);
+            }
+            prev = node;
+        }
+        state.nodeCount += count;
+
+        auto* first = detail::toInternal(nodes[0]);
+        auto* last = prev;
+        linkRangeAfter_(detail::toInternal(pos), first, last, state);
+
+        notifyObservers<true>(&Observer::onRangeInserted, state.observer, first, last);
+
+        return last;
+    }
+
+    Node* Program::detachRange(Node* first, Node* last) noexcept
+    {
+        auto& state = *_state;
+
+        if (!first->isAttached() || !last->isAttached())
+        {
+            // Can't detach a range twice.
+            return nullptr;
+        }
+
+        assert(isRangeLinked_(first, last));
+
+        notifyObservers<true>(&Observer::onRangeDetach, state.observer, first, last);
+
+        auto* post = last->getNext();
+
+        for (auto* node = detail::toInternal(first); node != nullptr; node = detail::toInternal(node->getNext()))
+        {
+            node->setAttached(false);
+            state.nodeCount--;
+
+            if (node == last)
+            {
+                break;
+            }
+        }
+
+        unlinkRange_(detail::toInternal(first), detail::toInternal(last), state);
+
+        return post;
+    }
+
+    Node* Program::splice(Node* pos, Node* first, Node* last) noexcept
+    {
+        auto& state = *_state;
+
+        assert(first->isAttached() && last->isAttached());
+        assert(isRangeLinked_(first, last));
+        assert(pos == nullptr || !isInRange_(pos, first, last));
+
+        if (pos == first->getPrev())
+        {
+            // Already in place.
+            return last;
+        }
+
+        unlinkRange_(detail::toInternal(first), detail::toInternal(last), state);
+        linkRangeAfter_(detail::toInternal(pos), detail::toInternal(first), detail::toInternal(last), state);
+
+        notifyObservers<true>(&Observer::onRangeMoved, state.observer, first, last);
+
+        return last;
     }
 
     static void destroyNode(detail::ProgramState& state, Node* node, bool quickDestroy)
@@ -426,22 +634,25 @@ namespace zasm
         node->visit([&](auto& ptr) {
             using T = std::decay_t<decltype(ptr)>;
 
-            auto& objectPool = state.objectPools.get<T>();
-            objectPool.destroy(&ptr);
-
-            if (!quickDestroy)
+            // Inline data is trivially copyable and released with the node.
+            if constexpr (!detail::kNodeInline<T>)
             {
-                objectPool.deallocate(&ptr, 1);
+                auto& objectPool = state.objectPools.get<T>();
+                objectPool.destroy(&ptr);
+
+                if (!quickDestroy)
+                {
+                    objectPool.deallocate(&ptr, 1);
+                }
             }
         });
 
-        auto& nodePool = state.objectPools.get<Node>();
-        nodePool.destroy(nodeToDestroy);
+        nodeToDestroy->~Node();
 
         if (!quickDestroy)
         {
-            // Release memory, when quickDestroy is true the entire pool will be cleared at once.
-            nodePool.deallocate(nodeToDestroy, 1);
+            // Release memory, when quickDestroy is true the entire arena will be cleared at once.
+            state.nodeArena.deallocate(nodeToDestroy);
 
             // Remove mapping.
             auto& nodeMap = state.nodeMap;
@@ -467,6 +678,17 @@ namespace zasm
         return _state->nodeCount;
     }
 
+    void Program::reserve(std::size_t nodeCount, std::size_t instructionCount, std::size_t labelCount)
+    {
+        auto& state = *_state;
+
+        state.nodeArena.reserve(nodeCount);
+        state.objectPools.get<Instruction>().reserve(instructionCount);
+
+        state.nodeMap.reserve(static_cast<std::size_t>(state.nextNodeId) + nodeCount);
+        state.labels.reserve(state.labels.size() + labelCount);
+    }
+
     void Program::clear() noexcept
     {
         Node* node = _state->head;
@@ -486,6 +708,7 @@ namespace zasm
         _state->sections.clear();
         _state->labels.clear();
         _state->symbolNames.clear();
+        _state->nodeArena.reset();
         _state->objectPools.reset();
     }
 
@@ -504,22 +727,25 @@ namespace zasm
         const auto nextId = state.nextNodeId;
         state.nextNodeId = static_cast<Node::Id>(static_cast<std::underlying_type_t<Node::Id>>(nextId) + 1U);
 
-        auto& nodePool = state.objectPools.get<Node>();
-        auto* node = detail::toInternal(nodePool.allocate(1));
-        if (node == nullptr)
-        {
-            return nullptr;
-        }
+        auto* node = static_cast<detail::Node*>(state.nodeArena.allocate());
 
-        // Construct object.
         using ObjectType = std::decay_t<T>;
-        auto& objectPool = state.objectPools.get<ObjectType>();
+        if constexpr (detail::kNodeInline<ObjectType>)
+        {
+            // Construct node with the object stored inline.
+            ::new ((void*)node) detail::Node(nextId, std::in_place, object);
+        }
+        else
+        {
+            // Construct object.
+            auto& objectPool = state.objectPools.get<ObjectType>();
 
-        auto* obj = objectPool.allocate(1);
-        ::new ((void*)obj) ObjectType(std::move(object));
+            auto* obj = objectPool.allocate(1);
+            ::new ((void*)obj) ObjectType(std::move(object));
 
-        // Construct node.
-        ::new ((void*)node) detail::Node(nextId, obj);
+            // Construct node.
+            ::new ((void*)node) detail::Node(nextId, obj);
+        }
 
         notifyObservers<true>(&Observer::onNodeCreated, state.observer, node);
 
@@ -15,13 +15,19 @@ namespace zasm
                 : ::zasm::Node(id, val)
             {
             }
+            template<typename T>
+            constexpr Node(zasm::Node::Id id, std::in_place_t, const T& val) noexcept
+                : ::zasm::Node(id, std::in_place, val)
+            {
+            }
+            // The node has to be in the same arena.
             void setPrev(::zasm::Node* node) noexcept
             {
-                _prev = node;
+                _prev = NodeChunk::indexOf(node);
             }
             void setNext(::zasm::Node* node) noexcept
             {
-                _next = node;
+                _next = NodeChunk::indexOf(node);
             }
             void setId(Node::Id id)
             {
@@ -39,6 +45,17 @@ namespace zasm
 
         static_assert(sizeof(Node) == sizeof(::zasm::Node));
 
+        // Id, flags and type tag share the first 8 bytes followed by the two links, a chunk holds a whole number
+        // of nodes.
+        static_assert(sizeof(::zasm::Node) == kNodeSlotSize);
+        static_assert(kNodeChunkSize % kNodeSlotSize == 0 && sizeof(NodeChunk) <= kNodeSlotSize);
+        static_assert(
+            sizeof(void*) != 8
+            || (kNodeInline<Sentinel> && kNodeInline<Label> && kNodeInline<Section> && kNodeInline<Align>));
+
+        // The data can be accessed in constant expressions.
+        static_assert(Node(zasm::Node::Id{}, std::in_place, Label{ Label::Id{ 1 } }).get<Label>().getId() == Label::Id{ 1 });
+
         static detail::Node* toInternal(zasm::Node* node) noexcept
         {
             return static_cast<Node*>(node);
@@ -0,0 +1,114 @@
+#pragma once
+
+#include "zasm/program/node.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <vector>
+
+namespace zasm::detail
+{
+    // Storage of the nodes of a program, the nodes are linked by their index in the arena, see NodeChunk. Freed
+    // slots are reused and the chunks are kept until the arena is destroyed.
+    class NodeArena : NodeChunkTable
+    {
+        std::vector<NodeChunk*> _chunks;
+        // Amount of chunks slots are handed out from, the last one is partially used.
+        std::size_t _usedChunks{};
+        std::uint32_t _nextSlot{ kNodeChunkSlots };
+        // Index of the first free slot, a free slot stores the index of the next one.
+        std::uint32_t _freeIndex{};
+
+        void addChunk()
+        {
+            _chunks.reserve(_chunks.size() + 1);
+
+            void* mem = ::operator new(kNodeChunkSize, std::align_val_t{ kNodeChunkSize });
+            auto* chunk = ::new (mem) NodeChunk{ this, static_cast<std::uint32_t>(_chunks.size()) };
+
+            _chunks.push_back(chunk);
+            chunks = _chunks.data();
+        }
+
+        void* at(std::uint32_t index) const noexcept
+        {
+            // NOLINTNEXTLINE
+            return reinterpret_cast<std::byte*>(_chunks[index / kNodeChunkSlots]) + (index % kNodeChunkSlots) * kNodeSlotSize;
+        }
+
+    public:
+        NodeArena() = default;
+        NodeArena(const NodeArena&) = delete;
+        NodeArena& operator=(const NodeArena&) = delete;
+
+        ~NodeArena()
+        {
+            for (auto* chunk : _chunks)
+            {
+                ::operator delete(chunk, std::align_val_t{ kNodeChunkSize });
+            }
+        }
+
+        // Returns the memory for a node, the node has to be constructed by the caller.
+        void* allocate()
+        {
+            if (_freeIndex != 0)
+            {
+                void* ptr = at(_freeIndex);
+                std::memcpy(&_freeIndex, ptr, sizeof(_freeIndex));
+                return ptr;
+            }
+
+            if (_nextSlot == kNodeChunkSlots)
+            {
+                if (_usedChunks == _chunks.size())
+                {
+                    addChunk();
+                }
+                _usedChunks++;
+                _nextSlot = 1;
+            }
+
+            const auto index = static_cast<std::uint32_t>(_usedChunks - 1) * kNodeChunkSlots + _nextSlot;
+            _nextSlot++;
+
+            return at(index);
+        }
+
+        // The node has to be destroyed by the caller.
+        void deallocate(void* ptr) noexcept
+        {
+            std::memcpy(ptr, &_freeIndex, sizeof(_freeIndex));
+            _freeIndex = NodeChunk::indexOf(ptr);
+        }
+
+        // Ensures that the next count allocations do not have to allocate another chunk.
+        void reserve(std::size_t count)
+        {
+            const auto slotsPerChunk = static_cast<std::size_t>(kNodeChunkSlots - 1);
+
+            std::size_t available = (_chunks.size() - _usedChunks) * slotsPerChunk;
+            if (_usedChunks != 0)
+            {
+                available += kNodeChunkSlots - _nextSlot;
+            }
+
+            while (available < count)
+            {
+                addChunk();
+                available += slotsPerChunk;
+            }
+        }
+
+        // Releases all nodes at once, the chunks are kept for the next nodes.
+        void reset() noexcept
+        {
+            _usedChunks = 0;
+            _nextSlot = kNodeChunkSlots;
+            _freeIndex = 0;
+        }
+    };
+
+} // namespace zasm::detail
@@ -1,5 +1,6 @@
 #pragma once
 
+#include "program.nodearena.hpp"
 #include "zasm/core/enumflags.hpp"
 #include "zasm/core/objectpool.hpp"
 #include "zasm/core/stringpool.hpp"
@@ -12,6 +13,8 @@
 #include <Zydis/Zydis.h>
 #include <cstddef>
 #include <tuple>
+#include <type_traits>
+#include <utility>
 #include <vector>
 #include <zasm/base/label.hpp>
 #include <zasm/base/mode.hpp>
@@ -58,9 +61,14 @@ namespace zasm::detail
             static constexpr std::size_t kSize = 30'000;
         };
 
+        // Types stored inline in the node have no pool.
+        template<typename T>
+        using PoolTuple = std::conditional_t<
+            kNodeInline<T>, std::tuple<>, std::tuple<ObjectPool<T, PoolSize<T>::kSize>>>;
+
         template<typename... TTypes> struct ObjectPools
         {
-            std::tuple<ObjectPool<TTypes, PoolSize<TTypes>::kSize>...> pools;
+            decltype(std::tuple_cat(std::declval<PoolTuple<TTypes>>()...)) pools;
 
             template<typename T> auto& get()
             {
@@ -74,7 +82,7 @@ namespace zasm::detail
         };
     } // namespace detail
 
-    using ObjectPools = detail::ObjectPools<zasm::Node, Sentinel, Instruction, Label, EmbeddedLabel, Data, Section, Align>;
+    using ObjectPools = detail::ObjectPools<Sentinel, Instruction, Label, EmbeddedLabel, Data, Section, Align>;
 
     struct NodeList
     {
@@ -103,6 +111,7 @@ namespace zasm::detail
 
         Label entryPoint{ Label::Id::Invalid };
 
+        NodeArena nodeArena;
         ObjectPools objectPools;
         Node::Id nextNodeId{};
 
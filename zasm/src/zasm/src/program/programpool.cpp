@@ -0,0 +1,193 @@
+#include "zasm/program/programpool.hpp"
+
+#include "program.state.hpp"
+
+#include <algorithm>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <zasm/program/program.hpp>
+#include <zasm/x86/assembler.hpp>
+
+namespace zasm
+{
+    namespace detail
+    {
+        struct ProgramPoolEntry
+        {
+            Program program;
+            x86::Assembler assembler;
+
+            explicit ProgramPoolEntry(MachineMode mode)
+                : program(mode)
+                , assembler(program)
+            {
+            }
+        };
+
+        struct ProgramPoolState
+        {
+            MachineMode mode{};
+
+            mutable std::mutex mutex;
+            std::vector<std::unique_ptr<ProgramPoolEntry>> entries;
+            std::vector<ProgramPoolEntry*> available;
+        };
+
+    } // namespace detail
+
+    // Clears everything the previous user has touched, the capacity is kept.
+    static void resetEntry(detail::ProgramPoolEntry& entry, MachineMode mode)
+    {
+        auto& program = entry.program;
+        program.clear();
+        program.setEntryPoint(Label{});
+        program.setMode(mode);
+
+        // Observers still registered by the previous user were notified about the clear, only the assembler
+        // stays registered.
+        auto& observers = program.getState().observer;
+        observers.erase(
+            std::remove_if(
+                observers.begin(), observers.end(), [&](const Observer* observer) { return observer != &entry.assembler; }),
+            observers.end());
+
+        entry.assembler.reset();
+    }
+
+    ProgramPool::Handle::Handle(detail::ProgramPoolState* state, detail::ProgramPoolEntry* entry) noexcept
+        : _state{ state }
+        , _entry{ entry }
+    {
+    }
+
+    ProgramPool::Handle::Handle(Handle&& other) noexcept
+    {
+        *this = std::move(other);
+    }
+
+    ProgramPool::Handle::~Handle()
+    {
+        release();
+    }
+
+    ProgramPool::Handle& ProgramPool::Handle::operator=(Handle&& other) noexcept
+    {
+        if (this != &other)
+        {
+            release();
+
+            _state = other._state;
+            _entry = other._entry;
+            other._state = nullptr;
+            other._entry = nullptr;
+        }
+
+        return *this;
+    }
+
+    void ProgramPool::Handle::release()
+    {
+        if (_entry == nullptr)
+        {
+            return;
+        }
+
+        // Reset outside of the lock, the entry is exclusively owned until it is available again.
+        resetEntry(*_entry, _state->mode);
+
+        {
+            std::lock_guard lock(_state->mutex);
+            _state->available.push_back(_entry);
+        }
+
+        _state = nullptr;
+        _entry = nullptr;
+    }
+
+    Program& ProgramPool::Handle::getProgram() const noexcept
+    {
+        return _entry->program;
+    }
+
+    x86::Assembler& ProgramPool::Handle::getAssembler() const noexcept
+    {
+        return _entry->assembler;
+    }
+
+    ProgramPool::ProgramPool(MachineMode mode, std::size_t initialCount)
+        : _state(new detail::ProgramPoolState())
+    {
+        _state->mode = mode;
+
+        _state->entries.reserve(initialCount);
+        _state->available.reserve(initialCount);
+        for (std::size_t i = 0; i < initialCount; ++i)
+        {
+            auto& entry = _state->entries.emplace_back(std::make_unique<detail::ProgramPoolEntry>(mode));
+            _state->available.push_back(entry.get());
+        }
+    }
+
+    ProgramPool::ProgramPool(ProgramPool&& other) noexcept
+    {
+        *this = std::move(other);
+    }
+
+    ProgramPool::~ProgramPool()
+    {
+        delete _state;
+        _state = nullptr;
+    }
+
+    ProgramPool& ProgramPool::operator=(ProgramPool&& other) noexcept
+    {
+        if (this != &other)
+        {
+            delete _state;
+            _state = other._state;
+            other._state = nullptr;
+        }
+
+        return *this;
+    }
+
+    ProgramPool::Handle ProgramPool::acquire()
+    {
+        auto& state = *_state;
+
+        {
+            std::lock_guard lock(state.mutex);
+            if (!state.available.empty())
+            {
+                auto* entry = state.available.back();
+                state.available.pop_back();
+                return Handle(_state, entry);
+            }
+        }
+
+        // Construct the new pair outside of the lock.
+        auto newEntry = std::make_unique<detail::ProgramPoolEntry>(state.mode);
+        auto* entry = newEntry.get();
+
+        {
+            std::lock_guard lock(state.mutex);
+            state.entries.push_back(std::move(newEntry));
+        }
+
+        return Handle(_state, entry);
+    }
+
+    std::size_t ProgramPool::getAvailableCount() const
+    {
+        std::lock_guard lock(_state->mutex);
+        return _state->available.size();
+    }
+
+    std::size_t ProgramPool::size() const
+    {
+        std::lock_guard lock(_state->mutex);
+        return _state->entries.size();
+    }
+
+} // namespace zasm
@@ -1,20 +1,50 @@
 #include "zasm/serialization/serializer.hpp"
 
+#include "../core/threadpool.hpp"
 #include "../encoder/encoder.context.hpp"
 #include "../program/program.state.hpp"
 #include "zasm/core/math.hpp"
 #include "zasm/encoder/encoder.hpp"
 #include "zasm/formatter/formatter.hpp"
+#include "zasm/program/observer.hpp"
 
 #include <Zydis/Decoder.h>
 #include <algorithm>
+#include <atomic>
 #include <cassert>
+#include <chrono>
 #include <cstddef>
+#include <cstring>
 #include <functional>
 #include <iterator>
+#include <new>
+#include <utility>
 
 namespace zasm
 {
+    // Simplified layout of the serialized nodes used to resolve the size of relative branches, consecutive
+    // nodes with a fixed size are merged into a single item.
+    struct LayoutItem
+    {
+        enum class Kind : std::uint8_t
+        {
+            Fixed,
+            Align,
+            Section,
+            Label,
+            Branch,
+        };
+
+        Kind kind{};
+        std::int32_t length{};
+        std::int32_t align{};
+        std::size_t nodeIndex{};
+        Label::Id label{ Label::Id::Invalid };
+        std::int64_t target{};
+        std::int32_t sizeRel8{};
+        std::int32_t sizeRel32{};
+    };
+
     namespace detail
     {
         struct LabelInfo
@@ -22,392 +52,1555 @@ namespace zasm
             static constexpr std::int32_t kUnboundOffset = -1;
             static constexpr std::int64_t kUnboundAddress = -1;
 
-            Label::Id labelId{ Label::Id::Invalid };
-            std::int32_t boundOffset{ kUnboundOffset };
-            std::int64_t boundAddress{ kUnboundAddress };
-        };
+            Label::Id labelId{ Label::Id::Invalid };
+            std::int32_t boundOffset{ kUnboundOffset };
+            std::int64_t boundAddress{ kUnboundAddress };
+        };
+
+        // A range of nodes that is encoded by a single worker, see Serializer::setThreadCount.
+        struct EncodeChunk
+        {
+            const Node* first{};
+            const Node* lastNode{};
+            std::size_t nodeIndex{};
+            std::size_t nodeCount{};
+            std::vector<std::uint8_t> code;
+        };
+
+        struct SerializerState;
+
+        // Tracks modifications of the program for incremental serialization.
+        class IncrementalObserver final : public Observer
+        {
+            SerializerState& _state;
+
+        public:
+            explicit IncrementalObserver(SerializerState& state) noexcept
+                : _state{ state }
+            {
+            }
+
+            void onNodeDestroy(Node* node) override;
+            void onNodeDetach(Node* node) override;
+            void onNodeInserted(Node* node) override;
+            void onRangeDetach(Node* first, Node* last) override;
+            void onRangeInserted(Node* first, Node* last) override;
+            void onRangeMoved(Node* first, Node* last) override;
+        };
+
+        struct SerializerState
+        {
+            static constexpr std::int32_t kInvalidNodeIndex = -1;
+
+            std::int64_t base{};
+            std::int32_t passCount{};
+            EncoderCache* encoderCache{};
+            std::size_t threadCount{};
+            ICodeSink* sink{};
+            IStream* stream{};
+            IStream* relocStream{};
+            std::size_t codeSize{};
+            bool isStatsEnabled{};
+            SerializerStats stats;
+            std::vector<SectionInfo> sections;
+            std::vector<std::uint8_t> code;
+            std::vector<RelocationInfo> relocations;
+            std::vector<RelocationInfo> externalRelocations;
+
+            // Offsets of the relocations grouped by their size, see Serializer::relocate.
+            std::vector<std::int32_t> relocOffsets32;
+            std::vector<std::int32_t> relocOffsets64;
+            std::vector<LabelInfo> labels;
+
+            // Scratch memory kept across calls, serializing small programs does not allocate once warm.
+            EncoderContext encoderCtx;
+            std::vector<std::uint8_t> codeScratch;
+            std::vector<std::uint8_t> layoutCode;
+            std::vector<EncoderContext::Node> layoutNodes;
+            std::vector<LayoutItem> layout;
+            ZydisDecoder decoder{};
+            MachineMode decoderMode{};
+            bool isDecoderInitialized{};
+
+            // Parallel encoding, the worker threads and the chunks are kept to reuse them across calls.
+            ThreadPool threadPool;
+            std::vector<EncodeChunk> chunks;
+            std::size_t chunkCount{};
+            bool hasUserChunks{};
+
+            // Incremental serialization, the encoded nodes of the last serialize call indexed by Node::Id.
+            ProgramState* observedProgram{};
+            IncrementalObserver observer{ *this };
+            MachineMode encodedMode{};
+            std::vector<EncoderContext::Node> encodedNodes;
+            std::vector<std::int32_t> encodedNodeIndex;
+
+            // The node ids in the order of the encoded nodes and the sorted indices of the nodes that have to be
+            // serialized one by one. Modifications add the indices where the previous order is broken to the dirty
+            // bounds, the ranges between the bounds are copied as a whole when the program is serialized again.
+            std::vector<Node::Id> encodedNodeIds;
+            std::vector<std::int32_t> encodedSingleNodes;
+            std::vector<std::int32_t> dirtyBounds;
+            bool canCopyRanges{};
+
+            // Built while copying ranges, replaces the above if the result is kept.
+            std::vector<Node::Id> nextNodeIds;
+            std::vector<std::int32_t> nextSingleNodes;
+            std::vector<std::pair<std::int32_t, std::int32_t>> movedRanges;
+
+            ~SerializerState()
+            {
+                stopObserving();
+            }
+
+            void stopObserving() noexcept
+            {
+                if (observedProgram != nullptr)
+                {
+                    auto& observers = observedProgram->observer;
+                    observers.erase(std::remove(observers.begin(), observers.end(), &observer), observers.end());
+                    observedProgram = nullptr;
+                }
+                resetEncodedNodes();
+            }
+
+            void resetEncodedNodes() noexcept
+            {
+                encodedNodes.clear();
+                encodedNodeIndex.clear();
+                encodedNodeIds.clear();
+                encodedSingleNodes.clear();
+                dirtyBounds.clear();
+                canCopyRanges = false;
+            }
+
+            std::int32_t getEncodedIndex(const Node* node) const noexcept
+            {
+                const auto nodeIdx = static_cast<std::size_t>(node->getId());
+                if (nodeIdx >= encodedNodeIndex.size())
+                {
+                    return kInvalidNodeIndex;
+                }
+                return encodedNodeIndex[nodeIdx];
+            }
+
+            void addDirtyBound(std::int32_t encodedIdx) noexcept
+            {
+                if (!canCopyRanges)
+                {
+                    return;
+                }
+
+                // With this many modifications there is nothing to gain from copying ranges.
+                if (dirtyBounds.size() >= encodedNodes.size())
+                {
+                    canCopyRanges = false;
+                    return;
+                }
+
+                try
+                {
+                    dirtyBounds.push_back(encodedIdx);
+                }
+                catch (const std::bad_alloc&)
+                {
+                    canCopyRanges = false;
+                }
+            }
+
+            void invalidateNode(const Node* node) noexcept
+            {
+                const auto encodedIdx = getEncodedIndex(node);
+                if (encodedIdx == kInvalidNodeIndex)
+                {
+                    return;
+                }
+
+                addDirtyBound(encodedIdx);
+                addDirtyBound(encodedIdx + 1);
+                encodedNodeIndex[static_cast<std::size_t>(node->getId())] = kInvalidNodeIndex;
+            }
+
+            // Nodes that were inserted or moved between two encoded nodes split the range around them.
+            void splitRangeAt(const Node* first, const Node* last) noexcept
+            {
+                if (const auto* prev = first->getPrev(); prev != nullptr)
+                {
+                    if (const auto encodedIdx = getEncodedIndex(prev); encodedIdx != kInvalidNodeIndex)
+                    {
+                        addDirtyBound(encodedIdx + 1);
+                    }
+                }
+                if (const auto* next = last->getNext(); next != nullptr)
+                {
+                    if (const auto encodedIdx = getEncodedIndex(next); encodedIdx != kInvalidNodeIndex)
+                    {
+                        addDirtyBound(encodedIdx);
+                    }
+                }
+            }
+
+            void invalidateRange(const Node* first, const Node* last) noexcept
+            {
+                for (const auto* node = first; node != nullptr; node = node->getNext())
+                {
+                    invalidateNode(node);
+                    if (node == last)
+                    {
+                        break;
+                    }
+                }
+            }
+
+            const EncoderContext::Node* getEncodedNode(const Node* node) const noexcept
+            {
+                const auto encodedIdx = getEncodedIndex(node);
+                if (encodedIdx == kInvalidNodeIndex)
+                {
+                    return nullptr;
+                }
+
+                return &encodedNodes[encodedIdx];
+            }
+        };
+
+        void IncrementalObserver::onNodeDestroy(Node* node)
+        {
+            _state.invalidateNode(node);
+        }
+
+        void IncrementalObserver::onNodeDetach(Node* node)
+        {
+            _state.invalidateNode(node);
+        }
+
+        void IncrementalObserver::onNodeInserted(Node* node)
+        {
+            _state.invalidateNode(node);
+            _state.splitRangeAt(node, node);
+        }
+
+        void IncrementalObserver::onRangeDetach(Node* first, Node* last)
+        {
+            _state.invalidateRange(first, last);
+        }
+
+        void IncrementalObserver::onRangeInserted(Node* first, Node* last)
+        {
+            _state.invalidateRange(first, last);
+            _state.splitRangeAt(first, last);
+        }
+
+        void IncrementalObserver::onRangeMoved(Node* first, Node* last)
+        {
+            _state.invalidateRange(first, last);
+            _state.splitRangeAt(first, last);
+        }
+
+    } // namespace detail
+
+    // Output of the serialization passes. The code is either written to a vector owned by the serializer, into
+    // the memory provided by a sink or in chunks to a stream, passes that only determine the layout discard it.
+    // Sinks and streams only receive the code of the final layout.
+    class CodeBuffer
+    {
+    public:
+        enum class Mode : std::uint8_t
+        {
+            Owned,
+            Sink,
+            Discard,
+            Stream,
+        };
+
+    private:
+        Mode _mode{};
+        // The entire code or the current chunk in stream mode.
+        std::vector<std::uint8_t>& _owned;
+        ICodeSink* _sink{};
+        CodeSpan _span{};
+        // Total size for sinks and when discarding, size of the flushed chunks in stream mode.
+        std::size_t _size{};
+        bool _hasFailed{};
+
+        bool ensureCapacity(std::size_t requiredSize)
+        {
+            if (requiredSize <= _span.capacity)
+            {
+                return true;
+            }
+            if (_hasFailed)
+            {
+                return false;
+            }
+
+            _span = _sink->grow(_size, requiredSize);
+            if (_span.data == nullptr || _span.capacity < requiredSize)
+            {
+                _span = {};
+                _hasFailed = true;
+                return false;
+            }
+
+            return true;
+        }
+
+    public:
+        CodeBuffer(Mode mode, ICodeSink* sink, std::vector<std::uint8_t>& storage) noexcept
+            : _mode{ mode }
+            , _owned{ storage }
+            , _sink{ sink }
+        {
+            _owned.clear();
+        }
+
+        Mode getMode() const noexcept
+        {
+            return _mode;
+        }
+
+        void setMode(Mode mode) noexcept
+        {
+            assert(mode != Mode::Sink || _sink != nullptr);
+            _mode = mode;
+        }
+
+        // Set if the sink or stream was unable to take the code, all further writes are discarded.
+        bool hasFailed() const noexcept
+        {
+            return _hasFailed;
+        }
+
+        std::size_t size() const noexcept
+        {
+            switch (_mode)
+            {
+                case Mode::Owned:
+                    return _owned.size();
+                case Mode::Stream:
+                    return _size + _owned.size();
+                default:
+                    return _size;
+            }
+        }
+
+        // Amount of bytes not yet flushed to the stream.
+        std::size_t getPendingSize() const noexcept
+        {
+            return _owned.size();
+        }
+
+        // Returns the pointer to the code at the offset, in stream mode the offset must not be flushed yet.
+        std::uint8_t* at(std::size_t offset) noexcept
+        {
+            switch (_mode)
+            {
+                case Mode::Owned:
+                    return _owned.data() + offset;
+                case Mode::Sink:
+                    return _span.data + offset;
+                case Mode::Stream:
+                    assert(offset >= _size);
+                    return _owned.data() + (offset - _size);
+                default:
+                    return nullptr;
+            }
+        }
+
+        void clear() noexcept
+        {
+            _owned.clear();
+            _size = 0;
+        }
+
+        void reserve(std::size_t size)
+        {
+            if (_mode == Mode::Owned)
+            {
+                _owned.reserve(size);
+            }
+            else if (_mode == Mode::Sink)
+            {
+                ensureCapacity(size);
+            }
+        }
+
+        void append(const std::uint8_t* data, std::size_t length)
+        {
+            switch (_mode)
+            {
+                case Mode::Owned:
+                case Mode::Stream:
+                    _owned.insert(_owned.end(), data, data + length);
+                    break;
+                case Mode::Sink:
+                    if (ensureCapacity(_size + length))
+                    {
+                        std::memcpy(_span.data + _size, data, length);
+                        _size += length;
+                    }
+                    break;
+                case Mode::Discard:
+                    _size += length;
+                    break;
+            }
+        }
+
+        // Writes the pending bytes to the stream.
+        bool flush(IStream& stream)
+        {
+            assert(_mode == Mode::Stream);
+
+            if (!_owned.empty() && stream.write(_owned.data(), _owned.size()) != _owned.size())
+            {
+                _hasFailed = true;
+            }
+
+            _size += _owned.size();
+            _owned.clear();
+
+            return !_hasFailed;
+        }
+
+        // Moves the current content into the vector, the buffer is left in an unspecified state. Returns false
+        // if the code is not available.
+        bool moveTo(std::vector<std::uint8_t>& out)
+        {
+            if (_mode == Mode::Owned)
+            {
+                std::swap(out, _owned);
+                return true;
+            }
+            return false;
+        }
+    };
+
+    class RelocationBuilder;
+
+    struct SerializeContext
+    {
+        EncoderContext& ctx;
+        CodeBuffer buffer;
+
+        // Result of the first pass, position independent instructions are not encoded again.
+        std::vector<std::uint8_t>& layoutCode;
+        std::vector<EncoderContext::Node>& layoutNodes;
+        bool hasLayout{};
+
+        // Streaming, the relocations of the nodes are built before their code is flushed.
+        IStream* stream{};
+        RelocationBuilder* relocations{};
+        std::size_t flushedNodeIndex{};
+
+        // Counters for the statistics, kept even if those are disabled.
+        std::size_t resizedNodes{};
+        std::size_t encodedInstructions{};
+        const detail::SerializerState* previous{};
+    };
+
+    static bool isLabelExternal(const detail::ProgramState& prog, Label::Id labelId) noexcept
+    {
+        const auto labelIdx = static_cast<std::size_t>(labelId);
+        if (labelIdx >= prog.labels.size())
+        {
+            return false;
+        }
+
+        const auto& entry = prog.labels[labelIdx];
+        return (entry.flags & LabelFlags::External) != LabelFlags::None;
+    }
+
+    static_assert(
+        static_cast<std::size_t>(RelocationType::Rel32) < std::tuple_size_v<decltype(SerializerStats::relocationsByType)>);
+    static_assert(
+        static_cast<std::size_t>(RelocationData::Data) < std::tuple_size_v<decltype(SerializerStats::relocationsByData)>);
+
+    // Builds the relocation entries for the encoded nodes.
+    class RelocationBuilder
+    {
+        detail::SerializerState& _serializer;
+        const detail::ProgramState& _program;
+        IStream* _stream{};
+        SerializerStats* _stats{};
+
+        // The decoder is kept by the serializer and only initialized again if the mode changes.
+        Error initDecoder()
+        {
+            auto& decoder = _serializer.decoder;
+
+            ZyanStatus decoderStatus{};
+            switch (_program.mode)
+            {
+                case MachineMode::I386:
+                    decoderStatus = ZydisDecoderInit(
+                        &decoder, ZYDIS_MACHINE_MODE_LONG_COMPAT_32, ZydisStackWidth::ZYDIS_STACK_WIDTH_32);
+                    break;
+                case MachineMode::AMD64:
+                    decoderStatus = ZydisDecoderInit(
+                        &decoder, ZYDIS_MACHINE_MODE_LONG_64, ZydisStackWidth::ZYDIS_STACK_WIDTH_64);
+                    break;
+                default:
+                    return ErrorCode::InvalidParameter;
+            }
+            if (decoderStatus != ZYAN_STATUS_SUCCESS)
+            {
+                // FIXME: Make this a better error.
+                return ErrorCode::InvalidMode;
+            }
+            _serializer.decoderMode = _program.mode;
+            _serializer.isDecoderInitialized = true;
+            return ErrorCode::None;
+        }
+
+    public:
+        // Relocations are written to the stream if one is specified instead of being kept by the serializer.
+        RelocationBuilder(
+            detail::SerializerState& serializer, const detail::ProgramState& program, IStream* stream,
+            SerializerStats* stats) noexcept
+            : _serializer{ serializer }
+            , _program{ program }
+            , _stream{ stream }
+            , _stats{ stats }
+        {
+            _serializer.relocations.clear();
+            _serializer.externalRelocations.clear();
+            _serializer.relocOffsets32.clear();
+            _serializer.relocOffsets64.clear();
+        }
+
+        Error add(const EncoderContext::Node& node, CodeBuffer& buffer);
+    };
+
+    Error RelocationBuilder::add(const EncoderContext::Node& node, CodeBuffer& buffer)
+    {
+        if (node.relocKind == RelocationType::None)
+        {
+            return ErrorCode::None;
+        }
+
+        RelocationInfo reloc;
+        reloc.kind = node.relocKind;
+        reloc.label = node.relocLabel;
+
+        bool isExternal = false;
+        if (reloc.label != Label::Id::Invalid)
+        {
+            isExternal = isLabelExternal(_program, reloc.label);
+        }
+
+        if (node.relocData == RelocationData::Data)
+        {
+            reloc.offset = node.offset;
+            reloc.address = node.address;
+            reloc.size = toBitSize(node.length * std::numeric_limits<std::uint8_t>::digits);
+        }
+        else if (node.relocSize != 0)
+        {
+            // Relative immediates are only relocated for external labels.
+            const bool isRelative = node.relocKind == RelocationType::Rel32;
+            if (isRelative && node.relocData == RelocationData::Immediate && !isExternal)
+            {
+                return ErrorCode::None;
+            }
+            if (isRelative)
+            {
+                reloc.relBaseOffset = node.length - node.relocOffset;
+            }
+
+            reloc.offset = node.offset + node.relocOffset;
+            reloc.address = node.address + node.relocOffset;
+            reloc.size = toBitSize(node.relocSize * std::numeric_limits<std::uint8_t>::digits);
+        }
+        else
+        {
+            // The decoder is only needed for instructions where the encoder could not determine the location
+            // of the relocated field.
+            if (!_serializer.isDecoderInitialized || _serializer.decoderMode != _program.mode)
+            {
+                if (auto decoderError = initDecoder(); decoderError != ErrorCode::None)
+                {
+                    return decoderError;
+                }
+            }
+
+            const std::uint8_t* data = buffer.at(node.offset);
+
+            if (_stats != nullptr)
+            {
+                _stats->decodedRelocations++;
+            }
+
+            ZydisDecodedInstruction instr{};
+
+            const auto decoderStatus = ZydisDecoderDecodeInstruction(&_serializer.decoder, nullptr, data, node.length, &instr);
+            if (decoderStatus != ZYAN_STATUS_SUCCESS)
+            {
+                // FIXME: Properly translate the error.
+                return ErrorCode::ImpossibleRelocation;
+            }
+
+            if (node.relocData == RelocationData::Immediate)
+            {
+                if (instr.raw.imm[0].is_relative == ZYAN_TRUE)
+                {
+                    if (!isExternal)
+                        return ErrorCode::None;
+
+                    reloc.relBaseOffset = instr.length - instr.raw.imm[0].offset;
+                }
+
+                reloc.offset = node.offset + instr.raw.imm[0].offset;
+                reloc.address = node.address + instr.raw.imm[0].offset;
+                reloc.size = toBitSize(instr.raw.imm[0].size);
+            }
+            else if (node.relocData == RelocationData::Memory)
+            {
+                if (node.relocKind == RelocationType::Rel32)
+                    reloc.relBaseOffset = instr.length - instr.raw.disp.offset;
+
+                reloc.offset = node.offset + instr.raw.disp.offset;
+                reloc.address = node.address + instr.raw.disp.offset;
+                reloc.size = toBitSize(instr.raw.disp.size);
+            }
+        }
+
+        if (_stats != nullptr)
+        {
+            _stats->relocationsByType[static_cast<std::size_t>(reloc.kind)]++;
+            _stats->relocationsByData[static_cast<std::size_t>(node.relocData)]++;
+        }
+
+        if (isExternal)
+        {
+            // Zero out the temporary value to make it easier to spot unpatched values.
+            if (reloc.size == BitSize::_8)
+            {
+                std::fill_n(buffer.at(reloc.offset), sizeof(std::uint8_t), 0U);
+            }
+            else if (reloc.size == BitSize::_16)
+            {
+                std::fill_n(buffer.at(reloc.offset), sizeof(std::uint16_t), 0U);
+            }
+            else if (reloc.size == BitSize::_32)
+            {
+                std::fill_n(buffer.at(reloc.offset), sizeof(std::uint32_t), 0U);
+            }
+            else if (reloc.size == BitSize::_64)
+            {
+                std::fill_n(buffer.at(reloc.offset), sizeof(std::uint64_t), 0U);
+            }
+
+            _serializer.externalRelocations.push_back(reloc);
+        }
+        else if (_stream != nullptr)
+        {
+            if (_stream->write(reloc) != sizeof(reloc))
+            {
+                return ErrorCode::OutOfMemory;
+            }
+        }
+        else
+        {
+            _serializer.relocations.push_back(reloc);
+
+            if (reloc.size == BitSize::_32)
+            {
+                _serializer.relocOffsets32.push_back(reloc.offset);
+            }
+            else if (reloc.size == BitSize::_64)
+            {
+                _serializer.relocOffsets64.push_back(reloc.offset);
+            }
+        }
+
+        return ErrorCode::None;
+    }
+
+    // Size of the chunks written to the stream.
+    static constexpr std::size_t kStreamChunkSize = 0x10000;
+
+    // Builds the relocations of the pending nodes and writes their code to the stream.
+    static Error flushStream(SerializeContext& state)
+    {
+        auto& ctx = state.ctx;
+
+        for (auto nodeIndex = state.flushedNodeIndex; nodeIndex < ctx.nodeIndex; ++nodeIndex)
+        {
+            if (const auto status = state.relocations->add(ctx.nodes[nodeIndex], state.buffer); status != ErrorCode::None)
+            {
+                return status;
+            }
+        }
+        state.flushedNodeIndex = ctx.nodeIndex;
+
+        if (!state.buffer.flush(*state.stream))
+        {
+            return ErrorCode::OutOfMemory;
+        }
+
+        return ErrorCode::None;
+    }
+
+    static Error serializeNode(
+        [[maybe_unused]] detail::ProgramState& program, SerializeContext& state, [[maybe_unused]] const Sentinel& node)
+    {
+        auto& ctx = state.ctx;
+
+        auto& nodeEntry = ctx.nodes[ctx.nodeIndex];
+        nodeEntry.offset = ctx.offset;
+        nodeEntry.address = ctx.va;
+        ctx.nodeIndex++;
+
+        return ErrorCode::None;
+    }
+
+    static constexpr auto kX86NopTable = std::array<std::array<std::uint8_t, 8>, 9>{ {
+        {},
+        { 0x90 },
+        { 0x66, 0x90 },
+        { 0x0f, 0x1f, 0x00 },
+        { 0x0f, 0x1f, 0x40, 0x00 },
+        { 0x0f, 0x1f, 0x44, 0x00, 0x00 },
+        { 0x66, 0x0f, 0x1f, 0x44, 0x00, 0x00 },
+        { 0x0f, 0x1f, 0x80, 0x00, 0x00, 0x00, 0x00 },
+        { 0x0f, 0x1f, 0x84, 0x00, 0x00, 0x00, 0x00, 0x00 },
+    } };
+
+    static constexpr auto kX86AlignTable = std::array<std::array<std::uint8_t, 8>, 9>{ {
+        {},
+        { 0xCC },
+        { 0xCC, 0xCC },
+        { 0xCC, 0xCC, 0xCC },
+        { 0xCC, 0xCC, 0xCC, 0xCC },
+        { 0xCC, 0xCC, 0xCC, 0xCC, 0xCC },
+        { 0xCC, 0xCC, 0xCC, 0xCC, 0xCC, 0xCC },
+        { 0xCC, 0xCC, 0xCC, 0xCC, 0xCC, 0xCC, 0xCC },
+        { 0xCC, 0xCC, 0xCC, 0xCC, 0xCC, 0xCC, 0xCC, 0xCC },
+    } };
+
+    static Error serializeNode([[maybe_unused]] detail::ProgramState& program, SerializeContext& state, const Align& node)
+    {
+        auto& ctx = state.ctx;
+
+        auto& nodeEntry = ctx.nodes[ctx.nodeIndex];
+        ctx.nodeIndex++;
+
+        nodeEntry.offset = ctx.offset;
+        nodeEntry.address = ctx.va;
+
+        const auto& table = std::invoke([&]() {
+            // TODO: Add support for different modes one day.
+            if (node.getType() == Align::Type::Code)
+                return kX86NopTable;
+            else
+                return kX86AlignTable;
+        });
+
+        const auto alignedVA = math::alignTo<std::int64_t>(ctx.va, node.getAlign());
+
+        assert(alignedVA - ctx.va < std::numeric_limits<std::int32_t>::max());
+        const auto alignSize = static_cast<std::int32_t>(alignedVA - ctx.va);
+
+        for (auto alignBytesMissing = alignSize; alignBytesMissing > 0;)
+        {
+            const auto tableSize = static_cast<std::int32_t>(table.size());
+            const auto dataIndex = std::min<std::int32_t>(tableSize - 1, alignBytesMissing);
+            const auto& dataEntry = table[dataIndex];
+
+            state.buffer.append(dataEntry.data(), dataIndex);
+
+            alignBytesMissing -= dataIndex;
+        }
+
+        if (nodeEntry.length != 0 && nodeEntry.length != alignSize)
+        {
+            ctx.needsExtraPass = true;
+            state.resizedNodes++;
+        }
+        nodeEntry.length = alignSize;
+
+        auto& sect = ctx.sections[ctx.sectionIndex];
+        sect.rawSize += alignSize;
+
+        ctx.va += alignSize;
+        ctx.offset += alignSize;
+
+        return ErrorCode::None;
+    }
+
+    static Error serializeNode(const detail::ProgramState& prog, SerializeContext& state, const Instruction& instr)
+    {
+        auto& ctx = state.ctx;
+
+        auto res = encode(state.ctx, prog.mode, instr);
+        if (!res)
+        {
+            return res.error();
+        }
+        state.encodedInstructions++;
+
+        {
+            auto& nodeEntry = ctx.nodes[ctx.nodeIndex];
+            ctx.nodeIndex++;
+
+            if (nodeEntry.length != 0 && res->buffer.length != nodeEntry.length)
+            {
+                ctx.needsExtraPass = true;
+                state.resizedNodes++;
+            }
+            nodeEntry.length = res->buffer.length;
+            nodeEntry.offset = ctx.offset;
+            nodeEntry.address = ctx.va;
+            nodeEntry.relocKind = res->relocKind;
+            nodeEntry.relocData = res->relocData;
+            nodeEntry.relocLabel = res->relocLabel;
+            nodeEntry.relocOffset = res->relocOffset;
+            nodeEntry.relocSize = res->relocSize;
+        }
+
+        auto& sect = ctx.sections[ctx.sectionIndex];
+        sect.rawSize += res->buffer.length;
+
+        ctx.va += res->buffer.length;
+        ctx.offset += res->buffer.length;
+
+        state.buffer.append(res->buffer.data.data(), res->buffer.length);
+
+        return ErrorCode::None;
+    }
+
+    static Error serializeNode(const detail::ProgramState& prog, SerializeContext& state, const Label& label)
+    {
+        if (!label.isValid())
+        {
+            return ErrorCode::InvalidLabel;
+        }
+
+        auto& ctx = state.ctx;
+
+        auto& nodeEntry = ctx.nodes[ctx.nodeIndex];
+        ctx.nodeIndex++;
+
+        nodeEntry.length = 0;
+        nodeEntry.offset = ctx.offset;
+        nodeEntry.address = ctx.va;
+
+        const auto labelIdx = static_cast<std::size_t>(label.getId());
+        if (labelIdx >= prog.labels.size())
+        {
+            return ErrorCode::LabelNotFound;
+        }
+
+        // Users of the label may have been encoded with the address from the previous pass.
+        if (const auto prevVA = ctx.getLabelAddress(label.getId()); prevVA.has_value() && *prevVA != ctx.va)
+        {
+            ctx.needsExtraPass = true;
+        }
+
+        auto& linkEntry = state.ctx.getOrCreateLabelLink(label.getId());
+        linkEntry.boundOffset = ctx.offset;
+        linkEntry.boundVA = ctx.va;
+
+        return ErrorCode::None;
+    }
+
+    static bool isSameSection(const EncoderSection& lhs, const EncoderSection& rhs) noexcept
+    {
+        return lhs.nameId == rhs.nameId && lhs.attribs == rhs.attribs && lhs.align == rhs.align;
+    }
+
+    static void finalizeCurSection(SerializeContext& state) noexcept
+    {
+        auto& ctx = state.ctx;
+
+        auto& curSection = ctx.sections[ctx.sectionIndex];
+
+        // Final virtual size.
+        curSection.virtualSize = math::alignTo<std::int64_t>(curSection.rawSize, curSection.align);
+
+        // Align current address.
+        ctx.va = math::alignTo<int64_t>(ctx.va, curSection.align);
+    }
+
+    static Error serializeNode(const detail::ProgramState& prog, SerializeContext& state, const Section& section)
+    {
+        auto& ctx = state.ctx;
+
+        const auto sectionIndex = static_cast<std::size_t>(section.getId());
+        if (sectionIndex >= prog.sections.size())
+        {
+            return ErrorCode::SectionNotFound;
+        }
+
+        const auto& sectionData = prog.sections[sectionIndex];
+
+        auto& curSection = ctx.sections[ctx.sectionIndex];
+
+        // Check if sections should be merged.
+        EncoderSection newSect{};
+        newSect.attribs = sectionData.attribs;
+        newSect.nameId = sectionData.nameId;
+        newSect.align = sectionData.align;
+
+        if (!isSameSection(curSection, newSect))
+        {
+            // Finish this section.
+            finalizeCurSection(state);
+
+            // Add new section.
+            newSect.index = static_cast<int32_t>(ctx.sections.size());
+            newSect.offset = ctx.offset;
+            newSect.address = ctx.va;
+
+            ctx.sections.push_back(newSect);
+            ctx.sectionIndex++;
+        }
+
+        auto& nodeEntry = ctx.nodes[ctx.nodeIndex];
+        ctx.nodeIndex++;
+
+        nodeEntry.length = 0;
+        nodeEntry.offset = ctx.offset;
+        nodeEntry.address = ctx.va;
+
+        return ErrorCode::None;
+    }
+
+    static Error serializeNode([[maybe_unused]] const detail::ProgramState& program, SerializeContext& state, const Data& data)
+    {
+        auto& ctx = state.ctx;
+
+        const auto* ptr = static_cast<const uint8_t*>(data.getData());
+        const auto totalSize = static_cast<int32_t>(data.getTotalSize());
+
+        auto& nodeEntry = ctx.nodes[ctx.nodeIndex];
+        ctx.nodeIndex++;
+
+        nodeEntry.offset = ctx.offset;
+        nodeEntry.address = ctx.va;
+        nodeEntry.length = totalSize;
+
+        ctx.va += totalSize;
+        ctx.offset += totalSize;
+
+        auto& sect = ctx.sections[ctx.sectionIndex];
+        sect.rawSize += totalSize;
+
+        auto& buffer = state.buffer;
+        buffer.reserve(buffer.size() + totalSize);
+
+        const auto dataSize = data.getSize();
+        for (std::size_t i = 0; i < data.getRepeatCount(); ++i)
+        {
+            buffer.append(ptr, dataSize);
+        }
+
+        return ErrorCode::None;
+    }
+
+    static Error serializeNode(const detail::ProgramState& program, SerializeContext& state, const EmbeddedLabel& data)
+    {
+        auto& ctx = state.ctx;
+
+        std::int32_t byteSize = 0;
+        std::int64_t labelAddr = 0;
+
+        const auto label = data.getLabel();
+        if (auto addr = state.ctx.getLabelAddress(label.getId()); addr.has_value())
+        {
+            labelAddr = *addr;
+        }
+        else
+        {
+            if (!isLabelExternal(program, label.getId()))
+            {
+                ctx.needsExtraPass = true;
+            }
+        }
+
+        if (data.isRelative() && !ctx.needsExtraPass)
+        {
+            const auto relLabel = data.getRelativeLabel();
+            if (auto addr = ctx.getLabelAddress(relLabel.getId()); addr.has_value())
+            {
+                labelAddr -= *addr;
+            }
+            else
+            {
+                ctx.needsExtraPass = true;
+            }
+        }
+
+        std::array<std::uint8_t, sizeof(std::uint64_t)> tempBuf{};
+        RelocationType relocKind = RelocationType::Abs;
+
+        const auto absValue = std::abs(labelAddr);
+        if (data.getSize() == BitSize::_8)
+        {
+            if (!ctx.needsExtraPass && absValue >= std::numeric_limits<std::uint8_t>::max())
+            {
+                return ErrorCode::InvalidLabel;
+            }
+            const auto rawValue = static_cast<std::int8_t>(labelAddr);
+            std::memcpy(tempBuf.data(), &rawValue, sizeof(rawValue));
+            byteSize = sizeof(rawValue);
+        }
+        else if (data.getSize() == BitSize::_16)
+        {
+            if (!ctx.needsExtraPass && absValue >= std::numeric_limits<std::uint16_t>::max())
+            {
+                return ErrorCode::InvalidLabel;
+            }
+            const auto rawValue = static_cast<std::int16_t>(labelAddr);
+            std::memcpy(tempBuf.data(), &rawValue, sizeof(rawValue));
+            byteSize = sizeof(rawValue);
+        }
+        else if (data.getSize() == BitSize::_32)
+        {
+            if (!ctx.needsExtraPass && absValue >= std::numeric_limits<std::uint32_t>::max())
+            {
+                return ErrorCode::InvalidLabel;
+            }
+            const auto rawValue = static_cast<std::int32_t>(labelAddr);
+            std::memcpy(tempBuf.data(), &rawValue, sizeof(rawValue));
+            byteSize = sizeof(rawValue);
+        }
+        else if (data.getSize() == BitSize::_64)
+        {
+            const auto rawValue = static_cast<std::int64_t>(labelAddr);
+            std::memcpy(tempBuf.data(), &rawValue, sizeof(rawValue));
+            byteSize = sizeof(rawValue);
+        }
+        else
+        {
+            return ErrorCode::InvalidOperation;
+        }
+
+        auto& nodeEntry = ctx.nodes[ctx.nodeIndex];
+        ctx.nodeIndex++;
 
-        struct SerializerState
+        nodeEntry.offset = ctx.offset;
+        nodeEntry.address = ctx.va;
+        nodeEntry.length = byteSize;
+
+        if (!data.isRelative())
         {
-            std::int64_t base{};
-            std::vector<SectionInfo> sections;
-            std::vector<std::uint8_t> code;
-            std::vector<RelocationInfo> relocations;
-            std::vector<RelocationInfo> externalRelocations;
-            std::vector<LabelInfo> labels;
-        };
+            // Needs to be relocatable if this is an absolute label.
+            nodeEntry.relocKind = relocKind;
+            nodeEntry.relocData = RelocationData::Data;
+            nodeEntry.relocLabel = label.getId();
+        }
 
-    } // namespace detail
+        ctx.va += byteSize;
+        ctx.offset += byteSize;
 
-    struct SerializeContext
-    {
-        EncoderContext& ctx;
-        std::vector<std::uint8_t> buffer;
-    };
+        auto& sect = ctx.sections[ctx.sectionIndex];
+        sect.rawSize += byteSize;
 
-    static bool isLabelExternal(const detail::ProgramState& prog, Label::Id labelId) noexcept
+        state.buffer.append(tempBuf.data(), byteSize);
+
+        return ErrorCode::None;
+    }
+
+    static bool hasLabelMoved(const detail::SerializerState& previous, EncoderContext& ctx, Label::Id labelId)
     {
         const auto labelIdx = static_cast<std::size_t>(labelId);
-        if (labelIdx >= prog.labels.size())
+
+        auto previousAddress = detail::LabelInfo::kUnboundAddress;
+        if (labelIdx < previous.labels.size())
         {
-            return false;
+            previousAddress = previous.labels[labelIdx].boundAddress;
         }
 
-        const auto& entry = prog.labels[labelIdx];
-        return (entry.flags & LabelFlags::External) != LabelFlags::None;
+        return ctx.getLabelAddress(labelId).value_or(detail::LabelInfo::kUnboundAddress) != previousAddress;
     }
 
-    static Error serializeNode(
-        [[maybe_unused]] detail::ProgramState& program, SerializeContext& state, [[maybe_unused]] const Sentinel& node)
+    static bool hasLabelMoved(const detail::SerializerState& previous, EncoderContext& ctx, const Instruction& instr)
     {
-        auto& ctx = state.ctx;
-
-        auto& nodeEntry = ctx.nodes[ctx.nodeIndex];
-        nodeEntry.offset = ctx.offset;
-        nodeEntry.address = ctx.va;
-        ctx.nodeIndex++;
+        const auto& ops = instr.getOperands();
+        for (std::size_t i = 0; i < instr.getOperandCount(); ++i)
+        {
+            auto labelId = Label::Id::Invalid;
+            if (const auto* label = ops[i].getIf<Label>(); label != nullptr)
+            {
+                labelId = label->getId();
+            }
+            else if (const auto* mem = ops[i].getIf<Mem>(); mem != nullptr)
+            {
+                labelId = mem->getLabelId();
+            }
 
-        return ErrorCode::None;
+            if (labelId != Label::Id::Invalid && hasLabelMoved(previous, ctx, labelId))
+            {
+                return true;
+            }
+        }
+        return false;
     }
 
-    static constexpr auto kX86NopTable = std::array<std::array<std::uint8_t, 8>, 9>{ {
-        {},
-        { 0x90 },
-        { 0x66, 0x90 },
-        { 0x0f, 0x1f, 0x00 },
-        { 0x0f, 0x1f, 0x40, 0x00 },
-        { 0x0f, 0x1f, 0x44, 0x00, 0x00 },
-        { 0x66, 0x0f, 0x1f, 0x44, 0x00, 0x00 },
-        { 0x0f, 0x1f, 0x80, 0x00, 0x00, 0x00, 0x00 },
-        { 0x0f, 0x1f, 0x84, 0x00, 0x00, 0x00, 0x00, 0x00 },
-    } };
-
-    static constexpr auto kX86AlignTable = std::array<std::array<std::uint8_t, 8>, 9>{ {
-        {},
-        { 0xCC },
-        { 0xCC, 0xCC },
-        { 0xCC, 0xCC, 0xCC },
-        { 0xCC, 0xCC, 0xCC, 0xCC },
-        { 0xCC, 0xCC, 0xCC, 0xCC, 0xCC },
-        { 0xCC, 0xCC, 0xCC, 0xCC, 0xCC, 0xCC },
-        { 0xCC, 0xCC, 0xCC, 0xCC, 0xCC, 0xCC, 0xCC },
-        { 0xCC, 0xCC, 0xCC, 0xCC, 0xCC, 0xCC, 0xCC, 0xCC },
-    } };
-
-    static Error serializeNode([[maybe_unused]] detail::ProgramState& program, SerializeContext& state, const Align& node)
+    static void copyEncodedNode(SerializeContext& state, const EncoderContext::Node& encodedNode, const std::uint8_t* code)
     {
         auto& ctx = state.ctx;
 
+        const auto* data = code + encodedNode.offset;
+        const auto length = encodedNode.length;
+
         auto& nodeEntry = ctx.nodes[ctx.nodeIndex];
         ctx.nodeIndex++;
 
+        if (nodeEntry.length != 0 && length != nodeEntry.length)
+        {
+            ctx.needsExtraPass = true;
+            state.resizedNodes++;
+        }
+        nodeEntry.length = length;
         nodeEntry.offset = ctx.offset;
         nodeEntry.address = ctx.va;
+        nodeEntry.relocKind = encodedNode.relocKind;
+        nodeEntry.relocData = encodedNode.relocData;
+        nodeEntry.relocLabel = encodedNode.relocLabel;
+        nodeEntry.relocOffset = encodedNode.relocOffset;
+        nodeEntry.relocSize = encodedNode.relocSize;
 
-        const auto& table = std::invoke([&]() {
-            // TODO: Add support for different modes one day.
-            if (node.getType() == Align::Type::Code)
-                return kX86NopTable;
-            else
-                return kX86AlignTable;
-        });
+        auto& sect = ctx.sections[ctx.sectionIndex];
+        sect.rawSize += length;
 
-        const auto alignedVA = math::alignTo<std::int64_t>(ctx.va, node.getAlign());
+        ctx.va += length;
+        ctx.offset += length;
 
-        assert(alignedVA - ctx.va < std::numeric_limits<std::int32_t>::max());
-        const auto alignSize = static_cast<std::int32_t>(alignedVA - ctx.va);
+        state.buffer.append(data, length);
+    }
 
-        for (auto alignBytesMissing = alignSize; alignBytesMissing > 0;)
+    // Copies the encoding of an instruction from the first pass or from the previous serialization if it
+    // is still valid at the current address.
+    static bool reuseEncodedNode(SerializeContext& state, const Node* node)
+    {
+        const auto* instr = node->getIf<Instruction>();
+        if (instr == nullptr)
         {
-            const auto tableSize = static_cast<std::int32_t>(table.size());
-            const auto dataIndex = std::min<std::int32_t>(tableSize - 1, alignBytesMissing);
-            const auto& dataEntry = table[dataIndex];
+            return false;
+        }
 
-            auto& buffer = state.buffer;
-            buffer.insert(buffer.end(), std::begin(dataEntry), std::begin(dataEntry) + dataIndex);
+        auto& ctx = state.ctx;
 
-            alignBytesMissing -= dataIndex;
+        const bool addressDependent = isAddressDependent(*instr);
+        if (!addressDependent && state.hasLayout)
+        {
+            copyEncodedNode(state, state.layoutNodes[ctx.nodeIndex], state.layoutCode.data());
+            return true;
         }
 
-        if (nodeEntry.length != 0 && nodeEntry.length != alignSize)
+        if (state.previous == nullptr)
         {
-            ctx.needsExtraPass = true;
+            return false;
         }
-        nodeEntry.length = alignSize;
-
-        auto& sect = ctx.sections[ctx.sectionIndex];
-        sect.rawSize += alignSize;
 
-        ctx.va += alignSize;
-        ctx.offset += alignSize;
-
-        return ErrorCode::None;
-    }
-
-    static Error serializeNode(const detail::ProgramState& prog, SerializeContext& state, const Instruction& instr)
-    {
-        auto& ctx = state.ctx;
+        const auto& previous = *state.previous;
 
-        auto res = encode(state.ctx, prog.mode, instr);
-        if (!res)
+        const auto* encodedNode = previous.getEncodedNode(node);
+        if (encodedNode == nullptr)
         {
-            return res.error();
+            return false;
         }
 
+        if (addressDependent)
         {
-            auto& nodeEntry = ctx.nodes[ctx.nodeIndex];
-            ctx.nodeIndex++;
-
-            if (nodeEntry.length != 0 && res->buffer.length != nodeEntry.length)
+            if (encodedNode->address != ctx.va || hasLabelMoved(previous, ctx, *instr))
             {
-                ctx.needsExtraPass = true;
+                return false;
             }
-            nodeEntry.length = res->buffer.length;
-            nodeEntry.offset = ctx.offset;
-            nodeEntry.address = ctx.va;
-            nodeEntry.relocKind = res->relocKind;
-            nodeEntry.relocData = res->relocData;
-            nodeEntry.relocLabel = res->relocLabel;
         }
 
-        auto& sect = ctx.sections[ctx.sectionIndex];
-        sect.rawSize += res->buffer.length;
-
-        ctx.va += res->buffer.length;
-        ctx.offset += res->buffer.length;
-
-        auto& buffer = state.buffer;
-        buffer.insert(buffer.end(), std::begin(res->buffer.data), std::begin(res->buffer.data) + res->buffer.length);
-
-        return ErrorCode::None;
+        copyEncodedNode(state, *encodedNode, previous.code.data());
+        return true;
     }
 
-    static Error serializeNode(const detail::ProgramState& prog, SerializeContext& state, const Label& label)
+    // Nodes that are serialized one by one when the program is serialized again, the encoding of everything
+    // else does not depend on its position and is copied in ranges.
+    static bool isSingleNode(const Node& node)
     {
-        if (!label.isValid())
+        if (node.holds<Sentinel>())
         {
-            return ErrorCode::InvalidLabel;
+            return false;
         }
 
+        const auto* instr = node.getIf<Instruction>();
+        return instr == nullptr || isAddressDependent(*instr);
+    }
+
+    // Copies the encoded nodes from first up to last of the previous serialization as a single block, the
+    // entries are moved by the difference to the current offset and address.
+    static void copyEncodedRange(
+        SerializeContext& state, const detail::SerializerState& previous, std::size_t first, std::size_t last)
+    {
         auto& ctx = state.ctx;
 
-        auto& nodeEntry = ctx.nodes[ctx.nodeIndex];
-        ctx.nodeIndex++;
+        const auto count = last - first;
+        assert(ctx.nodeIndex + count <= ctx.nodes.size());
 
-        nodeEntry.length = 0;
-        nodeEntry.offset = ctx.offset;
-        nodeEntry.address = ctx.va;
+        const auto* encodedNodes = previous.encodedNodes.data();
+        const auto encodedOffset = encodedNodes[first].offset;
+        const auto length = encodedNodes[last - 1].offset + encodedNodes[last - 1].length - encodedOffset;
+        const auto offsetDelta = ctx.offset - encodedOffset;
+        const auto addressDelta = ctx.va - encodedNodes[first].address;
 
-        const auto labelIdx = static_cast<std::size_t>(label.getId());
-        if (labelIdx >= prog.labels.size())
+        auto* nodeEntries = ctx.nodes.data() + ctx.nodeIndex;
+        std::copy(encodedNodes + first, encodedNodes + last, nodeEntries);
+        if (offsetDelta != 0 || addressDelta != 0)
         {
-            return ErrorCode::LabelNotFound;
+            for (std::size_t i = 0; i < count; ++i)
+            {
+                nodeEntries[i].offset += offsetDelta;
+                nodeEntries[i].address += addressDelta;
+            }
         }
+        ctx.nodeIndex += count;
 
-        auto& linkEntry = state.ctx.getOrCreateLabelLink(label.getId());
-        linkEntry.boundOffset = ctx.offset;
-        linkEntry.boundVA = ctx.va;
+        auto& sect = ctx.sections[ctx.sectionIndex];
+        sect.rawSize += length;
 
-        return ErrorCode::None;
-    }
+        ctx.va += length;
+        ctx.offset += length;
 
-    static bool isSameSection(const EncoderSection& lhs, const EncoderSection& rhs) noexcept
-    {
-        return lhs.nameId == rhs.nameId && lhs.attribs == rhs.attribs && lhs.align == rhs.align;
+        state.buffer.append(previous.code.data() + encodedOffset, length);
     }
 
-    static void finalizeCurSection(SerializeContext& state) noexcept
-    {
-        auto& ctx = state.ctx;
-
-        auto& curSection = ctx.sections[ctx.sectionIndex];
+    // After this many iterations branches are only allowed to grow which guarantees termination.
+    static constexpr std::int32_t kMaxShrinkIterations = 16;
 
-        // Final virtual size.
-        curSection.virtualSize = math::alignTo<std::int64_t>(curSection.rawSize, curSection.align);
+    static bool getBranchItem(
+        const detail::ProgramState& prog, const Instruction& instr, std::int32_t length, LayoutItem& item) noexcept
+    {
+        const auto& encodeInfo = getEncodeVariantInfo(instr);
+        if (!encodeInfo.isControlFlow || !encodeInfo.canEncodeRel8() || !encodeInfo.canEncodeRel32())
+        {
+            return false;
+        }
 
-        // Align current address.
-        ctx.va = math::alignTo<int64_t>(ctx.va, curSection.align);
-    }
+        const auto opIndex = static_cast<std::size_t>(encodeInfo.cfOperandIndex);
+        if (opIndex >= instr.getOperandCount())
+        {
+            return false;
+        }
 
-    static Error serializeNode(const detail::ProgramState& prog, SerializeContext& state, const Section& section)
-    {
-        auto& ctx = state.ctx;
+        const auto& op = instr.getOperands()[opIndex];
+        if (const auto* label = op.getIf<Label>(); label != nullptr)
+        {
+            if (isLabelExternal(prog, label->getId()))
+            {
+                return false;
+            }
+            item.label = label->getId();
+        }
+        else if (const auto* imm = op.getIf<Imm>(); imm != nullptr)
+        {
+            item.target = imm->value<std::int64_t>();
+        }
+        else
+        {
+            return false;
+        }
 
-        const auto sectionIndex = static_cast<std::size_t>(section.getId());
-        if (sectionIndex >= prog.sections.size())
+        // Prefixes are part of both forms.
+        const auto prefixSize = length
+            - (length >= encodeInfo.encodeSizeRel32 ? encodeInfo.encodeSizeRel32 : encodeInfo.encodeSizeRel8);
+        if (prefixSize < 0)
         {
-            return ErrorCode::SectionNotFound;
+            return false;
         }
 
-        const auto& sectionData = prog.sections[sectionIndex];
+        item.kind = LayoutItem::Kind::Branch;
+        item.length = length;
+        item.sizeRel8 = encodeInfo.encodeSizeRel8 + prefixSize;
+        item.sizeRel32 = encodeInfo.encodeSizeRel32 + prefixSize;
 
-        auto& curSection = ctx.sections[ctx.sectionIndex];
+        return true;
+    }
 
-        // Check if sections should be merged.
-        EncoderSection newSect{};
-        newSect.attribs = sectionData.attribs;
-        newSect.nameId = sectionData.nameId;
-        newSect.align = sectionData.align;
+    static void buildLayout(
+        const detail::ProgramState& prog, const EncoderContext& ctx, const EncoderSection& defaultSect, const Node* first,
+        const Node* lastNode, std::vector<LayoutItem>& items)
+    {
+        items.clear();
 
-        if (!isSameSection(curSection, newSect))
+        EncoderSection curSect = defaultSect;
+
+        const auto addItem = [&](const LayoutItem& item) {
+            if (item.kind == LayoutItem::Kind::Fixed && !items.empty() && items.back().kind == LayoutItem::Kind::Fixed)
+            {
+                items.back().length += item.length;
+                return;
+            }
+            items.push_back(item);
+        };
+
+        std::size_t nodeIndex = 0;
+        for (const auto* node = first; node != lastNode; node = node->getNext(), ++nodeIndex)
         {
-            // Finish this section.
-            finalizeCurSection(state);
+            LayoutItem item{};
+            item.nodeIndex = nodeIndex;
+            item.length = ctx.nodes[nodeIndex].length;
 
-            // Add new section.
-            newSect.index = static_cast<int32_t>(ctx.sections.size());
-            newSect.offset = ctx.offset;
-            newSect.address = ctx.va;
+            if (const auto* label = node->getIf<Label>(); label != nullptr)
+            {
+                item.kind = LayoutItem::Kind::Label;
+                item.label = label->getId();
+            }
+            else if (const auto* align = node->getIf<Align>(); align != nullptr)
+            {
+                item.kind = LayoutItem::Kind::Align;
+                item.align = align->getAlign();
+            }
+            else if (const auto* section = node->getIf<Section>(); section != nullptr)
+            {
+                const auto& sectionData = prog.sections[static_cast<std::size_t>(section->getId())];
 
-            ctx.sections.push_back(newSect);
-            ctx.sectionIndex++;
-        }
+                EncoderSection newSect{};
+                newSect.attribs = sectionData.attribs;
+                newSect.nameId = sectionData.nameId;
+                newSect.align = sectionData.align;
 
-        auto& nodeEntry = ctx.nodes[ctx.nodeIndex];
-        ctx.nodeIndex++;
+                if (isSameSection(curSect, newSect))
+                {
+                    continue;
+                }
 
-        nodeEntry.length = 0;
-        nodeEntry.offset = ctx.offset;
-        nodeEntry.address = ctx.va;
+                item.kind = LayoutItem::Kind::Section;
+                item.align = curSect.align;
+
+                curSect = newSect;
+            }
+            else if (const auto* instr = node->getIf<Instruction>(); instr != nullptr)
+            {
+                if (!getBranchItem(prog, *instr, item.length, item))
+                {
+                    item.kind = LayoutItem::Kind::Fixed;
+                }
+            }
+            else
+            {
+                item.kind = LayoutItem::Kind::Fixed;
+            }
 
-        return ErrorCode::None;
+            addItem(item);
+        }
     }
 
-    static Error serializeNode([[maybe_unused]] const detail::ProgramState& program, SerializeContext& state, const Data& data)
+    // Iterates the layout until the size of all branches and the address of all labels are stable, this
+    // only touches the layout items and does not encode anything.
+    static void relaxLayout(EncoderContext& ctx, std::int64_t base, std::vector<LayoutItem>& items)
     {
-        auto& ctx = state.ctx;
+        for (std::int32_t iteration = 0;; ++iteration)
+        {
+            bool hasChanged = false;
 
-        const auto* ptr = static_cast<const uint8_t*>(data.getData());
-        const auto totalSize = static_cast<int32_t>(data.getTotalSize());
+            std::int64_t va = base;
+            std::int32_t offset = 0;
 
-        auto& nodeEntry = ctx.nodes[ctx.nodeIndex];
-        ctx.nodeIndex++;
+            for (auto& item : items)
+            {
+                switch (item.kind)
+                {
+                    case LayoutItem::Kind::Fixed:
+                        break;
+                    case LayoutItem::Kind::Align:
+                        item.length = static_cast<std::int32_t>(math::alignTo<std::int64_t>(va, item.align) - va);
+                        break;
+                    case LayoutItem::Kind::Section:
+                        va = math::alignTo<std::int64_t>(va, item.align);
+                        break;
+                    case LayoutItem::Kind::Label:
+                    {
+                        auto& linkEntry = ctx.getOrCreateLabelLink(item.label);
+                        if (linkEntry.boundVA != va)
+                        {
+                            linkEntry.boundVA = va;
+                            hasChanged = true;
+                        }
+                        linkEntry.boundOffset = offset;
+                        break;
+                    }
+                    case LayoutItem::Kind::Branch:
+                    {
+                        auto target = item.target;
+                        if (item.label != Label::Id::Invalid)
+                        {
+                            target = ctx.getOrCreateLabelLink(item.label).boundVA;
+                        }
+
+                        const auto rel = target - (va + item.sizeRel8);
+                        const bool isShort = rel >= std::numeric_limits<std::int8_t>::min()
+                            && rel <= std::numeric_limits<std::int8_t>::max();
+
+                        auto newLength = isShort ? item.sizeRel8 : item.sizeRel32;
+                        if (iteration >= kMaxShrinkIterations)
+                        {
+                            newLength = std::max(newLength, item.length);
+                        }
+
+                        if (newLength != item.length)
+                        {
+                            item.length = newLength;
+                            hasChanged = true;
+                        }
+                        break;
+                    }
+                }
 
-        nodeEntry.offset = ctx.offset;
-        nodeEntry.address = ctx.va;
-        nodeEntry.length = totalSize;
+                va += item.length;
+                offset += item.length;
+            }
 
-        ctx.va += totalSize;
-        ctx.offset += totalSize;
+            if (!hasChanged)
+            {
+                break;
+            }
+        }
 
-        auto& sect = ctx.sections[ctx.sectionIndex];
-        sect.rawSize += totalSize;
+        // Apply the sizes so the next pass can detect if the layout did not hold.
+        for (const auto& item : items)
+        {
+            if (item.kind == LayoutItem::Kind::Align || item.kind == LayoutItem::Kind::Branch)
+            {
+                ctx.nodes[item.nodeIndex].length = item.length;
+            }
+        }
+    }
 
-        auto& buffer = state.buffer;
-        buffer.reserve(buffer.size() + totalSize);
+    // Chunks smaller than this are not worth the overhead of a worker.
+    static constexpr std::size_t kMinChunkSize = 64;
 
-        const auto dataSize = data.getSize();
-        for (std::size_t i = 0; i < data.getRepeatCount(); ++i)
+    static detail::EncodeChunk& addChunk(detail::SerializerState& serializer, const Node* first, std::size_t nodeIndex)
+    {
+        if (serializer.chunkCount >= serializer.chunks.size())
         {
-            std::copy_n(ptr, dataSize, std::back_inserter(buffer));
+            serializer.chunks.emplace_back();
         }
 
-        return ErrorCode::None;
+        auto& chunk = serializer.chunks[serializer.chunkCount++];
+        chunk.first = first;
+        chunk.lastNode = nullptr;
+        chunk.nodeIndex = nodeIndex;
+        chunk.nodeCount = 0;
+        chunk.code.clear();
+
+        return chunk;
     }
 
-    static Error serializeNode(const detail::ProgramState& program, SerializeContext& state, const EmbeddedLabel& data)
+    // Splits the range at section nodes, sections larger than the share of a single thread are split further.
+    static void splitChunks(
+        detail::SerializerState& serializer, const Node* first, const Node* lastNode, std::size_t nodeCount)
     {
-        auto& ctx = state.ctx;
+        serializer.chunkCount = 0;
 
-        std::int32_t byteSize = 0;
-        std::int64_t labelAddr = 0;
+        const auto maxChunkSize = std::max(kMinChunkSize, nodeCount / serializer.threadCount);
 
-        const auto label = data.getLabel();
-        if (auto addr = state.ctx.getLabelAddress(label.getId()); addr.has_value())
-        {
-            labelAddr = *addr;
-        }
-        else
-        {
-            if (!isLabelExternal(program, label.getId()))
-            {
-                ctx.needsExtraPass = true;
-            }
-        }
+        auto* chunk = &addChunk(serializer, first, 0);
 
-        if (data.isRelative() && !ctx.needsExtraPass)
+        std::size_t nodeIndex = 0;
+        for (const auto* node = first; node != lastNode; node = node->getNext(), ++nodeIndex)
         {
-            const auto relLabel = data.getRelativeLabel();
-            if (auto addr = ctx.getLabelAddress(relLabel.getId()); addr.has_value())
-            {
-                labelAddr -= *addr;
-            }
-            else
+            const bool isSectionStart = node->holds<Section>() && chunk->nodeCount >= kMinChunkSize;
+            if (isSectionStart || chunk->nodeCount >= maxChunkSize)
             {
-                ctx.needsExtraPass = true;
+                chunk->lastNode = node;
+                chunk = &addChunk(serializer, node, nodeIndex);
             }
+            chunk->nodeCount++;
         }
 
-        std::array<std::uint8_t, sizeof(std::uint64_t)> tempBuf{};
-        RelocationType relocKind = RelocationType::Abs;
+        chunk->lastNode = lastNode;
+    }
 
-        const auto absValue = std::abs(labelAddr);
-        if (data.getSize() == BitSize::_8)
+    // Encodes all instructions of the chunk that do not depend on the address, everything else is left to
+    // the sequential passes.
+    static bool preEncodeChunk(
+        detail::ProgramState& prog, EncoderCache* cache, detail::EncodeChunk& chunk, std::vector<EncoderContext::Node>& nodes)
+    {
+        EncoderContext ctx{};
+        ctx.program = &prog;
+        ctx.cache = cache;
+
+        std::size_t nodeIndex = chunk.nodeIndex;
+        for (const auto* node = chunk.first; node != chunk.lastNode; node = node->getNext(), ++nodeIndex)
         {
-            if (!ctx.needsExtraPass && absValue >= std::numeric_limits<std::uint8_t>::max())
+            const auto* instr = node->getIf<Instruction>();
+            if (instr == nullptr || isAddressDependent(*instr))
             {
-                return ErrorCode::InvalidLabel;
+                continue;
             }
-            const auto rawValue = static_cast<std::int8_t>(labelAddr);
-            std::memcpy(tempBuf.data(), &rawValue, sizeof(rawValue));
-            byteSize = sizeof(rawValue);
-        }
-        else if (data.getSize() == BitSize::_16)
-        {
-            if (!ctx.needsExtraPass && absValue >= std::numeric_limits<std::uint16_t>::max())
+
+            auto res = encode(ctx, prog.mode, *instr);
+            if (!res)
             {
-                return ErrorCode::InvalidLabel;
+                return false;
             }
-            const auto rawValue = static_cast<std::int16_t>(labelAddr);
-            std::memcpy(tempBuf.data(), &rawValue, sizeof(rawValue));
-            byteSize = sizeof(rawValue);
+
+            auto& nodeEntry = nodes[nodeIndex];
+            nodeEntry.offset = static_cast<std::int32_t>(chunk.code.size());
+            nodeEntry.length = res->buffer.length;
+            nodeEntry.relocKind = res->relocKind;
+            nodeEntry.relocData = res->relocData;
+            nodeEntry.relocLabel = res->relocLabel;
+            nodeEntry.relocOffset = res->relocOffset;
+            nodeEntry.relocSize = res->relocSize;
+
+            chunk.code.insert(
+                chunk.code.end(), std::begin(res->buffer.data), std::begin(res->buffer.data) + res->buffer.length);
         }
-        else if (data.getSize() == BitSize::_32)
-        {
-            if (!ctx.needsExtraPass && absValue >= std::numeric_limits<std::uint32_t>::max())
+
+        return true;
+    }
+
+    // Encodes the chunks on the worker threads and stitches the results into the layout of the serialize
+    // context, the sequential passes then only have to encode the instructions that depend on an address.
+    static bool preEncodeParallel(detail::ProgramState& prog, detail::SerializerState& serializer, SerializeContext& state)
+    {
+        const auto chunkCount = serializer.chunkCount;
+        auto& chunks = serializer.chunks;
+
+        state.layoutNodes.assign(state.ctx.nodes.size(), {});
+
+        std::atomic<bool> hasFailed{};
+
+        serializer.threadPool.run(serializer.threadCount, chunkCount, [&](std::size_t idx) {
+            if (!hasFailed && !preEncodeChunk(prog, serializer.encoderCache, chunks[idx], state.layoutNodes))
             {
-                return ErrorCode::InvalidLabel;
+                hasFailed = true;
             }
-            const auto rawValue = static_cast<std::int32_t>(labelAddr);
-            std::memcpy(tempBuf.data(), &rawValue, sizeof(rawValue));
-            byteSize = sizeof(rawValue);
-        }
-        else if (data.getSize() == BitSize::_64)
+        });
+
+        // Let the sequential pass report the error.
+        if (hasFailed)
         {
-            const auto rawValue = static_cast<std::int64_t>(labelAddr);
-            std::memcpy(tempBuf.data(), &rawValue, sizeof(rawValue));
-            byteSize = sizeof(rawValue);
+            return false;
         }
-        else
+
+        std::size_t codeSize = 0;
+        for (std::size_t i = 0; i < chunkCount; ++i)
         {
-            return ErrorCode::InvalidOperation;
+            codeSize += chunks[i].code.size();
         }
 
-        auto& nodeEntry = ctx.nodes[ctx.nodeIndex];
-        ctx.nodeIndex++;
-
-        nodeEntry.offset = ctx.offset;
-        nodeEntry.address = ctx.va;
-        nodeEntry.length = byteSize;
+        auto& code = state.layoutCode;
+        code.clear();
+        code.reserve(codeSize);
 
-        if (!data.isRelative())
+        for (std::size_t i = 0; i < chunkCount; ++i)
         {
-            // Needs to be relocatable if this is an absolute label.
-            nodeEntry.relocKind = relocKind;
-            nodeEntry.relocData = RelocationData::Data;
-            nodeEntry.relocLabel = label.getId();
-        }
-
-        ctx.va += byteSize;
-        ctx.offset += byteSize;
+            const auto& chunk = chunks[i];
+            const auto chunkOffset = static_cast<std::int32_t>(code.size());
 
-        auto& sect = ctx.sections[ctx.sectionIndex];
-        sect.rawSize += byteSize;
+            for (std::size_t n = 0; n < chunk.nodeCount; ++n)
+            {
+                state.layoutNodes[chunk.nodeIndex + n].offset += chunkOffset;
+            }
 
-        auto& buffer = state.buffer;
-        buffer.insert(buffer.end(), std::begin(tempBuf), std::begin(tempBuf) + byteSize);
+            code.insert(code.end(), chunk.code.begin(), chunk.code.end());
+        }
 
-        return ErrorCode::None;
+        state.hasLayout = true;
+        return true;
     }
 
     Serializer::Serializer()
@@ -428,17 +1621,121 @@ namespace zasm
 
     Serializer& Serializer::operator=(Serializer&& other) noexcept
     {
-        _state = other._state;
-        other._state = nullptr;
+        if (this != &other)
+        {
+            delete _state;
+            _state = other._state;
+            other._state = nullptr;
+        }
 
         return *this;
     }
 
+    void Serializer::enableIncremental(Program& program)
+    {
+        auto& programState = program.getState();
+        if (_state->observedProgram == &programState)
+        {
+            return;
+        }
+
+        _state->stopObserving();
+
+        programState.observer.push_back(&_state->observer);
+        _state->observedProgram = &programState;
+    }
+
+    void Serializer::disableIncremental() noexcept
+    {
+        _state->stopObserving();
+    }
+
+    bool Serializer::isIncremental() const noexcept
+    {
+        return _state->observedProgram != nullptr;
+    }
+
+    void Serializer::invalidate(const Node* node) noexcept
+    {
+        if (node != nullptr)
+        {
+            _state->invalidateNode(node);
+        }
+    }
+
     Error Serializer::serialize(const Program& program, std::int64_t newBase)
     {
         return serialize(program, newBase, program.getHead(), program.getTail());
     }
 
+    Error Serializer::serializeRanges(
+        const Program& program, std::int64_t newBase, const SerializerRange* ranges, std::size_t rangeCount)
+    {
+        if (ranges == nullptr || rangeCount == 0)
+        {
+            return ErrorCode::InvalidParameter;
+        }
+
+        // Ranges must follow each other without gaps.
+        for (std::size_t i = 0; i < rangeCount; ++i)
+        {
+            const auto& range = ranges[i];
+            if (range.first == nullptr || range.last == nullptr)
+            {
+                return ErrorCode::InvalidParameter;
+            }
+            if (i + 1 < rangeCount && range.last->getNext() != ranges[i + 1].first)
+            {
+                return ErrorCode::InvalidParameter;
+            }
+        }
+
+        _state->chunkCount = 0;
+
+        std::size_t nodeIndex = 0;
+        for (std::size_t i = 0; i < rangeCount; ++i)
+        {
+            auto& chunk = addChunk(*_state, ranges[i].first, nodeIndex);
+            chunk.lastNode = ranges[i].last->getNext();
+
+            for (const auto* node = chunk.first; node != chunk.lastNode; node = node->getNext())
+            {
+                if (node == nullptr)
+                {
+                    return ErrorCode::InvalidParameter;
+                }
+                chunk.nodeCount++;
+            }
+            nodeIndex += chunk.nodeCount;
+        }
+
+        _state->hasUserChunks = true;
+        const auto res = serialize(program, newBase, ranges[0].first, ranges[rangeCount - 1].last);
+        _state->hasUserChunks = false;
+
+        return res;
+    }
+
+    Error Serializer::serialize(const Program& program, std::int64_t newBase, ICodeSink& sink)
+    {
+        _state->sink = &sink;
+        const auto res = serialize(program, newBase, program.getHead(), program.getTail());
+        _state->sink = nullptr;
+
+        return res;
+    }
+
+    Error Serializer::serialize(const Program& program, std::int64_t newBase, IStream& code, IStream* relocations)
+    {
+        _state->stream = &code;
+        _state->relocStream = relocations;
+        const auto res = serialize(program, newBase, program.getHead(), program.getTail());
+        _state->stream = nullptr;
+        _state->relocStream = nullptr;
+
+        return res;
+    }
+
     Error Serializer::serialize(const Program& program, std::int64_t newBase, const Node* first, const Node* last)
     {
         detail::ProgramState& programState = program.getState();
@@ -460,63 +1757,240 @@ namespace zasm
             return count;
         }();
 
-        EncoderContext encoderCtx{};
+        auto& encoderCtx = _state->encoderCtx;
+        encoderCtx.reset();
         encoderCtx.program = &program.getState();
-        encoderCtx.nodes.resize(nodeCount);
+        encoderCtx.cache = _state->encoderCache;
+        encoderCtx.nodes.assign(nodeCount, {});
         encoderCtx.baseVA = newBase;
 
-        SerializeContext state{ encoderCtx, {} };
+        // For sinks and streams only the final pass emits code, the passes before only determine the layout.
+        auto bufferMode = CodeBuffer::Mode::Owned;
+        if (_state->stream != nullptr || _state->sink != nullptr)
+        {
+            bufferMode = CodeBuffer::Mode::Discard;
+        }
+
+        SerializeContext state{
+            encoderCtx, CodeBuffer(bufferMode, _state->sink, _state->codeScratch), _state->layoutCode, _state->layoutNodes,
+        };
+
+        const bool isIncremental = _state->observedProgram == &programState;
+        if (isIncremental && _state->encodedMode == program.getMode() && !_state->encodedNodes.empty())
+        {
+            state.previous = _state;
+
+            // Use the label addresses from the previous serialization as the initial guess.
+            encoderCtx.labelHints.resize(_state->labels.size());
+            for (std::size_t i = 0; i < _state->labels.size(); ++i)
+            {
+                encoderCtx.labelHints[i] = _state->labels[i].boundAddress;
+            }
+        }
+
+        SerializerStats* stats = nullptr;
+        std::chrono::steady_clock::time_point encodeStart;
+        if (_state->isStatsEnabled)
+        {
+            stats = &_state->stats;
+            *stats = {};
+            encodeStart = std::chrono::steady_clock::now();
+        }
+
+        // Encode everything that does not depend on an address up front on the worker threads, this is
+        // not needed for incremental serialization as those nodes are copied from the previous result.
+        if (_state->threadCount > 1 && state.previous == nullptr && _state->stream == nullptr)
+        {
+            if (!_state->hasUserChunks)
+            {
+                splitChunks(*_state, first, lastNode, nodeCount);
+            }
+            if (_state->chunkCount > 1)
+            {
+                preEncodeParallel(programState, *_state, state);
+            }
+        }
+
+        std::int32_t codeDiff = 0;
+        std::int32_t codeSize = 0;
+
+        EncoderSection defaultSect{};
+        defaultSect.index = 0;
+        defaultSect.attribs = Section::kDefaultAttribs;
+        defaultSect.align = Section::kDefaultAlign;
+        defaultSect.address = newBase;
+        defaultSect.nameId = programState.symbolNames.find(".text");
+        if (defaultSect.nameId == StringPool::Id::Invalid)
+        {
+            defaultSect.nameId = programState.symbolNames.acquire(".text");
+        }
+
+        const auto beginPass = [&]() {
+            state.buffer.clear();
+
+            encoderCtx.needsExtraPass = false;
+            encoderCtx.pass++;
+            state.resizedNodes = 0;
+            encoderCtx.offset = 0;
+            encoderCtx.va = newBase;
+            encoderCtx.nodeIndex = 0;
+            encoderCtx.sectionIndex = 0;
+
+            // Setup default section.
+            encoderCtx.sections.clear();
+            encoderCtx.sections.push_back(defaultSect);
+        };
+
+        const auto endPass = [&]() -> Error {
+            if (state.buffer.hasFailed())
+            {
+                return ErrorCode::OutOfMemory;
+            }
+
+            const auto newSize = static_cast<int32_t>(state.buffer.size());
+            codeDiff = newSize - codeSize;
+            codeSize = newSize;
+
+            if (stats != nullptr)
+            {
+                stats->resizedNodesPerPass.push_back(state.resizedNodes);
+            }
+
+            return ErrorCode::None;
+        };
+
+        const auto serializeSingle = [&](const Node* node) -> Error {
+            if ((state.hasLayout || state.previous != nullptr) && reuseEncodedNode(state, node))
+            {
+                return ErrorCode::None;
+            }
+
+            const auto status = node->visit([&](auto&& n) { return serializeNode(programState, state, n); });
+            if (status != ErrorCode::None)
+            {
+                const auto fmtOptions = formatter::Options::HexImmediates | formatter::Options::HexOffsets;
+                const auto nodeString = formatter::toString(program, node, fmtOptions);
 
-        std::int32_t codeDiff = 0;
-        std::int32_t codeSize = 0;
+                char msg[256];
+                std::snprintf(
+                    msg, sizeof(msg), "Error at node \"%s\" with id %u: %s", nodeString.c_str(),
+                    static_cast<std::uint32_t>(node->getId()), status.getErrorMessage());
 
-        EncoderSection defaultSect{};
-        defaultSect.index = 0;
-        defaultSect.attribs = Section::kDefaultAttribs;
-        defaultSect.align = Section::kDefaultAlign;
-        defaultSect.address = newBase;
-        defaultSect.nameId = programState.symbolNames.acquire(".text");
+                return Error(status.getCode(), msg);
+            }
+
+            return ErrorCode::None;
+        };
 
         const auto serializePass = [&]() -> Error {
-            state.buffer.clear();
+            beginPass();
 
-            encoderCtx.needsExtraPass = false;
-            encoderCtx.pass++;
-            encoderCtx.offset = 0;
-            encoderCtx.va = newBase;
-            encoderCtx.nodeIndex = 0;
-            encoderCtx.sectionIndex = 0;
+            for (const auto* node = first; node != lastNode; node = node->getNext())
+            {
+                if (state.stream != nullptr && state.buffer.getPendingSize() >= kStreamChunkSize)
+                {
+                    if (const auto status = flushStream(state); status != ErrorCode::None)
+                    {
+                        return status;
+                    }
+                }
 
-            // Setup default section.
-            encoderCtx.sections.clear();
-            encoderCtx.sections.push_back(defaultSect);
+                if (const auto status = serializeSingle(node); status != ErrorCode::None)
+                {
+                    return status;
+                }
+            }
 
-            for (const auto* node = first; node != lastNode; node = node->getNext())
+            return endPass();
+        };
+
+        // Copies the ranges between the dirty bounds of the previous serialization as a whole, only the modified
+        // nodes and the nodes that depend on their position are serialized one by one.
+        const auto serializeCopyPass = [&]() -> Error {
+            beginPass();
+
+            const auto& previous = *_state;
+            const auto& bounds = previous.dirtyBounds;
+            const auto& singleNodes = previous.encodedSingleNodes;
+            const auto encodedCount = static_cast<std::int32_t>(previous.encodedNodes.size());
+
+            auto& nodeIds = _state->nextNodeIds;
+            auto& nextSingleNodes = _state->nextSingleNodes;
+            auto& movedRanges = _state->movedRanges;
+            nodeIds.clear();
+            nextSingleNodes.clear();
+            movedRanges.clear();
+
+            const auto* node = first;
+            while (node != nullptr)
             {
-                const auto status = node->visit([&](auto&& n) { return serializeNode(programState, state, n); });
-                if (status != ErrorCode::None)
+                const auto nodeIndex = static_cast<std::int32_t>(encoderCtx.nodeIndex);
+
+                const auto encodedIdx = previous.getEncodedIndex(node);
+                if (encodedIdx != detail::SerializerState::kInvalidNodeIndex
+                    && !std::binary_search(singleNodes.begin(), singleNodes.end(), encodedIdx))
                 {
-                    const auto fmtOptions = formatter::Options::HexImmediates | formatter::Options::HexOffsets;
-                    const auto nodeString = formatter::toString(program, node, fmtOptions);
+                    auto rangeEnd = encodedCount;
+                    if (auto it = std::upper_bound(bounds.begin(), bounds.end(), encodedIdx); it != bounds.end())
+                    {
+                        rangeEnd = std::min(rangeEnd, *it);
+                    }
+                    if (auto it = std::upper_bound(singleNodes.begin(), singleNodes.end(), encodedIdx);
+                        it != singleNodes.end())
+                    {
+                        rangeEnd = std::min(rangeEnd, *it);
+                    }
+
+                    copyEncodedRange(state, previous, encodedIdx, rangeEnd);
 
-                    char msg[256];
-                    std::snprintf(
-                        msg, sizeof(msg), "Error at node \"%s\" with id %u: %s", nodeString.c_str(),
-                        static_cast<std::uint32_t>(node->getId()), status.getErrorMessage());
+                    nodeIds.insert(
+                        nodeIds.end(), previous.encodedNodeIds.begin() + encodedIdx,
+                        previous.encodedNodeIds.begin() + rangeEnd);
+                    if (nodeIndex != encodedIdx)
+                    {
+                        movedRanges.emplace_back(nodeIndex, nodeIndex + (rangeEnd - encodedIdx));
+                    }
 
-                    return Error(status.getCode(), msg);
+                    // Nothing was inserted or removed within the range, continue after its last node.
+                    const auto lastId = static_cast<std::size_t>(previous.encodedNodeIds[rangeEnd - 1]);
+                    node = programState.nodeMap[lastId]->getNext();
+                    continue;
                 }
-            }
 
-            const auto newSize = static_cast<int32_t>(state.buffer.size());
-            codeDiff = newSize - codeSize;
-            codeSize = newSize;
+                if (const auto status = serializeSingle(node); status != ErrorCode::None)
+                {
+                    return status;
+                }
 
-            return ErrorCode::None;
+                nodeIds.push_back(node->getId());
+                if (isSingleNode(*node))
+                {
+                    nextSingleNodes.push_back(nodeIndex);
+                }
+                if (nodeIndex != encodedIdx)
+                {
+                    movedRanges.emplace_back(nodeIndex, nodeIndex + 1);
+                }
+
+                node = node->getNext();
+            }
+            assert(encoderCtx.nodeIndex == encoderCtx.nodes.size());
+
+            return endPass();
         };
 
+        // Unmodified ranges can be copied if the previous serialization covered the entire program as well.
+        const bool useCopyPass = state.previous != nullptr && _state->canCopyRanges && first == program.getHead()
+            && lastNode == nullptr;
+        if (useCopyPass)
+        {
+            auto& bounds = _state->dirtyBounds;
+            std::sort(bounds.begin(), bounds.end());
+            bounds.erase(std::unique(bounds.begin(), bounds.end()), bounds.end());
+        }
+
         // Initial.
-        if (const auto status = serializePass(); status != ErrorCode::None)
+        if (const auto status = useCopyPass ? serializeCopyPass() : serializePass(); status != ErrorCode::None)
         {
             return status;
         }
@@ -532,6 +2006,19 @@ namespace zasm
             return ErrorCode::UnresolvedLabel;
         }
 
+        // Resolve the layout without encoding, ideally the next pass is the final one.
+        if (encoderCtx.needsExtraPass)
+        {
+            if (state.buffer.moveTo(state.layoutCode))
+            {
+                state.layoutNodes = encoderCtx.nodes;
+                state.hasLayout = true;
+            }
+
+            buildLayout(programState, encoderCtx, defaultSect, first, lastNode, _state->layout);
+            relaxLayout(encoderCtx, newBase, _state->layout);
+        }
+
         // Second or more passes.
         while (encoderCtx.needsExtraPass)
         {
@@ -541,9 +2028,51 @@ namespace zasm
             }
         }
 
+        RelocationBuilder relocations(*_state, programState, _state->relocStream, stats);
+
+        // The layout is final, emit the code to the stream with an extra pass.
+        if (_state->stream != nullptr)
+        {
+            state.buffer.setMode(CodeBuffer::Mode::Stream);
+            state.stream = _state->stream;
+            state.relocations = &relocations;
+
+            if (const auto status = serializePass(); status != ErrorCode::None)
+            {
+                return status;
+            }
+            if (const auto status = flushStream(state); status != ErrorCode::None)
+            {
+                return status;
+            }
+            assert(!encoderCtx.needsExtraPass);
+        }
+
+        // The layout is final, encode straight into the sink with an extra pass. The size is known so the sink
+        // only has to grow once.
+        if (_state->sink != nullptr)
+        {
+            state.buffer.setMode(CodeBuffer::Mode::Sink);
+            state.buffer.reserve(static_cast<std::size_t>(codeSize));
+
+            if (const auto status = serializePass(); status != ErrorCode::None)
+            {
+                return status;
+            }
+            assert(!encoderCtx.needsExtraPass);
+        }
+
         // Finalize last section.
         finalizeCurSection(state);
 
+        // The copied ranges stay valid if no other pass was needed, otherwise the previous state is replaced.
+        const bool keepsCopiedRanges = useCopyPass && encoderCtx.pass == 1
+            && state.buffer.getMode() == CodeBuffer::Mode::Owned;
+        if (!keepsCopiedRanges)
+        {
+            _state->resetEncodedNodes();
+        }
+
         // Update all label information.
         _state->labels.clear();
         for (auto& labelLink : encoderCtx.labelLinks)
@@ -551,6 +2080,7 @@ namespace zasm
             const auto labelIdx = static_cast<std::size_t>(labelLink.id);
             if (labelIdx >= programState.labels.size())
             {
+                _state->resetEncodedNodes();
                 return ErrorCode::InvalidLabel;
             }
 
@@ -560,118 +2090,43 @@ namespace zasm
             labelEntry.boundAddress = labelLink.boundVA;
         }
 
-        // Generate relocation data.
-        ZydisDecoder decoder;
-        ZyanStatus decoderStatus{};
-        switch (program.getMode())
+        std::chrono::steady_clock::time_point relocStart;
+        if (stats != nullptr)
         {
-            case MachineMode::I386:
-                decoderStatus = ZydisDecoderInit(
-                    &decoder, ZYDIS_MACHINE_MODE_LONG_COMPAT_32, ZydisStackWidth::ZYDIS_STACK_WIDTH_32);
-                break;
-            case MachineMode::AMD64:
-                decoderStatus = ZydisDecoderInit(&decoder, ZYDIS_MACHINE_MODE_LONG_64, ZydisStackWidth::ZYDIS_STACK_WIDTH_64);
-                break;
-            default:
-                return ErrorCode::InvalidParameter;
-        }
-        if (decoderStatus != ZYAN_STATUS_SUCCESS)
-        {
-            // FIXME: Make this a better error.
-            return ErrorCode::InvalidMode;
+            relocStart = std::chrono::steady_clock::now();
+            stats->encodeTime = relocStart - encodeStart;
         }
 
-        _state->relocations.clear();
-        for (auto& node : encoderCtx.nodes)
+        // Generate relocation data, when streaming this was done before flushing the code.
+        if (_state->stream == nullptr)
         {
-            if (node.relocKind == RelocationType::None)
-            {
-                continue;
-            }
-
-            RelocationInfo reloc;
-            reloc.kind = node.relocKind;
-            reloc.label = node.relocLabel;
-
-            bool isExternal = false;
-            if (reloc.label != Label::Id::Invalid)
-            {
-                isExternal = isLabelExternal(programState, reloc.label);
-            }
-
-            if (node.relocData == RelocationData::Data)
-            {
-                reloc.offset = node.offset;
-                reloc.address = node.address;
-                reloc.size = toBitSize(node.length * std::numeric_limits<std::uint8_t>::digits);
-            }
-            else
+            for (const auto& node : encoderCtx.nodes)
             {
-                const std::uint8_t* data = state.buffer.data() + node.offset;
-
-                ZydisDecodedInstruction instr{};
-
-                decoderStatus = ZydisDecoderDecodeInstruction(&decoder, nullptr, data, node.length, &instr);
-                if (decoderStatus != ZYAN_STATUS_SUCCESS)
-                {
-                    // FIXME: Properly translate the error.
-                    return ErrorCode::ImpossibleRelocation;
-                }
-
-                if (node.relocData == RelocationData::Immediate)
-                {
-                    if (instr.raw.imm[0].is_relative == ZYAN_TRUE)
-                    {
-                        if (!isExternal)
-                            continue;
-
-                        reloc.relBaseOffset = instr.length - instr.raw.imm[0].offset;
-                    }
-
-                    reloc.offset = node.offset + instr.raw.imm[0].offset;
-                    reloc.address = node.address + instr.raw.imm[0].offset;
-                    reloc.size = toBitSize(instr.raw.imm[0].size);
-                }
-                else if (node.relocData == RelocationData::Memory)
+                if (const auto status = relocations.add(node, state.buffer); status != ErrorCode::None)
                 {
-                    if (node.relocKind == RelocationType::Rel32)
-                        reloc.relBaseOffset = instr.length - instr.raw.disp.offset;
-
-                    reloc.offset = node.offset + instr.raw.disp.offset;
-                    reloc.address = node.address + instr.raw.disp.offset;
-                    reloc.size = toBitSize(instr.raw.disp.size);
+                    _state->resetEncodedNodes();
+                    return status;
                 }
             }
+        }
 
-            if (isExternal)
-            {
-                // Zero out the temporary value to make it easier to spot unpatched values.
-                if (reloc.size == BitSize::_8)
-                {
-                    std::fill_n(std::begin(state.buffer) + reloc.offset, sizeof(std::uint8_t), 0U);
-                }
-                else if (reloc.size == BitSize::_16)
-                {
-                    std::fill_n(std::begin(state.buffer) + reloc.offset, sizeof(std::uint16_t), 0U);
-                }
-                else if (reloc.size == BitSize::_32)
-                {
-                    std::fill_n(std::begin(state.buffer) + reloc.offset, sizeof(std::uint32_t), 0U);
-                }
-                else if (reloc.size == BitSize::_64)
-                {
-                    std::fill_n(std::begin(state.buffer) + reloc.offset, sizeof(std::uint64_t), 0U);
-                }
-
-                _state->externalRelocations.push_back(reloc);
-            }
-            else
-            {
-                _state->relocations.push_back(reloc);
-            }
+        if (stats != nullptr)
+        {
+            stats->relocationTime = std::chrono::steady_clock::now() - relocStart;
         }
 
-        _state->code = std::move(state.buffer);
+        _state->codeSize = state.buffer.size();
+        if (state.buffer.getMode() == CodeBuffer::Mode::Owned)
+        {
+            state.buffer.moveTo(_state->code);
+        }
+        else
+        {
+            // The code only lives in the sink or stream, release what earlier serializations left behind.
+            std::vector<std::uint8_t>().swap(_state->code);
+            std::vector<std::uint8_t>().swap(_state->codeScratch);
+            std::vector<std::uint8_t>().swap(_state->layoutCode);
+        }
 
         _state->sections.clear();
         for (auto& sectionLink : encoderCtx.sections)
@@ -689,92 +2144,218 @@ namespace zasm
         }
 
         _state->base = newBase;
+        _state->passCount = encoderCtx.pass;
+
+        if (stats != nullptr)
+        {
+            stats->passCount = encoderCtx.pass;
+            stats->encodedInstructions = state.encodedInstructions;
+            stats->codeSize = _state->codeSize;
+            for (const auto& sect : encoderCtx.sections)
+            {
+                stats->sectionSizes.push_back(sect.rawSize);
+            }
+        }
+
+        if (keepsCopiedRanges)
+        {
+            // Only the nodes that are at a different position than before need a new index.
+            auto& encodedNodeIndex = _state->encodedNodeIndex;
+            if (encodedNodeIndex.size() < programState.nodeMap.size())
+            {
+                encodedNodeIndex.resize(programState.nodeMap.size(), detail::SerializerState::kInvalidNodeIndex);
+            }
+
+            std::swap(_state->encodedNodeIds, _state->nextNodeIds);
+            std::swap(_state->encodedSingleNodes, _state->nextSingleNodes);
+            for (const auto& [rangeStart, rangeEnd] : _state->movedRanges)
+            {
+                for (auto nodeIndex = rangeStart; nodeIndex < rangeEnd; ++nodeIndex)
+                {
+                    encodedNodeIndex[static_cast<std::size_t>(_state->encodedNodeIds[nodeIndex])] = nodeIndex;
+                }
+            }
+            std::swap(_state->encodedNodes, encoderCtx.nodes);
+            _state->dirtyBounds.clear();
+        }
+        else if (isIncremental && state.buffer.getMode() == CodeBuffer::Mode::Owned)
+        {
+            // Keep the encoded nodes around for the next serialization.
+            _state->encodedMode = program.getMode();
+            _state->encodedNodeIndex.assign(programState.nodeMap.size(), detail::SerializerState::kInvalidNodeIndex);
+
+            std::int32_t nodeIndex = 0;
+            for (const auto* node = first; node != lastNode; node = node->getNext())
+            {
+                _state->encodedNodeIndex[static_cast<std::size_t>(node->getId())] = nodeIndex;
+                _state->encodedNodeIds.push_back(node->getId());
+                if (isSingleNode(*node))
+                {
+                    _state->encodedSingleNodes.push_back(nodeIndex);
+                }
+                nodeIndex++;
+            }
+            std::swap(_state->encodedNodes, encoderCtx.nodes);
+
+            _state->canCopyRanges = first == program.getHead() && lastNode == nullptr;
+        }
 
         return ErrorCode::None;
     }
 
-    Error Serializer::relocate(std::int64_t newBase)
+    // Returns false if one of the 32 bit slots would not fit the new value.
+    static bool canRelocate32(const std::uint8_t* code, const std::vector<std::int32_t>& offsets, std::int64_t delta) noexcept
     {
-        if (_state->code.empty())
+        if (offsets.empty())
         {
-            return ErrorCode::EmptyState;
+            return true;
+        }
+
+        std::uint32_t minValue = std::numeric_limits<std::uint32_t>::max();
+        std::uint32_t maxValue = 0;
+        for (const auto offset : offsets)
+        {
+            std::uint32_t value{};
+            std::memcpy(&value, code + offset, sizeof(value));
+
+            minValue = std::min(minValue, value);
+            maxValue = std::max(maxValue, value);
         }
 
-        const auto oldBase = _state->base;
+        const auto newMin = static_cast<std::int64_t>(minValue) + delta;
+        const auto newMax = static_cast<std::int64_t>(maxValue) + delta;
 
-        // Make a copy of the code buffer to avoid corrupting the
-        // state in case one of the relocations fail.
-        std::vector<std::uint8_t> code = _state->code;
+        return newMin >= 0 && newMax <= std::numeric_limits<std::uint32_t>::max();
+    }
 
-        std::vector<RelocationInfo> relocs = _state->relocations;
-        for (auto& reloc : relocs)
+    static void relocate32(std::uint8_t* code, const std::vector<std::int32_t>& offsets, std::int64_t delta) noexcept
+    {
+        const auto delta32 = static_cast<std::uint32_t>(delta);
+        for (const auto offset : offsets)
         {
-            if (reloc.size == BitSize::_32)
-            {
-                std::uint32_t value{};
-                std::memcpy(&value, code.data() + reloc.offset, sizeof(value));
+            std::uint32_t value{};
+            std::memcpy(&value, code + offset, sizeof(value));
+            value += delta32;
+            std::memcpy(code + offset, &value, sizeof(value));
+        }
+    }
 
-                std::uint64_t newValue = value;
-                newValue -= oldBase;
-                newValue += newBase;
+    static void relocate64(std::uint8_t* code, const std::vector<std::int32_t>& offsets, std::int64_t delta) noexcept
+    {
+        const auto delta64 = static_cast<std::uint64_t>(delta);
+        for (const auto offset : offsets)
+        {
+            std::uint64_t value{};
+            std::memcpy(&value, code + offset, sizeof(value));
+            value += delta64;
+            std::memcpy(code + offset, &value, sizeof(value));
+        }
+    }
 
-                if (newValue > std::numeric_limits<std::uint32_t>::max())
-                {
-                    return ErrorCode::ImpossibleRelocation;
-                }
+    Error Serializer::relocate(std::int64_t newBase)
+    {
+        if (_state->code.empty())
+        {
+            return ErrorCode::EmptyState;
+        }
 
-                value = static_cast<std::uint32_t>(newValue);
-                std::memcpy(code.data() + reloc.offset, &value, sizeof(value));
-            }
-            else if (reloc.size == BitSize::_64)
-            {
-                std::uint64_t value{};
-                std::memcpy(&value, code.data() + reloc.offset, sizeof(value));
+        const auto delta = newBase - _state->base;
 
-                std::uint64_t newValue = value;
-                newValue -= oldBase;
-                newValue += newBase;
+        // Validate everything first so the state is untouched in case one of the relocations fail.
+        auto* code = _state->code.data();
+        if (!canRelocate32(code, _state->relocOffsets32, delta))
+        {
+            return ErrorCode::ImpossibleRelocation;
+        }
 
-                value = static_cast<std::uint64_t>(newValue);
-                std::memcpy(code.data() + reloc.offset, &value, sizeof(value));
-            }
+        relocate32(code, _state->relocOffsets32, delta);
+        relocate64(code, _state->relocOffsets64, delta);
 
-            reloc.address -= oldBase;
-            reloc.address += newBase;
+        for (auto& reloc : _state->relocations)
+        {
+            reloc.address += delta;
         }
 
         // Adjust external relocations.
-        std::vector<RelocationInfo> externalRelocs = _state->externalRelocations;
-        for (auto& reloc : externalRelocs)
+        for (auto& reloc : _state->externalRelocations)
         {
-            reloc.address -= oldBase;
-            reloc.address += newBase;
+            reloc.address += delta;
         }
 
         // Adjust label addresses.
-        std::vector<detail::LabelInfo> labels = _state->labels;
-        for (auto& label : labels)
+        for (auto& label : _state->labels)
         {
-            label.boundAddress -= oldBase;
-            label.boundAddress += newBase;
+            label.boundAddress += delta;
         }
 
         // Adjust sections
-        std::vector<SectionInfo> sections = _state->sections;
-        for (auto& sect : sections)
+        for (auto& sect : _state->sections)
         {
-            sect.address -= oldBase;
-            sect.address += newBase;
+            sect.address += delta;
         }
 
-        // Update state.
-        _state->code = std::move(code);
-        _state->labels = std::move(labels);
-        _state->sections = std::move(sections);
-        _state->relocations = std::move(relocs);
-        _state->externalRelocations = std::move(externalRelocs);
         _state->base = newBase;
 
+        // The relocated code no longer matches the encoded nodes.
+        _state->resetEncodedNodes();
+
+        return ErrorCode::None;
+    }
+
+    Error Serializer::relocateInto(const std::int64_t* newBases, std::uint8_t* const* buffers, std::size_t count) const
+    {
+        if (_state->code.empty())
+        {
+            return ErrorCode::EmptyState;
+        }
+        if (newBases == nullptr || buffers == nullptr)
+        {
+            return ErrorCode::InvalidParameter;
+        }
+
+        const auto* code = _state->code.data();
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            if (buffers[i] == nullptr)
+            {
+                return ErrorCode::InvalidParameter;
+            }
+            if (!canRelocate32(code, _state->relocOffsets32, newBases[i] - _state->base))
+            {
+                return ErrorCode::ImpossibleRelocation;
+            }
+        }
+
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            std::memcpy(buffers[i], code, _state->code.size());
+        }
+
+        // Each slot is read once and written to every buffer.
+        for (const auto offset : _state->relocOffsets32)
+        {
+            std::uint32_t value{};
+            std::memcpy(&value, code + offset, sizeof(value));
+
+            for (std::size_t i = 0; i < count; ++i)
+            {
+                const auto newValue = value + static_cast<std::uint32_t>(newBases[i] - _state->base);
+                std::memcpy(buffers[i] + offset, &newValue, sizeof(newValue));
+            }
+        }
+
+        for (const auto offset : _state->relocOffsets64)
+        {
+            std::uint64_t value{};
+            std::memcpy(&value, code + offset, sizeof(value));
+
+            for (std::size_t i = 0; i < count; ++i)
+            {
+                const auto newValue = value + static_cast<std::uint64_t>(newBases[i] - _state->base);
+                std::memcpy(buffers[i] + offset, &newValue, sizeof(newValue));
+            }
+        }
+
         return ErrorCode::None;
     }
 
@@ -783,9 +2364,54 @@ namespace zasm
         return _state->base;
     }
 
+    void Serializer::setEncoderCache(EncoderCache* cache) noexcept
+    {
+        _state->encoderCache = cache;
+    }
+
+    EncoderCache* Serializer::getEncoderCache() const noexcept
+    {
+        return _state->encoderCache;
+    }
+
+    void Serializer::setStatsEnabled(bool enabled) noexcept
+    {
+        _state->isStatsEnabled = enabled;
+        if (!enabled)
+        {
+            _state->stats = {};
+        }
+    }
+
+    bool Serializer::isStatsEnabled() const noexcept
+    {
+        return _state->isStatsEnabled;
+    }
+
+    const SerializerStats& Serializer::getStats() const noexcept
+    {
+        return _state->stats;
+    }
+
+    void Serializer::setThreadCount(std::size_t count) noexcept
+    {
+        _state->threadCount = count;
+        _state->threadPool.resize(count);
+    }
+
+    std::size_t Serializer::getThreadCount() const noexcept
+    {
+        return _state->threadCount;
+    }
+
+    std::int32_t Serializer::getPassCount() const noexcept
+    {
+        return _state->passCount;
+    }
+
     std::size_t Serializer::getCodeSize() const noexcept
     {
-        return _state->code.size();
+        return _state->codeSize;
     }
 
     const std::uint8_t* Serializer::getCode() const noexcept
@@ -867,9 +2493,16 @@ namespace zasm
     void Serializer::clear() noexcept
     {
         _state->base = 0;
+        _state->passCount = 0;
         _state->code.clear();
+        _state->codeSize = 0;
         _state->sections.clear();
         _state->labels.clear();
+        _state->relocations.clear();
+        _state->externalRelocations.clear();
+        _state->relocOffsets32.clear();
+        _state->relocOffsets64.clear();
+        _state->resetEncodedNodes();
     }
 
 } // namespace zasm
@@ -26,6 +26,12 @@ namespace zasm::x86
         return _cursor;
     }
 
+    void Assembler::reset() noexcept
+    {
+        _cursor = nullptr;
+        _attribState = Attribs::None;
+    }
+
     Label Assembler::createLabel(const char* name /*= nullptr*/)
     {
         return _program.createLabel(name);
@@ -199,4 +205,20 @@ namespace zasm::x86
         _cursor = node->getPrev();
     }
 
+    void Assembler::onRangeDetach(Node* first, Node* last) noexcept
+    {
+        for (auto* node = first; node != nullptr; node = node->getNext())
+        {
+            if (node == _cursor)
+            {
+                _cursor = first->getPrev();
+                return;
+            }
+            if (node == last)
+            {
+                return;
+            }
+        }
+    }
+
 } // namespace zasm::x86